@@ -29,7 +29,7 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos)
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
+static bool DeserializeBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
@@ -44,6 +44,28 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
     } catch (std::exception& e) {
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
+    return true;
+}
+
+// The block index only holds headers that were hashed and checked when they
+// were accepted, so a header read back identical to the indexed one hashes
+// to the indexed hash and does not need to go through HashQuark again.
+static bool HeaderMatchesIndex(const CBlockHeader& header, const CBlockIndex* pindex)
+{
+    const uint256 hashPrevBlock = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256(0);
+    return header.nVersion == pindex->nVersion &&
+        header.hashPrevBlock == hashPrevBlock &&
+        header.hashMerkleRoot == pindex->hashMerkleRoot &&
+        header.nTime == pindex->nTime &&
+        header.nBits == pindex->nBits &&
+        header.nNonce == pindex->nNonce &&
+        (header.nVersion < 4 || header.nAccumulatorCheckpoint == pindex->nAccumulatorCheckpoint);
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
+{
+    if (!DeserializeBlockFromDisk(block, pos))
+        return false;
 
     // Check the header
     if (block.IsProofOfWork()) {
@@ -56,13 +78,15 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos()))
+    if (!DeserializeBlockFromDisk(block, pindex->GetBlockPos()))
         return false;
-    if (block.GetHash() != pindex->GetBlockHash()) {
-        LogPrintf("%s : block=%s index=%s\n", __func__, block.GetHash(), pindex->GetBlockHash());
-        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match index");
-    }
-    return true;
+    if (HeaderMatchesIndex(block, pindex))
+        return true;
+
+    if (block.IsProofOfWork() && !CheckProofOfWork(block.GetHash(), block.nBits, Params()))
+        return error("ReadBlockFromDisk : Errors in block header");
+    LogPrintf("%s : block=%s index=%s\n", __func__, block.GetHash(), pindex->GetBlockHash());
+    return error("ReadBlockFromDisk(CBlock&, CBlockIndex*) : GetHash() doesn't match index");
 }
 
 bool BlockDiskDataReader::ReadBlock(const CBlockIndex* blockIndex, CBlock& block) const
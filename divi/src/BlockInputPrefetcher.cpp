@@ -0,0 +1,105 @@
+#include <BlockInputPrefetcher.h>
+
+#include <checkqueue.h>
+#include <primitives/block.h>
+#include <ThreadManagementHelpers.h>
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+int nInputPrefetchThreads = 0;
+static CCheckQueue<CCoinsPrefetch> prefetchqueue(16);
+
+CCoinsPrefetch::CCoinsPrefetch(
+    ): view(NULL)
+    , txid()
+    , coins(NULL)
+    , found(NULL)
+{
+}
+
+CCoinsPrefetch::CCoinsPrefetch(
+    const CCoinsView& viewIn,
+    const uint256& txidIn,
+    CCoins& coinsOut,
+    bool& foundOut
+    ): view(&viewIn)
+    , txid(txidIn)
+    , coins(&coinsOut)
+    , found(&foundOut)
+{
+}
+
+bool CCoinsPrefetch::operator()()
+{
+    *found = view->GetCoins(txid, *coins);
+    return true;
+}
+
+void CCoinsPrefetch::swap(CCoinsPrefetch& check)
+{
+    std::swap(view, check.view);
+    std::swap(txid, check.txid);
+    std::swap(coins, check.coins);
+    std::swap(found, check.found);
+}
+
+void BlockInputPrefetcher::ThreadPrefetch()
+{
+    RenameThread("divi-prefetch");
+    prefetchqueue.Thread();
+}
+
+BlockInputPrefetcher::BlockInputPrefetcher(
+    CCoinsViewCache& cache
+    ): cache_(cache)
+{
+}
+
+unsigned BlockInputPrefetcher::Prefetch(const CBlock& block)
+{
+    if (!nInputPrefetchThreads)
+        return 0u;
+
+    // Outputs created within the block are not in the database yet
+    std::set<uint256> createdInBlock;
+    std::vector<uint256> missing;
+    for (const CTransaction& tx : block.vtx) {
+        if (!tx.IsCoinBase()) {
+            for (const CTxIn& txin : tx.vin) {
+                const uint256& prevHash = txin.prevout.hash;
+                if (createdInBlock.count(prevHash) == 0 && !cache_.HaveCoinsInCache(prevHash))
+                    missing.push_back(prevHash);
+            }
+        }
+        createdInBlock.insert(tx.GetHash());
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    // A single read is not worth waking the pool for
+    if (missing.size() < 2)
+        return 0u;
+
+    std::vector<CCoins> coins(missing.size());
+    std::unique_ptr<bool[]> found(new bool[missing.size()]());
+    std::vector<CCoinsPrefetch> reads;
+    reads.reserve(missing.size());
+    for (unsigned i = 0; i < missing.size(); ++i)
+        reads.emplace_back(cache_.GetBackend(), missing[i], coins[i], found[i]);
+    {
+        CCheckQueueControl<CCoinsPrefetch> control(&prefetchqueue);
+        control.Add(reads);
+        control.Wait();
+    }
+
+    unsigned warmed = 0;
+    for (unsigned i = 0; i < missing.size(); ++i) {
+        if (!found[i])
+            continue;
+        cache_.WarmCoins(missing[i], coins[i]);
+        ++warmed;
+    }
+    return warmed;
+}
@@ -0,0 +1,46 @@
+#ifndef BLOCK_INPUT_PREFETCHER_H
+#define BLOCK_INPUT_PREFETCHER_H
+#include <coins.h>
+#include <uint256.h>
+
+class CBlock;
+
+/**
+ * Closure reading the coins of one transaction from a (thread safe) view
+ * Results are written to slots owned by the caller, one per closure
+ */
+class CCoinsPrefetch
+{
+private:
+    const CCoinsView* view;
+    uint256 txid;
+    CCoins* coins;
+    bool* found;
+
+public:
+    CCoinsPrefetch();
+    CCoinsPrefetch(const CCoinsView& viewIn, const uint256& txidIn, CCoins& coinsOut, bool& foundOut);
+
+    bool operator()();
+
+    void swap(CCoinsPrefetch& check);
+};
+
+/**
+ * Issues the database reads for all the inputs of a block that are missing
+ * from a coins cache on the prefetch threads, and warms the cache with the
+ * results, so that validation does not wait on one read per input.
+ */
+class BlockInputPrefetcher
+{
+private:
+    CCoinsViewCache& cache_;
+
+public:
+    static void ThreadPrefetch();
+    explicit BlockInputPrefetcher(CCoinsViewCache& cache);
+
+    /** Returns the number of transactions whose coins were added to the cache */
+    unsigned Prefetch(const CBlock& block);
+};
+#endif// BLOCK_INPUT_PREFETCHER_H
@@ -3,7 +3,6 @@
 #include <BlockTemplate.h>
 #include "chain.h"
 #include "coins.h"
-#include "FeeAndPriorityCalculator.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "txmempool.h"
@@ -15,6 +14,9 @@
 
 #include <Settings.h>
 
+#include <algorithm>
+#include <limits>
+
 bool IsFinalTx(const CTransaction& tx, const CChain& activeChain, int nBlockHeight = 0 , int64_t nBlockTime = 0);
 
 static unsigned int GetMaxBlockSize(const Settings& settings,unsigned int defaultMaxBlockSize, unsigned int maxBlockSizeCurrent)
@@ -41,48 +43,115 @@ static unsigned int GetBlockMinSize(const Settings& settings, unsigned int defau
     return blockMinSize;
 }
 
-//
-// Unconfirmed transactions in the memory pool often depend on other
-// transactions in the memory pool. When we select transactions from the
-// pool, we select by highest priority or fee rate, so we might consider
-// transactions that depend on transactions that aren't yet in the block.
-// The COrphan class keeps track of these 'temporary orphans' while
-// CreateBlock is figuring out which transactions to include.
-//
-class COrphan
+namespace
 {
-public:
-    const CTransaction* ptx;
-    std::set<uint256> setDependsOn;
-    CFeeRate feeRate;
-    double dPriority;
+// A mempool entry whose ancestor package state has been reduced by ancestors
+// already placed in the block being assembled. mapTx itself is never touched
+// while filling a template; the reduced scores live here instead.
+struct CTxMemPoolModifiedEntry {
+    CTxMemPoolModifiedEntry(CTxMemPool::txiter entry)
+    {
+        iter = entry;
+        nSizeWithAncestors = entry->GetSizeWithAncestors();
+        nModFeesWithAncestors = entry->GetModFeesWithAncestors();
+    }
+
+    CTxMemPool::txiter iter;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+};
 
-    COrphan(const CTransaction* ptxIn) : ptx(ptxIn), feeRate(0), dPriority(0)
+struct modifiedentry_iter {
+    typedef CTxMemPool::txiter result_type;
+    result_type operator() (const CTxMemPoolModifiedEntry &entry) const
     {
+        return entry.iter;
     }
 };
 
-class TxPriorityCompare
-{
-    bool byFee;
+// Same ordering as CompareTxMemPoolEntryByAncestorFee, on the reduced state
+struct CompareModifiedEntry {
+    bool operator()(const CTxMemPoolModifiedEntry &a, const CTxMemPoolModifiedEntry &b) const
+    {
+        double f1 = (double)a.nModFeesWithAncestors * b.nSizeWithAncestors;
+        double f2 = (double)b.nModFeesWithAncestors * a.nSizeWithAncestors;
+        if (f1 == f2) {
+            return CTxMemPool::CompareIteratorByHash()(a.iter, b.iter);
+        }
+        return f1 > f2;
+    }
+};
+
+// Orders a package so that every transaction follows its in-package parents
+struct CompareTxIterByAncestorCount {
+    bool operator()(const CTxMemPool::txiter &a, const CTxMemPool::txiter &b) const
+    {
+        if (a->GetCountWithAncestors() != b->GetCountWithAncestors())
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        return CTxMemPool::CompareIteratorByHash()(a, b);
+    }
+};
 
-public:
-    TxPriorityCompare(bool _byFee) : byFee(_byFee) {}
+typedef boost::multi_index_container<
+    CTxMemPoolModifiedEntry,
+    boost::multi_index::indexed_by<
+        boost::multi_index::ordered_unique<
+            modifiedentry_iter,
+            CTxMemPool::CompareIteratorByHash
+        >,
+        boost::multi_index::ordered_non_unique<
+            boost::multi_index::identity<CTxMemPoolModifiedEntry>,
+            CompareModifiedEntry
+        >
+    >
+> indexed_modified_transaction_set;
+
+typedef indexed_modified_transaction_set::nth_index<0>::type::iterator modtxiter;
+typedef indexed_modified_transaction_set::nth_index<1>::type::iterator modtxscoreiter;
+
+struct update_for_parent_inclusion
+{
+    update_for_parent_inclusion(CTxMemPool::txiter it) : iter(it) {}
 
-    bool operator()(const TxPriority& a, const TxPriority& b)
+    void operator() (CTxMemPoolModifiedEntry &e)
     {
-        if (byFee) {
-            if (a.get<1>() == b.get<1>())
-                return a.get<0>() < b.get<0>();
-            return a.get<1>() < b.get<1>();
-        } else {
-            if (a.get<0>() == b.get<0>())
-                return a.get<1>() < b.get<1>();
-            return a.get<0>() < b.get<0>();
-        }
+        e.nModFeesWithAncestors -= iter->GetModifiedFee();
+        e.nSizeWithAncestors -= iter->GetTxSize();
     }
+
+    CTxMemPool::txiter iter;
 };
 
+/**
+ * Remove the ancestor state of newly included transactions from all of their
+ * in-mempool descendants still outside the block.
+ */
+void UpdatePackagesForAdded(
+    const CTxMemPool& mempool,
+    const CTxMemPool::setEntries& inBlock,
+    const std::vector<CTxMemPool::txiter>& alreadyAdded,
+    indexed_modified_transaction_set& mapModifiedTx)
+{
+    for (const CTxMemPool::txiter& it : alreadyAdded) {
+        CTxMemPool::setEntries descendants;
+        mempool.CalculateDescendants(it, descendants);
+        for (CTxMemPool::txiter desc : descendants) {
+            if (inBlock.count(desc))
+                continue;
+            modtxiter mit = mapModifiedTx.find(desc);
+            if (mit == mapModifiedTx.end()) {
+                CTxMemPoolModifiedEntry modEntry(desc);
+                modEntry.nSizeWithAncestors -= it->GetTxSize();
+                modEntry.nModFeesWithAncestors -= it->GetModifiedFee();
+                mapModifiedTx.insert(modEntry);
+            } else {
+                mapModifiedTx.modify(mit, update_for_parent_inclusion(it));
+            }
+        }
+    }
+}
+} // anonymous namespace
+
 BlockMemoryPoolTransactionCollector::BlockMemoryPoolTransactionCollector(
     const Settings& settings,
     CCoinsViewCache* baseCoinsViewCache,
@@ -104,247 +173,293 @@ BlockMemoryPoolTransactionCollector::BlockMemoryPoolTransactionCollector(
 
 }
 
-void BlockMemoryPoolTransactionCollector::RecordOrphanTransaction (
-    std::shared_ptr<COrphan>& porphan,
-    const CTransaction& tx,
-    const CTxIn& txin,
-    DependingTransactionsMap& dependentTransactions) const
-{
-    if (porphan == nullptr)
-        porphan = std::make_shared<COrphan>(&tx);
-    dependentTransactions[txin.prevout.hash].push_back(porphan);
-    porphan->setDependsOn.insert(txin.prevout.hash);
-}
-
-void BlockMemoryPoolTransactionCollector::ComputeTransactionPriority (
-    double& dPriority,
-    const CTransaction& tx,
-    CAmount nTotalIn,
-    COrphan* porphan,
-    std::vector<TxPriority>& vecPriority,
-    const CTransaction* mempoolTx) const
+PrioritizedTransactionData::PrioritizedTransactionData(
+    ): tx(nullptr)
+    , nTxSigOps(0u)
 {
-    unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-    dPriority = FeeAndPriorityCalculator::instance().ComputePriority(tx,dPriority, nTxSize);
-
-    uint256 hash = tx.GetHash();
-    mempool_.ApplyDeltas(hash, dPriority, nTotalIn);
-
-    CFeeRate feeRate(nTotalIn - tx.GetValueOut(), nTxSize);
-
-    if (porphan) {
-        porphan->dPriority = dPriority;
-        porphan->feeRate = feeRate;
-    } else
-        vecPriority.push_back(TxPriority(dPriority, feeRate, mempoolTx));
 }
-
-void BlockMemoryPoolTransactionCollector::AddDependingTransactionsToPriorityQueue (
-    DependingTransactionsMap& dependentTransactions,
-    const uint256& hash,
-    std::vector<TxPriority>& vecPriority,
-    TxPriorityCompare& comparer) const
+PrioritizedTransactionData::PrioritizedTransactionData(
+    const CTransaction& transaction,
+    unsigned txSigOps
+    ): tx(&transaction)
+    , nTxSigOps(txSigOps)
 {
-    if (dependentTransactions.count(hash)) {
-        for (auto& porphan : dependentTransactions[hash]) {
-            if (!porphan->setDependsOn.empty()) {
-                porphan->setDependsOn.erase(hash);
-                if (porphan->setDependsOn.empty()) {
-                    vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                    std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                }
-            }
-        }
-    }
 }
 
-bool BlockMemoryPoolTransactionCollector::IsFreeTransaction (
-    const uint256& hash,
-    const bool& fSortedByFee,
-    const CFeeRate& feeRate,
-    const uint64_t& nBlockSize,
-    const unsigned int& nTxSize,
-    const CTransaction& tx) const
+BlockMemoryPoolTransactionCollector::BlockFillState::BlockFillState(
+    ): inBlock()
+    , transactions()
+    , nBlockSize(1000)
+    , nBlockSigOps(100)
 {
-    double dPriorityDelta = 0;
-    CAmount nFeeDelta = 0;
-    mempool_.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
-
-    return (fSortedByFee &&
-        (dPriorityDelta <= 0) &&
-        (nFeeDelta <= 0) &&
-        (feeRate < txFeeRate_) &&
-        (nBlockSize + nTxSize >= blockMinSize_));
 }
 
-void BlockMemoryPoolTransactionCollector::AddTransactionToBlock (
-    const CTransaction& tx,
-    CBlockTemplate& blocktemplate) const
+BlockMemoryPoolTransactionCollector::CachedTransactionSet::CachedTransactionSet(
+    ): valid(false)
+    , tipHash()
+    , mempoolSequence(0u)
+    , transactions()
 {
-    blocktemplate.block.vtx.push_back(tx);
 }
 
-std::vector<TxPriority> BlockMemoryPoolTransactionCollector::PrioritizeMempoolTransactions (
+bool BlockMemoryPoolTransactionCollector::TestPackage (
+    const std::vector<CTxMemPool::txiter>& package,
     const int& nHeight,
-    DependingTransactionsMap& dependentTransactions,
-    CCoinsViewCache& view) const
+    CCoinsViewCache& packageView,
+    const BlockFillState& blockState,
+    std::vector<PrioritizedTransactionData>& packageTransactions) const
 {
-    std::vector<TxPriority> vecPriority;
-    vecPriority.reserve(mempool_.mapTx.size());
-    for (auto mi = mempool_.mapTx.begin(); mi != mempool_.mapTx.end(); ++mi) {
-        const CTransaction& tx = mi->second.GetTx();
-        if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, activeChain_, nHeight)){
-            continue;
-        }
-
-        std::shared_ptr<COrphan> porphan;
-        double dPriority = 0;
-        CAmount nTotalIn = 0;
-        bool fMissingInputs = false;
-        for (const CTxIn& txin : tx.vin) {
-
-            // Read prev transaction
-            if (!view.HaveCoins(txin.prevout.hash)) {
-                CTransaction prevTx;
-                if(!mempool_.lookupOutpoint(txin.prevout.hash, prevTx)) {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    LogPrintf("ERROR: mempool transaction missing input\n");
-                    fMissingInputs = true;
-                    break;
-                }
-
-                // Has to wait for dependencies
-                RecordOrphanTransaction(porphan, tx, txin, dependentTransactions);
-
-                nTotalIn += prevTx.vout[txin.prevout.n].nValue;
-                continue;
-            }
+    const unsigned int constexpr nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
+    uint64_t nPackageSize = 0;
+    unsigned int nPackageSigOps = 0;
+    packageTransactions.clear();
+    for (const CTxMemPool::txiter& it : package) {
+        const CTransaction& tx = it->GetTx();
+        if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, activeChain_, nHeight))
+            return false;
 
-            const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-            assert(coins);
+        nPackageSize += it->GetTxSize();
+        if (blockState.nBlockSize + nPackageSize >= blockMaxSize_)
+            return false;
 
-            CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
-            nTotalIn += nValueIn;
+        if (!packageView.HaveInputs(tx))
+            return false;
 
-            int nConf = nHeight - coins->nHeight;
+        const uint256& hash = tx.GetHash();
+        std::map<uint256, unsigned int>::const_iterator verified = verifiedTransactions_.find(hash);
+        const bool fVerified = verified != verifiedTransactions_.end();
+        unsigned int nTxSigOps = fVerified? verified->second : GetLegacySigOpCount(tx) + GetP2SHSigOpCount(tx, packageView);
+        nPackageSigOps += nTxSigOps;
+        if (blockState.nBlockSigOps + nPackageSigOps >= nMaxBlockSigOps)
+            return false;
 
-            dPriority += (double)nValueIn * nConf;
-        }
-        if (fMissingInputs) {
-            continue;
+        // Note that flags: we don't want to set mempool/IsStandard()
+        // policy here, but we still have to ensure that the block we
+        // create only contains transactions that are valid in new blocks.
+        // A txid commits to its prevouts, so a pass stays valid for as long
+        // as those inputs are available.
+        if (!fVerified) {
+            CValidationState state;
+            if (!CheckInputs(tx, state, packageView, blockIndexMap_, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
+                return false;
+            verifiedTransactions_.insert(std::make_pair(hash, nTxSigOps));
         }
-        ComputeTransactionPriority(dPriority, tx, nTotalIn, porphan.get(), vecPriority, &mi->second.GetTx());
+
+        CTxUndo txundo;
+        UpdateCoinsWithTransaction(tx, packageView, txundo, nHeight);
+        packageTransactions.emplace_back(tx, nTxSigOps);
     }
-    return vecPriority;
+    return true;
 }
 
-void BlockMemoryPoolTransactionCollector::PrioritizeFeePastPrioritySize
-(
-    std::vector<TxPriority>& vecPriority,
-    bool& fSortedByFee,
-    TxPriorityCompare& comparer,
-    const uint64_t& nBlockSize,
-    const unsigned int& nTxSize,
-    double& dPriority) const
+void BlockMemoryPoolTransactionCollector::AddPackageToBlock (
+    const std::vector<CTxMemPool::txiter>& package,
+    const std::vector<PrioritizedTransactionData>& packageTransactions,
+    BlockFillState& blockState) const
 {
-    if (!fSortedByFee &&
-            ((nBlockSize + nTxSize >= blockPrioritySize_) || !AllowFree(dPriority))) {
-        fSortedByFee = true;
-        comparer = TxPriorityCompare(fSortedByFee);
-        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+    for (unsigned i = 0; i < package.size(); ++i) {
+        blockState.inBlock.insert(package[i]);
+        blockState.transactions.push_back(packageTransactions[i]);
+        blockState.nBlockSize += package[i]->GetTxSize();
+        blockState.nBlockSigOps += packageTransactions[i].nTxSigOps;
     }
 }
 
-PrioritizedTransactionData::PrioritizedTransactionData(
-    ): tx(nullptr)
-    , nTxSigOps(0u)
-{
-}
-PrioritizedTransactionData::PrioritizedTransactionData(
-    const CTransaction& transaction,
-    unsigned txSigOps
-    ): tx(&transaction)
-    , nTxSigOps(txSigOps)
+void BlockMemoryPoolTransactionCollector::AddTransactionToBlock (
+    const CTransaction& tx,
+    CBlockTemplate& blocktemplate) const
 {
+    blocktemplate.block.vtx.push_back(tx);
 }
 
-std::vector<PrioritizedTransactionData> BlockMemoryPoolTransactionCollector::PrioritizeTransactions(
-    std::vector<TxPriority>& vecPriority,
+void BlockMemoryPoolTransactionCollector::AddPriorityTransactions (
     const int& nHeight,
     CCoinsViewCache& view,
-    DependingTransactionsMap& dependentTransactions) const
+    BlockFillState& blockState) const
 {
-    std::vector<PrioritizedTransactionData> prioritizedTransactions;
-
-    // Largest block you're willing to create:
-    // How much of the block should be dedicated to high-priority transactions,
-    // included regardless of the fees they pay
-    // Minimum block size you want to create; block will be filled with free transactions
-    // until there are no more or the block reaches this size:
-
-    uint64_t nBlockSize = 1000;
-    int nBlockSigOps = 100;
-    const unsigned int constexpr nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
-    bool fSortedByFee = (blockPrioritySize_ <= 0);
-
-    TxPriorityCompare comparer(fSortedByFee);
+    if (blockPrioritySize_ == 0)
+        return;
+
+    // Coin age priority grows with the chain height, so unlike the fee rate
+    // it cannot be kept sorted in the mempool and is computed here.
+    typedef std::pair<double, CTxMemPool::txiter> TxCoinAgePriority;
+    auto comparer = [](const TxCoinAgePriority& a, const TxCoinAgePriority& b) {
+        if (a.first == b.first)
+            return CTxMemPool::CompareIteratorByHash()(b.second, a.second);
+        return a.first < b.first;
+    };
+    std::vector<TxCoinAgePriority> vecPriority;
+    vecPriority.reserve(mempool_.mapTx.size());
+    for (CTxMemPool::txiter mi = mempool_.mapTx.begin(); mi != mempool_.mapTx.end(); ++mi) {
+        double dPriority = mi->GetPriority(nHeight);
+        CAmount dummy;
+        mempool_.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
+        if (AllowFree(dPriority))
+            vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
+    }
     std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
 
+    // Transactions whose in-mempool parents are not in the block yet
+    std::map<CTxMemPool::txiter, double, CTxMemPool::CompareIteratorByHash> waitPriMap;
+    std::vector<CTxMemPool::txiter> package(1);
+    std::vector<PrioritizedTransactionData> packageTransactions;
     while (!vecPriority.empty()) {
-        // Take highest priority transaction off the priority queue:
-        double dPriority = vecPriority.front().get<0>();
-        CFeeRate feeRate = vecPriority.front().get<1>();
-        const CTransaction& tx = *(vecPriority.front().get<2>());
-
+        const double dPriority = vecPriority.front().first;
+        CTxMemPool::txiter iter = vecPriority.front().second;
         std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
         vecPriority.pop_back();
 
-        // Size limits
-        unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-        // Legacy limits on sigOps:
-        unsigned int nTxSigOps = GetLegacySigOpCount(tx);
-        // Skip free transactions if we're past the minimum block size:
-        const uint256& hash = tx.GetHash();
-        if (nBlockSize + nTxSize >= blockMaxSize_ ||
-            nBlockSigOps + nTxSigOps >= nMaxBlockSigOps||
-            IsFreeTransaction(hash, fSortedByFee, feeRate, nBlockSize, nTxSize, tx))
-        {
+        if (blockState.inBlock.count(iter))
             continue;
+
+        bool fParentsInBlock = true;
+        for (CTxMemPool::txiter parent : mempool_.GetMemPoolParents(iter)) {
+            if (!blockState.inBlock.count(parent)) {
+                fParentsInBlock = false;
+                break;
+            }
         }
-        // Prioritise by fee once past the priority size or we run out of high-priority
-        // transactions:
-        PrioritizeFeePastPrioritySize(vecPriority, fSortedByFee, comparer, nBlockSize, nTxSize, dPriority);
-        if (!view.HaveInputs(tx)) {
+        if (!fParentsInBlock) {
+            waitPriMap.insert(std::make_pair(iter, dPriority));
             continue;
         }
-        nTxSigOps += GetP2SHSigOpCount(tx, view);
-        if (nBlockSigOps + nTxSigOps >= nMaxBlockSigOps) {
+
+        if (blockState.nBlockSize + iter->GetTxSize() >= blockPrioritySize_)
+            break;
+
+        package[0] = iter;
+        CCoinsViewCache packageView(&view);
+        if (!TestPackage(package, nHeight, packageView, blockState, packageTransactions))
             continue;
+        packageView.Flush();
+        AddPackageToBlock(package, packageTransactions, blockState);
+
+        for (CTxMemPool::txiter child : mempool_.GetMemPoolChildren(iter)) {
+            auto wpiter = waitPriMap.find(child);
+            if (wpiter != waitPriMap.end()) {
+                vecPriority.push_back(TxCoinAgePriority(wpiter->second, child));
+                std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                waitPriMap.erase(wpiter);
+            }
         }
+    }
+}
 
-        // Note that flags: we don't want to set mempool/IsStandard()
-        // policy here, but we still have to ensure that the block we
-        // create only contains transactions that are valid in new blocks.
-        CValidationState state;
-        if (!CheckInputs(tx, state, view, blockIndexMap_, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true)) {
+void BlockMemoryPoolTransactionCollector::AddPackageTransactions (
+    const int& nHeight,
+    CCoinsViewCache& view,
+    BlockFillState& blockState) const
+{
+    // Entries whose ancestors were partly included by the priority phase or by
+    // an earlier package, scored on what is left of their package.
+    indexed_modified_transaction_set mapModifiedTx;
+    // Packages that could not be added; their descendants are skipped too.
+    CTxMemPool::setEntries failedTx;
+
+    std::vector<CTxMemPool::txiter> alreadyAdded(blockState.inBlock.begin(), blockState.inBlock.end());
+    UpdatePackagesForAdded(mempool_, blockState.inBlock, alreadyAdded, mapModifiedTx);
+
+    auto skipMapTxEntry = [&](CTxMemPool::txiter it) {
+        return mapModifiedTx.count(it) || blockState.inBlock.count(it) || failedTx.count(it);
+    };
+
+    const auto& ancestorIndex = mempool_.mapTx.get<ancestor_score>();
+    auto mi = ancestorIndex.begin();
+    std::vector<PrioritizedTransactionData> packageTransactions;
+    while (mi != ancestorIndex.end() || !mapModifiedTx.empty()) {
+        if (mi != ancestorIndex.end() && skipMapTxEntry(mempool_.mapTx.project<0>(mi))) {
+            ++mi;
             continue;
         }
 
-        prioritizedTransactions.emplace_back(tx, nTxSigOps);
-        nBlockSize += nTxSize;
-        nBlockSigOps += nTxSigOps;
+        // Take the better of the next unmodified entry and the best modified one
+        bool fUsingModified = false;
+        CTxMemPool::txiter iter;
+        modtxscoreiter modit = mapModifiedTx.get<1>().begin();
+        if (mi == ancestorIndex.end()) {
+            iter = modit->iter;
+            fUsingModified = true;
+        } else {
+            iter = mempool_.mapTx.project<0>(mi);
+            if (modit != mapModifiedTx.get<1>().end() &&
+                    CompareModifiedEntry()(*modit, CTxMemPoolModifiedEntry(iter))) {
+                iter = modit->iter;
+                fUsingModified = true;
+            } else {
+                ++mi;
+            }
+        }
+
+        uint64_t packageSize = iter->GetSizeWithAncestors();
+        CAmount packageFees = iter->GetModFeesWithAncestors();
+        if (fUsingModified) {
+            packageSize = modit->nSizeWithAncestors;
+            packageFees = modit->nModFeesWithAncestors;
+        }
 
-        CTxUndo txundo;
-        UpdateCoinsWithTransaction(tx, view, txundo, nHeight);
+        if (packageFees < txFeeRate_.GetFee(packageSize) && blockState.nBlockSize >= blockMinSize_) {
+            // Everything else we might consider has a lower fee rate
+            break;
+        }
 
-        // Add transactions that depend on this one to the priority queue
-        AddDependingTransactionsToPriorityQueue(dependentTransactions, hash, vecPriority, comparer);
+        if (blockState.nBlockSize + packageSize >= blockMaxSize_) {
+            if (fUsingModified) {
+                mapModifiedTx.get<1>().erase(modit);
+                failedTx.insert(iter);
+            }
+            continue;
+        }
+
+        CTxMemPool::setEntries ancestors;
+        std::string dummy;
+        mempool_.CalculateMemPoolAncestors(*iter, ancestors,
+            std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max(),
+            std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max(),
+            dummy, false);
+        std::vector<CTxMemPool::txiter> package;
+        package.push_back(iter);
+        for (CTxMemPool::txiter ancestor : ancestors) {
+            if (!blockState.inBlock.count(ancestor))
+                package.push_back(ancestor);
+        }
+        std::sort(package.begin(), package.end(), CompareTxIterByAncestorCount());
+
+        CCoinsViewCache packageView(&view);
+        if (!TestPackage(package, nHeight, packageView, blockState, packageTransactions)) {
+            if (fUsingModified) {
+                mapModifiedTx.get<1>().erase(modit);
+            }
+            failedTx.insert(iter);
+            continue;
+        }
+        packageView.Flush();
+        AddPackageToBlock(package, packageTransactions, blockState);
+        for (const CTxMemPool::txiter& added : package) {
+            mapModifiedTx.erase(added);
+        }
+        UpdatePackagesForAdded(mempool_, blockState.inBlock, package, mapModifiedTx);
     }
+}
 
-    LogPrintf("CreateNewBlock(): total size %u\n", nBlockSize);
-    return prioritizedTransactions;
+void BlockMemoryPoolTransactionCollector::UpdateTransactionCache (
+    const uint256& tipHash,
+    const BlockFillState& blockState) const
+{
+    cachedTransactions_.valid = true;
+    cachedTransactions_.tipHash = tipHash;
+    cachedTransactions_.mempoolSequence = mempool_.GetTransactionsUpdated();
+    cachedTransactions_.transactions.clear();
+    cachedTransactions_.transactions.reserve(blockState.transactions.size());
+    for (const PrioritizedTransactionData& txData : blockState.transactions)
+        cachedTransactions_.transactions.push_back(*txData.tx);
+
+    // Forget transactions that have since left the mempool
+    for (auto it = verifiedTransactions_.begin(); it != verifiedTransactions_.end();) {
+        if (mempool_.mapTx.count(it->first))
+            ++it;
+        else
+            it = verifiedTransactions_.erase(it);
+    }
 }
 
 void BlockMemoryPoolTransactionCollector::AddTransactionsToBlockIfPossible (
@@ -352,23 +467,26 @@ void BlockMemoryPoolTransactionCollector::AddTransactionsToBlockIfPossible (
     CCoinsViewCache& view,
     CBlockTemplate& blocktemplate) const
 {
-    DependingTransactionsMap dependentTransactions;
-
-    std::vector<TxPriority> vecPriority =
-        PrioritizeMempoolTransactions(nHeight, dependentTransactions, view);
+    const uint256 tipHash = blocktemplate.previousBlockIndex->GetBlockHash();
+    if (cachedTransactions_.valid &&
+        cachedTransactions_.tipHash == tipHash &&
+        cachedTransactions_.mempoolSequence == mempool_.GetTransactionsUpdated())
+    {
+        for (const CTransaction& tx : cachedTransactions_.transactions)
+            AddTransactionToBlock(tx, blocktemplate);
+        return;
+    }
+    if (!cachedTransactions_.valid || cachedTransactions_.tipHash != tipHash)
+        verifiedTransactions_.clear();
 
-    std::vector<PrioritizedTransactionData> prioritizedTransactions =
-        PrioritizeTransactions(
-            vecPriority,
-            nHeight,
-            view,
-            dependentTransactions);
+    BlockFillState blockState;
+    AddPriorityTransactions(nHeight, view, blockState);
+    AddPackageTransactions(nHeight, view, blockState);
+    LogPrintf("CreateNewBlock(): total size %u\n", blockState.nBlockSize);
 
-    for(const PrioritizedTransactionData& txData: prioritizedTransactions)
-    {
-        const CTransaction& tx = *txData.tx;
+    UpdateTransactionCache(tipHash, blockState);
+    for (const CTransaction& tx : cachedTransactions_.transactions)
         AddTransactionToBlock(tx, blocktemplate);
-    }
 }
 
 bool BlockMemoryPoolTransactionCollector::CollectTransactionsIntoBlock (
@@ -387,6 +505,6 @@ bool BlockMemoryPoolTransactionCollector::CollectTransactionsIntoBlock (
         view,
         pblocktemplate);
 
-    LogPrintf("CreateNewBlock(): block tostring %s\n", block);
+    LogPrint("miner", "CreateNewBlock(): block tostring %s\n", block);
     return true;
 }
@@ -6,23 +6,22 @@
 #include <uint256.h>
 
 #include <list>
+#include <map>
 #include <memory>
 #include <set>
 #include <stdint.h>
 #include <vector>
 
-#include <boost/tuple/tuple.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 
 #include <I_BlockTransactionCollector.h>
+#include <txmempool.h>
 
 class BlockMap;
 class CTransaction;
-class CTxIn;
 class CBlock;
 class CCoinsViewCache;
 class CBlockIndex;
-class CTxMemPool;
 class CBlockTemplate;
 class CBlockHeader;
 class CFeeRate;
@@ -41,18 +40,18 @@ struct PrioritizedTransactionData
         unsigned txSigOps);
 };
 
-class COrphan;
-
-// We want to sort transactions by priority and fee rate, so:
-typedef boost::tuple<double, CFeeRate, const CTransaction*> TxPriority;
-class TxPriorityCompare;
 class CChain;
 
+/**
+ * Fills block templates from the mempool. Up to -blockprioritysize bytes go to
+ * the highest-priority transactions that qualify as free; the rest of the block
+ * is taken from the mempool's ancestor fee rate index, a package (a transaction
+ * together with its not yet included in-mempool ancestors) at a time, so no
+ * dependency graph is rebuilt and nothing is re-sorted per template.
+ */
 class BlockMemoryPoolTransactionCollector: public I_BlockTransactionCollector
 {
 private:
-    using DependingTransactionsMap = std::map<uint256, std::vector<std::shared_ptr<COrphan>>>;
-
     CCoinsViewCache* baseCoinsViewCache_;
     const CChain& activeChain_;
     const BlockMap& blockIndexMap_;
@@ -63,56 +62,73 @@ private:
     const unsigned blockPrioritySize_;
     const unsigned blockMinSize_;
 
+    /** Running totals of the template being filled */
+    struct BlockFillState
+    {
+        CTxMemPool::setEntries inBlock;
+        std::vector<PrioritizedTransactionData> transactions;
+        uint64_t nBlockSize;
+        unsigned int nBlockSigOps;
+        BlockFillState();
+    };
+
+    /**
+     * The transactions last collected, and the tip and mempool sequence
+     * (GetTransactionsUpdated) they were collected against. Staking retries
+     * with neither changed reuse them as they are.
+     */
+    struct CachedTransactionSet
+    {
+        bool valid;
+        uint256 tipHash;
+        unsigned int mempoolSequence;
+        std::vector<CTransaction> transactions;
+        CachedTransactionSet();
+    };
+    mutable CachedTransactionSet cachedTransactions_;
+    /**
+     * Sigop counts of mempool transactions that already passed the mandatory
+     * script checks on top of cachedTransactions_.tipHash. When only the
+     * mempool changed, reassembly re-verifies just the new arrivals.
+     */
+    mutable std::map<uint256, unsigned int> verifiedTransactions_;
+
 private:
-    void UpdateTime(CBlockHeader* block, const CBlockIndex* pindexPrev) const;
-    void RecordOrphanTransaction (
-        std::shared_ptr<COrphan>& porphan,
-        const CTransaction& tx,
-        const CTxIn& txin,
-        DependingTransactionsMap& mapDependers) const;
+    /**
+     * Check a package, sorted parents first, against the block so far: size,
+     * finality, inputs, sigops and mandatory script flags. On success its
+     * spends are applied to packageView and its transactions returned.
+     */
+    bool TestPackage (
+        const std::vector<CTxMemPool::txiter>& package,
+        const int& nHeight,
+        CCoinsViewCache& packageView,
+        const BlockFillState& blockState,
+        std::vector<PrioritizedTransactionData>& packageTransactions) const;
 
-    void ComputeTransactionPriority (
-        double& dPriority,
-        const CTransaction& tx,
-        CAmount nTotalIn,
-        COrphan* porphan,
-        std::vector<TxPriority>& vecPriority,
-        const CTransaction* mempoolTx) const;
-    void AddDependingTransactionsToPriorityQueue (
-        DependingTransactionsMap& mapDependers,
-        const uint256& hash,
-        std::vector<TxPriority>& vecPriority,
-        TxPriorityCompare& comparer) const;
-
-    bool IsFreeTransaction (
-        const uint256& hash,
-        const bool& fSortedByFee,
-        const CFeeRate& feeRate,
-        const uint64_t& nBlockSize,
-        const unsigned int& nTxSize,
-        const CTransaction& tx) const;
+    void AddPackageToBlock (
+        const std::vector<CTxMemPool::txiter>& package,
+        const std::vector<PrioritizedTransactionData>& packageTransactions,
+        BlockFillState& blockState) const;
 
     void AddTransactionToBlock (
         const CTransaction& tx,
         CBlockTemplate& blocktemplate) const;
 
-    std::vector<TxPriority> PrioritizeMempoolTransactions (
+    void AddPriorityTransactions (
         const int& nHeight,
-        DependingTransactionsMap& mapDependers,
-        CCoinsViewCache& view) const;
-
-    void PrioritizeFeePastPrioritySize (
-        std::vector<TxPriority>& vecPriority,
-        bool& fSortedByFee,
-        TxPriorityCompare& comparer,
-        const uint64_t& nBlockSize,
-        const unsigned int& nTxSize,
-        double& dPriority) const;
-    std::vector<PrioritizedTransactionData> PrioritizeTransactions(
-        std::vector<TxPriority>& vecPriority,
+        CCoinsViewCache& view,
+        BlockFillState& blockState) const;
+
+    void AddPackageTransactions (
         const int& nHeight,
         CCoinsViewCache& view,
-        DependingTransactionsMap& mapDependers) const;
+        BlockFillState& blockState) const;
+
+    void UpdateTransactionCache (
+        const uint256& tipHash,
+        const BlockFillState& blockState) const;
+
     void AddTransactionsToBlockIfPossible (
         const int& nHeight,
         CCoinsViewCache& view,
@@ -73,6 +73,8 @@ bool BlockTransactionChecker::Check(const CBlockRewards& nExpectedMint,bool fJus
         if (!tx.IsCoinBase())
         {
             txInputChecker_.ScheduleBackgroundThreadScriptChecking();
+            if (txInputChecker_.BackgroundScriptChecksHaveFailed())
+                return state_.DoS(100, false);
         }
         if (!CheckCoinstakeForVaults(tx, nExpectedMint, view_)) {
             return state_.DoS(100, error("%s : coinstake is invalid for vault",__func__),
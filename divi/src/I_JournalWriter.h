@@ -0,0 +1,11 @@
+#ifndef I_JOURNAL_WRITER_H
+#define I_JOURNAL_WRITER_H
+/** Receives the changes made to a cache between two snapshots of it */
+template <typename Entry>
+class I_JournalWriter
+{
+public:
+    virtual ~I_JournalWriter(){}
+    virtual void Append(const Entry& entry) = 0;
+};
+#endif // I_JOURNAL_WRITER_H
@@ -9,5 +9,9 @@ public:
         unsigned int hashproofTimestamp,
         uint256& computedProofOfStake,
         bool checkOnly) const = 0;
+    virtual void computeProofsOfStake(
+        unsigned int latestHashproofTimestamp,
+        unsigned int numberOfTimestamps,
+        uint256* computedProofsOfStake) const = 0;
 };
 #endif// I_PROOF_OF_STAKE_CALCULATOR_H
\ No newline at end of file
@@ -71,8 +71,12 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(translate("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE_SIZE, MAX_DB_CACHE_SIZE, DEFAULT_DB_CACHE_SIZE));
     strUsage += HelpMessageOpt("-loadblock=<file>", translate("Imports blocks from external blk000??.dat file") + " " + translate("on startup"));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf(translate("Set the Maximum reorg depth (default: %u)"),  defaultParameters.MaxReorganizationDepth()   ));
+    strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(translate("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
+    strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(translate("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(translate("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(translate("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-prefetchthreads=<n>", strprintf(translate("Set the number of threads reading block inputs from the coin database ahead of validation (0 to %d, 0 or 1 = disabled, default: %d)"), MAX_INPUT_PREFETCH_THREADS, DEFAULT_INPUT_PREFETCH_THREADS));
+    strUsage += HelpMessageOpt("-prevalidationthreads=<n>", strprintf(translate("Set the number of threads checking the signatures of relayed transactions and masternode messages ahead of their processing (0 to %d, 0 = disabled, default: %d)"), MAX_MESSAGE_PREVALIDATION_THREADS, DEFAULT_MESSAGE_PREVALIDATION_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(translate("Specify pid file (default: %s)"), "divid.pid"));
 #endif
@@ -165,6 +169,7 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
 
     strUsage += HelpMessageGroup(translate("Debugging/Testing options:"));
     if (settings.GetBoolArg("-help-debug", false)) {
+        strUsage += HelpMessageOpt("-checkbalanceledger", strprintf("Compare the incrementally kept wallet balances with a scan of all wallet transactions on every balance query (default: %u)", defaultParameters.DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)",defaultParameters.DefaultConsistencyChecks() ));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultParameters.DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf(translate("Only accept block chain matching built-in checkpoints (default: %u)"), 1));
@@ -195,9 +200,13 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-logips", strprintf(translate("Include IP addresses in debug output (default: %u)"), 0));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(translate("Prepend debug output with timestamp (default: %u)"), 1));
     if (settings.GetBoolArg("-help-debug", false)) {
+        strUsage += HelpMessageOpt("-limitancestorcount=<n>", strprintf(translate("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)"), DEFAULT_ANCESTOR_LIMIT));
+        strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf(translate("Do not accept transactions whose size with all in-mempool ancestors exceeds <n> kilobytes (default: %u)"), DEFAULT_ANCESTOR_SIZE_LIMIT));
+        strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf(translate("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)"), DEFAULT_DESCENDANT_LIMIT));
+        strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf(translate("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u)."), DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf(translate("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:%u)"), 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf(translate("Require high priority for relaying free or low-fee transactions (default:%u)"), 1));
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(translate("Limit size of signature cache to <n> entries (default: %u)"), 50000));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(translate("Limit size of signature cache to <n> megabytes (default: %u)"), DEFAULT_MAX_SIG_CACHE_SIZE));
         strUsage += HelpMessageOpt("-acceptnonstandard", translate("Relay non-standard transactions"));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(translate("Fees (in DIV/Kb) smaller than this are considered zero fee for relaying (default: %s)"), FormatMoney( DEFAULT_TX_RELAY_FEE_PER_KILOBYTE )));
@@ -216,6 +225,7 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(translate("Staking options:"));
     strUsage += HelpMessageOpt("-staking=<n>", strprintf(translate("Enable staking functionality (0-1, default: %u)"), 1));
+    strUsage += HelpMessageOpt("-stakingthreads=<n>", strprintf(translate("Set the number of threads searching for a stake kernel (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), MAX_STAKING_THREADS, DEFAULT_STAKING_THREADS));
     if (settings.GetBoolArg("-help-debug", false)) {
         strUsage += HelpMessageOpt("-printstakemodifier", translate("Display the stake modifier calculations in the debug.log file."));
         strUsage += HelpMessageOpt("-printcoinstake", translate("Display verbose coin stake messages in the debug.log file."));
@@ -250,7 +260,8 @@ std::string HelpMessage(HelpMessageMode mode,const Settings& settings, const CCh
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", translate("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(translate("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 51473, 51475));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", translate("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
-    strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(translate("Set the number of threads to service RPC calls (default: %d)"), 4));
+    strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(translate("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_RPC_THREADS));
+    strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf(translate("Set the depth of the work queue to service RPC calls (default: %d)"), DEFAULT_RPC_WORK_QUEUE));
     strUsage += HelpMessageOpt("-rpckeepalive", strprintf(translate("RPC support for HTTP persistent connections (default: %d)"), 1));
 
     return strUsage;
@@ -206,11 +206,38 @@ bool InitializeMasternodeIfRequested(const Settings& settings, bool transactionI
     return true;
 }
 
+namespace
+{
+std::unique_ptr<CFlatDBLog<MasternodeNetworkMessageManager>> masternodeCacheStore;
+std::unique_ptr<CFlatDBLog<MasternodePaymentData>> masternodePaymentStore;
+
+/** Compacts the journaled caches whose journals have outgrown their snapshots */
+void CompactMasternodeCaches()
+{
+    if(masternodeCacheStore && masternodeCacheStore->NeedsCompaction())
+    {
+        MasternodeNetworkMessageManager& networkMessageManager = mnModule.getNetworkMessageManager();
+        CDataStream snapshot(SER_DISK, CLIENT_VERSION);
+        bool prepared;
+        {
+            LOCK(networkMessageManager.cs);
+            prepared = masternodeCacheStore->PrepareCompaction(networkMessageManager, snapshot);
+        }
+        if(prepared) masternodeCacheStore->FinishCompaction(snapshot);
+    }
+    if(masternodePaymentStore && masternodePaymentStore->NeedsCompaction())
+    {
+        mnModule.getMasternodePayments().CompactPaymentData(*masternodePaymentStore);
+    }
+}
+}
+
 bool LoadMasternodeDataFromDisk(UIMessenger& uiMessenger,std::string pathToDataDir)
 {
     if (!fLiteMode)
     {
         MasternodeNetworkMessageManager& networkMessageManager = mnModule.getNetworkMessageManager();
+        MasternodePaymentData& masternodePaymentData = mnModule.getMasternodePaymentData();
         CNetFulfilledRequestManager& networkFulfilledRequestManager = mnModule.getNetworkFulfilledRequestManager();
         std::string strDBName;
 
@@ -223,22 +250,26 @@ bool LoadMasternodeDataFromDisk(UIMessenger& uiMessenger,std::string pathToDataD
 
         strDBName = "mncache.dat";
         uiMessenger.InitMessage("Loading masternode cache...");
-        CFlatDB<MasternodeNetworkMessageManager> flatdb1(strDBName, "magicMasternodeCache");
-        if(!flatdb1.Load(networkMessageManager)) {
+        masternodeCacheStore.reset(new CFlatDBLog<MasternodeNetworkMessageManager>(strDBName, "magicMasternodeCache"));
+        if(!masternodeCacheStore->Load(networkMessageManager)) {
             return uiMessenger.InitError("Failed to load masternode cache from", "\n" + pathToDataDir );
         }
+        networkMessageManager.SetJournal(masternodeCacheStore.get());
 
+        strDBName = "mnpayments.dat";
+        masternodePaymentStore.reset(new CFlatDBLog<MasternodePaymentData>(strDBName, "magicMasternodePaymentsCache"));
         if(networkMessageManager.masternodeCount()) {
-            MasternodePaymentData& masternodePaymentData = mnModule.getMasternodePaymentData();
-            strDBName = "mnpayments.dat";
             uiMessenger.InitMessage("Loading masternode payment cache...");
-            CFlatDB<MasternodePaymentData> flatdb2(strDBName, "magicMasternodePaymentsCache");
-            if(!flatdb2.Load(masternodePaymentData)) {
+            if(!masternodePaymentStore->Load(masternodePaymentData)) {
                 return uiMessenger.InitError("Failed to load masternode payments cache from", "\n" + pathToDataDir);
             }
         } else {
             uiMessenger.InitMessage("Masternode cache is empty, skipping payments and governance cache...");
+            if(!masternodePaymentStore->Compact(masternodePaymentData)) {
+                return uiMessenger.InitError("Failed to reset masternode payments cache in", "\n" + pathToDataDir);
+            }
         }
+        masternodePaymentData.SetJournal(masternodePaymentStore.get());
     }
     return true;
 }
@@ -246,13 +277,13 @@ void SaveMasternodeDataToDisk()
 {
     if(!fLiteMode)
     {
-        MasternodeNetworkMessageManager& networkMessageManager = mnModule.getNetworkMessageManager();
-        MasternodePaymentData& masternodePaymentData = mnModule.getMasternodePaymentData();
+        // everything the journals hold is already on disk; only compact
+        // those that would make the next startup replay too much
+        CompactMasternodeCaches();
+        if(masternodeCacheStore) masternodeCacheStore->Flush();
+        if(masternodePaymentStore) masternodePaymentStore->Flush();
+
         CNetFulfilledRequestManager& networkFulfilledRequestManager = mnModule.getNetworkFulfilledRequestManager();
-        CFlatDB<MasternodeNetworkMessageManager> flatdb1("mncache.dat", "magicMasternodeCache");
-        flatdb1.Dump(networkMessageManager);
-        CFlatDB<MasternodePaymentData> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-        flatdb2.Dump(masternodePaymentData);
         CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
         flatdb4.Dump(networkFulfilledRequestManager);
     }
@@ -434,6 +465,7 @@ void ThreadMasternodeBackgroundSync()
 
     int64_t nTimeManageStatus = 0;
     int64_t nTimeConnections = 0;
+    int64_t nTimeCompactCaches = 0;
 
     CMasternodeSync& masternodeSync = mnModule.getMasternodeSynchronization();
     CMasternodeMan& mnodeman = mnModule.getMasternodeManager();
@@ -456,6 +488,10 @@ void ThreadMasternodeBackgroundSync()
             masternodePayments.ResetRankingCache();
             FulfilledMasternodeResyncRequest();
         }
+        if (now >= nTimeCompactCaches + 60) {
+            nTimeCompactCaches = now;
+            CompactMasternodeCaches();
+        }
         if(!IsBlockchainSynced())
         {
             continue;
@@ -5,9 +5,55 @@
 #include <masternode-sync.h>
 #include <version.h>
 
+#include <algorithm>
+
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
 #define MASTERNODE_MIN_MNP_SECONDS (10 * 60)
 
+MasternodeNetworkMessageManager::JournalEntry::JournalEntry(
+    ): type(BROADCAST)
+    , broadcast()
+    , ping()
+    , collateral()
+    , peer()
+    , askAgain(0)
+{
+}
+
+MasternodeNetworkMessageManager::JournalEntry::JournalEntry(
+    const CMasternodeBroadcast& mnb
+    ): JournalEntry()
+{
+    type = BROADCAST;
+    broadcast = mnb;
+}
+
+MasternodeNetworkMessageManager::JournalEntry::JournalEntry(
+    const CMasternodePing& mnp
+    ): JournalEntry()
+{
+    type = PING;
+    ping = mnp;
+}
+
+MasternodeNetworkMessageManager::JournalEntry::JournalEntry(
+    const COutPoint& removedCollateral
+    ): JournalEntry()
+{
+    type = REMOVAL;
+    collateral = removedCollateral;
+}
+
+MasternodeNetworkMessageManager::JournalEntry::JournalEntry(
+    const CNetAddr& askedPeer,
+    int64_t askAgainTime
+    ): JournalEntry()
+{
+    type = LIST_REQUEST;
+    peer = askedPeer;
+    askAgain = askAgainTime;
+}
+
 MasternodeNetworkMessageManager::MasternodeNetworkMessageManager(
     ): nDsqCount(0)
     , mAskedUsForMasternodeList()
@@ -15,6 +61,7 @@ MasternodeNetworkMessageManager::MasternodeNetworkMessageManager(
     , mWeAskedForMasternodeListEntry()
     , mapSeenMasternodeBroadcast()
     , mapSeenMasternodePing()
+    , journal_(nullptr)
     , cs()
     , cs_process_message()
     , masternodes()
@@ -50,6 +97,7 @@ void MasternodeNetworkMessageManager::clearTimedOutAndExpiredRequests(bool force
 
             clearExpiredMasternodeBroadcasts(it->vin.prevout);
             clearExpiredMasternodeEntryRequests(it->vin.prevout);
+            appendToJournal(JournalEntry(it->vin.prevout));
             it = masternodes.erase(it);
         } else {
             ++it;
@@ -176,6 +224,7 @@ bool MasternodeNetworkMessageManager::recordDsegUpdateAttempt(const CAddress& pe
 
     int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
     mWeAskedForMasternodeList[peerAddress] = askAgain;
+    appendToJournal(JournalEntry(peerAddress, askAgain));
     return true;
 }
 
@@ -231,20 +280,18 @@ bool MasternodeNetworkMessageManager::pingIsKnown(const uint256& pingHash) const
 {
     return mapSeenMasternodePing.count(pingHash) >0;
 }
-void MasternodeNetworkMessageManager::recordPing(const CMasternodePing& mnp)
+void MasternodeNetworkMessageManager::updateSeenPing(const CMasternodePing& mnp)
 {
+    AssertLockHeld(cs);
     mapSeenMasternodePing[mnp.GetHash()] = mnp;
 
     const CMasternode* pmn = nullptr;
+    for(const CMasternode& mn: masternodes)
     {
-        LOCK(cs);
-        for(const CMasternode& mn: masternodes)
+        if (mn.vin.prevout == mnp.vin.prevout)
         {
-            if (mn.vin.prevout == mnp.vin.prevout)
-            {
-                pmn = &mn;
-                break;
-            }
+            pmn = &mn;
+            break;
         }
     }
     if (pmn != nullptr)
@@ -257,11 +304,19 @@ void MasternodeNetworkMessageManager::recordPing(const CMasternodePing& mnp)
         }
     }
 }
+void MasternodeNetworkMessageManager::recordPing(const CMasternodePing& mnp)
+{
+    LOCK(cs);
+    updateSeenPing(mnp);
+    appendToJournal(JournalEntry(mnp));
+}
 void MasternodeNetworkMessageManager::recordBroadcast(const CMasternodeBroadcast& mnb)
 {
+    LOCK(cs);
     const uint256 hash = mnb.GetHash();
     if(broadcastIsKnown(hash)) return;
     mapSeenMasternodeBroadcast.emplace(hash,mnb);
+    appendToJournal(JournalEntry(mnb));
 }
 const CMasternodeBroadcast& MasternodeNetworkMessageManager::getKnownBroadcast(const uint256& broadcastHash) const
 {
@@ -281,4 +336,67 @@ const CMasternode* MasternodeNetworkMessageManager::find(const CTxIn& vin) const
             return &mn;
     }
     return nullptr;
-}
\ No newline at end of file
+}
+void MasternodeNetworkMessageManager::recordMasternodeRemoval(const COutPoint& collateral)
+{
+    LOCK(cs);
+    appendToJournal(JournalEntry(collateral));
+}
+
+void MasternodeNetworkMessageManager::appendToJournal(const JournalEntry& entry) const
+{
+    if (journal_ != nullptr)
+        journal_->Append(entry);
+}
+
+void MasternodeNetworkMessageManager::SetJournal(I_JournalWriter<JournalEntry>* journal)
+{
+    LOCK(cs);
+    journal_ = journal;
+}
+
+void MasternodeNetworkMessageManager::ApplyJournalEntry(const JournalEntry& entry)
+{
+    LOCK(cs);
+    auto findByCollateral = [this](const COutPoint& collateral) {
+        return std::find_if(masternodes.begin(), masternodes.end(),
+            [&collateral](const CMasternode& mn) { return mn.vin.prevout == collateral; });
+    };
+    switch (entry.type) {
+    case JournalEntry::BROADCAST: {
+        // entries can be replayed onto a snapshot that already has them, so
+        // never go back to an older ping than the one the masternode has
+        CMasternode mn(entry.broadcast);
+        auto it = findByCollateral(mn.vin.prevout);
+        if (it != masternodes.end()) {
+            if (it->lastPing.sigTime > mn.lastPing.sigTime)
+                mn.lastPing = it->lastPing;
+            *it = mn;
+        } else if (mn.IsEnabled()) {
+            masternodes.push_back(mn);
+        }
+        mapSeenMasternodeBroadcast.emplace(entry.broadcast.GetHash(), entry.broadcast);
+        break;
+    }
+    case JournalEntry::PING: {
+        updateSeenPing(entry.ping);
+        auto it = findByCollateral(entry.ping.vin.prevout);
+        if (it != masternodes.end() && it->lastPing.sigTime < entry.ping.sigTime)
+            it->lastPing = entry.ping;
+        break;
+    }
+    case JournalEntry::REMOVAL: {
+        auto it = findByCollateral(entry.collateral);
+        if (it != masternodes.end())
+            masternodes.erase(it);
+        clearExpiredMasternodeBroadcasts(entry.collateral);
+        clearExpiredMasternodeEntryRequests(entry.collateral);
+        break;
+    }
+    case JournalEntry::LIST_REQUEST: {
+        int64_t& askAgain = mWeAskedForMasternodeList[entry.peer];
+        askAgain = std::max(askAgain, entry.askAgain);
+        break;
+    }
+    }
+}
@@ -8,11 +8,63 @@
 #include <serialize.h>
 #include <protocol.h>
 #include <masternode.h>
+#include <I_JournalWriter.h>
 
 class CMasternodeSync;
 
 class MasternodeNetworkMessageManager
 {
+public:
+    /** A change to the masternode list, the seen broadcasts and pings or the
+     *  list requests we sent, as journaled between snapshots of the cache.  */
+    class JournalEntry
+    {
+    public:
+        enum Type : unsigned char {
+            BROADCAST,
+            PING,
+            REMOVAL,
+            LIST_REQUEST,
+        };
+
+        unsigned char type;
+        CMasternodeBroadcast broadcast;
+        CMasternodePing ping;
+        COutPoint collateral;
+        CNetAddr peer;
+        int64_t askAgain;
+
+        JournalEntry();
+        explicit JournalEntry(const CMasternodeBroadcast& mnb);
+        explicit JournalEntry(const CMasternodePing& mnp);
+        explicit JournalEntry(const COutPoint& removedCollateral);
+        JournalEntry(const CNetAddr& askedPeer, int64_t askAgainTime);
+
+        ADD_SERIALIZE_METHODS
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+        {
+            READWRITE(type);
+            switch (type) {
+            case BROADCAST:
+                READWRITE(broadcast);
+                break;
+            case PING:
+                READWRITE(ping);
+                break;
+            case REMOVAL:
+                READWRITE(collateral);
+                break;
+            case LIST_REQUEST:
+                READWRITE(peer);
+                READWRITE(askAgain);
+                break;
+            default:
+                throw std::ios_base::failure("Unknown masternode journal entry type");
+            }
+        }
+    };
+
 private:
     // Dummy variable to keep serialization consistent;
     int64_t nDsqCount;
@@ -26,7 +78,10 @@ private:
     std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
     // Keep track of all pings I've seen
     std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+    I_JournalWriter<JournalEntry>* journal_;
 
+    void appendToJournal(const JournalEntry& entry) const;
+    void updateSeenPing(const CMasternodePing& mnp);
     void clearTimedOutMasternodeListRequestsFromPeers();
     void clearTimedOutMasternodeListRequestsToPeers();
     void clearTimedOutMasternodeEntryRequests();
@@ -62,6 +117,12 @@ public:
     const CMasternodeBroadcast& getKnownBroadcast(const uint256& broadcastHash) const;
     const CMasternodePing& getKnownPing(const uint256& pingHash) const;
     const CMasternode* find(const CTxIn& vin) const;
+    /** Journals that the masternode with the given collateral was taken off the list.  */
+    void recordMasternodeRemoval(const COutPoint& collateral);
+
+    /** Sets where the changes to the cache are journaled, or stops journaling them if null.  */
+    void SetJournal(I_JournalWriter<JournalEntry>* journal);
+    void ApplyJournalEntry(const JournalEntry& entry);
 
     ADD_SERIALIZE_METHODS
     template <typename Stream, typename Operation>
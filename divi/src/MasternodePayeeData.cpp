@@ -79,6 +79,23 @@ bool CMasternodeBlockPayees::GetPayee(CScript& payee) const
     return (nVotes > -1);
 }
 
+std::vector<CScript> CMasternodeBlockPayees::GetPayeesWithVotes(int nVotesReq) const
+{
+    LOCK(cs_vecPayments);
+
+    std::vector<CScript> payees;
+    for (const auto& p : vecPayments) {
+        if (p.nVotes >= nVotesReq) payees.push_back(p.scriptPubKey);
+    }
+
+    return payees;
+}
+
+int CMasternodeBlockPayees::GetHeight() const
+{
+    return nBlockHeight;
+}
+
 bool CMasternodeBlockPayees::HasPayeeWithVotes(const CScript& payee, int nVotesReq) const
 {
     LOCK(cs_vecPayments);
@@ -52,6 +52,8 @@ public:
     bool CanVote(const COutPoint& voter) const;
     bool GetPayee(CScript& payee) const;
     bool HasPayeeWithVotes(const CScript& payee, int nVotesReq) const;
+    std::vector<CScript> GetPayeesWithVotes(int nVotesReq) const;
+    int GetHeight() const;
 
     bool IsTransactionValid(const I_BlockSubsidyProvider& subsidies,const CTransaction& txNew) const;
     std::string GetRequiredPaymentsString() const;
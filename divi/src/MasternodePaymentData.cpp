@@ -1,9 +1,13 @@
 #include <MasternodePaymentData.h>
 #include <sstream>
 
+const int MasternodePaymentData::PAID_PAYEE_MIN_VOTES = 2;
+
 MasternodePaymentData::MasternodePaymentData(
-    ): mapMasternodePayeeVotes()
+    ): journal_(nullptr)
+    , mapMasternodePayeeVotes()
     , mapMasternodeBlocks()
+    , mapPaidPayeeBlocks()
 {
 }
 
@@ -19,6 +23,74 @@ bool MasternodePaymentData::masternodeWinnerVoteIsKnown(const uint256& hash) con
     return true;
 }
 
+bool MasternodePaymentData::CountWinnerVote(const CMasternodePaymentWinner& winner)
+{
+    if (!mapMasternodePayeeVotes.emplace(winner.GetHash(), winner).second)
+        return false;
+
+    auto mit = mapMasternodeBlocks.find(winner.GetScoreHash());
+    if (mit == mapMasternodeBlocks.end()) {
+        CMasternodeBlockPayees blockPayees(winner.GetHeight());
+        mit = mapMasternodeBlocks.emplace(winner.GetScoreHash(), std::move(blockPayees)).first;
+    }
+    mit->second.CountVote(winner.vinMasternode.prevout, winner.payee);
+    RecordPayeeVote(winner.payee, winner.GetScoreHash());
+    return true;
+}
+
+bool MasternodePaymentData::RecordWinnerVote(const CMasternodePaymentWinner& winner)
+{
+    if (!CountWinnerVote(winner))
+        return false;
+    if (journal_ != nullptr)
+        journal_->Append(winner);
+    return true;
+}
+
+void MasternodePaymentData::SetJournal(I_JournalWriter<JournalEntry>* journal)
+{
+    journal_ = journal;
+}
+
+void MasternodePaymentData::ApplyJournalEntry(const JournalEntry& winner)
+{
+    CountWinnerVote(winner);
+}
+
+void MasternodePaymentData::RecordPayeeVote(const CScript& payee, const uint256& scoreHash)
+{
+    const auto mit = mapMasternodeBlocks.find(scoreHash);
+    if (mit == mapMasternodeBlocks.end() || !mit->second.HasPayeeWithVotes(payee, PAID_PAYEE_MIN_VOTES))
+        return;
+    mapPaidPayeeBlocks[payee].emplace(mit->second.GetHeight(), scoreHash);
+}
+
+void MasternodePaymentData::EraseBlockPayees(const uint256& scoreHash)
+{
+    const auto mit = mapMasternodeBlocks.find(scoreHash);
+    if (mit == mapMasternodeBlocks.end())
+        return;
+    const auto block = std::make_pair(mit->second.GetHeight(), scoreHash);
+    for (const CScript& payee : mit->second.GetPayeesWithVotes(PAID_PAYEE_MIN_VOTES)) {
+        const auto pit = mapPaidPayeeBlocks.find(payee);
+        if (pit == mapPaidPayeeBlocks.end())
+            continue;
+        pit->second.erase(block);
+        if (pit->second.empty())
+            mapPaidPayeeBlocks.erase(pit);
+    }
+    mapMasternodeBlocks.erase(mit);
+}
+
+void MasternodePaymentData::RebuildPaidPayeeBlocks()
+{
+    mapPaidPayeeBlocks.clear();
+    for (const auto& block : mapMasternodeBlocks) {
+        for (const CScript& payee : block.second.GetPayeesWithVotes(PAID_PAYEE_MIN_VOTES))
+            mapPaidPayeeBlocks[payee].emplace(block.second.GetHeight(), block.first);
+    }
+}
+
 std::string MasternodePaymentData::ToString() const
 {
     std::ostringstream info;
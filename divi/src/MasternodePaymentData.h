@@ -1,23 +1,57 @@
 #ifndef MASTERNODE_PAYMENT_DATA_H
 #define MASTERNODE_PAYMENT_DATA_H
 #include <map>
+#include <set>
 #include <uint256.h>
 #include <string>
+#include <utility>
 #include <MasternodePayeeData.h>
+#include <I_JournalWriter.h>
 
 class MasternodePaymentData
 {
+private:
+    I_JournalWriter<CMasternodePaymentWinner>* journal_;
+
+    bool CountWinnerVote(const CMasternodePaymentWinner& winner);
+
 public:
+    /** Winner votes are journaled between snapshots of the cache; pruned ones
+     *  are not, as the next pruning drops them again after a replay.  */
+    typedef CMasternodePaymentWinner JournalEntry;
+
     /** Map from the inventory hashes of mnw's to the corresponding data.  */
     std::map<uint256, CMasternodePaymentWinner> mapMasternodePayeeVotes;
     /** Map from score hashes of blocks to the corresponding winners.  */
     std::map<uint256, CMasternodeBlockPayees> mapMasternodeBlocks;
 
+    /** Votes a payee needs on a block to count as having been paid in it.  */
+    static const int PAID_PAYEE_MIN_VOTES;
+    typedef std::set<std::pair<int, uint256>> BlocksByHeight;
+    /** Reverse index of mapMasternodeBlocks: the heights and score hashes of the
+     *  blocks each payee has PAID_PAYEE_MIN_VOTES votes on.  It is not stored,
+     *  but rebuilt when the maps are read.  */
+    std::map<CScript, BlocksByHeight> mapPaidPayeeBlocks;
+
     MasternodePaymentData();
     ~MasternodePaymentData();
 
     bool masternodeWinnerVoteIsKnown(const uint256& hash) const;
 
+    /** Adds the vote and counts it for its block and payee, unless it is
+     *  already known.  Returns true if it was added.  */
+    bool RecordWinnerVote(const CMasternodePaymentWinner& winner);
+
+    /** Updates the reverse index after a vote for payee was counted on the block with the given score hash.  */
+    void RecordPayeeVote(const CScript& payee, const uint256& scoreHash);
+    /** Removes the payees of the block with the given score hash, and the block from the reverse index.  */
+    void EraseBlockPayees(const uint256& scoreHash);
+    void RebuildPaidPayeeBlocks();
+
+    /** Sets where new winner votes are journaled, or stops journaling them if null.  */
+    void SetJournal(I_JournalWriter<JournalEntry>* journal);
+    void ApplyJournalEntry(const JournalEntry& winner);
+
     void CheckAndRemove(){}
     void Clear(){}
     std::string ToString() const;
@@ -28,6 +62,8 @@ public:
     {
         READWRITE(mapMasternodePayeeVotes);
         READWRITE(mapMasternodeBlocks);
+        if (ser_action.ForRead())
+            RebuildPaidPayeeBlocks();
     }
 };
 
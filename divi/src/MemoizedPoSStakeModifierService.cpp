@@ -0,0 +1,61 @@
+#include <MemoizedPoSStakeModifierService.h>
+
+#include <chain.h>
+#include <StakingData.h>
+
+constexpr size_t MemoizedPoSStakeModifierService::DEFAULT_MAX_ENTRIES;
+
+MemoizedPoSStakeModifierService::MemoizedPoSStakeModifierService(
+    const I_PoSStakeModifierService& decorated,
+    const CChain& activeChain,
+    size_t maxEntries
+    ): decoratedStakeModifierService_(decorated)
+    , activeChain_(activeChain)
+    , maxEntries_(maxEntries)
+    , cs_cache_()
+    , chainTipOfCachedEntries_(nullptr)
+    , stakeModifierByKey_()
+    , insertionOrder_()
+{
+}
+
+std::pair<uint64_t,bool> MemoizedPoSStakeModifierService::getStakeModifier(const StakingData& stakingData) const
+{
+    const CacheKey key(stakingData.blockHashOfFirstConfirmationBlock_, stakingData.blockHashOfChainTipBlock_);
+    const CBlockIndex* chainTip = activeChain_.Tip();
+    {
+        LOCK(cs_cache_);
+        if(chainTip != chainTipOfCachedEntries_)
+        {
+            stakeModifierByKey_.clear();
+            insertionOrder_.clear();
+            chainTipOfCachedEntries_ = chainTip;
+        }
+        auto it = stakeModifierByKey_.find(key);
+        if(it != stakeModifierByKey_.end())
+        {
+            return std::make_pair(it->second,true);
+        }
+    }
+
+    const std::pair<uint64_t,bool> stakeModifier = decoratedStakeModifierService_.getStakeModifier(stakingData);
+    if(!stakeModifier.second || maxEntries_ == 0u) return stakeModifier;
+
+    LOCK(cs_cache_);
+    if(chainTip == chainTipOfCachedEntries_ && stakeModifierByKey_.emplace(key, stakeModifier.first).second)
+    {
+        insertionOrder_.push_back(key);
+        if(insertionOrder_.size() > maxEntries_)
+        {
+            stakeModifierByKey_.erase(insertionOrder_.front());
+            insertionOrder_.pop_front();
+        }
+    }
+    return stakeModifier;
+}
+
+size_t MemoizedPoSStakeModifierService::size() const
+{
+    LOCK(cs_cache_);
+    return stakeModifierByKey_.size();
+}
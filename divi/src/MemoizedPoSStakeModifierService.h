@@ -0,0 +1,45 @@
+#ifndef MEMOIZED_POS_STAKE_MODIFIER_SERVICE_H
+#define MEMOIZED_POS_STAKE_MODIFIER_SERVICE_H
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <utility>
+#include <uint256.h>
+#include <sync.h>
+#include <I_PoSStakeModifierService.h>
+
+class StakingData;
+class CChain;
+class CBlockIndex;
+
+/**
+ * Remembers the stake modifiers found by the decorated service, keyed by the
+ * block that first confirmed the stake and the chain tip it is staked on.
+ * The legacy lookup walks the active chain, so everything is forgotten as
+ * soon as the active chain tip changes. At most maxEntries are kept.
+ */
+class MemoizedPoSStakeModifierService: public I_PoSStakeModifierService
+{
+private:
+    typedef std::pair<uint256,uint256> CacheKey;
+
+    const I_PoSStakeModifierService& decoratedStakeModifierService_;
+    const CChain& activeChain_;
+    const size_t maxEntries_;
+
+    mutable CCriticalSection cs_cache_;
+    mutable const CBlockIndex* chainTipOfCachedEntries_;
+    mutable std::map<CacheKey,uint64_t> stakeModifierByKey_;
+    mutable std::deque<CacheKey> insertionOrder_;
+
+public:
+    static constexpr size_t DEFAULT_MAX_ENTRIES = 20000u;
+
+    MemoizedPoSStakeModifierService(
+        const I_PoSStakeModifierService& decorated,
+        const CChain& activeChain,
+        size_t maxEntries = DEFAULT_MAX_ENTRIES);
+    virtual std::pair<uint64_t,bool> getStakeModifier(const StakingData& stakingData) const;
+    size_t size() const;
+};
+#endif// MEMOIZED_POS_STAKE_MODIFIER_SERVICE_H
@@ -0,0 +1,65 @@
+#include <MerkleTree.h>
+
+#include <crypto/sha256.h>
+#include <primitives/block.h>
+
+static_assert(sizeof(uint256) == 32u, "merkle levels are hashed as flat arrays of 32-byte nodes");
+
+namespace
+{
+/**
+ * Hashes the nodes of a level with numberOfNodes entries pairwise into
+ * parents. An odd last node is paired with itself. Parents may be the same
+ * array as nodes: every pair is read before its parent overwrites it.
+ * Returns whether the last two nodes of the level are identical.
+ */
+bool ComputeMerkleLevel(uint256* parents, const uint256* nodes, size_t numberOfNodes)
+{
+    const size_t numberOfPairs = numberOfNodes / 2;
+    const bool mutated = numberOfPairs > 0 && (numberOfNodes % 2) == 0 &&
+        nodes[numberOfNodes - 2] == nodes[numberOfNodes - 1];
+    SHA256D64(parents->begin(), nodes->begin(), numberOfPairs);
+    if (numberOfNodes % 2 != 0) {
+        uint256 lastPair[2] = {nodes[numberOfNodes - 1], nodes[numberOfNodes - 1]};
+        SHA256D64(parents[numberOfPairs].begin(), lastPair[0].begin(), 1);
+    }
+    return mutated;
+}
+}
+
+uint256 ComputeMerkleTree(std::vector<uint256>& tree, bool* mutated)
+{
+    const size_t numberOfLeaves = tree.size();
+    size_t numberOfNodes = numberOfLeaves;
+    for (size_t levelSize = numberOfLeaves; levelSize > 1u; levelSize = (levelSize + 1) / 2)
+        numberOfNodes += (levelSize + 1) / 2;
+    tree.resize(numberOfNodes);
+
+    bool mutation = false;
+    size_t levelStart = 0;
+    for (size_t levelSize = numberOfLeaves; levelSize > 1u; levelSize = (levelSize + 1) / 2)
+    {
+        mutation |= ComputeMerkleLevel(&tree[levelStart + levelSize], &tree[levelStart], levelSize);
+        levelStart += levelSize;
+    }
+    if (mutated) *mutated = mutation;
+    return tree.empty() ? uint256() : tree.back();
+}
+
+uint256 ComputeMerkleRoot(std::vector<uint256> leaves, bool* mutated)
+{
+    bool mutation = false;
+    for (size_t levelSize = leaves.size(); levelSize > 1u; levelSize = (levelSize + 1) / 2)
+        mutation |= ComputeMerkleLevel(&leaves[0], &leaves[0], levelSize);
+    if (mutated) *mutated = mutation;
+    return leaves.empty() ? uint256() : leaves[0];
+}
+
+uint256 BlockMerkleRoot(const CBlock& block, bool* mutated)
+{
+    std::vector<uint256> leaves;
+    leaves.reserve(block.vtx.size());
+    for (const CTransaction& tx : block.vtx)
+        leaves.push_back(tx.GetHash());
+    return ComputeMerkleRoot(std::move(leaves), mutated);
+}
@@ -0,0 +1,24 @@
+#ifndef MERKLE_TREE_H
+#define MERKLE_TREE_H
+#include <vector>
+#include <uint256.h>
+
+class CBlock;
+
+/**
+ * Extends tree, which holds the leaves of a merkle tree, with all of its
+ * inner levels in the layout of CBlock::vMerkleTree: every level follows the
+ * one below it and the root comes last. The hash pairs of a level lie back to
+ * back in memory, so each level is hashed in one multi-lane double-SHA256 pass.
+ * Returns the root, or zero for an empty tree. If non-NULL, *mutated is set
+ * when two identical hashes are paired at the end of a level (CVE-2012-2459).
+ */
+uint256 ComputeMerkleTree(std::vector<uint256>& tree, bool* mutated = nullptr);
+
+/** Same as ComputeMerkleTree, but only keeps the root, hashing each level in place. */
+uint256 ComputeMerkleRoot(std::vector<uint256> leaves, bool* mutated = nullptr);
+
+/** Merkle root of the transactions of block, for checks that do not need its vMerkleTree */
+uint256 BlockMerkleRoot(const CBlock& block, bool* mutated = nullptr);
+
+#endif// MERKLE_TREE_H
@@ -0,0 +1,151 @@
+#include <MessagePreValidator.h>
+
+#include <coins.h>
+#include <defaultValues.h>
+#include <masternode.h>
+#include <MasternodePayeeData.h>
+#include <MasternodePing.h>
+#include <obfuscation.h>
+#include <primitives/transaction.h>
+#include <script/interpreter.h>
+#include <script/sigcache.h>
+#include <script/standard.h>
+#include <spork.h>
+#include <streams.h>
+#include <sync.h>
+#include <ThreadManagementHelpers.h>
+#include <txmempool.h>
+
+#include <atomic>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+int nMessagePreValidationThreads = 0;
+
+extern CCriticalSection cs_main;
+extern CTxMemPool mempool;
+extern CCoinsViewCache* pcoinsTip;
+
+namespace
+{
+/** Messages waiting on one of the pre-validation threads */
+class PreValidationQueue
+{
+private:
+    boost::mutex mutex_;
+    boost::condition_variable condition_;
+    std::deque<std::pair<std::string, CDataStream>> messages_;
+
+public:
+    void Push(const std::string& strCommand, const CDataStream& vRecv)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            if (messages_.size() >= MAX_QUEUED_PREVALIDATION_MESSAGES)
+                return;
+            messages_.emplace_back(strCommand, vRecv);
+        }
+        condition_.notify_one();
+    }
+
+    /** Blocks until a message is queued; interruptible */
+    std::pair<std::string, CDataStream> Pop()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        while (messages_.empty())
+            condition_.wait(lock);
+        std::pair<std::string, CDataStream> message = std::move(messages_.front());
+        messages_.pop_front();
+        return message;
+    }
+};
+
+PreValidationQueue preValidationQueues[MAX_MESSAGE_PREVALIDATION_THREADS];
+std::atomic<int> nextPreValidationThread(0);
+
+/** Input scripts of a relayed transaction, checked against the coins it spends in the chain or the mempool */
+bool PreValidateTransaction(const CTransaction& tx)
+{
+    if (tx.IsCoinBase() || tx.IsCoinStake())
+        return false;
+
+    std::vector<CTxOut> spentOutputs;
+    spentOutputs.reserve(tx.vin.size());
+    {
+        LOCK2(cs_main, mempool.cs);
+        if (pcoinsTip == nullptr || mempool.exists(tx.GetHash()))
+            return false;
+        CCoinsViewMemPool view(pcoinsTip, mempool);
+        CCoins coins;
+        for (const CTxIn& txin : tx.vin) {
+            // Orphans are left to the handler thread
+            if (!view.GetCoins(txin.prevout.hash, coins) || !coins.IsAvailable(txin.prevout.n))
+                return false;
+            spentOutputs.push_back(coins.vout[txin.prevout.n]);
+        }
+    }
+
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        if (!VerifyScript(tx.vin[i].scriptSig, spentOutputs[i].scriptPubKey, STANDARD_SCRIPT_VERIFY_FLAGS, CachingTransactionSignatureChecker(&tx, i, true)))
+            return false;
+    }
+    return true;
+}
+}
+
+void MessagePreValidator::ThreadPreValidate()
+{
+    RenameThread("divi-prevalidate");
+    PreValidationQueue& queue = preValidationQueues[nextPreValidationThread++ % MAX_MESSAGE_PREVALIDATION_THREADS];
+    while (true) {
+        std::pair<std::string, CDataStream> message = queue.Pop();
+        boost::this_thread::interruption_point();
+        PreValidate(message.first, message.second);
+    }
+}
+
+bool MessagePreValidator::IsPreValidated(const std::string& strCommand)
+{
+    return strCommand == "tx" || strCommand == "mnb" || strCommand == "mnp" || strCommand == "mnw" || strCommand == "spork";
+}
+
+void MessagePreValidator::Submit(NodeId nodeId, const std::string& strCommand, const CDataStream& vRecv)
+{
+    if (!nMessagePreValidationThreads)
+        return;
+    preValidationQueues[static_cast<unsigned>(nodeId) % nMessagePreValidationThreads].Push(strCommand, vRecv);
+}
+
+bool MessagePreValidator::PreValidate(const std::string& strCommand, CDataStream& vRecv)
+{
+    // Malformed messages are reported when they are processed
+    try {
+        if (strCommand == "tx") {
+            CTransaction tx;
+            vRecv >> tx;
+            return PreValidateTransaction(tx);
+        } else if (strCommand == "mnb") {
+            CMasternodeBroadcast mnb;
+            vRecv >> mnb;
+            const bool broadcastSignatureCached = CObfuScationSigner::PreVerifySignature(mnb);
+            return CObfuScationSigner::PreVerifySignature(mnb.lastPing) && broadcastSignatureCached;
+        } else if (strCommand == "mnp") {
+            CMasternodePing mnp;
+            vRecv >> mnp;
+            return CObfuScationSigner::PreVerifySignature(mnp);
+        } else if (strCommand == "mnw") {
+            CMasternodePaymentWinner winner;
+            vRecv >> winner;
+            return CObfuScationSigner::PreVerifySignature(winner);
+        } else if (strCommand == "spork") {
+            CSporkMessage spork;
+            vRecv >> spork;
+            return spork.PreVerifySignature();
+        }
+    } catch (const std::exception&) {
+    }
+    return false;
+}
@@ -0,0 +1,28 @@
+#ifndef MESSAGE_PRE_VALIDATOR_H
+#define MESSAGE_PRE_VALIDATOR_H
+#include <NodeId.h>
+
+#include <string>
+
+class CDataStream;
+
+/**
+ * Checks the signatures of relayed transactions, masternode messages and
+ * sporks on a pool of threads while they wait in their peer's receive queue,
+ * recording the results in the signature cache. Processing the messages
+ * stays serialized on the message handler thread, where the checks are then
+ * cache lookups. A peer's messages always go to the same thread, in order.
+ */
+class MessagePreValidator
+{
+public:
+    static void ThreadPreValidate();
+
+    /** Whether messages of this command benefit from pre-validation */
+    static bool IsPreValidated(const std::string& strCommand);
+    /** Queues a copy of the message payload; dropped if the thread is backed up */
+    static void Submit(NodeId nodeId, const std::string& strCommand, const CDataStream& vRecv);
+    /** Checks the message on the calling thread. Returns whether anything was cached */
+    static bool PreValidate(const std::string& strCommand, CDataStream& vRecv);
+};
+#endif// MESSAGE_PRE_VALIDATOR_H
@@ -29,6 +29,7 @@ CNetMessage::CNetMessage(int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersion
     nHdrPos = 0;
     nDataPos = 0;
     nTime = 0;
+    fPreValidationQueued = false;
 }
 
 bool CNetMessage::complete() const
@@ -43,6 +43,7 @@ public:
     CDataStream vRecv; // received message data
     unsigned int nDataPos;
     int64_t nTime; // time (in microseconds) of message receipt.
+    bool fPreValidationQueued; // handed to the pre-validation threads already
 
     CNetMessage(int nTypeIn, int nVersionIn);
     bool complete() const;
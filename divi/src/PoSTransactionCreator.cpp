@@ -17,6 +17,10 @@
 #include <utiltime.h>
 #include <StakableCoin.h>
 #include <timedata.h>
+#include <StakeSearchPool.h>
+#include <defaultValues.h>
+
+#include <atomic>
 
 class StakedCoins
 {
@@ -66,11 +70,14 @@ PoSTransactionCreator::PoSTransactionCreator(
     , wallet_(wallet)
     , hashedBlockTimestamps_(hashedBlockTimestamps)
     , hashproofTimestampMinimumValue_(0)
+    , stakeSearchPool_(new StakeSearchPool(
+        ResolveStakingThreadCount(settings_.GetArg("-stakingthreads", DEFAULT_STAKING_THREADS))))
 {
 }
 
 PoSTransactionCreator::~PoSTransactionCreator()
 {
+    stakeSearchPool_.reset();
     stakedCoins_.reset();
 }
 
@@ -172,18 +179,17 @@ void PoSTransactionCreator::CombineUtxos(
     }
 }
 
-bool PoSTransactionCreator::FindHashproof(
+HashproofCreationResult PoSTransactionCreator::FindHashproof(
     const CBlockIndex* chainTip,
     unsigned int nBits,
-    unsigned int& nTxNewTime,
-    const StakableCoin& stakeData,
-    CMutableTransaction& txNew)
+    unsigned int nTxNewTime,
+    const StakableCoin& stakeData) const
 {
     BlockMap::const_iterator it = mapBlockIndex_.find(stakeData.blockHashOfFirstConfirmation);
     if (it == mapBlockIndex_.end())
     {
         LogPrint("staking","%s failed to find block index for %s\n",__func__,stakeData.blockHashOfFirstConfirmation);
-        return false;
+        return HashproofCreationResult::FailedSetup();
     }
 
     StakingData stakingData(
@@ -194,25 +200,12 @@ bool PoSTransactionCreator::FindHashproof(
         stakeData.GetTxOut().nValue,
         chainTip->GetBlockHash());
     HashproofCreationResult hashproofResult = proofGenerator_.CreateHashproofTimestamp(stakingData,nTxNewTime);
-    if(!hashproofResult.failedAtSetup())
-    {
-        hashedBlockTimestamps_.clear();
-        hashedBlockTimestamps_[chainTip->nHeight] = GetTime();
-    }
-    if (hashproofResult.succeeded())
+    if (hashproofResult.succeeded() && hashproofResult.timestamp() <= chainTip->GetMedianTimePast())
     {
-        if (hashproofResult.timestamp() <= chainTip->GetMedianTimePast())
-        {
-            LogPrintf("%s : kernel found, but it is too far in the past \n",__func__);
-            return false;
-        }
-        LogPrint("staking","%s : kernel found for %s\n",__func__, stakeData.tx->ToStringShort());
-
-        SetSuportedStakingScript(stakeData,txNew);
-        nTxNewTime = hashproofResult.timestamp();
-        return true;
+        LogPrintf("%s : kernel found, but it is too far in the past \n",__func__);
+        return HashproofCreationResult::FailedGeneration();
     }
-    return false;
+    return hashproofResult;
 }
 
 const StakableCoin* PoSTransactionCreator::FindProofOfStake(
@@ -222,24 +215,68 @@ const StakableCoin* PoSTransactionCreator::FindProofOfStake(
     unsigned int& nTxNewTime,
     bool& isVaultScript)
 {
+    std::vector<const StakableCoin*> candidates;
+    std::vector<bool> candidateIsVault;
     for (const StakableCoin& pcoin: stakedCoins_->asSet())
     {
-        if(!IsSupportedScript(pcoin.GetTxOut().scriptPubKey,isVaultScript))
+        bool vaultScript = false;
+        if(!IsSupportedScript(pcoin.GetTxOut().scriptPubKey,vaultScript))
         {
             continue;
         }
-        if(chainTip->nHeight != activeChain_.Height())
-        {
-            hashproofTimestampMinimumValue_ = 0;
-            return nullptr;
-        }
-        if(FindHashproof(chainTip,blockBits, nTxNewTime, pcoin,txCoinStake) )
+        candidates.push_back(&pcoin);
+        candidateIsVault.push_back(vaultScript);
+    }
+
+    // Candidates are checked concurrently; results are only applied once the search is over
+    std::vector<unsigned> hashproofTimestamps(candidates.size(), 0u);
+    std::atomic<bool> chainTipChanged(false);
+    std::atomic<bool> hashproofAttempted(false);
+    const unsigned initialTimestamp = nTxNewTime;
+    const size_t winningCandidate = stakeSearchPool_->search(candidates.size(),
+        [&](size_t candidateIndex) -> bool
         {
-            return &pcoin;
-        }
+            if(chainTip->nHeight != activeChain_.Height())
+            {
+                chainTipChanged = true;
+                return true;
+            }
+            const StakableCoin& stakeData = *candidates[candidateIndex];
+            HashproofCreationResult hashproofResult = FindHashproof(chainTip, blockBits, initialTimestamp, stakeData);
+            if(!hashproofResult.failedAtSetup())
+            {
+                hashproofAttempted = true;
+            }
+            if(!hashproofResult.succeeded())
+            {
+                return false;
+            }
+            hashproofTimestamps[candidateIndex] = hashproofResult.timestamp();
+            return true;
+        });
+
+    if(hashproofAttempted)
+    {
+        hashedBlockTimestamps_.clear();
+        hashedBlockTimestamps_[chainTip->nHeight] = GetTime();
+    }
+    if(chainTipChanged)
+    {
+        hashproofTimestampMinimumValue_ = 0;
+        return nullptr;
     }
-    hashproofTimestampMinimumValue_ = nTxNewTime;
-    return nullptr;
+    if(winningCandidate == candidates.size())
+    {
+        hashproofTimestampMinimumValue_ = nTxNewTime;
+        return nullptr;
+    }
+
+    const StakableCoin& stakeData = *candidates[winningCandidate];
+    LogPrint("staking","%s : kernel found for %s\n",__func__, stakeData.tx->ToStringShort());
+    SetSuportedStakingScript(stakeData,txCoinStake);
+    nTxNewTime = hashproofTimestamps[winningCandidate];
+    isVaultScript = candidateIsVault[winningCandidate];
+    return &stakeData;
 }
 
 void PoSTransactionCreator::SplitOrCombineUTXOS(
@@ -26,6 +26,8 @@ class BlockMap;
 class StakedCoins;
 struct StakableCoin;
 class Settings;
+class StakeSearchPool;
+class HashproofCreationResult;
 
 class PoSTransactionCreator: public I_PoSTransactionCreator
 {
@@ -41,6 +43,7 @@ private:
     CWallet& wallet_;
     std::map<unsigned int, unsigned int>& hashedBlockTimestamps_;
     int64_t hashproofTimestampMinimumValue_;
+    std::unique_ptr<StakeSearchPool> stakeSearchPool_;
 
     void CombineUtxos(
         const CAmount& stakeSplit,
@@ -54,12 +57,11 @@ private:
 
     bool SelectCoins();
 
-    bool FindHashproof(
+    HashproofCreationResult FindHashproof(
         const CBlockIndex* chainTip,
         unsigned int nBits,
-        unsigned int& nTxNewTime,
-        const StakableCoin& stakeData,
-        CMutableTransaction& txNew);
+        unsigned int nTxNewTime,
+        const StakableCoin& stakeData) const;
 
     const StakableCoin* FindProofOfStake(
         const CBlockIndex* chainTip,
@@ -4,6 +4,10 @@
 #include <primitives/transaction.h>
 #include <hash.h>
 #include <StakingData.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <string.h>
+#include <vector>
 
 static constexpr unsigned int MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING = 60 * 60 * 24 * 7 - 60 * 60;
 
@@ -15,6 +19,28 @@ static uint256 stakeHash(uint64_t stakeModifier, unsigned int hashproofTimestamp
     return Hash(ss.begin(), ss.end());
 }
 
+static void stakeHashes(uint64_t stakeModifier, unsigned int latestHashproofTimestamp, unsigned int numberOfTimestamps, const COutPoint& prevout, unsigned int coinstakeStartTime, uint256* hashes)
+{
+    //Same serialization as stakeHash, where only the trailing timestamp differs between kernels
+    CDataStream ss(SER_GETHASH, 0);
+    ss << stakeModifier << coinstakeStartTime << prevout.n << prevout.hash;
+    const size_t kernelSize = ss.size() + sizeof(uint32_t);
+
+    std::vector<unsigned char> kernels(kernelSize * numberOfTimestamps);
+    for(unsigned int i = 0; i < numberOfTimestamps; ++i)
+    {
+        unsigned char* kernel = &kernels[kernelSize * i];
+        memcpy(kernel, &ss[0], ss.size());
+        WriteLE32(kernel + ss.size(), latestHashproofTimestamp - i);
+    }
+    std::vector<unsigned char> digests(CSHA256::OUTPUT_SIZE * numberOfTimestamps);
+    SHA256DBatch(digests.data(), kernels.data(), kernelSize, numberOfTimestamps);
+    for(unsigned int i = 0; i < numberOfTimestamps; ++i)
+    {
+        memcpy(hashes[i].begin(), &digests[CSHA256::OUTPUT_SIZE * i], CSHA256::OUTPUT_SIZE);
+    }
+}
+
 //test hash vs target
 static bool stakeTargetHit(const uint256& hashProofOfStake, int64_t nValueIn, const uint256& bnTargetPerCoinDay, int64_t nTimeWeight)
 {
@@ -52,4 +78,11 @@ bool ProofOfStakeCalculator::computeProofOfStakeAndCheckItMeetsTarget(
     if(!checkOnly) computedProofOfStake = stakeHash(stakeModifier_,hashproofTimestamp, utxoToStake_,coinstakeStartTime_);
     int64_t coinAgeWeightOfUtxo = std::min<int64_t>(hashproofTimestamp - coinstakeStartTime_, MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING);
     return stakeTargetHit(computedProofOfStake,utxoValue_,targetPerCoinDay_, coinAgeWeightOfUtxo);
+}
+void ProofOfStakeCalculator::computeProofsOfStake(
+    unsigned int latestHashproofTimestamp,
+    unsigned int numberOfTimestamps,
+    uint256* computedProofsOfStake) const
+{
+    stakeHashes(stakeModifier_,latestHashproofTimestamp,numberOfTimestamps,utxoToStake_,coinstakeStartTime_,computedProofsOfStake);
 }
\ No newline at end of file
@@ -22,5 +22,12 @@ public:
         unsigned int hashproofTimestamp,
         uint256& computedProofOfStake,
         bool checkOnly) const;
+
+    /** Computes the proofs of stake for latestHashproofTimestamp, latestHashproofTimestamp-1, ...
+     *  in a single batch, so the kernels are hashed in parallel lanes. */
+    virtual void computeProofsOfStake(
+        unsigned int latestHashproofTimestamp,
+        unsigned int numberOfTimestamps,
+        uint256* computedProofsOfStake) const;
 };
 #endif// PROOF_OF_STAKE_CALCULATOR_H
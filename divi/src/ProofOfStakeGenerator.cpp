@@ -6,6 +6,7 @@
 #include <I_PoSStakeModifierService.h>
 #include <ProofOfStakeCalculator.h>
 #include <memory>
+#include <vector>
 
 // Start of Proof-of-Stake Computations
 HashproofCreationResult::HashproofCreationResult(
@@ -47,10 +48,12 @@ bool CreateHashProofForProofOfStake(
     const StakingData& stakingData,
     unsigned int& hashproofTimestamp)
 {
-    uint256 hashproof = 0;
+    //hash every candidate timestamp in one batch, then check them in the original order
+    std::vector<uint256> hashproofs(I_ProofOfStakeGenerator::nHashDrift);
+    calculator.computeProofsOfStake(hashproofTimestamp, I_ProofOfStakeGenerator::nHashDrift, hashproofs.data());
     for (unsigned int i = 0; i < I_ProofOfStakeGenerator::nHashDrift; i++) //iterate the hashing
     {
-        if(!calculator.computeProofOfStakeAndCheckItMeetsTarget(hashproofTimestamp,hashproof,false))
+        if(!calculator.computeProofOfStakeAndCheckItMeetsTarget(hashproofTimestamp,hashproofs[i],true))
         {
             --hashproofTimestamp;
             continue;
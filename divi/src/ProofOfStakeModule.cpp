@@ -2,6 +2,7 @@
 
 #include <LegacyPoSStakeModifierService.h>
 #include <PoSStakeModifierService.h>
+#include <MemoizedPoSStakeModifierService.h>
 #include <ProofOfStakeGenerator.h>
 #include <chainparams.h>
 
@@ -11,13 +12,15 @@ ProofOfStakeModule::ProofOfStakeModule(
     const BlockMap& blockIndexByHash
     ): legacyStakeModifierService_(new LegacyPoSStakeModifierService(blockIndexByHash,activeChain))
     , stakeModifierService_(new PoSStakeModifierService(*legacyStakeModifierService_, blockIndexByHash))
-    , proofGenerator_(new ProofOfStakeGenerator(*stakeModifierService_,chainParameters.GetMinCoinAgeForStaking()))
+    , memoizedStakeModifierService_(new MemoizedPoSStakeModifierService(*stakeModifierService_, activeChain))
+    , proofGenerator_(new ProofOfStakeGenerator(*memoizedStakeModifierService_,chainParameters.GetMinCoinAgeForStaking()))
 {
 
 }
 ProofOfStakeModule::~ProofOfStakeModule()
 {
     proofGenerator_.reset();
+    memoizedStakeModifierService_.reset();
     stakeModifierService_.reset();
     legacyStakeModifierService_.reset();
 }
@@ -0,0 +1,95 @@
+#include <RpcStateSnapshot.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <checkpoints.h>
+#include <coins.h>
+#include <main.h>
+#include <rpcserver.h>
+#include <sync.h>
+#include <txmempool.h>
+#ifdef ENABLE_WALLET
+#include <wallet.h>
+#endif
+
+extern CChain chainActive;
+extern CCriticalSection cs_main;
+extern CBlockIndex* pindexBestHeader;
+extern CCoinsViewCache* pcoinsTip;
+extern CTxMemPool mempool;
+#ifdef ENABLE_WALLET
+extern CWallet* pwalletMain;
+#endif
+
+namespace
+{
+std::shared_ptr<const RpcStateSnapshot> currentSnapshot = std::make_shared<const RpcStateSnapshot>();
+}
+
+RpcStateSnapshot::RpcStateSnapshot(
+    ): tip(nullptr)
+    , height(-1)
+    , headerHeight(-1)
+    , difficulty(0.0)
+    , verificationProgress(0.0)
+    , moneySupply(0)
+    , coinsCacheUsage(0u)
+    , hasWallet(false)
+    , walletVersion(0)
+    , balance(0)
+    , stakingBalance(0)
+    , hasMintableCoins(false)
+    , walletChangeCount(0u)
+    , mempoolSequence(0u)
+{
+}
+
+void PublishRpcStateSnapshot(std::shared_ptr<const RpcStateSnapshot> snapshot)
+{
+    std::atomic_store(&currentSnapshot, snapshot);
+}
+
+std::shared_ptr<const RpcStateSnapshot> GetRpcStateSnapshot()
+{
+    return std::atomic_load(&currentSnapshot);
+}
+
+void UpdateRpcStateSnapshot()
+{
+    static const CCheckpointServices checkpointsVerifier(GetCurrentChainCheckpoints);
+    AssertLockHeld(cs_main);
+
+    std::shared_ptr<const RpcStateSnapshot> previous = GetRpcStateSnapshot();
+    std::shared_ptr<RpcStateSnapshot> snapshot = std::make_shared<RpcStateSnapshot>(*previous);
+    CBlockIndex* tip = chainActive.Tip();
+    const bool tipChanged = tip != previous->tip;
+    if (tip && tipChanged) {
+        snapshot->tip = tip;
+        snapshot->height = tip->nHeight;
+        snapshot->bestBlockHash = tip->GetBlockHash();
+        snapshot->difficulty = GetDifficulty(tip);
+        snapshot->verificationProgress = checkpointsVerifier.GuessVerificationProgress(tip);
+        snapshot->moneySupply = tip->nMoneySupply;
+    }
+    snapshot->headerHeight = pindexBestHeader ? pindexBestHeader->nHeight : -1;
+    snapshot->coinsCacheUsage = pcoinsTip ? pcoinsTip->DynamicMemoryUsage() : 0u;
+#ifdef ENABLE_WALLET
+    if (pwalletMain) {
+        snapshot->walletVersion = pwalletMain->GetVersion();
+        const unsigned int mempoolSequence = mempool.GetTransactionsUpdated();
+        if (tipChanged || !previous->hasWallet ||
+            pwalletMain->GetBalanceChangeCount() != previous->walletChangeCount ||
+            mempoolSequence != previous->mempoolSequence)
+        {
+            LOCK(pwalletMain->cs_wallet);
+            snapshot->hasWallet = true;
+            snapshot->walletChangeCount = pwalletMain->GetBalanceChangeCount();
+            snapshot->mempoolSequence = mempoolSequence;
+            snapshot->balance = pwalletMain->GetBalance();
+            snapshot->stakingBalance = pwalletMain->GetStakingBalance();
+            snapshot->hasMintableCoins = pwalletMain->MintableCoins();
+        }
+    }
+#endif
+    PublishRpcStateSnapshot(snapshot);
+}
@@ -0,0 +1,53 @@
+#ifndef RPC_STATE_SNAPSHOT_H
+#define RPC_STATE_SNAPSHOT_H
+#include <amount.h>
+#include <uint256.h>
+#include <memory>
+#include <stdint.h>
+
+class CBlockIndex;
+
+/**
+ * Chain tip and wallet summary as of one point in time. A new snapshot is
+ * published, with cs_main held, whenever one of them may have changed;
+ * read-only RPCs answer from the latest one without taking cs_main, so they
+ * never wait behind block connection.
+ */
+struct RpcStateSnapshot
+{
+    const CBlockIndex* tip;
+    int height;
+    uint256 bestBlockHash;
+    int headerHeight;
+    double difficulty;
+    double verificationProgress;
+    CAmount moneySupply;
+
+    uint64_t coinsCacheUsage;
+
+    bool hasWallet;
+    int walletVersion;
+    CAmount balance;
+    CAmount stakingBalance;
+    bool hasMintableCoins;
+    uint64_t walletChangeCount;
+    unsigned int mempoolSequence;
+
+    RpcStateSnapshot();
+};
+
+/** Replace the snapshot served to readers; snapshots already handed out stay valid */
+void PublishRpcStateSnapshot(std::shared_ptr<const RpcStateSnapshot> snapshot);
+/** The latest published snapshot. Never blocks on cs_main */
+std::shared_ptr<const RpcStateSnapshot> GetRpcStateSnapshot();
+
+/**
+ * Capture chainActive and the wallet into a new snapshot and publish it.
+ * Requires cs_main. The wallet summary is only recomputed when the tip, the
+ * wallet's balance change count or the mempool moved since the previous
+ * snapshot (the mempool can drop wallet transactions without telling the
+ * wallet), so this is cheap to call after anything that might have changed.
+ */
+void UpdateRpcStateSnapshot();
+
+#endif // RPC_STATE_SNAPSHOT_H
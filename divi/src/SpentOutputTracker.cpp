@@ -60,6 +60,47 @@ bool SpentOutputTracker::IsSpent(const uint256& hash, unsigned int n) const
     return false;
 }
 
+/**
+ * Outpoint is spent in a block if any spending transaction
+ * is confirmed on the active chain:
+ */
+bool SpentOutputTracker::IsSpentInBlock(const uint256& hash, unsigned int n) const
+{
+    const COutPoint outpoint(hash, n);
+    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+        const CWalletTx* transactionPtr = transactionRecord_.GetWalletTx(it->second);
+        if (transactionPtr && transactionPtr->GetNumberOfBlockConfirmations() >= 1)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Outpoint is spent only in the mempool if a spending transaction
+ * is in the mempool and none is confirmed on the active chain. Its
+ * spent status can then change without the wallet being notified.
+ */
+bool SpentOutputTracker::IsSpentOnlyInMempool(const uint256& hash, unsigned int n) const
+{
+    const COutPoint outpoint(hash, n);
+    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+    bool spentInMempool = false;
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+        const CWalletTx* transactionPtr = transactionRecord_.GetWalletTx(it->second);
+        if (!transactionPtr)
+            continue;
+        const int depth = transactionPtr->GetNumberOfBlockConfirmations();
+        if (depth >= 1)
+            return false;
+        if (depth == 0)
+            spentInMempool = true;
+    }
+    return spentInMempool;
+}
+
 std::pair<CWalletTx*,bool> SpentOutputTracker::UpdateSpends(
     const CWalletTx& newlyAddedTransaction,
     int64_t orderedTransactionIndex,
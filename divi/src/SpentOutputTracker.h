@@ -34,6 +34,8 @@ public:
         int64_t orderedTransactionIndex=0,
         bool loadedFromDisk=false);
     bool IsSpent(const uint256& hash, unsigned int n) const;
+    bool IsSpentInBlock(const uint256& hash, unsigned int n) const;
+    bool IsSpentOnlyInMempool(const uint256& hash, unsigned int n) const;
     std::set<uint256> GetConflictingTxHashes(const CWalletTx& tx) const;
 };
 #endif// SPENT_OUTPUT_TRACKER_H
@@ -0,0 +1,83 @@
+#include <StakableCoinIndex.h>
+
+constexpr int StakableCoinIndex::UNCONFIRMED;
+
+StakableCoinIndex::StakableCoinIndex(
+    ): confirmationHeightByOutput_()
+    , outputsByConfirmationHeight_()
+    , needsRebuild_(true)
+{
+}
+
+void StakableCoinIndex::Update(const COutPoint& output, int confirmationHeight)
+{
+    auto it = confirmationHeightByOutput_.find(output);
+    if(it != confirmationHeightByOutput_.end())
+    {
+        if(it->second == confirmationHeight) return;
+        Remove(output);
+    }
+    confirmationHeightByOutput_[output] = confirmationHeight;
+    outputsByConfirmationHeight_[confirmationHeight].insert(output);
+}
+
+void StakableCoinIndex::Remove(const COutPoint& output)
+{
+    auto it = confirmationHeightByOutput_.find(output);
+    if(it == confirmationHeightByOutput_.end()) return;
+
+    auto bucket = outputsByConfirmationHeight_.find(it->second);
+    if(bucket != outputsByConfirmationHeight_.end())
+    {
+        bucket->second.erase(output);
+        if(bucket->second.empty()) outputsByConfirmationHeight_.erase(bucket);
+    }
+    confirmationHeightByOutput_.erase(it);
+}
+
+void StakableCoinIndex::Clear()
+{
+    confirmationHeightByOutput_.clear();
+    outputsByConfirmationHeight_.clear();
+}
+
+bool StakableCoinIndex::Contains(const COutPoint& output) const
+{
+    return confirmationHeightByOutput_.count(output) > 0u;
+}
+
+size_t StakableCoinIndex::size() const
+{
+    return confirmationHeightByOutput_.size();
+}
+
+void StakableCoinIndex::MarkForRebuild()
+{
+    needsRebuild_ = true;
+}
+
+bool StakableCoinIndex::NeedsRebuild() const
+{
+    return needsRebuild_;
+}
+
+void StakableCoinIndex::MarkRebuilt()
+{
+    needsRebuild_ = false;
+}
+
+void StakableCoinIndex::GetOutputsConfirmedAtOrBelow(int maximumConfirmationHeight, std::vector<COutPoint>& outputs) const
+{
+    const auto end = outputsByConfirmationHeight_.upper_bound(maximumConfirmationHeight);
+    for(auto bucket = outputsByConfirmationHeight_.begin(); bucket != end; ++bucket)
+    {
+        outputs.insert(outputs.end(), bucket->second.begin(), bucket->second.end());
+    }
+}
+
+void StakableCoinIndex::GetUnconfirmedOutputs(std::vector<COutPoint>& outputs) const
+{
+    const auto bucket = outputsByConfirmationHeight_.find(UNCONFIRMED);
+    if(bucket == outputsByConfirmationHeight_.end()) return;
+    outputs.insert(outputs.end(), bucket->second.begin(), bucket->second.end());
+}
@@ -0,0 +1,44 @@
+#ifndef STAKABLE_COIN_INDEX_H
+#define STAKABLE_COIN_INDEX_H
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
+#include <limits>
+#include <primitives/transaction.h>
+
+/**
+ * Wallet outputs that may be used for staking, bucketed by the height of the
+ * block that confirmed them. Membership only says an output is a candidate;
+ * depth, maturity, lock and spent status are still checked on selection.
+ */
+class StakableCoinIndex
+{
+private:
+    std::map<COutPoint, int> confirmationHeightByOutput_;
+    std::map<int, std::set<COutPoint>> outputsByConfirmationHeight_;
+    std::atomic<bool> needsRebuild_;
+
+public:
+    static constexpr int UNCONFIRMED = std::numeric_limits<int>::max();
+
+    StakableCoinIndex();
+
+    /** Insert an output, or move it to a new confirmation height bucket */
+    void Update(const COutPoint& output, int confirmationHeight);
+    void Remove(const COutPoint& output);
+    void Clear();
+    bool Contains(const COutPoint& output) const;
+    size_t size() const;
+
+    /** Request a full rebuild, e.g. after the set of scripts considered ours has changed */
+    void MarkForRebuild();
+    bool NeedsRebuild() const;
+    void MarkRebuilt();
+
+    /** Append all outputs confirmed at or below maximumConfirmationHeight */
+    void GetOutputsConfirmedAtOrBelow(int maximumConfirmationHeight, std::vector<COutPoint>& outputs) const;
+    /** Append all outputs whose confirming block was not on the active chain when last indexed */
+    void GetUnconfirmedOutputs(std::vector<COutPoint>& outputs) const;
+};
+#endif// STAKABLE_COIN_INDEX_H
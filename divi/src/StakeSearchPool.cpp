@@ -0,0 +1,133 @@
+#include <StakeSearchPool.h>
+
+#include <ThreadManagementHelpers.h>
+#include <defaultValues.h>
+
+#include <algorithm>
+#include <boost/bind.hpp>
+
+StakeSearchPool::StakeSearchPool(
+    unsigned numberOfThreads
+    ): numberOfThreads_(std::max(1u, numberOfThreads))
+    , workers_()
+    , mutex_()
+    , workAvailable_()
+    , workFinished_()
+    , searchGeneration_(0)
+    , pendingWorkers_(0)
+    , shutdown_(false)
+    , candidateCheck_(nullptr)
+    , numberOfCandidates_(0)
+    , nextCandidate_(0)
+    , firstHit_(0)
+    , stopRequested_(false)
+{
+    // The searching thread itself is the remaining worker
+    for(unsigned threadIndex = 1; threadIndex < numberOfThreads_; ++threadIndex)
+    {
+        workers_.create_thread(boost::bind(&StakeSearchPool::WorkerLoop, this));
+    }
+}
+
+StakeSearchPool::~StakeSearchPool()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    workAvailable_.notify_all();
+    workers_.join_all();
+}
+
+unsigned StakeSearchPool::numberOfThreads() const
+{
+    return numberOfThreads_;
+}
+
+void StakeSearchPool::ProcessCandidates()
+{
+    while(!stopRequested_.load())
+    {
+        const size_t candidateIndex = nextCandidate_.fetch_add(1);
+        if(candidateIndex >= numberOfCandidates_) return;
+        if((*candidateCheck_)(candidateIndex))
+        {
+            size_t noHitYet = numberOfCandidates_;
+            firstHit_.compare_exchange_strong(noHitYet, candidateIndex);
+            stopRequested_.store(true);
+            return;
+        }
+    }
+}
+
+void StakeSearchPool::WorkerLoop()
+{
+    RenameThread("divi-stakesearch");
+    uint64_t lastSearchGeneration = 0;
+    while(true)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while(!shutdown_ && searchGeneration_ == lastSearchGeneration)
+            {
+                workAvailable_.wait(lock);
+            }
+            if(shutdown_) return;
+            lastSearchGeneration = searchGeneration_;
+        }
+
+        ProcessCandidates();
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            if(--pendingWorkers_ == 0u) workFinished_.notify_all();
+        }
+    }
+}
+
+size_t StakeSearchPool::search(size_t numberOfCandidates, const CandidateCheck& candidateCheck)
+{
+    if(numberOfThreads_ == 1u || numberOfCandidates < 2u)
+    {
+        for(size_t candidateIndex = 0; candidateIndex < numberOfCandidates; ++candidateIndex)
+        {
+            if(candidateCheck(candidateIndex)) return candidateIndex;
+        }
+        return numberOfCandidates;
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        candidateCheck_ = &candidateCheck;
+        numberOfCandidates_ = numberOfCandidates;
+        nextCandidate_.store(0);
+        firstHit_.store(numberOfCandidates);
+        stopRequested_.store(false);
+        pendingWorkers_ = numberOfThreads_ - 1u;
+        ++searchGeneration_;
+    }
+    workAvailable_.notify_all();
+
+    ProcessCandidates();
+
+    {
+        // Workers reference candidateCheck, so wait for all of them even if interrupted
+        boost::this_thread::disable_interruption noInterruption;
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        while(pendingWorkers_ > 0u)
+        {
+            workFinished_.wait(lock);
+        }
+        candidateCheck_ = nullptr;
+    }
+    return firstHit_.load();
+}
+
+unsigned ResolveStakingThreadCount(int64_t requestedThreads)
+{
+    if(requestedThreads <= 0)
+        requestedThreads += boost::thread::hardware_concurrency();
+    if(requestedThreads < 1)
+        return 1u;
+    return static_cast<unsigned>(std::min<int64_t>(requestedThreads, MAX_STAKING_THREADS));
+}
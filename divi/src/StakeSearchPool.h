@@ -0,0 +1,63 @@
+#ifndef STAKE_SEARCH_POOL_H
+#define STAKE_SEARCH_POOL_H
+
+#include <atomic>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/**
+ * Pool of threads that cooperatively search a list of stake candidates.
+ * Idle workers grab the next unclaimed candidate from a shared cursor, so
+ * a slow candidate never holds up the rest of the list, and the whole search
+ * is abandoned as soon as any worker reports a hit.
+ * The thread calling search() takes part as a worker, so a pool of one thread
+ * walks the candidates serially and in order.
+ */
+class StakeSearchPool
+{
+public:
+    typedef std::function<bool(size_t)> CandidateCheck;
+
+private:
+    const unsigned numberOfThreads_;
+    boost::thread_group workers_;
+    boost::mutex mutex_;
+    boost::condition_variable workAvailable_;
+    boost::condition_variable workFinished_;
+    uint64_t searchGeneration_;
+    unsigned pendingWorkers_;
+    bool shutdown_;
+
+    const CandidateCheck* candidateCheck_;
+    size_t numberOfCandidates_;
+    std::atomic<size_t> nextCandidate_;
+    std::atomic<size_t> firstHit_;
+    std::atomic<bool> stopRequested_;
+
+    void WorkerLoop();
+    void ProcessCandidates();
+
+public:
+    explicit StakeSearchPool(unsigned numberOfThreads);
+    ~StakeSearchPool();
+
+    /** Number of threads, including the caller, that take part in a search */
+    unsigned numberOfThreads() const;
+
+    /**
+     * Run candidateCheck over the indices [0, numberOfCandidates) until one of them returns true.
+     * Returns the index of the candidate that succeeded, or numberOfCandidates if none did.
+     * candidateCheck is called concurrently from several threads and must be thread safe.
+     */
+    size_t search(size_t numberOfCandidates, const CandidateCheck& candidateCheck);
+};
+
+/** Translate a -stakingthreads value (0 = auto, <0 = leave that many cores free) into a thread count */
+unsigned ResolveStakingThreadCount(int64_t requestedThreads);
+
+#endif // STAKE_SEARCH_POOL_H
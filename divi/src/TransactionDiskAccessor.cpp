@@ -20,51 +20,49 @@ extern CChain chainActive;
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock, bool fAllowSlow)
 {
-    CBlockIndex* pindexSlow = NULL;
-    {
-        LOCK(cs_main);
-        {
-            if (mempool.lookup(hash, txOut) || mempool.lookupBareTxid(hash, txOut)) {
-                return true;
-            }
-        }
+    if (mempool.lookup(hash, txOut) || mempool.lookupBareTxid(hash, txOut)) {
+        return true;
+    }
 
-        if (fTxIndex) {
-            CDiskTxPos postx;
-            if (pblocktree->ReadTxIndex(hash, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-                if (file.IsNull())
-                    return error("%s: OpenBlockFile failed", __func__);
-                CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                    file >> txOut;
-                } catch (std::exception& e) {
-                    return error("%s : Deserialize or I/O error - %s", __func__, e.what());
-                }
-                hashBlock = header.GetHash();
-                if (txOut.GetHash() != hash && txOut.GetBareTxid() != hash)
-                    return error("%s : txid mismatch", __func__);
-                return true;
+    // The transaction index and the block files it points into may be read
+    // concurrently, so lookups through them do not need cs_main.
+    if (fTxIndex) {
+        CDiskTxPos postx;
+        if (pblocktree->ReadTxIndex(hash, postx)) {
+            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+            if (file.IsNull())
+                return error("%s: OpenBlockFile failed", __func__);
+            CBlockHeader header;
+            try {
+                file >> header;
+                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+                file >> txOut;
+            } catch (std::exception& e) {
+                return error("%s : Deserialize or I/O error - %s", __func__, e.what());
             }
-
-            // Transaction not found in the index (which works both with
-            // txid and bare txid), nothing more can be done.
-            return false;
+            hashBlock = header.GetHash();
+            if (txOut.GetHash() != hash && txOut.GetBareTxid() != hash)
+                return error("%s : txid mismatch", __func__);
+            return true;
         }
 
-        if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
-            int nHeight = -1;
-            {
-                CCoinsViewCache& view = *pcoinsTip;
-                const CCoins* coins = view.AccessCoins(hash);
-                if (coins)
-                    nHeight = coins->nHeight;
-            }
-            if (nHeight > 0)
-                pindexSlow = chainActive[nHeight];
+        // Transaction not found in the index (which works both with
+        // txid and bare txid), nothing more can be done.
+        return false;
+    }
+
+    CBlockIndex* pindexSlow = NULL;
+    if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
+        LOCK(cs_main);
+        int nHeight = -1;
+        {
+            CCoinsViewCache& view = *pcoinsTip;
+            const CCoins* coins = view.AccessCoins(hash);
+            if (coins)
+                nHeight = coins->nHeight;
         }
+        if (nHeight > 0)
+            pindexSlow = chainActive[nHeight];
     }
 
     if (pindexSlow) {
@@ -80,3 +80,8 @@ bool TransactionInputChecker::WaitForScriptsToBeChecked()
 {
     return multiThreadedScriptChecker.Wait();
 }
+
+bool TransactionInputChecker::BackgroundScriptChecksHaveFailed()
+{
+    return multiThreadedScriptChecker.HasFailed();
+}
@@ -36,5 +36,6 @@ public:
         CBlockIndex* pindex);
     bool TotalSigOpsAreBelowMaximum(const CTransaction& tx);
     bool WaitForScriptsToBeChecked();
+    bool BackgroundScriptChecksHaveFailed();
 };
 #endif// TRANSACTION_INPUT_CHECKER_H
@@ -0,0 +1,167 @@
+#include <WalletBalanceLedger.h>
+
+constexpr int WalletBalanceLedger::NEVER;
+
+WalletBalances::WalletBalances(
+    ): trusted(0)
+    , unconfirmed(0)
+    , immature(0)
+    , spendable(0)
+    , stakable(0)
+    , ownedVaults(0)
+{
+}
+
+WalletBalances& WalletBalances::operator+=(const WalletBalances& other)
+{
+    trusted += other.trusted;
+    unconfirmed += other.unconfirmed;
+    immature += other.immature;
+    spendable += other.spendable;
+    stakable += other.stakable;
+    ownedVaults += other.ownedVaults;
+    return *this;
+}
+
+WalletBalances& WalletBalances::operator-=(const WalletBalances& other)
+{
+    trusted -= other.trusted;
+    unconfirmed -= other.unconfirmed;
+    immature -= other.immature;
+    spendable -= other.spendable;
+    stakable -= other.stakable;
+    ownedVaults -= other.ownedVaults;
+    return *this;
+}
+
+bool WalletBalances::operator==(const WalletBalances& other) const
+{
+    return trusted == other.trusted &&
+        unconfirmed == other.unconfirmed &&
+        immature == other.immature &&
+        spendable == other.spendable &&
+        stakable == other.stakable &&
+        ownedVaults == other.ownedVaults;
+}
+
+bool WalletBalances::operator!=(const WalletBalances& other) const
+{
+    return !(*this == other);
+}
+
+WalletBalanceLedger::WalletBalanceLedger(
+    ): entries_()
+    , transactionsByRefreshHeight_()
+    , volatileTransactions_()
+    , dirtyTransactions_()
+    , totals_()
+    , syncedHeight_(-1)
+    , syncedBlockHash_(0)
+    , needsRebuild_(true)
+    , changeCount_(0u)
+{
+}
+
+void WalletBalanceLedger::Record(const uint256& txid, const WalletBalances& contribution, bool isVolatile, int refreshHeight)
+{
+    Remove(txid);
+    Entry& entry = entries_[txid];
+    entry.contribution = contribution;
+    entry.refreshHeight = refreshHeight;
+    entry.isVolatile = isVolatile;
+    totals_ += contribution;
+    if(isVolatile) volatileTransactions_.insert(txid);
+    if(refreshHeight != NEVER) transactionsByRefreshHeight_[refreshHeight].insert(txid);
+}
+
+void WalletBalanceLedger::Remove(const uint256& txid)
+{
+    auto it = entries_.find(txid);
+    if(it == entries_.end()) return;
+
+    const Entry& entry = it->second;
+    totals_ -= entry.contribution;
+    if(entry.isVolatile) volatileTransactions_.erase(txid);
+    auto bucket = transactionsByRefreshHeight_.find(entry.refreshHeight);
+    if(bucket != transactionsByRefreshHeight_.end())
+    {
+        bucket->second.erase(txid);
+        if(bucket->second.empty()) transactionsByRefreshHeight_.erase(bucket);
+    }
+    entries_.erase(it);
+}
+
+void WalletBalanceLedger::Clear()
+{
+    entries_.clear();
+    transactionsByRefreshHeight_.clear();
+    volatileTransactions_.clear();
+    dirtyTransactions_.clear();
+    totals_ = WalletBalances();
+}
+
+size_t WalletBalanceLedger::size() const
+{
+    return entries_.size();
+}
+
+const WalletBalances& WalletBalanceLedger::Totals() const
+{
+    return totals_;
+}
+
+void WalletBalanceLedger::MarkDirty(const uint256& txid)
+{
+    dirtyTransactions_.insert(txid);
+    ++changeCount_;
+}
+
+void WalletBalanceLedger::TakeTransactionsToRefresh(int height, std::vector<uint256>& txids)
+{
+    std::set<uint256> due;
+    due.swap(dirtyTransactions_);
+    due.insert(volatileTransactions_.begin(), volatileTransactions_.end());
+    const auto end = transactionsByRefreshHeight_.upper_bound(height);
+    for(auto bucket = transactionsByRefreshHeight_.begin(); bucket != end; ++bucket)
+    {
+        due.insert(bucket->second.begin(), bucket->second.end());
+    }
+    txids.insert(txids.end(), due.begin(), due.end());
+}
+
+void WalletBalanceLedger::SetSyncedTip(int height, const uint256& blockHash)
+{
+    syncedHeight_ = height;
+    syncedBlockHash_ = blockHash;
+}
+
+int WalletBalanceLedger::SyncedHeight() const
+{
+    return syncedHeight_;
+}
+
+const uint256& WalletBalanceLedger::SyncedBlockHash() const
+{
+    return syncedBlockHash_;
+}
+
+void WalletBalanceLedger::MarkForRebuild()
+{
+    needsRebuild_ = true;
+    ++changeCount_;
+}
+
+bool WalletBalanceLedger::NeedsRebuild() const
+{
+    return needsRebuild_;
+}
+
+void WalletBalanceLedger::MarkRebuilt()
+{
+    needsRebuild_ = false;
+}
+
+uint64_t WalletBalanceLedger::ChangeCount() const
+{
+    return changeCount_;
+}
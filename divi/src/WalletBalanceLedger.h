@@ -0,0 +1,86 @@
+#ifndef WALLET_BALANCE_LEDGER_H
+#define WALLET_BALANCE_LEDGER_H
+#include <amount.h>
+#include <uint256.h>
+#include <atomic>
+#include <stdint.h>
+#include <limits>
+#include <map>
+#include <set>
+#include <vector>
+
+/** The balances the wallet reports, or the share of them owed to a single transaction */
+struct WalletBalances
+{
+    CAmount trusted;
+    CAmount unconfirmed;
+    CAmount immature;
+    CAmount spendable;
+    CAmount stakable;
+    CAmount ownedVaults;
+
+    WalletBalances();
+    WalletBalances& operator+=(const WalletBalances& other);
+    WalletBalances& operator-=(const WalletBalances& other);
+    bool operator==(const WalletBalances& other) const;
+    bool operator!=(const WalletBalances& other) const;
+};
+
+/**
+ * Running wallet balances, kept as the sum of the last computed contribution of
+ * each wallet transaction. A contribution is recomputed once its transaction is
+ * marked dirty, once the chain reaches the refresh height recorded with it (e.g.
+ * when a coinstake matures), and on every refresh while it is volatile, i.e. may
+ * change without the wallet being told (mempool membership). The ledger also
+ * remembers the tip it was last synced to, so that a reorganisation can be
+ * detected and answered with a full rebuild.
+ */
+class WalletBalanceLedger
+{
+private:
+    struct Entry
+    {
+        WalletBalances contribution;
+        int refreshHeight;
+        bool isVolatile;
+    };
+    std::map<uint256, Entry> entries_;
+    std::map<int, std::set<uint256>> transactionsByRefreshHeight_;
+    std::set<uint256> volatileTransactions_;
+    std::set<uint256> dirtyTransactions_;
+    WalletBalances totals_;
+    int syncedHeight_;
+    uint256 syncedBlockHash_;
+    std::atomic<bool> needsRebuild_;
+    std::atomic<uint64_t> changeCount_;
+
+public:
+    static constexpr int NEVER = std::numeric_limits<int>::max();
+
+    WalletBalanceLedger();
+
+    /** Insert or replace the contribution of a transaction */
+    void Record(const uint256& txid, const WalletBalances& contribution, bool isVolatile, int refreshHeight = NEVER);
+    void Remove(const uint256& txid);
+    void Clear();
+    size_t size() const;
+    const WalletBalances& Totals() const;
+
+    void MarkDirty(const uint256& txid);
+    /** Move the dirty transactions, the volatile ones and those due at this height into txids */
+    void TakeTransactionsToRefresh(int height, std::vector<uint256>& txids);
+
+    void SetSyncedTip(int height, const uint256& blockHash);
+    int SyncedHeight() const;
+    const uint256& SyncedBlockHash() const;
+
+    /** Request a full rebuild, e.g. after the set of scripts considered ours has changed */
+    void MarkForRebuild();
+    bool NeedsRebuild() const;
+    void MarkRebuilt();
+
+    /** Counts the calls to MarkDirty and MarkForRebuild, so that callers can
+     *  tell whether the balances may have moved without asking for them */
+    uint64_t ChangeCount() const;
+};
+#endif// WALLET_BALANCE_LEDGER_H
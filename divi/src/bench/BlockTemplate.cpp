@@ -0,0 +1,126 @@
+#include "bench.h"
+
+#include <BlockMemoryPoolTransactionCollector.h>
+#include <BlockTemplate.h>
+#include <FeeRate.h>
+#include <Settings.h>
+#include <blockmap.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <txmempool.h>
+
+#include <memory>
+
+/** Mempool size the templates are assembled from */
+static const unsigned MEMPOOL_TRANSACTIONS = 5000;
+
+/** A tip, its coins and a mempool of independent fee-paying spends of them */
+class BlockTemplateEnvironment
+{
+private:
+    bool addressIndex_;
+    bool spentIndex_;
+    CBlockIndex tip_;
+    CCoinsView dummyCoins_;
+
+public:
+    BlockMap blockIndexMap;
+    CChain chain;
+    CCoinsViewCache coins;
+    CTxMemPool mempool;
+    CCriticalSection mainCS;
+    CFeeRate relayFee;
+    std::unique_ptr<BlockMemoryPoolTransactionCollector> collector;
+    std::vector<uint256> transactionHashes;
+
+    BlockTemplateEnvironment(
+        ): addressIndex_(false)
+        , spentIndex_(false)
+        , tip_()
+        , dummyCoins_()
+        , blockIndexMap()
+        , chain()
+        , coins(&dummyCoins_)
+        , mempool(CFeeRate(0), addressIndex_, spentIndex_)
+        , mainCS()
+        , relayFee(10000)
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+
+        const uint256 tipHash = uint256S("7d3b1f1a0c5e9e3a2b4c6d8e0f1a2b3c4d5e6f708192a3b4c5d6e7f8091a2b3c");
+        tip_.nHeight = 100;
+        tip_.phashBlock = &blockIndexMap.insert(std::make_pair(tipHash, &tip_)).first->first;
+        chain.SetTip(&tip_);
+
+        coins.SetBestBlock(tipHash);
+        for (unsigned i = 0; i < MEMPOOL_TRANSACTIONS; ++i) {
+            CMutableTransaction funding;
+            funding.vin.resize(1);
+            funding.vin[0].prevout = COutPoint(uint256S("01"), i);
+            funding.vout.emplace_back(COIN, CScript() << OP_TRUE);
+            coins.ModifyCoins(funding.GetHash())->FromTx(funding, 1);
+
+            CMutableTransaction spend;
+            spend.vin.resize(1);
+            spend.vin[0].prevout = COutPoint(funding.GetHash(), 0);
+            const CAmount fee = 10000 + i;
+            spend.vout.emplace_back(COIN - fee, CScript() << OP_TRUE);
+            const CTransaction tx(spend);
+            mempool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, fee, 0, 0.0, 1), coins);
+            transactionHashes.push_back(tx.GetHash());
+        }
+
+        collector.reset(new BlockMemoryPoolTransactionCollector(
+            Settings::instance(), &coins, chain, blockIndexMap, mempool, mainCS, relayFee));
+    }
+
+    size_t AssembleTemplate() const
+    {
+        CBlockTemplate blockTemplate;
+        collector->CollectTransactionsIntoBlock(blockTemplate);
+        return blockTemplate.block.vtx.size();
+    }
+};
+
+/** Repeated staking attempts with neither the tip nor the mempool changing */
+static void BlockTemplateUnchanged(benchmark::State& state)
+{
+    BlockTemplateEnvironment environment;
+    environment.AssembleTemplate();
+    while (state.KeepRunning()) {
+        environment.AssembleTemplate();
+    }
+}
+
+/** Attempts that each follow a mempool change, so the template is rebuilt */
+static void BlockTemplateAfterMempoolChange(benchmark::State& state)
+{
+    BlockTemplateEnvironment environment;
+    environment.AssembleTemplate();
+    unsigned next = 0;
+    while (state.KeepRunning()) {
+        const uint256& hash = environment.transactionHashes[next++ % MEMPOOL_TRANSACTIONS];
+        environment.mempool.PrioritiseTransaction(hash, hash.ToString(), 0.0, 1);
+        environment.AssembleTemplate();
+    }
+}
+
+/** A collector with nothing cached, as every attempt used to be */
+static void BlockTemplateFromScratch(benchmark::State& state)
+{
+    BlockTemplateEnvironment environment;
+    while (state.KeepRunning()) {
+        BlockMemoryPoolTransactionCollector collector(
+            Settings::instance(), &environment.coins, environment.chain, environment.blockIndexMap,
+            environment.mempool, environment.mainCS, environment.relayFee);
+        CBlockTemplate blockTemplate;
+        collector.CollectTransactionsIntoBlock(blockTemplate);
+    }
+}
+
+BENCHMARK(BlockTemplateUnchanged);
+BENCHMARK(BlockTemplateAfterMempoolChange);
+BENCHMARK(BlockTemplateFromScratch);
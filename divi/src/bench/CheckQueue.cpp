@@ -0,0 +1,123 @@
+#include "bench.h"
+
+#include "checkqueue.h"
+#include "key.h"
+#include "pubkey.h"
+#include "uint256.h"
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+/** Signatures verified per block-sized round, in the small per-transaction batches block connection adds them in */
+static const unsigned SIGNATURES_PER_ROUND = 2000;
+static const unsigned SIGNATURES_PER_TRANSACTION = 2;
+
+/** A signature verification standing in for a CScriptCheck */
+class SignatureCheck
+{
+private:
+    CPubKey pubkey;
+    uint256 hash;
+    std::vector<unsigned char> signature;
+
+public:
+    SignatureCheck() {}
+    SignatureCheck(const CPubKey& pubkeyIn, const uint256& hashIn, const std::vector<unsigned char>& signatureIn)
+        : pubkey(pubkeyIn), hash(hashIn), signature(signatureIn) {}
+
+    bool operator()() const
+    {
+        return pubkey.Verify(hash, signature);
+    }
+
+    void swap(SignatureCheck& check)
+    {
+        std::swap(pubkey, check.pubkey);
+        std::swap(hash, check.hash);
+        signature.swap(check.signature);
+    }
+};
+
+/** A check that costs next to nothing, so that only the queue's own overhead is measured */
+class TrivialCheck
+{
+public:
+    bool operator()() const
+    {
+        return true;
+    }
+
+    void swap(TrivialCheck&) {}
+};
+
+static std::vector<SignatureCheck> SignaturesToVerify()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    std::vector<SignatureCheck> signatures;
+    for (unsigned i = 0; i < SIGNATURES_PER_ROUND; ++i) {
+        uint256 hash;
+        hash = i;
+        std::vector<unsigned char> signature;
+        key.Sign(hash, signature);
+        signatures.push_back(SignatureCheck(pubkey, hash, signature));
+    }
+    return signatures;
+}
+
+/** Verification throughput is the number of checks in a round divided by the time per iteration */
+template <typename T>
+static void VerifyWithThreads(benchmark::State& state, const std::vector<T>& checksPerRound, unsigned numberOfThreads)
+{
+    CCheckQueue<T> queue(128);
+    boost::thread_group workers;
+    for (unsigned i = 1; i < numberOfThreads; ++i)
+        workers.create_thread(boost::bind(&CCheckQueue<T>::Thread, &queue));
+
+    while (state.KeepRunning()) {
+        CCheckQueueControl<T> control(numberOfThreads > 1 ? &queue : NULL);
+        for (unsigned i = 0; i < checksPerRound.size(); i += SIGNATURES_PER_TRANSACTION) {
+            std::vector<T> checks(checksPerRound.begin() + i, checksPerRound.begin() + i + SIGNATURES_PER_TRANSACTION);
+            if (numberOfThreads > 1) {
+                control.Add(checks);
+            } else {
+                for (const T& check : checks)
+                    check();
+            }
+        }
+        control.Wait();
+    }
+
+    workers.interrupt_all();
+    workers.join_all();
+}
+
+static void VerifySignaturesWithThreads(benchmark::State& state, unsigned numberOfThreads)
+{
+    VerifyWithThreads(state, SignaturesToVerify(), numberOfThreads);
+}
+
+static void CheckQueueOverheadWithThreads(benchmark::State& state, unsigned numberOfThreads)
+{
+    VerifyWithThreads(state, std::vector<TrivialCheck>(SIGNATURES_PER_ROUND), numberOfThreads);
+}
+
+static void CheckQueueSignatures1Thread(benchmark::State& state) { VerifySignaturesWithThreads(state, 1); }
+static void CheckQueueSignatures2Threads(benchmark::State& state) { VerifySignaturesWithThreads(state, 2); }
+static void CheckQueueSignatures4Threads(benchmark::State& state) { VerifySignaturesWithThreads(state, 4); }
+static void CheckQueueSignatures8Threads(benchmark::State& state) { VerifySignaturesWithThreads(state, 8); }
+static void CheckQueueSignatures16Threads(benchmark::State& state) { VerifySignaturesWithThreads(state, 16); }
+
+static void CheckQueueOverhead2Threads(benchmark::State& state) { CheckQueueOverheadWithThreads(state, 2); }
+static void CheckQueueOverhead8Threads(benchmark::State& state) { CheckQueueOverheadWithThreads(state, 8); }
+
+BENCHMARK(CheckQueueSignatures1Thread);
+BENCHMARK(CheckQueueSignatures2Threads);
+BENCHMARK(CheckQueueSignatures4Threads);
+BENCHMARK(CheckQueueSignatures8Threads);
+BENCHMARK(CheckQueueSignatures16Threads);
+BENCHMARK(CheckQueueOverhead2Threads);
+BENCHMARK(CheckQueueOverhead8Threads);
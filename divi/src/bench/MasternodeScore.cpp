@@ -0,0 +1,49 @@
+#include "bench.h"
+
+#include "hash.h"
+#include "masternode.h"
+#include "version.h"
+
+#include <algorithm>
+
+/** Diamond masternodes hash the most rounds per score */
+static const size_t DIAMOND_HASH_ROUNDS = 2400;
+
+static CMasternode DiamondMasternode()
+{
+    CMasternode mn;
+    mn.vin = CTxIn(COutPoint(uint256S("4b2a9c1e"), 1));
+    mn.nTier = MasternodeTier::DIAMOND;
+    return mn;
+}
+
+/** The rounds hashed as one batch in parallel lanes */
+static void MasternodeScoreBatched(benchmark::State& state)
+{
+    const CMasternode mn = DiamondMasternode();
+    uint256 seedHash = uint256S("01");
+    while (state.KeepRunning()) {
+        seedHash = mn.CalculateScore(seedHash);
+    }
+}
+
+/** The rounds hashed one at a time from a copied hash writer, as scores used to be */
+static void MasternodeScorePerRound(benchmark::State& state)
+{
+    const CMasternode mn = DiamondMasternode();
+    uint256 seedHash = uint256S("01");
+    while (state.KeepRunning()) {
+        CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+        ss << seedHash << mn.vin.prevout.hash + mn.vin.prevout.n;
+        uint256 r;
+        for (size_t i = 0; i < DIAMOND_HASH_ROUNDS; ++i) {
+            CHashWriter round(ss);
+            round << static_cast<int>(i);
+            r = std::max(round.GetHash(), r);
+        }
+        seedHash = r;
+    }
+}
+
+BENCHMARK(MasternodeScoreBatched);
+BENCHMARK(MasternodeScorePerRound);
@@ -0,0 +1,65 @@
+#include "bench.h"
+
+#include "MerkleTree.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "utilstrencodings.h"
+
+#include <algorithm>
+#include <vector>
+
+static CBlock BlockWithTransactions(unsigned numberOfTransactions)
+{
+    CBlock block;
+    block.vtx.reserve(numberOfTransactions);
+    for (unsigned i = 0; i < numberOfTransactions; ++i) {
+        CMutableTransaction tx;
+        tx.nLockTime = i;
+        block.vtx.push_back(CTransaction(tx));
+    }
+    return block;
+}
+
+/** Pairwise hashing of each level, as CBlock::BuildMerkleTree did before levels were batched */
+static uint256 PairwiseMerkleRoot(const CBlock& block, std::vector<uint256>& tree)
+{
+    tree.clear();
+    for (const CTransaction& tx : block.vtx)
+        tree.push_back(tx.GetHash());
+    int j = 0;
+    for (int nSize = block.vtx.size(); nSize > 1; nSize = (nSize + 1) / 2) {
+        for (int i = 0; i < nSize; i += 2) {
+            int i2 = std::min(i + 1, nSize - 1);
+            tree.push_back(Hash(BEGIN(tree[j + i]), END(tree[j + i]), BEGIN(tree[j + i2]), END(tree[j + i2])));
+        }
+        j += nSize;
+    }
+    return tree.back();
+}
+
+static void MerkleRootPairwise(benchmark::State& state, unsigned numberOfTransactions)
+{
+    const CBlock block = BlockWithTransactions(numberOfTransactions);
+    std::vector<uint256> tree;
+    while (state.KeepRunning()) {
+        PairwiseMerkleRoot(block, tree);
+    }
+}
+
+static void MerkleRootBatched(benchmark::State& state, unsigned numberOfTransactions)
+{
+    const CBlock block = BlockWithTransactions(numberOfTransactions);
+    while (state.KeepRunning()) {
+        BlockMerkleRoot(block);
+    }
+}
+
+static void MerkleRootPairwise1000Transactions(benchmark::State& state) { MerkleRootPairwise(state, 1000); }
+static void MerkleRootPairwise10000Transactions(benchmark::State& state) { MerkleRootPairwise(state, 10000); }
+static void MerkleRootBatched1000Transactions(benchmark::State& state) { MerkleRootBatched(state, 1000); }
+static void MerkleRootBatched10000Transactions(benchmark::State& state) { MerkleRootBatched(state, 10000); }
+
+BENCHMARK(MerkleRootPairwise1000Transactions);
+BENCHMARK(MerkleRootPairwise10000Transactions);
+BENCHMARK(MerkleRootBatched1000Transactions);
+BENCHMARK(MerkleRootBatched10000Transactions);
@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#include <I_ProofOfStakeGenerator.h>
+#include <ProofOfStakeCalculator.h>
+#include <StakingData.h>
+#include <amount.h>
+#include <uint256.h>
+
+#include <vector>
+
+static StakingData BenchmarkStakingData()
+{
+    return StakingData(
+        453347746,
+        1599860645,
+        uint256S("4d2597aa8ff30a0f0f82466e1dfd7603d8f928e08c8887597e0e0524ae293e5c"),
+        COutPoint(uint256S("1f5d59023369ac9f32d25de4645cd4a1d101911a01514a1a854a6518795f4805"),1),
+        CAmount(1699450000000),
+        uint256S("2dfcd9caa2558c41148a13b67117197289863a887480825646acf5225bcc0156"));
+}
+
+static void StakeKernelSequentialSearch(benchmark::State& state)
+{
+    const StakingData stakingData = BenchmarkStakingData();
+    ProofOfStakeCalculator calculator(stakingData, 11764753600649114182ull);
+    unsigned timestamp = 1610200830;
+    uint256 hashproof;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < I_ProofOfStakeGenerator::nHashDrift; ++i) {
+            calculator.computeProofOfStakeAndCheckItMeetsTarget(timestamp - i, hashproof, false);
+        }
+        ++timestamp;
+    }
+}
+
+static void StakeKernelBatchedSearch(benchmark::State& state)
+{
+    const StakingData stakingData = BenchmarkStakingData();
+    ProofOfStakeCalculator calculator(stakingData, 11764753600649114182ull);
+    unsigned timestamp = 1610200830;
+    std::vector<uint256> hashproofs(I_ProofOfStakeGenerator::nHashDrift);
+    while (state.KeepRunning()) {
+        calculator.computeProofsOfStake(timestamp, I_ProofOfStakeGenerator::nHashDrift, hashproofs.data());
+        for (int i = 0; i < I_ProofOfStakeGenerator::nHashDrift; ++i) {
+            calculator.computeProofOfStakeAndCheckItMeetsTarget(timestamp - i, hashproofs[i], true);
+        }
+        ++timestamp;
+    }
+}
+
+BENCHMARK(StakeKernelSequentialSearch);
+BENCHMARK(StakeKernelBatchedSearch);
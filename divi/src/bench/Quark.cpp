@@ -0,0 +1,43 @@
+#include "bench.h"
+
+#include "crypto/quark.h"
+#include "hash.h"
+
+#include <vector>
+
+static const size_t HEADER_SIZE = 80;
+static const size_t HEADERS_PER_ITERATION = 64;
+
+static std::vector<unsigned char> BenchmarkHeaders()
+{
+    std::vector<unsigned char> headers(HEADER_SIZE * HEADERS_PER_ITERATION);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        headers[i] = static_cast<unsigned char>(i * 7 + 3);
+    }
+    return headers;
+}
+
+static void QuarkSequentialHeaders(benchmark::State& state)
+{
+    std::vector<unsigned char> headers = BenchmarkHeaders();
+    std::vector<uint256> hashes(HEADERS_PER_ITERATION);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < HEADERS_PER_ITERATION; ++i) {
+            hashes[i] = HashQuark(headers.begin() + HEADER_SIZE * i, headers.begin() + HEADER_SIZE * (i + 1));
+        }
+        ++headers[0];
+    }
+}
+
+static void QuarkBatchedHeaders(benchmark::State& state)
+{
+    std::vector<unsigned char> headers = BenchmarkHeaders();
+    std::vector<uint256> hashes(HEADERS_PER_ITERATION);
+    while (state.KeepRunning()) {
+        QuarkHashBatch(hashes[0].begin(), headers.data(), HEADER_SIZE, HEADERS_PER_ITERATION);
+        ++headers[0];
+    }
+}
+
+BENCHMARK(QuarkSequentialHeaders);
+BENCHMARK(QuarkBatchedHeaders);
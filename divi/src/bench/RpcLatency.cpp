@@ -0,0 +1,124 @@
+#include "bench.h"
+
+#include "RpcStateSnapshot.h"
+#include "sync.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+extern CCriticalSection cs_main;
+
+/** How long each simulated block holds cs_main, and the gap before the next one */
+static const int64_t BLOCK_CONNECTION_MILLIS = 20;
+static const int64_t BLOCK_GAP_MILLIS = 2;
+/** Reads arrive at a steady pace, as RPC clients do, rather than back to back */
+static const int64_t READ_INTERVAL_MILLIS = 1;
+
+/** Holds cs_main for a block's worth of work, publishes the new height, repeats */
+class BlockConnectionSimulator
+{
+private:
+    std::atomic<bool> stopRequested_;
+    int height_;
+    boost::thread thread_;
+
+    void Run()
+    {
+        while (!stopRequested_) {
+            {
+                LOCK(cs_main);
+                MilliSleep(BLOCK_CONNECTION_MILLIS);
+                std::shared_ptr<RpcStateSnapshot> snapshot = std::make_shared<RpcStateSnapshot>();
+                snapshot->height = ++height_;
+                PublishRpcStateSnapshot(snapshot);
+            }
+            MilliSleep(BLOCK_GAP_MILLIS);
+        }
+    }
+
+public:
+    BlockConnectionSimulator(): stopRequested_(false), height_(0)
+    {
+        thread_ = boost::thread(boost::bind(&BlockConnectionSimulator::Run, this));
+    }
+    ~BlockConnectionSimulator()
+    {
+        stopRequested_ = true;
+        thread_.join();
+    }
+
+    /** Only valid with cs_main held */
+    int Height() const
+    {
+        return height_;
+    }
+};
+
+static void ReportPercentiles(const char* name, std::vector<int64_t>& latencies)
+{
+    if (latencies.empty())
+        return;
+    std::sort(latencies.begin(), latencies.end());
+    const size_t last = latencies.size() - 1;
+    std::cout << "# " << name << " latency p50=" << latencies[last / 2] << "us"
+              << " p99=" << latencies[last * 99 / 100] << "us"
+              << " samples=" << latencies.size() << "\n";
+}
+
+template <typename ReadHeight>
+static void MeasureReadLatency(benchmark::State& state, const char* name, ReadHeight readHeight)
+{
+    BlockConnectionSimulator blockConnection;
+    std::vector<int64_t> latencies;
+    int height = 0;
+    while (state.KeepRunning()) {
+        MilliSleep(READ_INTERVAL_MILLIS);
+        const int64_t start = GetTimeMicros();
+        height = std::max(height, readHeight(blockConnection));
+        latencies.push_back(GetTimeMicros() - start);
+    }
+    ReportPercentiles(name, latencies);
+}
+
+/** Read-only RPCs answered from the published snapshot */
+static void RpcReadFromSnapshot(benchmark::State& state)
+{
+    MeasureReadLatency(state, "RpcReadFromSnapshot", [](const BlockConnectionSimulator&) -> int {
+        return GetRpcStateSnapshot()->height;
+    });
+}
+
+/** Read-only RPCs waiting on cs_main with a blocking lock */
+static void RpcReadBehindBlockingLock(benchmark::State& state)
+{
+    MeasureReadLatency(state, "RpcReadBehindBlockingLock", [](const BlockConnectionSimulator& blockConnection) -> int {
+        LOCK(cs_main);
+        return blockConnection.Height();
+    });
+}
+
+/** Read-only RPCs polling cs_main with TRY_LOCK, as CRPCTable::execute used to */
+static void RpcReadBehindSleepLoop(benchmark::State& state)
+{
+    MeasureReadLatency(state, "RpcReadBehindSleepLoop", [](const BlockConnectionSimulator& blockConnection) -> int {
+        while (true) {
+            TRY_LOCK(cs_main, lockMain);
+            if (!lockMain) {
+                MilliSleep(50);
+                continue;
+            }
+            return blockConnection.Height();
+        }
+    });
+}
+
+BENCHMARK(RpcReadFromSnapshot);
+BENCHMARK(RpcReadBehindBlockingLock);
+BENCHMARK(RpcReadBehindSleepLoop);
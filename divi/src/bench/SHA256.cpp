@@ -0,0 +1,47 @@
+#include "bench.h"
+
+#include "crypto/sha256.h"
+#include "uint256.h"
+
+#include <vector>
+
+static const size_t BUFFER_SIZE = 1000 * 1000;
+static const size_t MERKLE_PAIRS_PER_ITERATION = 1024;
+
+static void SHA256OneMegabyte(benchmark::State& state)
+{
+    std::vector<unsigned char> data(BUFFER_SIZE, 0);
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    while (state.KeepRunning()) {
+        CSHA256().Write(data.data(), data.size()).Finalize(hash);
+        data[0] = hash[0];
+    }
+}
+
+static void SHA256DSequentialMerklePairs(benchmark::State& state)
+{
+    std::vector<uint256> pairs(2 * MERKLE_PAIRS_PER_ITERATION);
+    std::vector<uint256> hashes(MERKLE_PAIRS_PER_ITERATION);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < MERKLE_PAIRS_PER_ITERATION; ++i) {
+            unsigned char hash[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write(pairs[2 * i].begin(), 64).Finalize(hash);
+            CSHA256().Write(hash, sizeof(hash)).Finalize(hashes[i].begin());
+        }
+        pairs[0] = hashes[0];
+    }
+}
+
+static void SHA256D64MerklePairs(benchmark::State& state)
+{
+    std::vector<uint256> pairs(2 * MERKLE_PAIRS_PER_ITERATION);
+    std::vector<uint256> hashes(MERKLE_PAIRS_PER_ITERATION);
+    while (state.KeepRunning()) {
+        SHA256D64(hashes[0].begin(), pairs[0].begin(), MERKLE_PAIRS_PER_ITERATION);
+        pairs[0] = hashes[0];
+    }
+}
+
+BENCHMARK(SHA256OneMegabyte);
+BENCHMARK(SHA256DSequentialMerklePairs);
+BENCHMARK(SHA256D64MerklePairs);
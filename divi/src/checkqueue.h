@@ -6,9 +6,12 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
 #include <vector>
 
-#include <boost/foreach.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -25,12 +28,54 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Checks are handed out without a lock. Each worker claims a chunk of the
+  * checks nobody has taken yet into its own range and works through it from
+  * the front, while workers that run out steal the back half of another
+  * worker's range. Ranges are single atomic words, so claiming, taking and
+  * stealing are all compare-and-swap operations; the mutex is only used by
+  * threads going to sleep when there is nothing left to do. As soon as one
+  * check fails, the checks that have not started yet are discarded.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! Checks live in fixed size segments, so publishing more never moves the ones being checked
+    static const uint32_t SEGMENT_SIZE = 1024;
+    //! Ranges store check indices in 24 bits
+    static const uint32_t MAX_CHECKS = 1 << 24;
+    //! The maximum number of workers (including the master)
+    static const uint32_t MAX_WORKERS = 64;
+
+    //! The checks of the current round, indexed by the order they were added in
+    std::vector<std::unique_ptr<T[]> > segments;
+
+    //! Number of checks added in the current round. Only the master writes it.
+    std::atomic<uint32_t> nAdded;
+
+    //! Number of checks of the current round that were run or discarded
+    std::atomic<uint32_t> nDone;
+
+    //! The round number (upper 32 bits) and the first check that no worker has claimed yet
+    std::atomic<uint64_t> frontier;
+
+    //! The range of claimed checks each worker has still to run; slot 0 belongs to the master
+    std::atomic<uint64_t> ranges[MAX_WORKERS];
+
+    //! The number of worker threads (excluding the master)
+    std::atomic<uint32_t> nWorkers;
+
+    //! The number of worker threads waiting on condWorker
+    std::atomic<int> nSleeping;
+
+    //! Whether the master is waiting on condMaster
+    std::atomic<bool> fMasterWaiting;
+
+    //! The temporary evaluation result.
+    std::atomic<bool> fAllOk;
+
+    //! Mutex used only to put threads without work to sleep
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,122 +84,208 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The maximum number of elements claimed in one go
+    uint32_t nBatchSize;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    /** A range is packed as the low 16 bits of its round, its begin and its end. */
+    static uint64_t PackRange(uint32_t round, uint32_t begin, uint32_t end)
+    {
+        return (uint64_t(round & 0xffff) << 48) | (uint64_t(begin) << 24) | end;
+    }
+    static bool RangeIsOfRound(uint64_t range, uint32_t round) { return (range >> 48) == (round & 0xffff); }
+    static uint32_t RangeBegin(uint64_t range) { return (range >> 24) & 0xffffff; }
+    static uint32_t RangeEnd(uint64_t range) { return range & 0xffffff; }
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    T& At(uint32_t index)
+    {
+        return segments[index / SEGMENT_SIZE][index % SEGMENT_SIZE];
+    }
 
-    //! The temporary evaluation result.
-    bool fAllOk;
+    uint32_t CurrentRound() const
+    {
+        return frontier.load() >> 32;
+    }
 
-    /**
-     * Number of verifications that haven't completed yet.
-     * This includes elements that are not anymore in queue, but still in
-     * worker's own batches.
-     */
-    unsigned int nTodo;
+    void WakeSleepers(bool fAll)
+    {
+        const bool fWorkers = nSleeping.load() > 0;
+        const bool fMaster = fMasterWaiting.load();
+        if (!fWorkers && !fMaster)
+            return;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (fAll)
+            condWorker.notify_all();
+        else
+            condWorker.notify_one();
+        if (fMaster)
+            condMaster.notify_one();
+    }
 
-    //! Whether we're shutting down.
-    bool fQuit;
+    void WakeMaster()
+    {
+        if (!fMasterWaiting.load())
+            return;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        condMaster.notify_one();
+    }
 
-    //! The maximum number of elements to be processed in one batch
-    unsigned int nBatchSize;
+    /** Move the next unclaimed checks into the range of this worker. */
+    bool Claim(uint32_t slot, uint32_t round)
+    {
+        uint64_t current = frontier.load();
+        while ((current >> 32) == round) {
+            const uint32_t begin = uint32_t(current);
+            // nAdded is reset before the round number changes, so a stale value makes the exchange fail
+            const uint32_t added = nAdded.load();
+            if (begin >= added)
+                return false;
+            // Leave a share for every other worker, but do not claim more than nBatchSize at once
+            const uint32_t nNow = std::max(1U, std::min(nBatchSize, (added - begin) / (nWorkers.load() + 1)));
+            if (frontier.compare_exchange_weak(current, (uint64_t(round) << 32) | (begin + nNow))) {
+                ranges[slot].store(PackRange(round, begin, begin + nNow));
+                if (nNow > 1)
+                    WakeSleepers(false);
+                return true;
+            }
+        }
+        return false;
+    }
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
-    {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master he can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+    /** Move the back half of the range of another worker into the range of this worker. */
+    bool Steal(uint32_t slot, uint32_t round)
+    {
+        const uint32_t nSlots = nWorkers.load() + 1;
+        for (uint32_t offset = 1; offset < nSlots; offset++) {
+            std::atomic<uint64_t>& victim = ranges[(slot + offset) % nSlots];
+            uint64_t current = victim.load();
+            while (RangeIsOfRound(current, round) && RangeBegin(current) < RangeEnd(current)) {
+                const uint32_t begin = RangeBegin(current);
+                const uint32_t end = RangeEnd(current);
+                const uint32_t nStolen = (end - begin + 1) / 2;
+                if (victim.compare_exchange_weak(current, PackRange(round, begin, end - nStolen))) {
+                    ranges[slot].store(PackRange(round, end - nStolen, end));
+                    if (nStolen > 1)
+                        WakeSleepers(false);
+                    return true;
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+        }
+        return false;
+    }
+
+    /** Run the checks in the range of this worker, taking them one at a time from the front. */
+    void RunRange(uint32_t slot, uint32_t round)
+    {
+        std::atomic<uint64_t>& range = ranges[slot];
+        uint64_t current = range.load();
+        while (RangeIsOfRound(current, round) && RangeBegin(current) < RangeEnd(current)) {
+            const uint32_t begin = RangeBegin(current);
+            if (!range.compare_exchange_weak(current, PackRange(round, begin + 1, RangeEnd(current))))
+                continue;
+            if (fAllOk.load(std::memory_order_relaxed)) {
+                T check;
+                check.swap(At(begin));
+                if (!check())
+                    fAllOk.store(false);
+            }
+            if (nDone.fetch_add(1) + 1 == nAdded.load())
+                // We processed the last element; inform the master it can exit and return the result
+                WakeMaster();
+            current = range.load();
+        }
+    }
+
+    bool HasWork(uint32_t round)
+    {
+        const uint64_t current = frontier.load();
+        if ((current >> 32) == round && uint32_t(current) < nAdded.load())
+            return true;
+        const uint32_t nSlots = nWorkers.load() + 1;
+        for (uint32_t slot = 0; slot < nSlots; slot++) {
+            const uint64_t range = ranges[slot].load();
+            if (RangeIsOfRound(range, round) && RangeBegin(range) < RangeEnd(range))
+                return true;
+        }
+        return false;
+    }
+
+    bool IsRoundDone()
+    {
+        return nDone.load() == nAdded.load();
+    }
+
+    /** Internal function that does bulk of the verification work. */
+    void Loop(uint32_t slot, bool fMaster)
+    {
+        while (true) {
+            const uint32_t round = CurrentRound();
+            if (Claim(slot, round) || Steal(slot, round)) {
+                RunRange(slot, round);
+                continue;
+            }
+            if (fMaster && IsRoundDone())
+                return;
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster) {
+                fMasterWaiting.store(true);
+                while (!HasWork(CurrentRound()) && !IsRoundDone())
+                    condMaster.wait(lock);
+                fMasterWaiting.store(false);
+            } else {
+                nSleeping++;
+                while (!HasWork(CurrentRound()))
+                    condWorker.wait(lock);
+                nSleeping--;
+            }
+        }
     }
 
 public:
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn) : segments(MAX_CHECKS / SEGMENT_SIZE), nAdded(0), nDone(0), frontier(0), nWorkers(0), nSleeping(0), fMasterWaiting(false), fAllOk(true), nBatchSize(nBatchSizeIn)
+    {
+        for (std::atomic<uint64_t>& range : ranges)
+            range.store(0);
+    }
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        const uint32_t slot = ++nWorkers;
+        assert(slot < MAX_WORKERS);
+        Loop(slot, false);
     }
 
     //! Wait until execution finishes, and return whether all evaluations where successful.
     bool Wait()
     {
-        return Loop(true);
+        Loop(0, true);
+        const bool fRet = fAllOk.load();
+        // reset the status for new work later; nAdded has to be cleared before the round number moves on
+        nAdded.store(0);
+        nDone.store(0);
+        fAllOk.store(true);
+        frontier.store(uint64_t(CurrentRound() + 1) << 32);
+        return fRet;
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        // once a check failed, the outcome is known and the rest need not run
+        if (vChecks.empty() || !fAllOk.load(std::memory_order_relaxed))
+            return;
+        uint32_t added = nAdded.load(std::memory_order_relaxed);
+        assert(added + vChecks.size() <= MAX_CHECKS);
+        for (T& check : vChecks) {
+            std::unique_ptr<T[]>& segment = segments[added / SEGMENT_SIZE];
+            if (!segment)
+                segment.reset(new T[SEGMENT_SIZE]);
+            check.swap(segment[added % SEGMENT_SIZE]);
+            added++;
         }
-        nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+        nAdded.store(added);
+        WakeSleepers(vChecks.size() > 1);
     }
 
     ~CCheckQueue()
@@ -163,8 +294,13 @@ public:
 
     bool IsIdle()
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        return nAdded.load() == 0 && fAllOk.load();
+    }
+
+    //! Whether a check of the current round has already failed
+    bool HasFailed()
+    {
+        return !fAllOk.load(std::memory_order_relaxed);
     }
 };
 
@@ -204,6 +340,11 @@ public:
             pqueue->Add(vChecks);
     }
 
+    bool HasFailed()
+    {
+        return pqueue != NULL && pqueue->HasFailed();
+    }
+
     ~CCheckQueueControl()
     {
         if (!fDone)
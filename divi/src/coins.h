@@ -7,6 +7,8 @@
 #define BITCOIN_COINS_H
 
 #include "compressor.h"
+#include "core_memusage.h"
+#include "memusage.h"
 #include "script/standard.h"
 #include "serialize.h"
 #include "uint256.h"
@@ -120,6 +122,15 @@ public:
     //! note that only !IsPruned() CCoins can be serialized
     bool IsPruned() const;
 
+    //! heap memory held by the outputs and their scripts
+    size_t DynamicMemoryUsage() const
+    {
+        size_t ret = memusage::DynamicUsage(vout);
+        for (const CTxOut& out : vout)
+            ret += RecursiveDynamicUsage(out.scriptPubKey);
+        return ret;
+    }
+
     //! equality test
     friend bool operator==(const CCoins& a, const CCoins& b)
     {
@@ -253,13 +264,24 @@ public:
 struct CCoinsCacheEntry {
     CCoins coins; // The actual cached data.
     unsigned char flags;
+    std::vector<bool> unspentInBase; // Which outputs the parent view had unspent when this entry was fetched.
+    int nHeightInBase; // The height the parent view had for them.
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
         FRESH = (1 << 1), // The parent view does not have this entry (or it is pruned).
     };
 
-    CCoinsCacheEntry() : coins(), flags(0) {}
+    CCoinsCacheEntry() : coins(), flags(0), unspentInBase(), nHeightInBase(0) {}
+
+    //! Remember the outputs of the parent's version, so that writing the entry back only touches the outputs that changed
+    void SetBaseState(const CCoins& base)
+    {
+        unspentInBase.resize(base.vout.size());
+        for (unsigned int n = 0; n < base.vout.size(); n++)
+            unspentInBase[n] = !base.vout[n].IsNull();
+        nHeightInBase = base.nHeight;
+    }
 };
 
 typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
@@ -315,6 +337,7 @@ public:
     bool HaveCoins(const uint256& txid) const override;
     uint256 GetBestBlock() const override;
     void SetBackend(CCoinsView& viewIn);
+    const CCoinsView& GetBackend() const;
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
     bool GetStats(CCoinsStats& stats) const override;
 };
@@ -344,7 +367,8 @@ class CCoinsModifier
 private:
     CCoinsViewCache& cache;
     CCoinsMap::iterator it;
-    CCoinsModifier(CCoinsViewCache& cache_, CCoinsMap::iterator it_);
+    size_t cachedCoinUsage; // Cached memory usage of the CCoins object before modification
+    CCoinsModifier(CCoinsViewCache& cache_, CCoinsMap::iterator it_, size_t usage);
 
 public:
     CCoins* operator->() { return &it->second.coins; }
@@ -367,6 +391,9 @@ protected:
     mutable uint256 hashBlock;
     mutable CCoinsMap cacheCoins;
 
+    /* Cached dynamic memory usage for the inner CCoins objects. */
+    mutable size_t cachedCoinsUsage;
+
 public:
     CCoinsViewCache(CCoinsView* baseIn);
     ~CCoinsViewCache();
@@ -392,6 +419,15 @@ public:
      */
     CCoinsModifier ModifyCoins(const uint256& txid);
 
+    //! Check if the coins of txid are in this cache, without consulting the base view
+    bool HaveCoinsInCache(const uint256& txid) const;
+
+    /**
+     * Add coins read from the base view ahead of their use as an unmodified
+     * entry, taking them out of coins. Does nothing if txid is already cached.
+     */
+    void WarmCoins(const uint256& txid, CCoins& coins);
+
     /**
      * Push the modifications applied to this cache to its base.
      * Failure to call this method before destruction will cause the changes to be forgotten.
@@ -402,6 +438,9 @@ public:
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
+    //! Calculate the size of the cache (in bytes), including the outputs held by each entry
+    size_t DynamicMemoryUsage() const;
+
     /**
      * Amount of divi coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
@@ -0,0 +1,230 @@
+// Copyright (c) 2017-2020 The DIVI Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/divi-config.h"
+#endif
+
+#include "crypto/quark.h"
+
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_skein.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AVX2)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace quark_avx2
+{
+void Blake512_4way(unsigned char* output, const unsigned char* input, size_t len);
+void Keccak512_4way(unsigned char* output, const unsigned char* input, size_t len);
+void Skein512_4way(unsigned char* output, const unsigned char* input, size_t len);
+}
+#endif
+
+// Internal implementation code.
+namespace
+{
+/** Size of each intermediate digest in the Quark chain. */
+static const size_t DIGEST_SIZE = 64;
+/** Number of messages handed to a multi-lane backend at once. */
+static const size_t LANES = 4;
+/** Longest message accepted by QuarkHashBatch's lane buffers, enough for any block header. */
+static const size_t MAX_LANE_MESSAGE_SIZE = 128;
+
+typedef void (*HashType)(unsigned char* output, const unsigned char* input, size_t len);
+
+/** One of the 512-bit hashes chained by Quark, with an optional backend hashing LANES messages at once. */
+struct Hash512
+{
+    HashType hash;
+    HashType hashLanes;
+    size_t maxLaneMessageSize;
+};
+
+#define SPH_HASH512(name)                                                          \
+    void name##512(unsigned char* output, const unsigned char* input, size_t len) \
+    {                                                                              \
+        sph_##name##512_context ctx;                                               \
+        sph_##name##512_init(&ctx);                                                \
+        sph_##name##512(&ctx, input, len);                                         \
+        sph_##name##512_close(&ctx, output);                                       \
+    }
+SPH_HASH512(blake)
+SPH_HASH512(bmw)
+SPH_HASH512(groestl)
+SPH_HASH512(jh)
+SPH_HASH512(keccak)
+SPH_HASH512(skein)
+#undef SPH_HASH512
+
+Hash512 Blake = {blake512, nullptr, 0};
+Hash512 Bmw = {bmw512, nullptr, 0};
+Hash512 Groestl = {groestl512, nullptr, 0};
+Hash512 Jh = {jh512, nullptr, 0};
+Hash512 Keccak = {keccak512, nullptr, 0};
+Hash512 Skein = {skein512, nullptr, 0};
+
+/** Quark picks the next hash from bit 3 of the previous digest at three points in the chain. */
+bool inline SelectsFirst(const unsigned char* digest)
+{
+    return (digest[0] & 8) != 0;
+}
+
+/** Hash `lanes` (at most LANES) messages of `len` bytes stored back to back. */
+void HashLanes(const Hash512& hasher, unsigned char* output, const unsigned char* input, size_t len, size_t lanes)
+{
+    if (hasher.hashLanes && lanes > 1 && len <= hasher.maxLaneMessageSize) {
+        if (lanes == LANES) {
+            hasher.hashLanes(output, input, len);
+            return;
+        }
+        unsigned char paddedInput[LANES * MAX_LANE_MESSAGE_SIZE] = {};
+        unsigned char paddedOutput[LANES * DIGEST_SIZE];
+        memcpy(paddedInput, input, len * lanes);
+        hasher.hashLanes(paddedOutput, paddedInput, len);
+        memcpy(output, paddedOutput, DIGEST_SIZE * lanes);
+        return;
+    }
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        hasher.hash(output + DIGEST_SIZE * lane, input + len * lane, len);
+    }
+}
+
+/** Hash each digest with `first` when it selects it, and with `second` otherwise. */
+void HashLanesBySelection(const Hash512& first, const Hash512& second, unsigned char* output, const unsigned char* input, size_t lanes)
+{
+    unsigned char grouped[LANES * DIGEST_SIZE];
+    unsigned char hashed[LANES * DIGEST_SIZE];
+    size_t lanesOfGroup[LANES];
+    size_t firstCount = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        if (SelectsFirst(input + DIGEST_SIZE * lane)) lanesOfGroup[firstCount++] = lane;
+    }
+    size_t secondCount = firstCount;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        if (!SelectsFirst(input + DIGEST_SIZE * lane)) lanesOfGroup[secondCount++] = lane;
+    }
+    for (size_t index = 0; index < lanes; ++index) {
+        memcpy(grouped + DIGEST_SIZE * index, input + DIGEST_SIZE * lanesOfGroup[index], DIGEST_SIZE);
+    }
+    HashLanes(first, hashed, grouped, DIGEST_SIZE, firstCount);
+    HashLanes(second, hashed + DIGEST_SIZE * firstCount, grouped + DIGEST_SIZE * firstCount, DIGEST_SIZE, lanes - firstCount);
+    for (size_t index = 0; index < lanes; ++index) {
+        memcpy(output + DIGEST_SIZE * lanesOfGroup[index], hashed + DIGEST_SIZE * index, DIGEST_SIZE);
+    }
+}
+
+/** The Quark chain over `lanes` messages, leaving the final 512-bit digests in `digests`. */
+void QuarkLanes(unsigned char* digests, const unsigned char* input, size_t len, size_t lanes)
+{
+    unsigned char scratch[LANES * DIGEST_SIZE];
+    HashLanes(Blake, digests, input, len, lanes);
+    HashLanes(Bmw, scratch, digests, DIGEST_SIZE, lanes);
+    HashLanesBySelection(Groestl, Skein, digests, scratch, lanes);
+    HashLanes(Groestl, scratch, digests, DIGEST_SIZE, lanes);
+    HashLanes(Jh, digests, scratch, DIGEST_SIZE, lanes);
+    HashLanesBySelection(Blake, Bmw, scratch, digests, lanes);
+    HashLanes(Keccak, digests, scratch, DIGEST_SIZE, lanes);
+    HashLanes(Skein, scratch, digests, DIGEST_SIZE, lanes);
+    HashLanesBySelection(Keccak, Jh, digests, scratch, lanes);
+}
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AVX2)
+/** Check whether the OS saves the AVX (YMM) register state on context switches. */
+bool AVXEnabledByOS()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+#endif
+
+} // namespace
+
+std::string QuarkAutoDetect()
+{
+    std::string ret = "standard";
+    Blake.hashLanes = nullptr;
+    Keccak.hashLanes = nullptr;
+    Skein.hashLanes = nullptr;
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AVX2)
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return ret;
+    }
+    const bool haveAVX = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabledByOS();
+    if (haveAVX && __get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx >> 5) & 1) {
+            Blake = {blake512, quark_avx2::Blake512_4way, 111};
+            Keccak = {keccak512, quark_avx2::Keccak512_4way, 71};
+            Skein = {skein512, quark_avx2::Skein512_4way, 64};
+            ret += ",avx2(4way blake,keccak,skein)";
+        }
+    }
+#endif
+#endif
+    return ret;
+}
+
+void QuarkHash(unsigned char* output, const unsigned char* input, size_t len)
+{
+    unsigned char hash[2][DIGEST_SIZE];
+    blake512(hash[0], input, len);
+    bmw512(hash[1], hash[0], DIGEST_SIZE);
+    if (SelectsFirst(hash[1])) {
+        groestl512(hash[0], hash[1], DIGEST_SIZE);
+    } else {
+        skein512(hash[0], hash[1], DIGEST_SIZE);
+    }
+    groestl512(hash[1], hash[0], DIGEST_SIZE);
+    jh512(hash[0], hash[1], DIGEST_SIZE);
+    if (SelectsFirst(hash[0])) {
+        blake512(hash[1], hash[0], DIGEST_SIZE);
+    } else {
+        bmw512(hash[1], hash[0], DIGEST_SIZE);
+    }
+    keccak512(hash[0], hash[1], DIGEST_SIZE);
+    skein512(hash[1], hash[0], DIGEST_SIZE);
+    if (SelectsFirst(hash[1])) {
+        keccak512(hash[0], hash[1], DIGEST_SIZE);
+    } else {
+        jh512(hash[0], hash[1], DIGEST_SIZE);
+    }
+    memcpy(output, hash[0], QUARK_OUTPUT_SIZE);
+}
+
+void QuarkHashBatch(unsigned char* output, const unsigned char* input, size_t len, size_t count)
+{
+    if (len > MAX_LANE_MESSAGE_SIZE) {
+        for (size_t message = 0; message < count; ++message) {
+            QuarkHash(output + QUARK_OUTPUT_SIZE * message, input + len * message, len);
+        }
+        return;
+    }
+    unsigned char digests[LANES * DIGEST_SIZE];
+    while (count > 0) {
+        const size_t lanes = count < LANES ? count : LANES;
+        QuarkLanes(digests, input, len, lanes);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            memcpy(output + QUARK_OUTPUT_SIZE * lane, digests + DIGEST_SIZE * lane, QUARK_OUTPUT_SIZE);
+        }
+        output += QUARK_OUTPUT_SIZE * lanes;
+        input += len * lanes;
+        count -= lanes;
+    }
+}
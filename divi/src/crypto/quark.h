@@ -0,0 +1,27 @@
+// Copyright (c) 2017-2020 The DIVI Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_QUARK_H
+#define BITCOIN_CRYPTO_QUARK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Size of a Quark digest, the first 256 bits of the last 512-bit hash in the chain. */
+static const size_t QUARK_OUTPUT_SIZE = 32;
+
+/** Autodetect the best available multi-lane Quark backend for this CPU.
+ *  Returns a description of the implementation in use. */
+std::string QuarkAutoDetect();
+
+/** Compute the Quark hash (as used by block headers before version 4) of `len` bytes at `input`. */
+void QuarkHash(unsigned char* output, const unsigned char* input, size_t len);
+
+/** Compute the Quark hashes of `count` messages of `len` bytes each, stored back to back in `input`.
+ *  The 32-byte digests are written back to back to `output`. Independent messages are hashed in
+ *  parallel lanes where the CPU allows it; the result matches calling QuarkHash on each message. */
+void QuarkHashBatch(unsigned char* output, const unsigned char* input, size_t len, size_t count);
+
+#endif // BITCOIN_CRYPTO_QUARK_H
@@ -0,0 +1,292 @@
+// Copyright (c) 2017-2020 The DIVI Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is compiled with AVX2 enabled and may only be called after
+// runtime detection confirmed the instructions are available.
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace quark_avx2 {
+namespace {
+
+/** Number of messages hashed side by side, one per 64-bit lane of a 256-bit register. */
+static const int LANES = 4;
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline AndNot(__m256i x, __m256i y) { return _mm256_andnot_si256(x, y); }
+__m256i inline RotL(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_sll_epi64(x, _mm_cvtsi32_si128(n)), _mm256_srl_epi64(x, _mm_cvtsi32_si128(64 - n)));
+}
+__m256i inline RotR(__m256i x, int n) { return RotL(x, 64 - n); }
+
+/** Word i of each lane's block, lanes being blockSize bytes apart. */
+__m256i inline LoadLE(const unsigned char* blocks, size_t blockSize, int i)
+{
+    return _mm256_set_epi64x(ReadLE64(blocks + 3 * blockSize + 8 * i), ReadLE64(blocks + 2 * blockSize + 8 * i),
+                             ReadLE64(blocks + blockSize + 8 * i), ReadLE64(blocks + 8 * i));
+}
+__m256i inline LoadBE(const unsigned char* blocks, size_t blockSize, int i)
+{
+    return _mm256_set_epi64x(ReadBE64(blocks + 3 * blockSize + 8 * i), ReadBE64(blocks + 2 * blockSize + 8 * i),
+                             ReadBE64(blocks + blockSize + 8 * i), ReadBE64(blocks + 8 * i));
+}
+
+/** Write the eight words of each lane's 512-bit digest to output, one 64-byte digest per lane. */
+template <void (*Write)(unsigned char*, uint64_t)>
+void inline StoreDigests(unsigned char* output, const __m256i* words)
+{
+    uint64_t lanes[LANES];
+    for (int i = 0; i < 8; ++i) {
+        _mm256_storeu_si256((__m256i*)lanes, words[i]);
+        for (int lane = 0; lane < LANES; ++lane) {
+            Write(output + 64 * lane + 8 * i, lanes[lane]);
+        }
+    }
+}
+
+/* ----------- BLAKE-512 ------------------------------------------------- */
+
+const uint64_t BLAKE512_IV[8] = {
+    0x6A09E667F3BCC908ull, 0xBB67AE8584CAA73Bull, 0x3C6EF372FE94F82Bull, 0xA54FF53A5F1D36F1ull,
+    0x510E527FADE682D1ull, 0x9B05688C2B3E6C1Full, 0x1F83D9ABFB41BD6Bull, 0x5BE0CD19137E2179ull};
+
+const uint64_t BLAKE512_C[16] = {
+    0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull,
+    0x452821E638D01377ull, 0xBE5466CF34E90C6Cull, 0xC0AC29B7C97C50DDull, 0x3F84D5B5B5470917ull,
+    0x9216D5D98979FB1Bull, 0xD1310BA698DFB5ACull, 0x2FFD72DBD01ADFB7ull, 0xB8E1AFED6A267E96ull,
+    0xBA7C9045F12C7F99ull, 0x24A19947B3916CF7ull, 0x0801F2E2858EFC16ull, 0x636920D871574E69ull};
+
+const unsigned char BLAKE_SIGMA[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0}};
+
+void inline BlakeG(const __m256i* m, const unsigned char* sigma, int i, __m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    const int m0 = sigma[2 * i], m1 = sigma[2 * i + 1];
+    a = Add(Add(a, b), Xor(m[m0], K(BLAKE512_C[m1])));
+    d = RotR(Xor(d, a), 32);
+    c = Add(c, d);
+    b = RotR(Xor(b, c), 25);
+    a = Add(Add(a, b), Xor(m[m1], K(BLAKE512_C[m0])));
+    d = RotR(Xor(d, a), 16);
+    c = Add(c, d);
+    b = RotR(Xor(b, c), 11);
+}
+
+/* ----------- Keccak-512 ------------------------------------------------ */
+
+const uint64_t KECCAK_RC[24] = {
+    0x0000000000000001ull, 0x0000000000008082ull, 0x800000000000808Aull, 0x8000000080008000ull,
+    0x000000000000808Bull, 0x0000000080000001ull, 0x8000000080008081ull, 0x8000000000008009ull,
+    0x000000000000008Aull, 0x0000000000000088ull, 0x0000000080008009ull, 0x000000008000000Aull,
+    0x000000008000808Bull, 0x800000000000008Bull, 0x8000000000008089ull, 0x8000000000008003ull,
+    0x8000000000008002ull, 0x8000000000000080ull, 0x000000000000800Aull, 0x800000008000000Aull,
+    0x8000000080008081ull, 0x8000000000008080ull, 0x0000000080000001ull, 0x8000000080008008ull};
+
+/** Rotation of lane x + 5y in the rho step. */
+const int KECCAK_RHO[25] = {
+    0, 1, 62, 28, 27,
+    36, 44, 6, 55, 20,
+    3, 10, 43, 25, 39,
+    41, 45, 15, 21, 8,
+    18, 2, 61, 56, 14};
+
+void KeccakF1600(__m256i* a)
+{
+    __m256i b[25];
+    __m256i c[5];
+    for (int round = 0; round < 24; ++round) {
+        // theta
+        for (int x = 0; x < 5; ++x) {
+            c[x] = Xor(Xor(Xor(a[x], a[x + 5]), Xor(a[x + 10], a[x + 15])), a[x + 20]);
+        }
+        for (int x = 0; x < 5; ++x) {
+            const __m256i d = Xor(c[(x + 4) % 5], RotL(c[(x + 1) % 5], 1));
+            for (int y = 0; y < 25; y += 5) {
+                a[x + y] = Xor(a[x + y], d);
+            }
+        }
+        // rho and pi
+        for (int x = 0; x < 5; ++x) {
+            for (int y = 0; y < 5; ++y) {
+                const int lane = x + 5 * y;
+                b[y + 5 * ((2 * x + 3 * y) % 5)] = KECCAK_RHO[lane] ? RotL(a[lane], KECCAK_RHO[lane]) : a[lane];
+            }
+        }
+        // chi
+        for (int y = 0; y < 25; y += 5) {
+            for (int x = 0; x < 5; ++x) {
+                a[x + y] = Xor(b[x + y], AndNot(b[(x + 1) % 5 + y], b[(x + 2) % 5 + y]));
+            }
+        }
+        // iota
+        a[0] = Xor(a[0], K(KECCAK_RC[round]));
+    }
+}
+
+/* ----------- Skein-512 ------------------------------------------------- */
+
+const uint64_t SKEIN512_IV[8] = {
+    0x4903ADFF749C51CEull, 0x0D95DE399746DF03ull, 0x8FD1934127C79BCEull, 0x9A255629FF352CB1ull,
+    0x5DB62599DF6CA7B0ull, 0xEABE394CA9D5C3F4ull, 0x991112C71A75B523ull, 0xAE18A40B660FCC33ull};
+
+/** Threefish-512 mix of two words. */
+void inline Mix(__m256i& x0, __m256i& x1, int rotation)
+{
+    x0 = Add(x0, x1);
+    x1 = Xor(RotL(x1, rotation), x0);
+}
+
+/** Four Threefish-512 rounds. The word permutation is folded into the order of the mixes. */
+void inline FourRounds(__m256i* p, const int* rotations)
+{
+    Mix(p[0], p[1], rotations[0]); Mix(p[2], p[3], rotations[1]); Mix(p[4], p[5], rotations[2]); Mix(p[6], p[7], rotations[3]);
+    Mix(p[2], p[1], rotations[4]); Mix(p[4], p[7], rotations[5]); Mix(p[6], p[5], rotations[6]); Mix(p[0], p[3], rotations[7]);
+    Mix(p[4], p[1], rotations[8]); Mix(p[6], p[3], rotations[9]); Mix(p[0], p[5], rotations[10]); Mix(p[2], p[7], rotations[11]);
+    Mix(p[6], p[1], rotations[12]); Mix(p[0], p[7], rotations[13]); Mix(p[2], p[5], rotations[14]); Mix(p[4], p[3], rotations[15]);
+}
+
+const int SKEIN_EVEN_ROTATIONS[16] = {46, 36, 19, 37, 33, 27, 14, 42, 17, 49, 36, 39, 44, 9, 54, 56};
+const int SKEIN_ODD_ROTATIONS[16] = {39, 30, 34, 24, 13, 50, 10, 17, 25, 29, 39, 43, 8, 35, 56, 22};
+
+/** One UBI block: h = Threefish_h,tweak(m) ^ m. The tweak is identical in every lane. */
+void SkeinUbi(__m256i* h, const __m256i* m, uint64_t tweak0, uint64_t tweak1)
+{
+    __m256i k[9];
+    k[8] = K(0x1BD11BDAA9FC1A22ull);
+    for (int i = 0; i < 8; ++i) {
+        k[i] = h[i];
+        k[8] = Xor(k[8], h[i]);
+    }
+    const __m256i t[3] = {K(tweak0), K(tweak1), K(tweak0 ^ tweak1)};
+
+    __m256i p[8];
+    for (int i = 0; i < 8; ++i) {
+        p[i] = m[i];
+    }
+    for (int s = 0; s <= 18; ++s) {
+        for (int i = 0; i < 8; ++i) {
+            p[i] = Add(p[i], k[(s + i) % 9]);
+        }
+        p[5] = Add(p[5], t[s % 3]);
+        p[6] = Add(p[6], t[(s + 1) % 3]);
+        p[7] = Add(p[7], K(s));
+        if (s == 18) break;
+        FourRounds(p, (s % 2 == 0) ? SKEIN_EVEN_ROTATIONS : SKEIN_ODD_ROTATIONS);
+    }
+    for (int i = 0; i < 8; ++i) {
+        h[i] = Xor(m[i], p[i]);
+    }
+}
+
+} // namespace
+
+/** BLAKE-512 of four len-byte messages stored back to back, len at most 111 (one block). */
+void Blake512_4way(unsigned char* output, const unsigned char* input, size_t len)
+{
+    unsigned char blocks[128 * LANES];
+    memset(blocks, 0, sizeof(blocks));
+    for (int lane = 0; lane < LANES; ++lane) {
+        unsigned char* block = blocks + 128 * lane;
+        memcpy(block, input + len * lane, len);
+        block[len] = 0x80;
+        block[111] |= 1;
+        WriteBE64(block + 120, len << 3);
+    }
+
+    __m256i m[16];
+    for (int i = 0; i < 16; ++i) {
+        m[i] = LoadBE(blocks, 128, i);
+    }
+    __m256i v[16];
+    for (int i = 0; i < 8; ++i) {
+        v[i] = K(BLAKE512_IV[i]);
+        v[i + 8] = K(BLAKE512_C[i]);
+    }
+    // Counter of message bits, the block holds the whole message
+    v[12] = Xor(v[12], K(len << 3));
+    v[13] = Xor(v[13], K(len << 3));
+
+    for (int round = 0; round < 16; ++round) {
+        const unsigned char* sigma = BLAKE_SIGMA[round % 10];
+        BlakeG(m, sigma, 0, v[0], v[4], v[8], v[12]);
+        BlakeG(m, sigma, 1, v[1], v[5], v[9], v[13]);
+        BlakeG(m, sigma, 2, v[2], v[6], v[10], v[14]);
+        BlakeG(m, sigma, 3, v[3], v[7], v[11], v[15]);
+        BlakeG(m, sigma, 4, v[0], v[5], v[10], v[15]);
+        BlakeG(m, sigma, 5, v[1], v[6], v[11], v[12]);
+        BlakeG(m, sigma, 6, v[2], v[7], v[8], v[13]);
+        BlakeG(m, sigma, 7, v[3], v[4], v[9], v[14]);
+    }
+
+    __m256i h[8];
+    for (int i = 0; i < 8; ++i) {
+        h[i] = Xor(K(BLAKE512_IV[i]), Xor(v[i], v[i + 8]));
+    }
+    StoreDigests<WriteBE64>(output, h);
+}
+
+/** Keccak-512 of four len-byte messages stored back to back, len at most 71 (one block). */
+void Keccak512_4way(unsigned char* output, const unsigned char* input, size_t len)
+{
+    unsigned char blocks[72 * LANES];
+    memset(blocks, 0, sizeof(blocks));
+    for (int lane = 0; lane < LANES; ++lane) {
+        unsigned char* block = blocks + 72 * lane;
+        memcpy(block, input + len * lane, len);
+        block[len] = 0x01;
+        block[71] |= 0x80;
+    }
+
+    __m256i a[25];
+    for (int i = 0; i < 25; ++i) {
+        a[i] = i < 9 ? LoadLE(blocks, 72, i) : _mm256_setzero_si256();
+    }
+    KeccakF1600(a);
+    StoreDigests<WriteLE64>(output, a);
+}
+
+/** Skein-512-512 of four len-byte messages stored back to back, len at most 64 (one block). */
+void Skein512_4way(unsigned char* output, const unsigned char* input, size_t len)
+{
+    unsigned char blocks[64 * LANES];
+    memset(blocks, 0, sizeof(blocks));
+    for (int lane = 0; lane < LANES; ++lane) {
+        memcpy(blocks + 64 * lane, input + len * lane, len);
+    }
+
+    __m256i h[8];
+    __m256i m[8];
+    for (int i = 0; i < 8; ++i) {
+        h[i] = K(SKEIN512_IV[i]);
+        m[i] = LoadLE(blocks, 64, i);
+    }
+    // Message block (type 48, first and final), then the output block (type 63, first and final)
+    SkeinUbi(h, m, len, (uint64_t)480 << 55);
+    for (int i = 0; i < 8; ++i) {
+        m[i] = _mm256_setzero_si256();
+    }
+    SkeinUbi(h, m, 8, (uint64_t)510 << 55);
+    StoreDigests<WriteLE64>(output, h);
+}
+
+} // namespace quark_avx2
+
+#endif
@@ -2,12 +2,44 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/divi-config.h"
+#endif
+
 #include "crypto/sha256.h"
 
 #include "crypto/common.h"
 
+#include <assert.h>
 #include <string.h>
 
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_SSE41) || defined(ENABLE_AVX2) || defined(ENABLE_SHANI)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(ENABLE_SSE41)
+namespace sha256_sse41
+{
+void Transform_4way(uint32_t* s, const unsigned char* chunks);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* chunks);
+}
+#endif
+
+#if defined(ENABLE_SHANI)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+#endif
+
 // Internal implementation code.
 namespace
 {
@@ -127,9 +159,131 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     s[7] += h;
 }
 
+/** Perform SHA-256 transformations on `blocks` consecutive 64-byte chunks. */
+void TransformBlocks(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    while (blocks--) {
+        Transform(s, chunk);
+        chunk += 64;
+    }
+}
+
 } // namespace sha256
+
+typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
+typedef void (*TransformLanesType)(uint32_t*, const unsigned char*);
+
+/** Single-lane backend used by CSHA256, replaced by SHA256AutoDetect with a hardware one where available. */
+TransformType Transform = sha256::TransformBlocks;
+
+/** Multi-lane backends, enabled by SHA256AutoDetect once the CPU is known to support them. */
+TransformLanesType Transform4 = nullptr;
+TransformLanesType Transform8 = nullptr;
+
+/** Perform independent SHA-256 transformations on `lanes` consecutive states and chunks. */
+void TransformLanes(uint32_t* s, const unsigned char* chunks, size_t lanes)
+{
+    while (Transform8 && lanes >= 8) {
+        Transform8(s, chunks);
+        s += 64;
+        chunks += 512;
+        lanes -= 8;
+    }
+    while (Transform4 && lanes >= 4) {
+        Transform4(s, chunks);
+        s += 32;
+        chunks += 256;
+        lanes -= 4;
+    }
+    while (lanes > 0) {
+        Transform(s, chunks, 1);
+        s += 8;
+        chunks += 64;
+        --lanes;
+    }
+}
+
+/** Hash the first-round digests held in `lanes` states again, writing the final digests to `output`.
+ *  `chunks` is scratch space for as many 64-byte chunks. */
+void FinishDoubleHashLanes(unsigned char* output, uint32_t* states, unsigned char* chunks, size_t lanes)
+{
+    memset(chunks, 0, 64 * lanes);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        unsigned char* chunk = chunks + 64 * lane;
+        for (int i = 0; i < 8; ++i) {
+            WriteBE32(chunk + 4 * i, states[8 * lane + i]);
+        }
+        chunk[32] = 0x80;
+        WriteBE64(chunk + 56, 256);
+        sha256::Initialize(states + 8 * lane);
+    }
+    TransformLanes(states, chunks, lanes);
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        for (int i = 0; i < 8; ++i) {
+            WriteBE32(output + CSHA256::OUTPUT_SIZE * lane + 4 * i, states[8 * lane + i]);
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_AVX2)
+/** Check whether the OS saves the AVX (YMM) register state on context switches. */
+bool AVXEnabledByOS()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+#endif
+
 } // namespace
 
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation)
+{
+    std::string ret = "standard";
+    Transform = sha256::TransformBlocks;
+    Transform4 = nullptr;
+    Transform8 = nullptr;
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(ENABLE_SSE41) || defined(ENABLE_AVX2) || defined(ENABLE_SHANI)
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return ret;
+    }
+#if defined(ENABLE_SHANI)
+    // The SHA extensions outrun the multi-lane backends even on independent messages, so use them alone.
+    if ((use_implementation & sha256_implementation::USE_SHANI) && ((ecx >> 19) & 1) && __get_cpuid_max(0, nullptr) >= 7) {
+        uint32_t ebx7, unused;
+        __cpuid_count(7, 0, unused, ebx7, unused, unused);
+        if ((ebx7 >> 29) & 1) {
+            Transform = sha256_shani::Transform;
+            return "shani(1way)";
+        }
+    }
+#endif
+#if defined(ENABLE_SSE41)
+    if ((use_implementation & sha256_implementation::USE_SSE4) && ((ecx >> 19) & 1)) {
+        Transform4 = sha256_sse41::Transform_4way;
+        ret += ",sse41(4way)";
+    }
+#endif
+#if defined(ENABLE_AVX2)
+    const bool haveAVX = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabledByOS();
+    if ((use_implementation & sha256_implementation::USE_AVX2) && haveAVX && __get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if ((ebx >> 5) & 1) {
+            Transform8 = sha256_avx2::Transform_8way;
+            ret += ",avx2(8way)";
+        }
+    }
+#endif
+#endif
+#endif
+    return ret;
+}
+
 
 ////// SHA-256
 
@@ -147,14 +301,15 @@ CSHA256& CSHA256::Write(const unsigned char* data, size_t len)
         memcpy(buf + bufsize, data, 64 - bufsize);
         bytes += 64 - bufsize;
         data += 64 - bufsize;
-        sha256::Transform(s, buf);
+        Transform(s, buf, 1);
         bufsize = 0;
     }
-    while (end >= data + 64) {
+    if (end - data >= 64) {
         // Process full chunks directly from the source.
-        sha256::Transform(s, data);
-        bytes += 64;
-        data += 64;
+        const size_t blocks = (end - data) / 64;
+        Transform(s, data, blocks);
+        bytes += 64 * blocks;
+        data += 64 * blocks;
     }
     if (end > data) {
         // Fill the buffer with what remains.
@@ -187,3 +342,89 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+void SHA256DBatch(unsigned char* output, const unsigned char* input, size_t len, size_t count)
+{
+    assert(len <= SHA256D_BATCH_MAX_MESSAGE_SIZE);
+    static const size_t MAX_LANES = 8;
+    uint32_t states[8 * MAX_LANES];
+    unsigned char chunks[64 * MAX_LANES];
+    while (count > 0) {
+        const size_t lanes = count < MAX_LANES ? count : MAX_LANES;
+
+        // First hash: each message, with its padding, fits a single chunk.
+        memset(chunks, 0, 64 * lanes);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            unsigned char* chunk = chunks + 64 * lane;
+            memcpy(chunk, input + len * lane, len);
+            chunk[len] = 0x80;
+            WriteBE64(chunk + 56, len << 3);
+            sha256::Initialize(states + 8 * lane);
+        }
+        TransformLanes(states, chunks, lanes);
+
+        FinishDoubleHashLanes(output, states, chunks, lanes);
+        output += CSHA256::OUTPUT_SIZE * lanes;
+        input += len * lanes;
+        count -= lanes;
+    }
+}
+
+void SHA256DBatchWithPrefix(unsigned char* output, const unsigned char* prefix, const unsigned char* input, size_t len, size_t count)
+{
+    assert(len <= SHA256D_BATCH_MAX_MESSAGE_SIZE);
+    static const size_t MAX_LANES = 8;
+    uint32_t midstate[8];
+    sha256::Initialize(midstate);
+    Transform(midstate, prefix, 1);
+
+    uint32_t states[8 * MAX_LANES];
+    unsigned char chunks[64 * MAX_LANES];
+    while (count > 0) {
+        const size_t lanes = count < MAX_LANES ? count : MAX_LANES;
+
+        // First hash: every lane resumes from the prefix, and the rest of its message fits one chunk.
+        memset(chunks, 0, 64 * lanes);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            unsigned char* chunk = chunks + 64 * lane;
+            memcpy(chunk, input + len * lane, len);
+            chunk[len] = 0x80;
+            WriteBE64(chunk + 56, (64 + len) << 3);
+            memcpy(states + 8 * lane, midstate, sizeof(midstate));
+        }
+        TransformLanes(states, chunks, lanes);
+
+        FinishDoubleHashLanes(output, states, chunks, lanes);
+        output += CSHA256::OUTPUT_SIZE * lanes;
+        input += len * lanes;
+        count -= lanes;
+    }
+}
+
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks)
+{
+    static const size_t MAX_LANES = 8;
+    uint32_t states[8 * MAX_LANES];
+    unsigned char chunks[64 * MAX_LANES];
+    while (blocks > 0) {
+        const size_t lanes = blocks < MAX_LANES ? blocks : MAX_LANES;
+
+        // First hash: the 64-byte inputs are chunks already, followed by a chunk of padding.
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            sha256::Initialize(states + 8 * lane);
+        }
+        TransformLanes(states, input, lanes);
+        memset(chunks, 0, 64 * lanes);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            unsigned char* chunk = chunks + 64 * lane;
+            chunk[0] = 0x80;
+            WriteBE64(chunk + 56, 512);
+        }
+        TransformLanes(states, chunks, lanes);
+
+        FinishDoubleHashLanes(output, states, chunks, lanes);
+        output += CSHA256::OUTPUT_SIZE * lanes;
+        input += 64 * lanes;
+        blocks -= lanes;
+    }
+}
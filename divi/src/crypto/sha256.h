@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -25,4 +26,37 @@ public:
     CSHA256& Reset();
 };
 
+namespace sha256_implementation {
+/** Backends SHA256AutoDetect may pick from; tests narrow this down to exercise each of them. */
+enum UseImplementation : uint8_t {
+    USE_STANDARD = 0,
+    USE_SSE4 = 1 << 0,
+    USE_AVX2 = 1 << 1,
+    USE_SHANI = 1 << 2,
+    USE_ALL = USE_SSE4 | USE_AVX2 | USE_SHANI,
+};
+}
+
+/** Autodetect the best available SHA256 backends (SHA extensions, or multi-lane SSE4.1/AVX2) for this CPU,
+ *  among those allowed by use_implementation. Returns a description of the implementation in use. */
+std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implementation = sha256_implementation::USE_ALL);
+
+/** Maximum length of a message accepted by SHA256DBatch (one chunk including padding). */
+static const size_t SHA256D_BATCH_MAX_MESSAGE_SIZE = 55;
+
+/** Compute the double-SHA256 of `count` messages of `len` bytes each, stored back to back in `input`.
+ *  Each message must be at most SHA256D_BATCH_MAX_MESSAGE_SIZE bytes. The 32-byte digests are
+ *  written back to back to `output`. Independent messages are hashed in parallel lanes. */
+void SHA256DBatch(unsigned char* output, const unsigned char* input, size_t len, size_t count);
+
+/** Compute the double-SHA256 of `count` messages that all start with the same 64-byte `prefix`, followed
+ *  by `len` bytes each stored back to back in `input` (at most SHA256D_BATCH_MAX_MESSAGE_SIZE). The prefix
+ *  is compressed once, and the rest of the messages are hashed in parallel lanes. */
+void SHA256DBatchWithPrefix(unsigned char* output, const unsigned char* prefix, const unsigned char* input, size_t len, size_t count);
+
+/** Compute the double-SHA256 of `blocks` 64-byte messages stored back to back in `input`, such as
+ *  the concatenated hash pairs of a merkle tree level. The 32-byte digests are written back to
+ *  back to `output`. */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -0,0 +1,120 @@
+// Copyright (c) 2017 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is compiled with AVX2 enabled and may only be called after
+// runtime detection confirmed the instructions are available.
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace sha256_avx2 {
+namespace {
+
+__m256i inline K(uint32_t x) { return _mm256_set1_epi32(x); }
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z) { return Add(Add(x, y), z); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z, __m256i w) { return Add(Add(x, y), Add(z, w)); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z, __m256i w, __m256i v) { return Add(Add(x, y, z), Add(w, v)); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z) { return Xor(Xor(x, y), z); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__m256i inline ShR(__m256i x, int n) { return _mm256_srli_epi32(x, n); }
+__m256i inline ShL(__m256i x, int n) { return _mm256_slli_epi32(x, n); }
+
+__m256i inline Ch(__m256i x, __m256i y, __m256i z) { return Xor(z, And(x, Xor(y, z))); }
+__m256i inline Maj(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m256i inline Sigma0(__m256i x) { return Xor(Or(ShR(x, 2), ShL(x, 30)), Or(ShR(x, 13), ShL(x, 19)), Or(ShR(x, 22), ShL(x, 10))); }
+__m256i inline Sigma1(__m256i x) { return Xor(Or(ShR(x, 6), ShL(x, 26)), Or(ShR(x, 11), ShL(x, 21)), Or(ShR(x, 25), ShL(x, 7))); }
+__m256i inline sigma0(__m256i x) { return Xor(Or(ShR(x, 7), ShL(x, 25)), Or(ShR(x, 18), ShL(x, 14)), ShR(x, 3)); }
+__m256i inline sigma1(__m256i x) { return Xor(Or(ShR(x, 17), ShL(x, 15)), Or(ShR(x, 19), ShL(x, 13)), ShR(x, 10)); }
+
+/** One round of SHA-256, on eight independent lanes. */
+void inline Round(__m256i a, __m256i b, __m256i c, __m256i& d, __m256i e, __m256i f, __m256i g, __m256i& h, __m256i k)
+{
+    __m256i t1 = Add(h, Sigma1(e), Ch(e, f, g), k);
+    __m256i t2 = Add(Sigma0(a), Maj(a, b, c));
+    d = Add(d, t1);
+    h = Add(t1, t2);
+}
+
+/** Load one big-endian message word from each of the eight lanes' chunks. */
+__m256i inline Read8(const unsigned char* chunks, int offset)
+{
+    return _mm256_set_epi32(ReadBE32(chunks + 448 + offset), ReadBE32(chunks + 384 + offset), ReadBE32(chunks + 320 + offset), ReadBE32(chunks + 256 + offset),
+                            ReadBE32(chunks + 192 + offset), ReadBE32(chunks + 128 + offset), ReadBE32(chunks + 64 + offset), ReadBE32(chunks + offset));
+}
+
+/** Load word i of each of the eight lanes' states. */
+__m256i inline Load8(const uint32_t* s, int i)
+{
+    return _mm256_set_epi32(s[56 + i], s[48 + i], s[40 + i], s[32 + i], s[24 + i], s[16 + i], s[8 + i], s[i]);
+}
+
+/** Add the lane values of v to word i of each of the eight lanes' states. */
+void inline Store8(uint32_t* s, int i, __m256i v)
+{
+    uint32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, v);
+    for (int lane = 0; lane < 8; ++lane) {
+        s[8 * lane + i] += lanes[lane];
+    }
+}
+
+const uint32_t roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+} // namespace
+
+/** Perform eight independent SHA-256 transformations.
+ *  s holds eight consecutive 8-word states, chunks eight consecutive 64-byte blocks. */
+void Transform_8way(uint32_t* s, const unsigned char* chunks)
+{
+    __m256i a = Load8(s, 0), b = Load8(s, 1), c = Load8(s, 2), d = Load8(s, 3);
+    __m256i e = Load8(s, 4), f = Load8(s, 5), g = Load8(s, 6), h = Load8(s, 7);
+    __m256i w[16];
+
+    for (int i = 0; i < 16; ++i) {
+        w[i] = Read8(chunks, 4 * i);
+    }
+    for (int i = 0; i < 64; i += 8) {
+        if (i >= 16) {
+            for (int j = i; j < i + 8; ++j) {
+                w[j & 15] = Add(w[j & 15], sigma1(w[(j + 14) & 15]), w[(j + 9) & 15], sigma0(w[(j + 1) & 15]));
+            }
+        }
+        Round(a, b, c, d, e, f, g, h, Add(K(roundConstants[i + 0]), w[(i + 0) & 15]));
+        Round(h, a, b, c, d, e, f, g, Add(K(roundConstants[i + 1]), w[(i + 1) & 15]));
+        Round(g, h, a, b, c, d, e, f, Add(K(roundConstants[i + 2]), w[(i + 2) & 15]));
+        Round(f, g, h, a, b, c, d, e, Add(K(roundConstants[i + 3]), w[(i + 3) & 15]));
+        Round(e, f, g, h, a, b, c, d, Add(K(roundConstants[i + 4]), w[(i + 4) & 15]));
+        Round(d, e, f, g, h, a, b, c, Add(K(roundConstants[i + 5]), w[(i + 5) & 15]));
+        Round(c, d, e, f, g, h, a, b, Add(K(roundConstants[i + 6]), w[(i + 6) & 15]));
+        Round(b, c, d, e, f, g, h, a, Add(K(roundConstants[i + 7]), w[(i + 7) & 15]));
+    }
+
+    Store8(s, 0, a);
+    Store8(s, 1, b);
+    Store8(s, 2, c);
+    Store8(s, 3, d);
+    Store8(s, 4, e);
+    Store8(s, 5, f);
+    Store8(s, 6, g);
+    Store8(s, 7, h);
+}
+
+} // namespace sha256_avx2
+
+#endif // ENABLE_AVX2
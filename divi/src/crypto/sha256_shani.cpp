@@ -0,0 +1,140 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// Based on https://github.com/noloader/SHA-Intrinsics/blob/master/sha256-x86.c,
+// Written and placed in public domain by Jeffrey Walton.
+// Based on code from Intel, and by Sean Gulley for the miTLS project.
+
+// This file is compiled with SSE4.1 and SHA enabled and may only be called after
+// runtime detection confirmed the instructions are available.
+#ifdef ENABLE_SHANI
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha256_shani {
+namespace {
+
+alignas(16) const uint8_t MASK[16] = {0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04, 0x0b, 0x0a, 0x09, 0x08, 0x0f, 0x0e, 0x0d, 0x0c};
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/** Four rounds of SHA-256, on message words `m` with round constants K[round..round+3]. */
+void inline __attribute__((always_inline)) QuadRound(__m128i& state0, __m128i& state1, __m128i m, int round)
+{
+    const __m128i msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + round)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+void inline __attribute__((always_inline)) ShiftMessageA(__m128i& m0, __m128i m1)
+{
+    m0 = _mm_sha256msg1_epu32(m0, m1);
+}
+
+void inline __attribute__((always_inline)) ShiftMessageC(__m128i& m0, __m128i m1, __m128i& m2)
+{
+    m2 = _mm_sha256msg2_epu32(_mm_add_epi32(m2, _mm_alignr_epi8(m1, m0, 4)), m1);
+}
+
+void inline __attribute__((always_inline)) ShiftMessageB(__m128i& m0, __m128i m1, __m128i& m2)
+{
+    ShiftMessageC(m0, m1, m2);
+    ShiftMessageA(m0, m1);
+}
+
+/** Convert the state from its a..h word order to the ABEF/CDGH layout used by the SHA instructions. */
+void inline __attribute__((always_inline)) Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+void inline __attribute__((always_inline)) Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+__m128i inline __attribute__((always_inline)) Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_load_si128((const __m128i*)MASK));
+}
+
+} // namespace
+
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i m0, m1, m2, m3, s0, s1, so0, so1;
+
+    s0 = _mm_loadu_si128((const __m128i*)s);
+    s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+
+    while (blocks--) {
+        so0 = s0;
+        so1 = s1;
+
+        m0 = Load(chunk);
+        QuadRound(s0, s1, m0, 0);
+        m1 = Load(chunk + 16);
+        QuadRound(s0, s1, m1, 4);
+        ShiftMessageA(m0, m1);
+        m2 = Load(chunk + 32);
+        QuadRound(s0, s1, m2, 8);
+        ShiftMessageA(m1, m2);
+        m3 = Load(chunk + 48);
+        QuadRound(s0, s1, m3, 12);
+        ShiftMessageB(m2, m3, m0);
+        QuadRound(s0, s1, m0, 16);
+        ShiftMessageB(m3, m0, m1);
+        QuadRound(s0, s1, m1, 20);
+        ShiftMessageB(m0, m1, m2);
+        QuadRound(s0, s1, m2, 24);
+        ShiftMessageB(m1, m2, m3);
+        QuadRound(s0, s1, m3, 28);
+        ShiftMessageB(m2, m3, m0);
+        QuadRound(s0, s1, m0, 32);
+        ShiftMessageB(m3, m0, m1);
+        QuadRound(s0, s1, m1, 36);
+        ShiftMessageB(m0, m1, m2);
+        QuadRound(s0, s1, m2, 40);
+        ShiftMessageB(m1, m2, m3);
+        QuadRound(s0, s1, m3, 44);
+        ShiftMessageB(m2, m3, m0);
+        QuadRound(s0, s1, m0, 48);
+        ShiftMessageB(m3, m0, m1);
+        QuadRound(s0, s1, m1, 52);
+        ShiftMessageC(m0, m1, m2);
+        QuadRound(s0, s1, m2, 56);
+        ShiftMessageC(m1, m2, m3);
+        QuadRound(s0, s1, m3, 60);
+
+        s0 = _mm_add_epi32(s0, so0);
+        s1 = _mm_add_epi32(s1, so1);
+
+        chunk += 64;
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+
+} // namespace sha256_shani
+
+#endif
@@ -48,6 +48,18 @@ constexpr unsigned int MAX_P2SH_SIGOPS = 15;
 /** The maximum number of sigops we're willing to relay/mine in a single tx */
 constexpr unsigned int MAX_TX_SIGOPS_CURRENT = MAX_BLOCK_SIGOPS_CURRENT / 5;
 constexpr unsigned int MAX_TX_SIGOPS_LEGACY = MAX_BLOCK_SIGOPS_LEGACY / 5;
+/** Default for -maxmempool, maximum megabytes of mempool memory usage */
+constexpr unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
+constexpr unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
+/** Default for -limitancestorcount, max number of in-mempool ancestors */
+constexpr unsigned int DEFAULT_ANCESTOR_LIMIT = 25;
+/** Default for -limitancestorsize, maximum kilobytes of tx + all in-mempool ancestors */
+constexpr unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = 101;
+/** Default for -limitdescendantcount, max number of in-mempool descendants */
+constexpr unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
+/** Default for -limitdescendantsize, maximum kilobytes of in-mempool descendants */
+constexpr unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 constexpr unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** The maximum size of a blk?????.dat file (since 0.8) */
@@ -64,6 +76,30 @@ constexpr unsigned int LOCKTIME_THRESHOLD = 500000000; // Tue Nov  5 00:53:20 19
 constexpr int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 constexpr int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of threads reading block inputs from the coin database ahead of validation */
+constexpr int MAX_INPUT_PREFETCH_THREADS = 32;
+/** -prefetchthreads default; the reads are latency bound, so this does not depend on the core count */
+constexpr int DEFAULT_INPUT_PREFETCH_THREADS = 8;
+/** Maximum number of threads checking the signatures of relayed messages ahead of their processing */
+constexpr int MAX_MESSAGE_PREVALIDATION_THREADS = 16;
+/** -prevalidationthreads default */
+constexpr int DEFAULT_MESSAGE_PREVALIDATION_THREADS = 4;
+/** Messages waiting on one pre-validation thread beyond which further ones are processed unchecked */
+constexpr unsigned MAX_QUEUED_PREVALIDATION_MESSAGES = 1000;
+/** -maxsigcachesize default (MiB) */
+constexpr int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+/** Maximum -maxsigcachesize (MiB); the cuckoo cache cannot index more than 2^32 entries */
+constexpr int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+/** -maxsigcachesize (MiB) above which startup warns that the option is no longer an entry count */
+constexpr int64_t SIG_CACHE_SIZE_WARNING_THRESHOLD = 1024;
+/** Maximum number of stake-searching threads allowed */
+constexpr int MAX_STAKING_THREADS = 16;
+/** -stakingthreads default (number of stake-searching threads, 0 = auto) */
+constexpr int DEFAULT_STAKING_THREADS = 1;
+/** -rpcthreads default (number of threads executing RPC calls) */
+constexpr int DEFAULT_RPC_THREADS = 4;
+/** -rpcworkqueue default (RPC calls that may wait for a free thread before further ones are refused) */
+constexpr int DEFAULT_RPC_WORK_QUEUE = 16;
 /** Number of blocks that can be requested at any given time from a single peer. */
 constexpr int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
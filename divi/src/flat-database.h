@@ -9,9 +9,14 @@
 #include "clientversion.h"
 #include "hash.h"
 #include "streams.h"
+#include "sync.h"
+#include "util.h"
 #include "utiltime.h"
 #include "Logging.h"
 #include "DataDirectory.h"
+#include "I_JournalWriter.h"
+
+#include <algorithm>
 
 #include <boost/filesystem.hpp>
 
@@ -23,7 +28,7 @@
 template<typename T>
 class CFlatDB
 {
-private:
+protected:
 
     enum ReadResult {
         Ok,
@@ -39,12 +44,8 @@ private:
     std::string strFilename;
     std::string strMagicMessage;
 
-    bool Write(const T& objToSave)
+    CDataStream Serialize(const T& objToSave) const
     {
-        // LOCK(objToSave.cs);
-
-        int64_t nStart = GetTimeMillis();
-
         // serialize, checksum data up to that point, then append checksum
         CDataStream ssObj(SER_DISK, CLIENT_VERSION);
         ssObj << strMagicMessage; // specific magic message for this type of object
@@ -52,12 +53,21 @@ private:
         ssObj << objToSave;
         uint256 hash = Hash(ssObj.begin(), ssObj.end());
         ssObj << hash;
+        return ssObj;
+    }
+
+    bool WriteSerialized(const CDataStream& ssObj)
+    {
+        int64_t nStart = GetTimeMillis();
 
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        // open a temporary output file, and associate with CAutoFile; it only
+        // replaces the existing file once fully written, so a crash never
+        // leaves a truncated one behind
+        boost::filesystem::path pathTmp = pathDB.string() + ".new";
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
         // Write and commit header, data
         try {
@@ -66,9 +76,21 @@ private:
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Failed to rename %s to %s", __func__, pathTmp.string(), pathDB.string());
 
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
+        return true;
+    }
+
+    bool Write(const T& objToSave)
+    {
+        // LOCK(objToSave.cs);
+
+        if (!WriteSerialized(Serialize(objToSave)))
+            return false;
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
@@ -227,5 +249,270 @@ public:
 
 };
 
+/**
+*   Journaled Dumping and Loading
+*   -----------------------------
+*   A CFlatDB snapshot plus an append-only journal of the changes made to the
+*   object since it was written.  T names a change as T::JournalEntry and
+*   replays one with T::ApplyJournalEntry.  Replaying has to be idempotent:
+*   a crash in the middle of a compaction leaves entries behind that the new
+*   snapshot already includes.
+*
+*   Each journal record is the size of the serialized entry, the entry and
+*   its hash, so a record torn by a crash is detected and cut off on load.
+*/
+template<typename T>
+class CFlatDBLog: public CFlatDB<T>, public I_JournalWriter<typename T::JournalEntry>
+{
+private:
+    typedef typename CFlatDB<T>::ReadResult ReadResult;
+    typedef typename T::JournalEntry JournalEntry;
+
+    /** The journal is compacted once it outgrows the snapshot, but not before reaching this size */
+    static const uint64_t MIN_COMPACTION_BYTES = 4 << 20;
+
+    boost::filesystem::path pathJournal;
+    /** The journal a compaction started from, only left behind if it did not finish */
+    boost::filesystem::path pathRotatedJournal;
+
+    mutable CCriticalSection cs_journal;
+    CCriticalSection cs_compaction;
+    FILE* fileJournal;
+    uint64_t nJournalBytes;
+    uint64_t nSnapshotBytes;
+    bool fJournalFailed;
+
+    CDataStream JournalHeader() const
+    {
+        CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+        ssHeader << this->strMagicMessage;
+        ssHeader << FLATDATA(Params().MessageStart());
+        return ssHeader;
+    }
+
+    bool WriteToJournal(const CDataStream& ssData)
+    {
+        AssertLockHeld(cs_journal);
+        if (fwrite(&ssData[0], 1, ssData.size(), fileJournal) != ssData.size() || fflush(fileJournal) != 0) {
+            fJournalFailed = true;
+            return error("%s: Failed to append to %s", __func__, pathJournal.string());
+        }
+        nJournalBytes += ssData.size();
+        return true;
+    }
+
+    bool OpenJournal()
+    {
+        AssertLockHeld(cs_journal);
+        fileJournal = fopen(pathJournal.string().c_str(), "ab");
+        if (fileJournal == nullptr) {
+            fJournalFailed = true;
+            return error("%s: Failed to open file %s", __func__, pathJournal.string());
+        }
+        fJournalFailed = false;
+        fseek(fileJournal, 0, SEEK_END);
+        nJournalBytes = ftell(fileJournal);
+        return nJournalBytes > 0 || WriteToJournal(JournalHeader());
+    }
+
+    void CloseJournal()
+    {
+        AssertLockHeld(cs_journal);
+        if (fileJournal == nullptr)
+            return;
+        FileCommit(fileJournal);
+        fclose(fileJournal);
+        fileJournal = nullptr;
+    }
+
+    ReadResult ReplayJournal(const boost::filesystem::path& pathReplayed, T& objToLoad)
+    {
+        if (!boost::filesystem::exists(pathReplayed))
+            return CFlatDB<T>::Ok;
+
+        int64_t nStart = GetTimeMillis();
+        std::vector<char> vchData(boost::filesystem::file_size(pathReplayed));
+        FILE *file = fopen(pathReplayed.string().c_str(), "rb");
+        if (file == nullptr) {
+            error("%s: Failed to open file %s", __func__, pathReplayed.string());
+            return CFlatDB<T>::FileError;
+        }
+        const size_t nRead = vchData.empty() ? 0 : fread(&vchData[0], 1, vchData.size(), file);
+        fclose(file);
+        if (nRead != vchData.size()) {
+            error("%s: Failed to read file %s", __func__, pathReplayed.string());
+            return CFlatDB<T>::FileError;
+        }
+
+        // a journal cut short before its header is complete holds no entries yet
+        const CDataStream ssHeader = JournalHeader();
+        size_t nValidBytes = 0;
+        if (vchData.size() >= ssHeader.size()) {
+            if (!std::equal(ssHeader.begin(), ssHeader.end(), vchData.begin())) {
+                error("%s: Invalid magic message or network magic number in %s", __func__, pathReplayed.string());
+                return CFlatDB<T>::IncorrectMagicMessage;
+            }
+            nValidBytes = ssHeader.size();
+        }
+
+        unsigned nEntries = 0;
+        CDataStream ssJournal(vchData.data() + nValidBytes, vchData.data() + vchData.size(), SER_DISK, CLIENT_VERSION);
+        try {
+            while (!ssJournal.empty()) {
+                uint32_t nEntrySize;
+                ssJournal >> nEntrySize;
+                if (nEntrySize + sizeof(uint256) > ssJournal.size())
+                    break;
+                std::vector<char> vchEntry(nEntrySize);
+                ssJournal.read(vchEntry.data(), nEntrySize);
+                CDataStream ssEntry(vchEntry, SER_DISK, CLIENT_VERSION);
+                uint256 hashIn;
+                ssJournal >> hashIn;
+                if (hashIn != Hash(ssEntry.begin(), ssEntry.end()))
+                    break;
+
+                JournalEntry entry;
+                ssEntry >> entry;
+                objToLoad.ApplyJournalEntry(entry);
+                ++nEntries;
+                nValidBytes = vchData.size() - ssJournal.size();
+            }
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+
+        if (nValidBytes < vchData.size()) {
+            LogPrintf("Discarding %u torn or corrupt bytes at the end of %s\n", vchData.size() - nValidBytes, pathReplayed.string());
+            boost::filesystem::resize_file(pathReplayed, nValidBytes);
+        }
+        LogPrintf("Replayed %u entries from %s  %dms\n", nEntries, pathReplayed.string(), GetTimeMillis() - nStart);
+        return CFlatDB<T>::Ok;
+    }
+
+public:
+    CFlatDBLog(std::string strFilenameIn, std::string strMagicMessageIn)
+        : CFlatDB<T>(strFilenameIn, strMagicMessageIn)
+        , fileJournal(nullptr)
+        , nJournalBytes(0)
+        , nSnapshotBytes(0)
+        , fJournalFailed(false)
+    {
+        pathJournal = this->pathDB.string() + ".log";
+        pathRotatedJournal = this->pathDB.string() + ".log.old";
+    }
+
+    ~CFlatDBLog()
+    {
+        LOCK(cs_journal);
+        CloseJournal();
+    }
+
+    /** Reads the snapshot, replays the journal on top of it, and opens the journal for appending.  */
+    bool Load(T& objToLoad)
+    {
+        LogPrintf("Reading info from %s...\n", this->strFilename);
+        ReadResult readResult = this->Read(objToLoad, true);
+        if (readResult == CFlatDB<T>::FileError)
+            LogPrintf("Missing file %s, will try to recreate\n", this->strFilename);
+        else if (readResult == CFlatDB<T>::IncorrectFormat)
+            LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
+        else if (readResult != CFlatDB<T>::Ok) {
+            LogPrintf("%s: File format of %s is unknown or invalid, please fix it manually\n", __func__, this->strFilename);
+            return false;
+        }
+
+        if (ReplayJournal(pathRotatedJournal, objToLoad) != CFlatDB<T>::Ok ||
+            ReplayJournal(pathJournal, objToLoad) != CFlatDB<T>::Ok)
+            return false;
+
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+
+        LOCK(cs_journal);
+        if (readResult == CFlatDB<T>::Ok)
+            nSnapshotBytes = boost::filesystem::file_size(this->pathDB);
+        CloseJournal();
+        return OpenJournal();
+    }
+
+    void Append(const JournalEntry& entry) override
+    {
+        CDataStream ssEntry(SER_DISK, CLIENT_VERSION);
+        ssEntry << entry;
+        CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+        ssRecord << static_cast<uint32_t>(ssEntry.size());
+        ssRecord.write(&ssEntry[0], ssEntry.size());
+        ssRecord << Hash(ssEntry.begin(), ssEntry.end());
+
+        LOCK(cs_journal);
+        if (fileJournal != nullptr && !fJournalFailed)
+            WriteToJournal(ssRecord);
+    }
+
+    bool NeedsCompaction() const
+    {
+        LOCK(cs_journal);
+        return fJournalFailed || nJournalBytes > std::max<uint64_t>(MIN_COMPACTION_BYTES, nSnapshotBytes);
+    }
+
+    /** Starts a new journal and serializes the snapshot that replaces the
+     *  old one.  The caller must keep objToSave from changing meanwhile;
+     *  entries it appends afterwards go to the new journal.  */
+    bool PrepareCompaction(const T& objToSave, CDataStream& ssSnapshot)
+    {
+        {
+            LOCK(cs_journal);
+            // a previous compaction that failed left its journal behind, which
+            // the snapshot about to be written covers just as well
+            if (!boost::filesystem::exists(pathRotatedJournal)) {
+                CloseJournal();
+                if (boost::filesystem::exists(pathJournal) && !RenameOver(pathJournal, pathRotatedJournal))
+                    return error("%s: Failed to rename %s", __func__, pathJournal.string());
+                if (!OpenJournal())
+                    return false;
+            }
+            else if (fileJournal == nullptr && !OpenJournal())
+                return false;
+        }
+        ssSnapshot = this->Serialize(objToSave);
+        return true;
+    }
+
+    /** Writes a snapshot from PrepareCompaction and drops the journal it
+     *  replaces.  This needs no lock on the object it was taken from.  */
+    bool FinishCompaction(const CDataStream& ssSnapshot)
+    {
+        LOCK(cs_compaction);
+        int64_t nStart = GetTimeMillis();
+        if (!this->WriteSerialized(ssSnapshot))
+            return false;
+        boost::filesystem::remove(pathRotatedJournal);
+        {
+            LOCK(cs_journal);
+            nSnapshotBytes = boost::filesystem::file_size(this->pathDB);
+        }
+        LogPrintf("%s compaction finished  %dms\n", this->strFilename, GetTimeMillis() - nStart);
+        return true;
+    }
+
+    /** Writes a new snapshot and starts an empty journal, for an object that
+     *  does not change meanwhile.  */
+    bool Compact(const T& objToSave)
+    {
+        CDataStream ssSnapshot(SER_DISK, CLIENT_VERSION);
+        return PrepareCompaction(objToSave, ssSnapshot) && FinishCompaction(ssSnapshot);
+    }
+
+    /** Commits the journal to disk, e.g. on shutdown.  */
+    void Flush()
+    {
+        LOCK(cs_journal);
+        if (fileJournal != nullptr)
+            FileCommit(fileJournal);
+    }
+};
+
 
 #endif
@@ -16,6 +16,8 @@
 #include <chainparams.h>
 #include "checkpoints.h"
 #include "compat/sanity.h"
+#include "crypto/quark.h"
+#include "crypto/sha256.h"
 #include <defaultValues.h>
 #include "key.h"
 #include "main.h"
@@ -24,6 +26,7 @@
 #include "miner.h"
 #include "net.h"
 #include "rpcserver.h"
+#include "script/sigcache.h"
 #include "script/standard.h"
 #include "spork.h"
 #include "sporkdb.h"
@@ -41,6 +44,8 @@
 #include <ActiveChainManager.h>
 #include <BlockDiskAccessor.h>
 #include <TransactionInputChecker.h>
+#include <BlockInputPrefetcher.h>
+#include <MessagePreValidator.h>
 #include <txmempool.h>
 
 #ifdef ENABLE_WALLET
@@ -71,6 +76,7 @@
 
 #include <ValidationState.h>
 #include <verifyDb.h>
+#include <RpcStateSnapshot.h>
 
 #ifdef ENABLE_WALLET
 CWallet* pwalletMain = NULL;
@@ -87,7 +93,9 @@ extern bool fReindex;
 extern bool fImporting;
 extern bool fCheckBlockIndex;
 extern int nScriptCheckThreads;
-extern int nCoinCacheSize;
+extern int nInputPrefetchThreads;
+extern int nMessagePreValidationThreads;
+extern size_t nCoinCacheUsage;
 extern bool fTxIndex;
 extern bool fVerifyingBlocks;
 extern bool fLiteMode;
@@ -492,6 +500,9 @@ bool VerifyCriticalDependenciesAreAvailable()
 {
     // ********************************************************* Step 4: sanity checks
 
+    LogPrintf("Using the '%s' SHA256 implementation\n", SHA256AutoDetect());
+    LogPrintf("Using the '%s' Quark implementation\n", QuarkAutoDetect());
+
     // Sanity check
     if (!VerifyECCAndLibCCompatibilityAreAvailable())
         return InitError(strprintf(translate("Initialization sanity check failed. %s is shutting down."), translate(PACKAGE_NAME)));
@@ -538,6 +549,19 @@ bool CheckCriticalUnsupportedFeaturesAreNotUsed()
     return true;
 }
 
+bool CheckSignatureCacheSize()
+{
+    // -maxsigcachesize used to count entries (50000 by default), so old
+    // configurations ask for gigabytes now that it is given in megabytes
+    const int64_t nMaxSigCacheSize = settings.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE);
+    if (nMaxSigCacheSize > MAX_MAX_SIG_CACHE_SIZE)
+        return InitError(strprintf(translate("Error: -maxsigcachesize=%d is above the maximum of %d. The signature cache size is now given in megabytes, not entries."), nMaxSigCacheSize, MAX_MAX_SIG_CACHE_SIZE));
+    if (nMaxSigCacheSize > SIG_CACHE_SIZE_WARNING_THRESHOLD)
+        InitWarning(strprintf(translate("Warning: -maxsigcachesize=%d reserves %d megabytes for the signature cache. The size is now given in megabytes, not entries."), nMaxSigCacheSize, nMaxSigCacheSize));
+
+    return true;
+}
+
 void SetConsistencyChecks()
 {
     // Checkmempool and checkblockindex default to true in regtest mode
@@ -556,6 +580,20 @@ void SetNumberOfThreadsToCheckScripts()
         nScriptCheckThreads = 0;
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+
+    // As with -par, a single thread would only read on the caller's thread anyway
+    nInputPrefetchThreads = settings.GetArg("-prefetchthreads", DEFAULT_INPUT_PREFETCH_THREADS);
+    if (nInputPrefetchThreads <= 1)
+        nInputPrefetchThreads = 0;
+    else if (nInputPrefetchThreads > MAX_INPUT_PREFETCH_THREADS)
+        nInputPrefetchThreads = MAX_INPUT_PREFETCH_THREADS;
+
+    // Unlike the queues above, the message handler does not take part, so a single thread still helps
+    nMessagePreValidationThreads = settings.GetArg("-prevalidationthreads", DEFAULT_MESSAGE_PREVALIDATION_THREADS);
+    if (nMessagePreValidationThreads < 0)
+        nMessagePreValidationThreads = 0;
+    else if (nMessagePreValidationThreads > MAX_MESSAGE_PREVALIDATION_THREADS)
+        nMessagePreValidationThreads = MAX_MESSAGE_PREVALIDATION_THREADS;
 }
 
 bool WalletIsDisabled()
@@ -631,6 +669,10 @@ void StartScriptVerificationThreads(boost::thread_group& threadGroup)
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&TransactionInputChecker::ThreadScriptCheck);
     }
+    for (int i = 0; i < nInputPrefetchThreads - 1; i++)
+        threadGroup.create_thread(&BlockInputPrefetcher::ThreadPrefetch);
+    for (int i = 0; i < nMessagePreValidationThreads; i++)
+        threadGroup.create_thread(&MessagePreValidator::ThreadPreValidate);
 }
 
 
@@ -713,6 +755,8 @@ void PrintInitialLogHeader(bool fDisableWallet, int numberOfFileDescriptors, con
     LogPrintf("Using config file %s\n", settings.GetConfigFile().string());
     LogPrintf("Using at most %i connections (%i file descriptors available)\n", maximumNumberOfConnections, numberOfFileDescriptors);
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for block input prefetching\n", nInputPrefetchThreads);
+    LogPrintf("Using %u threads for message pre-validation\n", nMessagePreValidationThreads);
 }
 
 bool SetSporkKey()
@@ -784,7 +828,7 @@ std::pair<size_t,size_t> CalculateDBCacheSizes()
     nTotalCache -= nBlockTreeDBCache;
     nCoinDBCache = nTotalCache / 2; // use half of the remaining cache for coindb cache
     nTotalCache -= nCoinDBCache;
-    nCoinCacheSize = nTotalCache / 300; // coins in memory require around 300 bytes
+    nCoinCacheUsage = nTotalCache; // the rest is for the in-memory coins cache, counted in bytes
 
     return std::make_pair(nBlockTreeDBCache,nCoinDBCache);
 }
@@ -800,6 +844,12 @@ bool TryToLoadBlocks(bool& fLoaded, std::string& strLoadError)
         if (fReindex)
             pblocktree->WriteReindexing(true);
 
+        uiInterface.InitMessage(translate("Upgrading chainstate database..."));
+        if (!pcoinsdbview->Upgrade()) {
+            strLoadError = translate("Error upgrading chainstate database");
+            return skipLoadingDueToError;
+        }
+
         // DIVI: load previous sessions sporks if we have them.
         uiInterface.InitMessage(translate("Loading sporks..."));
         GetSporkManager().LoadSporksFromDB();
@@ -843,7 +893,7 @@ bool TryToLoadBlocks(bool& fLoaded, std::string& strLoadError)
                 chainManager,
                 chainActive,
                 uiInterface,
-                nCoinCacheSize,
+                nCoinCacheUsage,
                 &ShutdownRequested);
             if (!dbVerifier.VerifyDB(pcoinsdbview,pcoinsTip, 4, settings.GetArg("-checkblocks", 100)))
             {
@@ -1106,6 +1156,11 @@ bool InitializeDivi(boost::thread_group& threadGroup)
     }
     SetConsistencyChecks();
     SetNumberOfThreadsToCheckScripts();
+    if(!CheckSignatureCacheSize())
+    {
+        return false;
+    }
+    InitSignatureCache();
 
     // Staking needs a CWallet instance, so make sure wallet is enabled
     bool fDisableWallet = WalletIsDisabled();
@@ -1313,6 +1368,11 @@ bool InitializeDivi(boost::thread_group& threadGroup)
     LogPrintf("mapAddressBook.size() = %u\n", pwalletMain ? pwalletMain->mapAddressBook.size() : 0);
 #endif
 
+    {
+        LOCK(cs_main);
+        UpdateRpcStateSnapshot();
+    }
+
     if (settings.GetBoolArg("-listenonion", DEFAULT_LISTEN_ONION))
         StartTorControl(threadGroup);
 
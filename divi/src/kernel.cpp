@@ -10,7 +10,6 @@
 #include <primitives/transaction.h>
 #include <primitives/block.h>
 #include "blockmap.h"
-#include "BlockDiskAccessor.h"
 #include "BlockRewards.h"
 #include "chain.h"
 #include "chainparams.h"
@@ -54,56 +53,45 @@ const CBlockIndex* GetLastBlockIndexWithGeneratedStakeModifier(const CBlockIndex
     return pindex;
 }
 
-// select a block from the candidate blocks in vSortedByTimestamp, excluding
-// already selected blocks in vSelectedBlocks, and with timestamp up to
-// nSelectionIntervalStop.
-static bool SelectBlockFromCandidates(
-        const std::vector<std::pair<int64_t, uint256> >& vSortedByTimestamp,
-        const std::map<uint256, const CBlockIndex*>& mapSelectedBlocks,
-        int64_t nSelectionIntervalStop,
-        uint64_t nStakeModifierPrev,
-        const CBlockIndex** pindexSelected)
+namespace
 {
-    bool fSelected = false;
-    uint256 hashBest = 0;
-    *pindexSelected = (const CBlockIndex*)0;
-    for (const std::pair<int64_t, uint256>& item: vSortedByTimestamp)
+struct StakeModifierCandidate
+{
+    int64_t blockTime;
+    uint256 blockHash;
+    const CBlockIndex* blockIndex;
+    uint256 selectionHash;
+
+    bool operator<(const StakeModifierCandidate& other) const
     {
-        if (!mapBlockIndex.count(item.second))
-            return error("SelectBlockFromCandidates: failed to find block index for candidate block %s", item.second);
+        return blockTime < other.blockTime || (blockTime == other.blockTime && blockHash < other.blockHash);
+    }
+};
+}
 
-        const CBlockIndex* pindex = mapBlockIndex[item.second];
-        if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
+// select a block from the candidate blocks in candidatesSortedByTimestamp, excluding
+// already selected blocks, and with timestamp up to nSelectionIntervalStop.
+static const StakeModifierCandidate* SelectBlockFromCandidates(
+        const std::vector<StakeModifierCandidate>& candidatesSortedByTimestamp,
+        const std::vector<bool>& alreadySelected,
+        int64_t nSelectionIntervalStop)
+{
+    const StakeModifierCandidate* selectedCandidate = nullptr;
+    for (unsigned candidateIndex = 0; candidateIndex < candidatesSortedByTimestamp.size(); ++candidateIndex)
+    {
+        const StakeModifierCandidate& candidate = candidatesSortedByTimestamp[candidateIndex];
+        if (selectedCandidate && candidate.blockTime > nSelectionIntervalStop)
             break;
 
-        if (mapSelectedBlocks.count(pindex->GetBlockHash()) > 0)
+        if (alreadySelected[candidateIndex])
             continue;
 
-        // compute the selection hash by hashing an input that is unique to that block
-        uint256 hashProof = pindex->IsProofOfStake() ? 0 : pindex->GetBlockHash();
-
-        CDataStream ss(SER_GETHASH, 0);
-        ss << hashProof << nStakeModifierPrev;
-        uint256 hashSelection = Hash(ss.begin(), ss.end());
-
-        // the selection hash is divided by 2**32 so that proof-of-stake block
-        // is always favored over proof-of-work block. this is to preserve
-        // the energy efficiency property
-        if (pindex->IsProofOfStake())
-            hashSelection >>= 32;
-
-        if (fSelected && hashSelection < hashBest) {
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*)pindex;
-        } else if (!fSelected) {
-            fSelected = true;
-            hashBest = hashSelection;
-            *pindexSelected = (const CBlockIndex*)pindex;
-        }
+        if (!selectedCandidate || candidate.selectionHash < selectedCandidate->selectionHash)
+            selectedCandidate = &candidate;
     }
-    if (settings.GetBoolArg("-printstakemodifier", false))
-        LogPrintf("SelectBlockFromCandidates: selection hash=%s\n", hashBest);
-    return fSelected;
+    if (selectedCandidate && settings.GetBoolArg("-printstakemodifier", false))
+        LogPrintf("SelectBlockFromCandidates: selection hash=%s\n", selectedCandidate->selectionHash);
+    return selectedCandidate;
 }
 
 // Stake Modifier (hash modifier of proof-of-stake):
@@ -119,27 +107,47 @@ static bool SelectBlockFromCandidates(
 // block. This is to make it difficult for an attacker to gain control of
 // additional bits in the stake modifier, even after generating a chain of
 // blocks.
-std::vector<std::pair<int64_t, uint256> > GetRecentBlocksSortedByIncreasingTimestamp(
+//
+// The selection hash of a candidate only depends on the block and the previous
+// stake modifier, so it is computed once per candidate instead of once per round.
+static std::vector<StakeModifierCandidate> GetRecentBlocksSortedByIncreasingTimestamp(
     const CBlockIndex* pindexPrev,
+    uint64_t nStakeModifierPrev,
     int64_t& nSelectionIntervalStop)
 {
-    // Sort candidate blocks by timestamp
-    std::vector<std::pair<int64_t, uint256> > vSortedByTimestamp;
-    vSortedByTimestamp.reserve(64);
+    std::vector<StakeModifierCandidate> candidates;
+    candidates.reserve(64);
     int64_t nSelectionInterval = GetStakeModifierSelectionInterval();
     int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / MODIFIER_INTERVAL) * MODIFIER_INTERVAL - nSelectionInterval;
     const CBlockIndex* pindex = pindexPrev;
 
     while (pindex && pindex->GetBlockTime() >= nSelectionIntervalStart) {
-        vSortedByTimestamp.push_back(std::make_pair(pindex->GetBlockTime(), pindex->GetBlockHash()));
+        StakeModifierCandidate candidate;
+        candidate.blockTime = pindex->GetBlockTime();
+        candidate.blockHash = pindex->GetBlockHash();
+        candidate.blockIndex = pindex;
+
+        // compute the selection hash by hashing an input that is unique to that block
+        uint256 hashProof = pindex->IsProofOfStake() ? 0 : candidate.blockHash;
+        CDataStream ss(SER_GETHASH, 0);
+        ss << hashProof << nStakeModifierPrev;
+        candidate.selectionHash = Hash(ss.begin(), ss.end());
+
+        // the selection hash is divided by 2**32 so that proof-of-stake block
+        // is always favored over proof-of-work block. this is to preserve
+        // the energy efficiency property
+        if (pindex->IsProofOfStake())
+            candidate.selectionHash >>= 32;
+
+        candidates.push_back(candidate);
         pindex = pindex->pprev;
     }
 
-    std::reverse(vSortedByTimestamp.begin(), vSortedByTimestamp.end());
-    std::sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end());
+    std::reverse(candidates.begin(), candidates.end());
+    std::sort(candidates.begin(), candidates.end());
 
     nSelectionIntervalStop = nSelectionIntervalStart;
-    return vSortedByTimestamp;
+    return candidates;
 }
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier)
 {
@@ -170,17 +178,19 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
 
     uint64_t nStakeModifierNew = 0;
     int64_t nSelectionIntervalStop = 0;
-    std::vector<std::pair<int64_t, uint256> > vSortedByTimestamp = GetRecentBlocksSortedByIncreasingTimestamp(pindexPrev,nSelectionIntervalStop);
+    const std::vector<StakeModifierCandidate> candidatesSortedByTimestamp =
+        GetRecentBlocksSortedByIncreasingTimestamp(pindexPrev, nStakeModifier, nSelectionIntervalStop);
 
-    const CBlockIndex* pindex = nullptr;
-    std::map<uint256, const CBlockIndex*> mapSelectedBlocks;
-    for (int nRound = 0; nRound < std::min(64, (int)vSortedByTimestamp.size()); nRound++) {
+    std::vector<bool> alreadySelected(candidatesSortedByTimestamp.size(), false);
+    for (int nRound = 0; nRound < std::min(64, (int)candidatesSortedByTimestamp.size()); nRound++) {
         nSelectionIntervalStop += GetStakeModifierSelectionIntervalSection(nRound);
-        if (!SelectBlockFromCandidates(vSortedByTimestamp, mapSelectedBlocks, nSelectionIntervalStop, nStakeModifier, &pindex))
+        const StakeModifierCandidate* selectedCandidate =
+            SelectBlockFromCandidates(candidatesSortedByTimestamp, alreadySelected, nSelectionIntervalStop);
+        if (!selectedCandidate)
             return error("ComputeNextStakeModifier: unable to select block at round %d", nRound);
 
-        nStakeModifierNew |= (((uint64_t)pindex->GetStakeEntropyBit()) << nRound);
-        mapSelectedBlocks.insert(std::make_pair(pindex->GetBlockHash(), pindex));
+        nStakeModifierNew |= (((uint64_t)selectedCandidate->blockIndex->GetStakeEntropyBit()) << nRound);
+        alreadySelected[selectedCandidate - &candidatesSortedByTimestamp[0]] = true;
     }
 
     if(ActivationState(pindexPrev).IsActive(Fork::HardenedStakeModifier))
@@ -234,12 +244,59 @@ void SetStakeModifiersForNewBlockIndex(CBlockIndex* pindexNew)
         LogPrintf("%s : Rejected by stake modifier checkpoint height=%d, modifier=%s \n", __func__, pindexNew->nHeight, boost::lexical_cast<std::string>(nStakeModifier));
 }
 
+// The coins view only describes the chain that ends at its best block, so this
+// is limited to coinstakes building on top of it (as during sync). Everything
+// needed is then in memory: the output in the coins, and the confirmation block
+// as the ancestor of pindexPrev at the height the coins were created at.
+bool RecoverStakeInputFromCoins(
+    const CCoinsViewCache& view,
+    const CBlockIndex* pindexPrev,
+    const COutPoint& prevout,
+    StakeInputSource& source)
+{
+    if (view.GetBestBlock() != pindexPrev->GetBlockHash())
+        return false;
+    const CCoins* coins = view.AccessCoins(prevout.hash);
+    if (!coins || !coins->IsAvailable(prevout.n))
+        return false;
+    source.output = coins->vout[prevout.n];
+    source.confirmationBlock = pindexPrev->GetAncestor(coins->nHeight);
+    return source.confirmationBlock != nullptr;
+}
+
+// Fallback for coinstakes on other branches, reading the transaction from disk
+bool RecoverStakeInputFromDisk(
+    const COutPoint& prevout,
+    bool fAllowSlow,
+    StakeInputSource& source)
+{
+    uint256 hashBlock;
+    CTransaction txPrev;
+    if (!GetTransaction(prevout.hash, txPrev, hashBlock, fAllowSlow) || prevout.n >= txPrev.vout.size())
+        return false;
+    source.output = txPrev.vout[prevout.n];
+    BlockMap::const_iterator it = mapBlockIndex.find(hashBlock);
+    source.confirmationBlock = it != mapBlockIndex.end() ? it->second : nullptr;
+    return true;
+}
+
+bool RecoverStakeInput(
+    const CCoinsViewCache& view,
+    const CBlockIndex* pindexPrev,
+    const COutPoint& prevout,
+    bool fAllowSlow,
+    StakeInputSource& source)
+{
+    return RecoverStakeInputFromCoins(view, pindexPrev, prevout, source) ||
+           RecoverStakeInputFromDisk(prevout, fAllowSlow, source);
+}
+
 // Check kernel hash target and coinstake signature
 bool CheckProofOfStakeContextAndRecoverStakingData(
-    const CBlock& block, CBlockIndex* pindexPrev, StakingData& stakingData)
+    const CCoinsViewCache& view, const CBlock& block, CBlockIndex* pindexPrev, StakingData& stakingData)
 {
     static const unsigned maxInputs = settings.MaxNumberOfPoSCombinableInputs();
-    const CTransaction tx = block.vtx[1];
+    const CTransaction& tx = block.vtx[1];
     if (!tx.IsCoinStake())
         return error("CheckProofOfStake() : called on non-coinstake %s", tx.ToStringShort());
 
@@ -250,56 +307,44 @@ bool CheckProofOfStakeContextAndRecoverStakingData(
     // Kernel (input 0) must match the stake hash target per coin age (nBits)
     const CTxIn& txin = tx.vin[0];
 
-    // First try finding the previous transaction in database
-    uint256 hashBlock;
-    CTransaction txPrev;
-    if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
+    StakeInputSource kernel;
+    if (!RecoverStakeInput(view, pindexPrev, txin.prevout, true, kernel))
         return error("CheckProofOfStake() : INFO: read txPrev failed");
 
-    const CScript &kernelScript = txPrev.vout[txin.prevout.n].scriptPubKey;
+    const CScript& kernelScript = kernel.output.scriptPubKey;
 
     // All other inputs (if any) must pay to the same script.
     for (unsigned i = 1; i < tx.vin.size (); ++i) {
-        CTransaction txPrev2;
-        uint256 hashBlock2;
-        if (!GetTransaction(tx.vin[i].prevout.hash, txPrev2, hashBlock2))
+        StakeInputSource input;
+        if (!RecoverStakeInput(view, pindexPrev, tx.vin[i].prevout, false, input))
             return error("CheckProofOfStake() : INFO: read txPrev failed for input %u", i);
-        if (txPrev2.vout[tx.vin[i].prevout.n].scriptPubKey != kernelScript)
+        if (input.output.scriptPubKey != kernelScript)
             return error("CheckProofOfStake() : Stake input %u pays to different script", i);
     }
 
     //verify signature and script
-    if (!VerifyScript(txin.scriptSig, txPrev.vout[txin.prevout.n].scriptPubKey, POS_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
+    if (!VerifyScript(txin.scriptSig, kernelScript, POS_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(&tx, 0)))
         return error("CheckProofOfStake() : VerifySignature failed on coinstake %s", tx.ToStringShort());
 
-    CBlockIndex* pindex = NULL;
-    BlockMap::iterator it = mapBlockIndex.find(hashBlock);
-    if (it != mapBlockIndex.end())
-        pindex = it->second;
-    else
+    if (!kernel.confirmationBlock)
         return error("CheckProofOfStake() : read block failed");
 
-    // Read block header
-    CBlock blockprev;
-    if (!ReadBlockFromDisk(blockprev, pindex->GetBlockPos()))
-        return error("CheckProofOfStake(): INFO: failed to find block");
-
     stakingData = StakingData(
         block.nBits,
-        blockprev.GetBlockTime(),
-        blockprev.GetHash(),
+        kernel.confirmationBlock->GetBlockTime(),
+        kernel.confirmationBlock->GetBlockHash(),
         txin.prevout,
-        txPrev.vout[txin.prevout.n].nValue,
+        kernel.output.nValue,
         pindexPrev->GetBlockHash());
 
     return true;
 }
-bool CheckProofOfStake(CChain& activeChain, const CBlock& block, CBlockIndex* pindexPrev, uint256& hashProofOfStake)
+bool CheckProofOfStake(CChain& activeChain, const CCoinsViewCache& view, const CBlock& block, CBlockIndex* pindexPrev, uint256& hashProofOfStake)
 {
     static ProofOfStakeModule posModule(Params(),activeChain,mapBlockIndex);
     static const I_ProofOfStakeGenerator& posGenerator = posModule.proofOfStakeGenerator();
     StakingData stakingData;
-    if(!CheckProofOfStakeContextAndRecoverStakingData(block,pindexPrev,stakingData))
+    if(!CheckProofOfStakeContextAndRecoverStakingData(view,block,pindexPrev,stakingData))
         return false;
     if (!posGenerator.ComputeAndVerifyProofOfStake(stakingData, block.nTime, hashProofOfStake))
         return error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s \n",
@@ -9,20 +9,22 @@
 #include <uint256.h>
 #include <amount.h>
 #include <map>
+#include <primitives/transaction.h>
 class CBlockIndex;
 class CBlockRewards;
 class CBlock;
 class CCoinsViewCache;
-class CTransaction;
-class COutPoint;
 class BlockMap;
 class CChain;
 struct StakingData;
 
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
+// Stake inputs are taken from view when the block builds on its best block,
+// and only read from disk otherwise
 bool CheckProofOfStake(
     CChain& activeChain,
+    const CCoinsViewCache& view,
     const CBlock& block,
     CBlockIndex* pindexPrev,
     uint256& hashProofOfStake);
@@ -37,6 +39,37 @@ bool CheckCoinstakeForVaults(const CTransaction& tx,
                              const CBlockRewards& expectedRewards,
                              const CCoinsViewCache& view);
 
+/** The output spent by a coinstake input, and the block that confirmed it if known */
+struct StakeInputSource
+{
+    CTxOut output;
+    const CBlockIndex* confirmationBlock;
+
+    StakeInputSource(): output(), confirmationBlock(nullptr) {}
+};
+
+// Recovers the spent output of a stake input from view, which only works
+// when pindexPrev is its best block and the output is still unspent there
+bool RecoverStakeInputFromCoins(
+    const CCoinsViewCache& view,
+    const CBlockIndex* pindexPrev,
+    const COutPoint& prevout,
+    StakeInputSource& source);
+
+// Recovers the spent output of a stake input from the transaction on disk
+bool RecoverStakeInputFromDisk(
+    const COutPoint& prevout,
+    bool fAllowSlow,
+    StakeInputSource& source);
+
+// Tries the coins view first and falls back to the disk
+bool RecoverStakeInput(
+    const CCoinsViewCache& view,
+    const CBlockIndex* pindexPrev,
+    const COutPoint& prevout,
+    bool fAllowSlow,
+    StakeInputSource& source);
+
 // Check stake modifier hard checkpoints
 bool CheckStakeModifierCheckpoints(
     int nHeight,
@@ -58,6 +58,9 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/thread.hpp>
 #include <BlockUndo.h>
+#include <BlockInputPrefetcher.h>
+#include <MerkleTree.h>
+#include <MessagePreValidator.h>
 #include <ValidationState.h>
 #include <scriptCheck.h>
 #include <blockFileInfo.h>
@@ -73,6 +76,7 @@
 #include <utilstrencodings.h>
 #include <NodeStateRegistry.h>
 #include <Node.h>
+#include <RpcStateSnapshot.h>
 
 /** Minimum disk space required - used in CheckDiskSpace() */
 static const uint64_t nMinDiskSpace = 52428800;
@@ -111,7 +115,7 @@ bool fAddressIndex = false;
 bool fSpentIndex = false;
 bool fCheckBlockIndex = false;
 bool fVerifyingBlocks = false;
-unsigned int nCoinCacheSize = 5000;
+size_t nCoinCacheUsage = 5000 * 300;
 bool IsFinalTx(const CTransaction& tx, const CChain& activeChain, int nBlockHeight = 0 , int64_t nBlockTime = 0);
 
 CCheckpointServices checkpointsVerifier(GetCurrentChainCheckpoints);
@@ -219,14 +223,7 @@ void SyncWithWallets(const CTransaction& tx, const CBlock* pblock)
 //
 int GetHeight()
 {
-    while (true) {
-        TRY_LOCK(cs_main, lockMain);
-        if (!lockMain) {
-            MilliSleep(50);
-            continue;
-        }
-        return chainActive.Height();
-    }
+    return GetRpcStateSnapshot()->height;
 }
 
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
@@ -529,6 +526,20 @@ bool CheckFeesPaidAreAcceptable(
     return true;
 }
 
+static size_t GetMaxMempoolUsage()
+{
+    return settings.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+}
+
+static void LimitMempoolSize(CTxMemPool& pool, size_t limit, int64_t age)
+{
+    const int expired = pool.Expire(GetTime() - age);
+    if (expired != 0)
+        LogPrint("mempool", "Expired %i transactions from the memory pool\n", expired);
+
+    pool.TrimToSize(limit);
+}
+
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool ignoreFees)
 {
     AssertLockHeld(cs_main);
@@ -648,6 +659,25 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
             return false;
         }
 
+        // Once the pool has been full, transactions must outbid what was evicted
+        const CAmount mempoolRejectFee = pool.GetMinFee(GetMaxMempoolUsage()).GetFee(nSize);
+        if (!ignoreFees && mempoolRejectFee > 0 && nFees < mempoolRejectFee)
+        {
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool min fee not met");
+        }
+
+        // Calculate in-mempool ancestors, up to a limit, so the package state
+        // kept for every entry stays cheap to update.
+        CTxMemPool::setEntries setAncestors;
+        const size_t nLimitAncestors = settings.GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+        const size_t nLimitAncestorSize = settings.GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT) * 1000;
+        const size_t nLimitDescendants = settings.GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+        const size_t nLimitDescendantSize = settings.GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000;
+        std::string errString;
+        if (!pool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString)) {
+            return state.DoS(0, error("%s : %s", __func__, errString), REJECT_NONSTANDARD, "too-long-mempool-chain");
+        }
+
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
         if (!CheckInputs(tx, state, view, mapBlockIndex, true, STANDARD_SCRIPT_VERIFY_FLAGS, true)) {
@@ -669,9 +699,14 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry, view);
+
+        LimitMempoolSize(pool, GetMaxMempoolUsage(), settings.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+        if (!pool.exists(hash))
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
     }
 
     SyncWithWallets(tx, NULL);
+    UpdateRpcStateSnapshot();
 
     return true;
 }
@@ -1128,7 +1163,7 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
     static int64_t nLastWrite = 0;
     try {
         if ((mode == FLUSH_STATE_ALWAYS) ||
-                ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->GetCacheSize() > nCoinCacheSize) ||
+                ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->DynamicMemoryUsage() > nCoinCacheUsage) ||
                 (mode == FLUSH_STATE_PERIODIC && GetTimeMicros() > nLastWrite + DATABASE_WRITE_INTERVAL * 1000000)) {
             // Typical CCoins structures on disk are around 100 bytes in size.
             // Pushing a new one to the database can cause it to be written
@@ -1188,10 +1223,10 @@ void static UpdateTip(CBlockIndex* pindexNew)
     nTimeBestReceived = GetTime();
     mempool.AddTransactionsUpdated(1);
 
-    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%u\n",
+    LogPrintf("UpdateTip: new best=%s  height=%d  log2_work=%.8g  tx=%lu  date=%s progress=%f  cache=%u(%.1fMiB)\n",
               chainActive.Tip()->GetBlockHash(), chainActive.Height(), log(chainActive.Tip()->nChainWork.getdouble()) / log(2.0), (unsigned long)chainActive.Tip()->nChainTx,
               DateTimeStrFormat("%Y-%m-%d %H:%M:%S", chainActive.Tip()->GetBlockTime()),
-              checkpointsVerifier.GuessVerificationProgress(chainActive.Tip()), (unsigned int)pcoinsTip->GetCacheSize());
+              checkpointsVerifier.GuessVerificationProgress(chainActive.Tip()), (unsigned int)pcoinsTip->GetCacheSize(), pcoinsTip->DynamicMemoryUsage() * (1.0 / (1 << 20)));
 
     cvBlockChange.notify_all();
 
@@ -1259,6 +1294,7 @@ bool static DisconnectTip(CValidationState& state)
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -1290,6 +1326,12 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
     nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    // Read the inputs missing from the coins cache in parallel instead of one by one during validation
+    const unsigned nPrefetched = BlockInputPrefetcher(*pcoinsTip).Prefetch(*pblock);
+    int64_t nTimePrefetched = GetTimeMicros();
+    nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint("bench", "  - Prefetch %u inputs: %.2fms [%.2fs]\n", nPrefetched, (nTimePrefetched - nTime2) * 0.001, nTimePrefetch * 0.000001);
+    nTime2 = nTimePrefetched;
     {
         CInv inv(MSG_BLOCK, pindexNew->GetBlockHash());
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, false, fAlreadyChecked);
@@ -1512,12 +1554,8 @@ bool ActivateBestChain(CValidationState& state, CBlock* pblock, bool fAlreadyChe
         boost::this_thread::interruption_point();
 
         bool fInitialDownload;
-        while (true) {
-            TRY_LOCK(cs_main, lockMain);
-            if (!lockMain) {
-                MilliSleep(50);
-                continue;
-            }
+        {
+            LOCK(cs_main);
 
             pindexMostWork = FindMostWorkChain();
 
@@ -1525,12 +1563,13 @@ bool ActivateBestChain(CValidationState& state, CBlock* pblock, bool fAlreadyChe
             if (pindexMostWork == NULL || pindexMostWork == chainActive.Tip())
                 return true;
 
-            if (!ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : NULL, fAlreadyChecked))
+            bool fStepSucceeded = ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : NULL, fAlreadyChecked);
+            UpdateRpcStateSnapshot();
+            if (!fStepSucceeded)
                 return false;
 
             pindexNewTip = chainActive.Tip();
             fInitialDownload = IsInitialBlockDownload();
-            break;
         }
         // When we reach this point, we switched to a new tip (stored in pindexNewTip).
 
@@ -1796,7 +1835,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckMerkleR
     }
 
     // Check timestamp
-    LogPrint("debug", "%s: block=%s  is proof of stake=%d\n", __func__, block.GetHash(), block.IsProofOfStake());
+    if (LogAcceptCategory("debug"))
+        LogPrint("debug", "%s: block=%s  is proof of stake=%d\n", __func__, block.GetHash(), block.IsProofOfStake());
     if (block.GetBlockTime() > GetAdjustedTime() + (block.IsProofOfStake() ? settings.MaxFutureBlockDrift() : 7200)) // 3 minute future drift for PoS
         return state.Invalid(error("%s : block timestamp too far in the future",__func__),
                              REJECT_INVALID, "time-too-new");
@@ -1804,7 +1844,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckMerkleR
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
-        uint256 hashMerkleRoot2 = block.BuildMerkleTree(&mutated);
+        uint256 hashMerkleRoot2 = BlockMerkleRoot(block, &mutated);
         if (block.hashMerkleRoot != hashMerkleRoot2)
             return state.DoS(100, error("%s : hashMerkleRoot mismatch",__func__),
                              REJECT_INVALID, "bad-txnmrklroot", true);
@@ -1893,7 +1933,7 @@ bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev)
         uint256 hashProofOfStake;
         uint256 hash = block.GetHash();
 
-        if(!CheckProofOfStake(chainActive,block,pindexPrev, hashProofOfStake)) {
+        if(!CheckProofOfStake(chainActive,*pcoinsTip,block,pindexPrev, hashProofOfStake)) {
             LogPrintf("WARNING: ProcessBlock(): check proof-of-stake failed for block %s\n", hash);
             return false;
         }
@@ -2455,6 +2495,59 @@ bool InitBlockIndex()
 }
 
 
+namespace
+{
+/** Headers hashed per batch while reindexing */
+constexpr unsigned REINDEX_HEADERS_PER_BATCH = 1024u;
+
+/**
+ * Reads the headers of the blocks in a block file ahead of the reindex
+ * through a handle of its own, and hashes them in batches, so that hashing
+ * the reindexed blocks is a lookup. A batch ends at the first gap in the
+ * file, which the reindex then has to search through byte by byte anyway.
+ */
+class BlockFileHeaderHasher
+{
+private:
+    CAutoFile file_;
+    uint64_t hashedUpTo_;
+
+public:
+    explicit BlockFileHeaderHasher(
+        const CDiskBlockPos* dbp
+        ): file_(dbp ? OpenBlockFile(CDiskBlockPos(dbp->nFile, 0), true) : NULL, SER_DISK, CLIENT_VERSION)
+        , hashedUpTo_(0u)
+    {
+    }
+
+    /** Hashes the next batch once the reindex reaches position, the end of the last one */
+    void HashAhead(uint64_t position)
+    {
+        if (file_.IsNull() || position < hashedUpTo_)
+            return;
+        std::vector<CBlockHeader> headers;
+        uint64_t blockStart = position;
+        try {
+            while (headers.size() < REINDEX_HEADERS_PER_BATCH && fseek(file_.Get(), blockStart, SEEK_SET) == 0) {
+                unsigned char buf[MESSAGE_START_SIZE];
+                unsigned int nSize = 0;
+                file_ >> FLATDATA(buf) >> nSize;
+                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE) || nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                    break;
+                CBlockHeader header;
+                file_ >> header;
+                headers.push_back(header);
+                blockStart += MESSAGE_START_SIZE + sizeof(nSize) + nSize;
+            }
+        } catch (const std::exception&) {
+            // end of the file
+        }
+        hashedUpTo_ = std::max(blockStart, position + 1);
+        PrecomputeBlockHeaderHashes(headers);
+    }
+};
+}
+
 bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -2465,11 +2558,13 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
+        BlockFileHeaderHasher headerHasher(dbp);
         uint64_t nRewind = blkdat.GetPos();
         while (!blkdat.eof()) {
             boost::this_thread::interruption_point();
 
             blkdat.SetPos(nRewind);
+            headerHasher.HashAhead(blkdat.GetPos());
             nRewind++;         // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
             unsigned int nSize = 0;
@@ -3396,6 +3491,8 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             vRecv >> headers[n];
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
+        // Each header is hashed several times while it is accepted
+        PrecomputeBlockHeaderHashes(headers);
 
         LOCK(cs_main);
 
@@ -3733,6 +3830,28 @@ static NetworkMessageState CheckNetworkMessageHeader(
     return NetworkMessageState::VALID;
 }
 
+/** Hands the complete messages queued behind the one being processed to the pre-validation threads */
+static void QueueMessagesForPreValidation(
+    NodeId nodeId,
+    std::deque<CNetMessage>::iterator messageIterator,
+    std::deque<CNetMessage>::iterator end)
+{
+    extern int nMessagePreValidationThreads;
+    if (!nMessagePreValidationThreads)
+        return;
+    // Bounded, as this runs once for every message of a long receive queue
+    static const unsigned MAX_LOOKAHEAD_MESSAGES = 32;
+    for (unsigned lookahead = 0; lookahead < MAX_LOOKAHEAD_MESSAGES && messageIterator != end && messageIterator->complete(); ++lookahead, ++messageIterator) {
+        CNetMessage& msg = *messageIterator;
+        if (msg.fPreValidationQueued)
+            continue;
+        msg.fPreValidationQueued = true;
+        const std::string strCommand = msg.hdr.GetCommand();
+        if (MessagePreValidator::IsPreValidated(strCommand))
+            MessagePreValidator::Submit(nodeId, strCommand, msg.vRecv);
+    }
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessReceivedMessages(CNode* pfrom)
 {
@@ -3773,6 +3892,8 @@ bool ProcessReceivedMessages(CNode* pfrom)
         const CMessageHeader& hdr = msg.hdr;
         std::string strCommand = msg.hdr.GetCommand();
 
+        QueueMessagesForPreValidation(pfrom->GetId(), iteratorToNextMessageToProcess, receivedMessageQueue.end());
+
         // Process message
         bool fRet = false;
         try {
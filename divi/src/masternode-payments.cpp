@@ -20,6 +20,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
+#include <deque>
 #include <numeric>
 #include <I_BlockSubsidyProvider.h>
 #include <script/standard.h>
@@ -29,6 +30,7 @@
 #include <MasternodePaymentData.h>
 #include <MasternodeHelpers.h>
 #include <MasternodeNetworkMessageManager.h>
+#include <flat-database.h>
 #include <timedata.h>
 #include <NodeStateRegistry.h>
 #include <Node.h>
@@ -134,6 +136,55 @@ public:
 };
 
 
+/** Number of seed hashes (blocks) whose masternode scores are kept.  */
+static constexpr unsigned SCORE_TABLE_SEEDS = 64;
+
+/**
+ * Internal helper class holding the scores of masternodes for recent seed
+ * hashes.  A score only depends on the seed hash and the collateral and tier
+ * of the masternode, so it is hashed once and then shared by the payment
+ * queue and the ranks used to check votes.
+ */
+class CMasternodePayments::ScoreTable
+{
+
+private:
+
+  typedef std::map<std::pair<COutPoint, int>, uint256> ScoresByMasternode;
+
+  CCriticalSection cs;
+  std::map<uint256, ScoresByMasternode> scoresBySeed;
+  /** Seed hashes in the order they were added, oldest first.  */
+  std::deque<uint256> seeds;
+
+public:
+
+  ScoreTable() = default;
+  ScoreTable(const ScoreTable&) = delete;
+  void operator=(const ScoreTable&) = delete;
+
+  uint256 GetScore(const CMasternode& mn, const uint256& seedHash)
+  {
+    LOCK(cs);
+    auto seedIt = scoresBySeed.find(seedHash);
+    if (seedIt == scoresBySeed.end()) {
+      if (seeds.size() >= SCORE_TABLE_SEEDS) {
+        scoresBySeed.erase(seeds.front());
+        seeds.pop_front();
+      }
+      seedIt = scoresBySeed.emplace(seedHash, ScoresByMasternode()).first;
+      seeds.push_back(seedHash);
+    }
+
+    const auto key = std::make_pair(mn.vin.prevout, static_cast<int>(mn.nTier));
+    auto scoreIt = seedIt->second.find(key);
+    if (scoreIt == seedIt->second.end())
+      scoreIt = seedIt->second.emplace(key, mn.CalculateScore(seedHash)).first;
+    return scoreIt->second;
+  }
+
+};
+
 /** Object for who's going to get paid on which blocks */
 
 CMasternodePayments::CMasternodePayments(
@@ -144,6 +195,7 @@ CMasternodePayments::CMasternodePayments(
     CMasternodeSync& masternodeSynchronization,
     const CChain& activeChain
     ): rankingCache(new RankingCache)
+    , scoreTable(new ScoreTable)
     , nSyncedFromPeer(0)
     , nLastBlockHeight(0)
     , networkFulfilledRequestManager_(networkFulfilledRequestManager)
@@ -360,12 +412,18 @@ bool CMasternodePayments::CheckMasternodeWinnerValidity(const CMasternodePayment
 // Is this masternode scheduled to get paid soon?
 // -- Only look ahead up to 8 blocks to allow for propagation of the latest 2 winners
 bool CMasternodePayments::IsScheduled(const CScript mnpayee, int nNotBlockHeight) const
+{
+    return GetScheduledPayees(nNotBlockHeight).count(mnpayee) > 0;
+}
+
+std::set<CScript> CMasternodePayments::GetScheduledPayees(int nNotBlockHeight) const
 {
     LOCK(cs_mapMasternodeBlocks);
 
+    std::set<CScript> scheduledPayees;
     CBlockIndex* tip = activeChain_.Tip();
     if (tip == nullptr)
-        return false;
+        return scheduledPayees;
 
     for (int64_t h = 0; h <= 8; ++h) {
         if (tip->nHeight + h == nNotBlockHeight) continue;
@@ -373,36 +431,28 @@ bool CMasternodePayments::IsScheduled(const CScript mnpayee, int nNotBlockHeight
         if (!GetBlockHashForScoring(seedHash, tip, h)) continue;
         auto* payees = GetPayeesForScoreHash(seedHash);
         CScript payee;
-        if (payees != nullptr && payees->GetPayee(payee) && payee == mnpayee)
-            return true;
+        if (payees != nullptr && payees->GetPayee(payee))
+            scheduledPayees.insert(payee);
     }
 
-    return false;
+    return scheduledPayees;
 }
 
 bool CMasternodePayments::AddWinningMasternode(const CMasternodePaymentWinner& winnerIn)
 {
-    CMasternodeBlockPayees* payees;
+    LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
+    return paymentData_.RecordWinnerVote(winnerIn);
+}
+
+bool CMasternodePayments::CompactPaymentData(CFlatDBLog<MasternodePaymentData>& store) const
+{
+    CDataStream snapshot(SER_DISK, CLIENT_VERSION);
     {
         LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePayeeVotes);
-
-        if (GetPaymentWinnerForHash(winnerIn.GetHash()) != nullptr)
+        if(!store.PrepareCompaction(paymentData_, snapshot))
             return false;
-
-        auto ins = mapMasternodePayeeVotes.emplace(winnerIn.GetHash(), winnerIn);
-        assert(ins.second);
-
-        payees = GetPayeesForScoreHash(winnerIn.GetScoreHash());
-        if (payees == nullptr) {
-            CMasternodeBlockPayees blockPayees(winnerIn.GetHeight());
-            auto mit = mapMasternodeBlocks.emplace(winnerIn.GetScoreHash(), std::move(blockPayees)).first;
-            payees = &mit->second;
-        }
     }
-
-    payees->CountVote(winnerIn.vinMasternode.prevout, winnerIn.payee);
-
-    return true;
+    return store.FinishCompaction(snapshot);
 }
 
 bool CMasternodeBlockPayees::IsTransactionValid(const I_BlockSubsidyProvider& subsidies, const CTransaction& txNew) const
@@ -514,7 +564,7 @@ void CMasternodePayments::PruneOldMasternodeWinnerData()
             LogPrint("mnpayments", "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.GetHeight());
             networkMessageManager_.mapSeenSyncMNW.erase((*it).first);
             mapMasternodePayeeVotes.erase(it++);
-            mapMasternodeBlocks.erase(winner.GetScoreHash());
+            paymentData_.EraseBlockPayees(winner.GetScoreHash());
         } else {
             ++it;
         }
@@ -552,36 +602,32 @@ std::string CMasternodePayments::ToString() const
 unsigned CMasternodePayments::FindLastPayeePaymentTime(const CMasternode& masternode, const unsigned maxBlockDepth) const
 {
     const CBlockIndex* chainTip = activeChain_.Tip();
-    if (chainTip == NULL) return 0u;
+    if (chainTip == NULL || maxBlockDepth == 0) return 0u;
 
-    CScript mnPayee = GetScriptForDestination(masternode.pubKeyCollateralAddress.GetID());
-    unsigned n = 0;
-    for (unsigned int i = 1; chainTip && chainTip->nHeight > 0; i++) {
-        if (n >= maxBlockDepth) {
-            return 0u;
-        }
-        n++;
+    /*
+        Look for the most recent block within maxBlockDepth of the tip on which this payee
+        has at least 2 votes. This will aid in consensus allowing the network to converge on
+        the same payees quickly, then keep the same schedule.
+    */
+    const CScript mnPayee = GetScriptForDestination(masternode.pubKeyCollateralAddress.GetID());
+    const int minHeight = std::max(1, chainTip->nHeight - static_cast<int>(maxBlockDepth) + 1);
 
-        uint256 seedHash;
-        if (!GetBlockHashForScoring(seedHash, chainTip, 0))
-            continue;
-
-        auto* masternodePayees = GetPayeesForScoreHash(seedHash);
-        if (masternodePayees != nullptr) {
-            /*
-                Search for this payee, with at least 2 votes. This will aid in consensus allowing the network
-                to converge on the same payees quickly, then keep the same schedule.
-            */
-            if (masternodePayees->HasPayeeWithVotes(mnPayee, 2)) {
-                return chainTip->nTime + masternode.DeterministicTimeOffset();
-            }
-        }
-
-        if (chainTip->pprev == NULL) {
-            assert(chainTip);
+    LOCK(cs_mapMasternodeBlocks);
+    const auto mit = paymentData_.mapPaidPayeeBlocks.find(mnPayee);
+    if (mit == paymentData_.mapPaidPayeeBlocks.end())
+        return 0u;
+
+    const MasternodePaymentData::BlocksByHeight& paidBlocks = mit->second;
+    for (auto it = paidBlocks.upper_bound(std::make_pair(chainTip->nHeight + 1, uint256())); it != paidBlocks.begin();) {
+        --it;
+        if (it->first < minHeight)
             break;
-        }
-        chainTip = chainTip->pprev;
+
+        // Only blocks of the active chain count, not ones the payee was voted for on a fork
+        const CBlockIndex* pindex = chainTip->GetAncestor(it->first);
+        uint256 seedHash;
+        if (pindex != nullptr && GetBlockHashForScoring(seedHash, pindex, 0) && seedHash == it->second)
+            return pindex->nTime + masternode.DeterministicTimeOffset();
     }
     return 0u;
 }
@@ -609,6 +655,7 @@ void ComputeMasternodesAndScores(
     const uint256& seedHash,
     const int nMnCount,
     const int nBlockHeight,
+    const std::set<CScript>& scheduledPayees,
     const bool fFilterSigTime,
     std::vector<CMasternode*>& masternodeQueue,
     std::map<const CMasternode*, uint256>& masternodeScores,
@@ -626,7 +673,7 @@ void ComputeMasternodesAndScores(
         // proper testing with a very small number of masternodes (which would
         // be scheduled and skipped all the time).
         if (Params().NetworkID() != CBaseChainParams::REGTEST) {
-            if (masternodePayments.IsScheduled(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()), nBlockHeight)) continue;
+            if (scheduledPayees.count(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID())) > 0) continue;
         }
 
         //it's too new, wait for a cycle
@@ -639,7 +686,7 @@ void ComputeMasternodesAndScores(
         if (ComputeMasternodeInputAge(mn) < nMnCount) continue;
 
         masternodeQueue.push_back(&mn);
-        masternodeScores[&mn] = mn.CalculateScore(seedHash);
+        masternodeScores[&mn] = masternodePayments.GetMasternodeScore(mn, seedHash);
     }
 }
 
@@ -652,12 +699,14 @@ std::vector<CMasternode*> CMasternodePayments::GetMasternodePaymentQueue(const u
 
     int nMnCount = masternodeManager_.CountEnabled();
     masternodeManager_.Check();
+    const std::set<CScript> scheduledPayees = GetScheduledPayees(nBlockHeight);
     ComputeMasternodesAndScores(
         *this,
         networkMessageManager_.masternodes,
         seedHash,
         nMnCount,
         nBlockHeight,
+        scheduledPayees,
         true,
         masternodeQueue,
         masternodeScores,
@@ -671,6 +720,7 @@ std::vector<CMasternode*> CMasternodePayments::GetMasternodePaymentQueue(const u
             seedHash,
             nMnCount,
             nBlockHeight,
+            scheduledPayees,
             false,
             masternodeQueue,
             masternodeScores,
@@ -698,7 +748,8 @@ namespace
 /** Checks if the given masternode is deemed "ok" based on the minimum
  *  masternode age for winners, the minimum protocol version and being active
  *  at all.  If so, returns true and sets its score.  */
-bool CheckAndGetScore(CMasternode& mn,
+bool CheckAndGetScore(const CMasternodePayments& masternodePayments,
+                      CMasternode& mn,
                       const uint256& seedHash, const int minProtocol,
                       int64_t& score)
 {
@@ -716,7 +767,7 @@ bool CheckAndGetScore(CMasternode& mn,
     if (!mn.IsEnabled ())
         return false;
 
-    const uint256 n = mn.CalculateScore(seedHash);
+    const uint256 n = masternodePayments.GetMasternodeScore(mn, seedHash);
     score = n.GetCompact(false);
 
     return true;
@@ -739,7 +790,7 @@ unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256&
             masternodeManager_.Check();
             for (auto& mn : networkMessageManager_.masternodes) {
                 int64_t score;
-                if (!CheckAndGetScore(mn, seedHash, minProtocol, score))
+                if (!CheckAndGetScore(*this, mn, seedHash, minProtocol, score))
                     continue;
 
                 rankedNodes.emplace_back(score, mn.vin.prevout.hash);
@@ -770,6 +821,11 @@ unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256&
     return static_cast<unsigned>(-1);
 }
 
+uint256 CMasternodePayments::GetMasternodeScore(const CMasternode& masternode, const uint256& seedHash) const
+{
+    return scoreTable->GetScore(masternode, seedHash);
+}
+
 void CMasternodePayments::ResetRankingCache()
 {
     rankingCache.reset(new RankingCache);
@@ -12,6 +12,7 @@
 #include <primitives/transaction.h>
 #include <sync.h>
 #include <MasternodePayeeData.h>
+#include <set>
 
 class CBlock;
 class CMasternodePayments;
@@ -29,6 +30,7 @@ class MasternodeNetworkMessageManager;
 class CChain;
 class CNetFulfilledRequestManager;
 class CNode;
+template <typename T> class CFlatDBLog;
 //
 // Masternode Payments Class
 // Keeps track of who should get paid for which blocks
@@ -41,6 +43,10 @@ private:
     // if some masternode is in the top-20 for a recent block height.
     class RankingCache;
     std::unique_ptr<RankingCache> rankingCache;
+    // Masternode scores for recent seed hashes, shared by everything that
+    // orders masternodes for a block.
+    class ScoreTable;
+    std::unique_ptr<ScoreTable> scoreTable;
 
     int nSyncedFromPeer;
     int nLastBlockHeight;
@@ -76,6 +82,10 @@ public:
     ~CMasternodePayments();
 
     bool AddWinningMasternode(const CMasternodePaymentWinner &winner);
+    /** Writes a new snapshot of the payment data to its store.  It is taken
+     *  with no votes added or pruned meanwhile, and written after the
+     *  payment locks are released.  */
+    bool CompactPaymentData(CFlatDBLog<MasternodePaymentData>& store) const;
 
     void Sync(CNode* node, int nCountNeeded);
     void CheckAndRemove();
@@ -83,6 +93,8 @@ public:
 
     bool IsTransactionValid(const I_BlockSubsidyProvider& subsidies,const CTransaction& txNew, const uint256& seedHash) const;
     bool IsScheduled(const CScript mnpayee, int nNotBlockHeight) const;
+    /** The payees of the upcoming blocks, as checked by IsScheduled for a single one */
+    std::set<CScript> GetScheduledPayees(int nNotBlockHeight) const;
 
     bool CanVote(const COutPoint& outMasternode, const uint256& seedHash);
 
@@ -107,6 +119,10 @@ public:
                                int minProtocol, unsigned nCheckNum) const;
     void ResetRankingCache();
 
+    /** Returns the score of the masternode for the given seed hash, computed
+     *  at most once per seed hash and masternode.  */
+    uint256 GetMasternodeScore(const CMasternode& masternode, const uint256& seedHash) const;
+
     /** Retrieves the payment winner for the given hash.  Returns null
      *  if there is no entry for that hash.  */
     const CMasternodePaymentWinner* GetPaymentWinnerForHash(const uint256& hash) const {
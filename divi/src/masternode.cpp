@@ -12,6 +12,8 @@
 #include <script/standard.h>
 #include <chainparams.h>
 #include <streams.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
 #include <net.h>
 
 CAmount CMasternode::GetTierCollateralAmount(const MasternodeTier tier)
@@ -150,30 +152,33 @@ CScript CMasternode::GetPaymentScript() const
     return GetScriptForDestination(dest);
 }
 
-static uint256 CalculateScoreHelper(CHashWriter hashWritter, int round)
-{
-    hashWritter << round;
-    return hashWritter.GetHash();
-}
-
 //
 // Deterministically calculate a given "score" for a Masternode depending on how close it's hash is to
 // the proof of work for that block. The further away they are the better, the furthest will win the election
 // and get paid this block
 //
+// Each round hashes seedHash || aux || round (as serialized by CHashWriter). The 64-byte prefix is the same
+// for all rounds, so the rounds are hashed as one batch in parallel SHA256 lanes.
+//
 uint256 CMasternode::CalculateScore(const uint256& seedHash) const
 {
     const uint256 aux = vin.prevout.hash + vin.prevout.n;
     const size_t nHashRounds = GetHashRoundsForTierMasternodes(static_cast<MasternodeTier>(nTier));
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    ss << seedHash;
-    ss << aux;
+    unsigned char prefix[2 * sizeof(uint256)];
+    memcpy(prefix, seedHash.begin(), sizeof(uint256));
+    memcpy(prefix + sizeof(uint256), aux.begin(), sizeof(uint256));
+
+    std::vector<unsigned char> rounds(sizeof(int32_t) * nHashRounds);
+    for (size_t i = 0; i < nHashRounds; ++i)
+        WriteLE32(&rounds[sizeof(int32_t) * i], static_cast<uint32_t>(i));
+    std::vector<uint256> hashes(nHashRounds);
+    if (nHashRounds > 0)
+        SHA256DBatchWithPrefix(hashes[0].begin(), prefix, rounds.data(), sizeof(int32_t), nHashRounds);
 
     uint256 r;
-    for(size_t i = 0; i < nHashRounds; ++i) {
-        r = std::max(CalculateScoreHelper(ss, i), r);
-    }
+    for (const uint256& hash : hashes)
+        r = std::max(hash, r);
 
     return r;
 }
@@ -285,6 +285,9 @@ CMasternodeMan::MnUpdateStatus CMasternodeMan::UpdateMasternodeFromBroadcast(CMa
         LogPrint("masternode","mnb - Got updated entry for %s\n", mnb.vin.prevout.hash);
         if (UpdateWithNewBroadcast(mnb,*pmn))
         {
+            // the list entry changed in place, so the cache journal has to
+            // learn about it here rather than through Add
+            networkMessageManager_.recordBroadcast(mnb);
             int unusedDoSValue = 0;
             if (mnb.lastPing != CMasternodePing() &&
                 CheckAndUpdatePing(*pmn,mnb.lastPing,unusedDoSValue))
@@ -564,6 +567,7 @@ void CMasternodeMan::Remove(const CTxIn& vin)
         if ((*it).vin == vin) {
             LogPrint("masternode", "CMasternodeMan: Removing Masternode %s - %i now\n", (*it).vin.prevout.hash, networkMessageManager_.masternodeCount() - 1);
             networkMessageManager_.masternodes.erase(it);
+            networkMessageManager_.recordMasternodeRemoval(vin.prevout);
             break;
         }
         ++it;
@@ -7,6 +7,7 @@
 #include "merkleblock.h"
 
 #include "hash.h"
+#include "MerkleTree.h"
 #include "primitives/block.h" // for MAX_BLOCK_SIZE
 #include "utilstrencodings.h"
 
@@ -35,25 +36,16 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter& filter)
     txn = CPartialMerkleTree(vHashes, vMatch);
 }
 
-uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTxid)
+uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256>& vTree)
 {
-    if (height == 0) {
-        // hash at height 0 is the txids themself
-        return vTxid[pos];
-    } else {
-        // calculate left hash
-        uint256 left = CalcHash(height - 1, pos * 2, vTxid), right;
-        // calculate right hash if not beyond the end of the array - copy left hash otherwise1
-        if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            right = CalcHash(height - 1, pos * 2 + 1, vTxid);
-        else
-            right = left;
-        // combine subhashes
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
-    }
+    // the levels are stored one after another, starting with the txids themselves at height 0
+    unsigned int nLevelStart = 0;
+    for (int level = 0; level < height; level++)
+        nLevelStart += CalcTreeWidth(level);
+    return vTree[nLevelStart + pos];
 }
 
-void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256>& vTxid, const std::vector<bool>& vMatch)
+void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256>& vTree, const std::vector<bool>& vMatch)
 {
     // determine whether this node is the parent of at least one matched txid
     bool fParentOfMatch = false;
@@ -63,12 +55,12 @@ void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const st
     vBits.push_back(fParentOfMatch);
     if (height == 0 || !fParentOfMatch) {
         // if at height 0, or nothing interesting below, store hash and stop
-        vHash.push_back(CalcHash(height, pos, vTxid));
+        vHash.push_back(CalcHash(height, pos, vTree));
     } else {
         // otherwise, don't store any hash, but descend into the subtrees
-        TraverseAndBuild(height - 1, pos * 2, vTxid, vMatch);
+        TraverseAndBuild(height - 1, pos * 2, vTree, vMatch);
         if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            TraverseAndBuild(height - 1, pos * 2 + 1, vTxid, vMatch);
+            TraverseAndBuild(height - 1, pos * 2 + 1, vTree, vMatch);
     }
 }
 
@@ -114,8 +106,10 @@ CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256>& vTxid, const
     while (CalcTreeWidth(nHeight) > 1)
         nHeight++;
 
-    // traverse the partial tree
-    TraverseAndBuild(nHeight, 0, vTxid, vMatch);
+    // hash all levels of the full tree at once, then traverse the partial tree
+    std::vector<uint256> vTree(vTxid);
+    ComputeMerkleTree(vTree);
+    TraverseAndBuild(nHeight, 0, vTree, vMatch);
 }
 
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
@@ -8,6 +8,7 @@
 #include <base58.h>
 #include <base58address.h>
 #include <hash.h>
+#include <script/sigcache.h>
 #include <string>
 #include <ui_interface.h>
 #include <Logging.h>
@@ -61,9 +62,13 @@ bool CObfuScationSigner::VerifyMessage(CKeyID pubkeyID, const std::vector<unsign
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
+    const uint256 hash = ss.GetHash();
+
+    if (IsCachedCompactSignature(hash, vchSig, pubkeyID))
+        return true;
 
     CPubKey pubkey2;
-    if (!pubkey2.RecoverCompact(ss.GetHash(), vchSig)) {
+    if (!pubkey2.RecoverCompact(hash, vchSig)) {
         errorMessage = translate("Error recovering public key.");
         return false;
     }
@@ -71,5 +76,24 @@ bool CObfuScationSigner::VerifyMessage(CKeyID pubkeyID, const std::vector<unsign
     if (pubkey2.GetID() != pubkeyID)
         LogPrint("sign","CObfuScationSigner::VerifyMessage -- keys don't match: %s %s\n", pubkey2.GetID(), pubkeyID);
 
-    return (pubkey2.GetID() == pubkeyID);
+    if (pubkey2.GetID() != pubkeyID)
+        return false;
+
+    CacheCompactSignature(hash, vchSig, pubkeyID);
+    return true;
+}
+
+bool CObfuScationSigner::PreVerifyMessage(const std::vector<unsigned char>& vchSig, const std::string& strMessage)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << strMessage;
+    const uint256 hash = ss.GetHash();
+
+    CPubKey signer;
+    if (!signer.RecoverCompact(hash, vchSig))
+        return false;
+
+    CacheCompactSignature(hash, vchSig, signer.GetID());
+    return true;
 }
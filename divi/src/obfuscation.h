@@ -19,6 +19,8 @@ struct CObfuScationSigner
     static bool SignMessage(std::string strMessage, std::string& errorMessage, std::vector<unsigned char>& vchSig, CKey key);
     /// Verify the message, returns true if succcessful
     static bool VerifyMessage(CKeyID pubkeyID, const std::vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage);
+    /// Recover the signer of the message ahead of its verification, so that VerifyMessage of it is a cache lookup
+    static bool PreVerifyMessage(const std::vector<unsigned char>& vchSig, const std::string& strMessage);
 
     template <typename T>
     static bool VerifySignature(const T& signableMessage, const CPubKey& keyToCheckAgainst,std::string& errorMessage)
@@ -30,6 +32,11 @@ struct CObfuScationSigner
         return true;
     }
     template <typename T>
+    static bool PreVerifySignature(const T& signableMessage)
+    {
+        return CObfuScationSigner::PreVerifyMessage(signableMessage.signature, signableMessage.getMessageToSign());
+    }
+    template <typename T>
     static bool SignAndVerify(T& signableMessage, const CKey& keyToSignWith, const CPubKey& keyToCheckAgainst,std::string& errorMessage)
     {
         const std::string strMessage = signableMessage.getMessageToSign();
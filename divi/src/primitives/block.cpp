@@ -7,18 +7,149 @@
 #include "primitives/block.h"
 
 #include "hash.h"
+#include "MerkleTree.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "Logging.h"
 
+#include <array>
+#include <assert.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string.h>
+
+namespace
+{
+/** Bytes of a header covered by its Quark hash, nVersion through nNonce */
+constexpr size_t QUARK_HEADER_SIZE = 80u;
+/** Offset of the merkle root within those bytes, which spreads headers over the shards */
+constexpr size_t QUARK_HEADER_MERKLE_ROOT_OFFSET = 36u;
+/** Independently locked parts of the memo, so concurrent hashing rarely contends */
+constexpr size_t HEADER_HASH_MEMO_SHARDS = 16u;
+/** Headers whose hashes are remembered; a full headers message fits */
+constexpr size_t MAX_REMEMBERED_HEADER_HASHES = 4096u;
+
+typedef std::array<unsigned char, QUARK_HEADER_SIZE> QuarkHeaderBytes;
+
+QuarkHeaderBytes GetQuarkHeaderBytes(const CBlockHeader& header)
+{
+    assert(static_cast<size_t>(END(header.nNonce) - BEGIN(header.nVersion)) == QUARK_HEADER_SIZE);
+    QuarkHeaderBytes bytes;
+    memcpy(bytes.data(), BEGIN(header.nVersion), QUARK_HEADER_SIZE);
+    return bytes;
+}
+
+/**
+ * The Quark hashes of recently hashed headers, keyed by the hashed bytes so
+ * that a remembered hash can never be stale. A block is hashed several times
+ * on its way through validation, and header batches are hashed ahead of it.
+ * GetHash is called from many threads, so the memo is split into shards by
+ * merkle root, each with its own lock and share of the capacity.
+ */
+class QuarkHeaderHashMemo
+{
+private:
+    typedef std::map<QuarkHeaderBytes, uint256> HashByHeader;
+
+    struct Shard
+    {
+        std::mutex mutex;
+        HashByHeader hashes;
+        std::deque<HashByHeader::iterator> insertionOrder;
+    };
+
+    Shard shards_[HEADER_HASH_MEMO_SHARDS];
+    std::atomic<uint64_t> hits_;
+
+    Shard& ShardOf(const QuarkHeaderBytes& header)
+    {
+        return shards_[header[QUARK_HEADER_MERKLE_ROOT_OFFSET] % HEADER_HASH_MEMO_SHARDS];
+    }
+
+public:
+    QuarkHeaderHashMemo(): hits_(0u) {}
+
+    bool Lookup(const QuarkHeaderBytes& header, uint256& hash)
+    {
+        Shard& shard = ShardOf(header);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const HashByHeader::const_iterator it = shard.hashes.find(header);
+        if (it == shard.hashes.end())
+            return false;
+        hash = it->second;
+        ++hits_;
+        return true;
+    }
+
+    void Insert(const QuarkHeaderBytes& header, const uint256& hash)
+    {
+        Shard& shard = ShardOf(header);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const std::pair<HashByHeader::iterator, bool> inserted = shard.hashes.emplace(header, hash);
+        if (!inserted.second)
+            return;
+        shard.insertionOrder.push_back(inserted.first);
+        if (shard.insertionOrder.size() > MAX_REMEMBERED_HEADER_HASHES / HEADER_HASH_MEMO_SHARDS) {
+            shard.hashes.erase(shard.insertionOrder.front());
+            shard.insertionOrder.pop_front();
+        }
+    }
+
+    uint64_t Hits() const
+    {
+        return hits_;
+    }
+};
+
+QuarkHeaderHashMemo& GetQuarkHeaderHashMemo()
+{
+    // Genesis blocks are hashed during static initialization
+    static QuarkHeaderHashMemo memo;
+    return memo;
+}
+}
+
 uint256 CBlockHeader::GetHash() const
 {
     if(nVersion < 4)
-        return HashQuark(BEGIN(nVersion), END(nNonce));
+    {
+        const QuarkHeaderBytes header = GetQuarkHeaderBytes(*this);
+        uint256 hash;
+        if (!GetQuarkHeaderHashMemo().Lookup(header, hash)) {
+            hash = HashQuark(header.begin(), header.end());
+            GetQuarkHeaderHashMemo().Insert(header, hash);
+        }
+        return hash;
+    }
 
     return Hash(BEGIN(nVersion), END(nAccumulatorCheckpoint));
 }
 
+uint64_t GetRememberedHeaderHashHits()
+{
+    return GetQuarkHeaderHashMemo().Hits();
+}
+
+void PrecomputeBlockHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<QuarkHeaderBytes> quarkHeaders;
+    quarkHeaders.reserve(headers.size());
+    for (const CBlockHeader& header : headers) {
+        if (header.nVersion < 4)
+            quarkHeaders.push_back(GetQuarkHeaderBytes(header));
+    }
+    if (quarkHeaders.empty())
+        return;
+
+    static_assert(sizeof(QuarkHeaderBytes) == QUARK_HEADER_SIZE, "headers are hashed as a flat array");
+    std::vector<uint256> hashes(quarkHeaders.size());
+    QuarkHashBatch(hashes[0].begin(), quarkHeaders[0].data(), QUARK_HEADER_SIZE, quarkHeaders.size());
+    for (size_t index = 0; index < quarkHeaders.size(); ++index)
+        GetQuarkHeaderHashMemo().Insert(quarkHeaders[index], hashes[index]);
+}
+
 uint256 CBlock::BuildMerkleTree(bool* fMutated) const
 {
     /* WARNING! If you're reading this because you're learning about crypto
@@ -60,26 +191,7 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
     vMerkleTree.reserve(vtx.size() * 2 + 16); // Safe upper bound for the number of total nodes.
     for (std::vector<CTransaction>::const_iterator it(vtx.begin()); it != vtx.end(); ++it)
         vMerkleTree.push_back(it->GetHash());
-    int j = 0;
-    bool mutated = false;
-    for (int nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
-    {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
-        }
-        j += nSize;
-    }
-    if (fMutated) {
-        *fMutated = mutated;
-    }
-    return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
+    return ComputeMerkleTree(vMerkleTree, fMutated);
 }
 
 std::vector<uint256> CBlock::GetMerkleBranch(int nIndex) const
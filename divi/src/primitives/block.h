@@ -163,6 +163,13 @@ public:
     void print() const;
 };
 
+/** Computes the Quark hashes of the pre version 4 headers among headers in
+ *  multi-lane batches and remembers them, so that their GetHash() calls during
+ *  validation are lookups. Later versions hash with SHA256 and are skipped. */
+void PrecomputeBlockHeaderHashes(const std::vector<CBlockHeader>& headers);
+
+/** Number of GetHash() calls answered from the remembered header hashes */
+uint64_t GetRememberedHeaderHashHits();
 
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
@@ -24,12 +24,15 @@
 #include <boost/foreach.hpp>
 #include <utilstrencodings.h>
 #include <txmempool.h>
+#include <script/sigcache.h>
+#include <RpcStateSnapshot.h>
+#include <defaultValues.h>
 
 using namespace json_spirit;
 using namespace std;
 
 extern Settings& settings;
-extern unsigned int nCoinCacheSize;
+extern size_t nCoinCacheUsage;
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, Object& entry);
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, Object& out, bool fIncludeHex);
 extern bool ShutdownRequested();
@@ -137,7 +140,7 @@ Value getblockcount(const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    return chainActive.Height();
+    return GetRpcStateSnapshot()->height;
 }
 
 Value getbestblockhash(const Array& params, bool fHelp)
@@ -151,7 +154,7 @@ Value getbestblockhash(const Array& params, bool fHelp)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetRpcStateSnapshot()->bestBlockHash.GetHex();
 }
 
 Value getdifficulty(const Array& params, bool fHelp)
@@ -191,6 +194,12 @@ Value getrawmempool(const Array& params, bool fHelp)
             "    \"height\" : n,           (numeric) block height when transaction entered pool\n"
             "    \"startingpriority\" : n, (numeric) priority when transaction entered pool\n"
             "    \"currentpriority\" : n,  (numeric) transaction priority now\n"
+            "    \"descendantcount\" : n,  (numeric) number of in-mempool descendant transactions (including this one)\n"
+            "    \"descendantsize\" : n,   (numeric) size of in-mempool descendants (including this one)\n"
+            "    \"descendantfees\" : n,   (numeric) modified fees of in-mempool descendants (including this one) in divi\n"
+            "    \"ancestorcount\" : n,    (numeric) number of in-mempool ancestor transactions (including this one)\n"
+            "    \"ancestorsize\" : n,     (numeric) size of in-mempool ancestors (including this one)\n"
+            "    \"ancestorfees\" : n,     (numeric) modified fees of in-mempool ancestors (including this one) in divi\n"
             "    \"depends\" : [           (array) unconfirmed transactions used as inputs for this transaction\n"
             "        \"transactionid\",    (string) parent transaction id\n"
             "       ... ]\n"
@@ -206,9 +215,8 @@ Value getrawmempool(const Array& params, bool fHelp)
     if (fVerbose) {
         LOCK(mempool.cs);
         Object o;
-        BOOST_FOREACH (const PAIRTYPE(uint256, CTxMemPoolEntry) & entry, mempool.mapTx) {
-            const uint256& hash = entry.first;
-            const CTxMemPoolEntry& e = entry.second;
+        BOOST_FOREACH (const CTxMemPoolEntry& e, mempool.mapTx) {
+            const uint256& hash = e.GetTx().GetHash();
             Object info;
             info.push_back(Pair("size", (int)e.GetTxSize()));
             info.push_back(Pair("fee", ValueFromAmount(e.GetFee())));
@@ -216,6 +224,12 @@ Value getrawmempool(const Array& params, bool fHelp)
             info.push_back(Pair("height", (int)e.GetHeight()));
             info.push_back(Pair("startingpriority", e.GetPriority(e.GetHeight())));
             info.push_back(Pair("currentpriority", e.GetPriority(chainActive.Height())));
+            info.push_back(Pair("descendantcount", e.GetCountWithDescendants()));
+            info.push_back(Pair("descendantsize", e.GetSizeWithDescendants()));
+            info.push_back(Pair("descendantfees", ValueFromAmount(e.GetModFeesWithDescendants())));
+            info.push_back(Pair("ancestorcount", e.GetCountWithAncestors()));
+            info.push_back(Pair("ancestorsize", e.GetSizeWithAncestors()));
+            info.push_back(Pair("ancestorfees", ValueFromAmount(e.GetModFeesWithAncestors())));
             const CTransaction& tx = e.GetTx();
             set<string> setDepends;
             for (const CTxIn& txin : tx.vin) {
@@ -303,12 +317,17 @@ Value getblock(const Array& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    CBlockIndex* pblockindex = NULL;
+    {
+        LOCK(cs_main);
+        BlockMap::iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mi->second;
+    }
 
+    // Block files are only appended to, so the read does not need cs_main
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
     if (!ReadBlockFromDisk(block, pblockindex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
@@ -319,6 +338,7 @@ Value getblock(const Array& params, bool fHelp)
         return strHex;
     }
 
+    LOCK(cs_main);
     return blockToJSON(block, pblockindex);
 }
 
@@ -388,6 +408,8 @@ Value gettxoutsetinfo(const Array& params, bool fHelp)
             "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
             "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "  \"cache_usage\": n,       (numeric) Memory held by the in-memory coins cache before this call flushed it, in bytes\n"
+            "  \"cache_limit\": n,       (numeric) Memory the coins cache may use before it is flushed, in bytes (from -dbcache)\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("gettxoutsetinfo", "") + HelpExampleRpc("gettxoutsetinfo", ""));
@@ -395,6 +417,11 @@ Value gettxoutsetinfo(const Array& params, bool fHelp)
     Object ret;
 
     CCoinsStats stats;
+    size_t cacheUsage = 0;
+    {
+        LOCK(cs_main);
+        cacheUsage = pcoinsTip->DynamicMemoryUsage();
+    }
     FlushStateToDisk();
     if (pcoinsTip->GetStats(stats)) {
         ret.push_back(Pair("height", (int64_t)stats.nHeight));
@@ -404,6 +431,8 @@ Value gettxoutsetinfo(const Array& params, bool fHelp)
         ret.push_back(Pair("bytes_serialized", (int64_t)stats.nSerializedSize));
         ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
         ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
+        ret.push_back(Pair("cache_usage", (int64_t)cacheUsage));
+        ret.push_back(Pair("cache_limit", (int64_t)nCoinCacheUsage));
     }
     return ret;
 }
@@ -508,14 +537,13 @@ Value verifychain(const Array& params, bool fHelp)
         chainManager,
         chainActive,
         uiInterface,
-        nCoinCacheSize,
+        nCoinCacheUsage,
         &ShutdownRequested);
     return dbVerifier.VerifyDB(pcoinsTip,pcoinsTip, nCheckLevel, nCheckDepth);
 }
 
 Value getblockchaininfo(const Array& params, bool fHelp)
 {
-    static const CCheckpointServices checkpointsVerifier(GetCurrentChainCheckpoints);
     if (fHelp || params.size() != 0)
         throw runtime_error(
             "getblockchaininfo\n"
@@ -533,14 +561,15 @@ Value getblockchaininfo(const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblockchaininfo", "") + HelpExampleRpc("getblockchaininfo", ""));
 
+    std::shared_ptr<const RpcStateSnapshot> snapshot = GetRpcStateSnapshot();
     Object obj;
     obj.push_back(Pair("chain", Params().NetworkIDString()));
-    obj.push_back(Pair("blocks", (int)chainActive.Height()));
-    obj.push_back(Pair("headers", pindexBestHeader ? pindexBestHeader->nHeight : -1));
-    obj.push_back(Pair("bestblockhash", chainActive.Tip()->GetBlockHash().GetHex()));
-    obj.push_back(Pair("difficulty", (double)GetDifficulty()));
-    obj.push_back(Pair("verificationprogress", checkpointsVerifier.GuessVerificationProgress(chainActive.Tip())));
-    obj.push_back(Pair("chainwork", chainActive.Tip()->nChainWork.GetHex()));
+    obj.push_back(Pair("blocks", snapshot->height));
+    obj.push_back(Pair("headers", snapshot->headerHeight));
+    obj.push_back(Pair("bestblockhash", snapshot->bestBlockHash.GetHex()));
+    obj.push_back(Pair("difficulty", snapshot->difficulty));
+    obj.push_back(Pair("verificationprogress", snapshot->verificationProgress));
+    obj.push_back(Pair("chainwork", snapshot->tip->nChainWork.GetHex()));
     return obj;
 }
 
@@ -652,6 +681,13 @@ Value getmempoolinfo(const Array& params, bool fHelp)
             "{\n"
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
+            "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"maxmempool\": xxxxx          (numeric) Maximum memory usage for the mempool\n"
+            "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee rate in DIV/kB for a transaction to be accepted\n"
+            "  \"evicted\": xxxxx             (numeric) Transactions evicted to stay below maxmempool since startup\n"
+            "  \"expired\": xxxxx             (numeric) Transactions expired after -mempoolexpiry since startup\n"
+            "  \"coinscacheusage\": xxxxx     (numeric) Memory used by the in-memory coins cache, which also holds the mempool's inputs\n"
+            "  \"coinscachelimit\": xxxxx     (numeric) Memory the coins cache may use before it is flushed (from -dbcache)\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getmempoolinfo", "") + HelpExampleRpc("getmempoolinfo", ""));
@@ -659,6 +695,42 @@ Value getmempoolinfo(const Array& params, bool fHelp)
     Object ret;
     ret.push_back(Pair("size", (int64_t)mempool.size()));
     ret.push_back(Pair("bytes", (int64_t)mempool.GetTotalTxSize()));
+    ret.push_back(Pair("usage", (int64_t)mempool.DynamicMemoryUsage()));
+    const size_t maxmempool = settings.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    ret.push_back(Pair("maxmempool", (int64_t)maxmempool));
+    ret.push_back(Pair("mempoolminfee", ValueFromAmount(mempool.GetMinFee(maxmempool).GetFeePerK())));
+    ret.push_back(Pair("evicted", (int64_t)mempool.GetEvictedCount()));
+    ret.push_back(Pair("expired", (int64_t)mempool.GetExpiredCount()));
+    ret.push_back(Pair("coinscacheusage", (int64_t)GetRpcStateSnapshot()->coinsCacheUsage));
+    ret.push_back(Pair("coinscachelimit", (int64_t)nCoinCacheUsage));
+
+    return ret;
+}
+
+Value getsigcacheinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getsigcacheinfo\n"
+            "\nReturns details on the signature cache since startup.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"bytes\": xxxxx               (numeric) Memory reserved for cache entries\n"
+            "  \"maxentries\": xxxxx          (numeric) Number of entries the cache can hold\n"
+            "  \"hits\": xxxxx                (numeric) Signature checks answered by the cache\n"
+            "  \"misses\": xxxxx              (numeric) Signature checks that had to be verified\n"
+            "  \"inserts\": xxxxx             (numeric) Verified signatures added to the cache\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getsigcacheinfo", "") + HelpExampleRpc("getsigcacheinfo", ""));
+
+    const SignatureCacheStats stats = GetSignatureCacheStats();
+    Object ret;
+    ret.push_back(Pair("bytes", (uint64_t)stats.bytes));
+    ret.push_back(Pair("maxentries", (uint64_t)stats.maxEntries));
+    ret.push_back(Pair("hits", (uint64_t)stats.hits));
+    ret.push_back(Pair("misses", (uint64_t)stats.misses));
+    ret.push_back(Pair("inserts", (uint64_t)stats.inserts));
 
     return ret;
 }
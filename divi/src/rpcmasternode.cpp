@@ -24,6 +24,7 @@
 #include <MasternodeHelpers.h>
 #include <version.h>
 #include <RpcMasternodeFeatures.h>
+#include <RpcStateSnapshot.h>
 
 #include <boost/tokenizer.hpp>
 #include <boost/algorithm/string.hpp>
@@ -392,8 +393,7 @@ Value getmasternodecount (const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getmasternodecount", "") + HelpExampleRpc("getmasternodecount", ""));
 
-    const CBlockIndex* tip = chainActive.Tip();
-    MasternodeCountData data = GetMasternodeCounts(tip);
+    MasternodeCountData data = GetMasternodeCounts(GetRpcStateSnapshot()->tip);
 
     Object obj;
     obj.push_back(Pair("total", data.total));
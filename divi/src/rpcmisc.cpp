@@ -37,6 +37,7 @@
 #include <IndexDatabaseUpdateCollector.h>
 
 #include <Settings.h>
+#include <RpcStateSnapshot.h>
 extern Settings& settings;
 
 using namespace boost;
@@ -153,22 +154,23 @@ Value getinfo(const Array& params, bool fHelp)
     proxyType proxy;
     GetProxy(NET_IPV4, proxy);
 
+    std::shared_ptr<const RpcStateSnapshot> snapshot = GetRpcStateSnapshot();
     Object obj;
     obj.push_back(Pair("version", CLIENT_VERSION_STR));
     obj.push_back(Pair("protocolversion", PROTOCOL_VERSION));
 #ifdef ENABLE_WALLET
-    if (pwalletMain) {
-        obj.push_back(Pair("walletversion", pwalletMain->GetVersion()));
-        obj.push_back(Pair("balance", ValueFromAmount(pwalletMain->GetBalance())));
+    if (snapshot->hasWallet) {
+        obj.push_back(Pair("walletversion", snapshot->walletVersion));
+        obj.push_back(Pair("balance", ValueFromAmount(snapshot->balance)));
     }
 #endif
-    obj.push_back(Pair("blocks", (int)chainActive.Height()));
+    obj.push_back(Pair("blocks", snapshot->height));
     obj.push_back(Pair("timeoffset", GetTimeOffset()));
     obj.push_back(Pair("connections", (int) GetPeerCount() ));
     obj.push_back(Pair("proxy", (proxy.IsValid() ? proxy.proxy.ToStringIPPort() : string())));
-    obj.push_back(Pair("difficulty", (double)GetDifficulty()));
+    obj.push_back(Pair("difficulty", snapshot->difficulty));
     obj.push_back(Pair("testnet", Params().NetworkID() == CBaseChainParams::TESTNET  ));
-    obj.push_back(Pair("moneysupply",ValueFromAmount(chainActive.Tip()->nMoneySupply)));
+    obj.push_back(Pair("moneysupply",ValueFromAmount(snapshot->moneySupply)));
 
 #ifdef ENABLE_WALLET
     if (pwalletMain) {
@@ -1161,13 +1163,14 @@ Value getstakingstatus(const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getstakingstatus", "") + HelpExampleRpc("getstakingstatus", ""));
 
+    std::shared_ptr<const RpcStateSnapshot> snapshot = GetRpcStateSnapshot();
     Object obj;
-    obj.push_back(Pair("validtime", chainActive.Tip()->nTime > 1471482000));
+    obj.push_back(Pair("validtime", snapshot->tip->nTime > 1471482000));
     obj.push_back(Pair("haveconnections", GetPeerCount()>0 ));
     if (pwalletMain) {
         obj.push_back(Pair("walletunlocked", !pwalletMain->IsLocked()));
-        obj.push_back(Pair("mintablecoins", pwalletMain->MintableCoins()));
-        obj.push_back(Pair("enoughcoins", pwalletMain->GetStakingBalance() > 0  ));
+        obj.push_back(Pair("mintablecoins", snapshot->hasMintableCoins));
+        obj.push_back(Pair("enoughcoins", snapshot->stakingBalance > 0  ));
     }
 
     obj.push_back(Pair("mnsync", GetMasternodeModule().getMasternodeSynchronization().IsSynced()));
@@ -33,6 +33,8 @@ using namespace json_spirit;
 
 //! Number of bytes to allocate and read at most at once in post data
 const size_t POST_READ_SIZE = 256 * 1024;
+//! Longest request line plus headers accepted by FrameHTTPRequest
+const size_t MAX_HTTP_HEADERS_SIZE = 64 * 1024;
 
 /**
  * HTTP protocol
@@ -256,6 +258,41 @@ int ReadHTTPMessage(std::basic_istream<char>& stream, map<string, string>& mapHe
  * http://www.codeproject.com/KB/recipes/JSON_Spirit.aspx
  */
 
+HTTPRequestFraming FrameHTTPRequest(const string& buffer, size_t max_size, size_t& requestSize)
+{
+    // The request line and headers are read line by line, up to an empty line
+    string::size_type lineStart = buffer.find('\n');
+    if (lineStart == string::npos)
+        return buffer.size() > MAX_HTTP_HEADERS_SIZE ? HTTP_REQUEST_TOO_LARGE : HTTP_REQUEST_INCOMPLETE;
+    ++lineStart;
+
+    int nLen = 0;
+    while (true) {
+        const string::size_type lineEnd = buffer.find('\n', lineStart);
+        if (lineEnd == string::npos)
+            return buffer.size() > MAX_HTTP_HEADERS_SIZE ? HTTP_REQUEST_TOO_LARGE : HTTP_REQUEST_INCOMPLETE;
+        const string str = buffer.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (str.empty() || str == "\r")
+            break;
+        string::size_type nColon = str.find(":");
+        if (nColon != string::npos) {
+            string strHeader = str.substr(0, nColon);
+            boost::trim(strHeader);
+            boost::to_lower(strHeader);
+            if (strHeader == "content-length")
+                nLen = atoi(str.c_str() + nColon + 1);
+        }
+    }
+    if (lineStart > MAX_HTTP_HEADERS_SIZE || nLen < 0 || (size_t)nLen > max_size)
+        return HTTP_REQUEST_TOO_LARGE;
+
+    if (buffer.size() - lineStart < (size_t)nLen)
+        return HTTP_REQUEST_INCOMPLETE;
+    requestSize = lineStart + nLen;
+    return HTTP_REQUEST_COMPLETE;
+}
+
 string JSONRPCRequest(const string& strMethod, const Array& params, const Value& id)
 {
     Object request;
@@ -84,6 +84,21 @@ bool ReadHTTPRequestLine(std::basic_istream<char>& stream, int& proto, std::stri
 int ReadHTTPStatus(std::basic_istream<char>& stream, int& proto);
 int ReadHTTPHeaders(std::basic_istream<char>& stream, std::map<std::string, std::string>& mapHeadersRet);
 int ReadHTTPMessage(std::basic_istream<char>& stream, std::map<std::string, std::string>& mapHeadersRet, std::string& strMessageRet, int nProto, size_t max_size);
+
+/** How much of one HTTP request sits at the front of a receive buffer */
+enum HTTPRequestFraming {
+    HTTP_REQUEST_INCOMPLETE,
+    HTTP_REQUEST_COMPLETE,
+    HTTP_REQUEST_TOO_LARGE,
+};
+/**
+ * Find the end of the first request in `buffer` (request line, headers up to
+ * the blank line, then Content-Length bytes of body) without consuming it, so
+ * that a non-blocking reader knows when ReadHTTPRequestLine and
+ * ReadHTTPMessage can parse it. On HTTP_REQUEST_COMPLETE `requestSize` is its
+ * length in bytes.
+ */
+HTTPRequestFraming FrameHTTPRequest(const std::string& buffer, size_t max_size, size_t& requestSize);
 std::string JSONRPCRequest(const std::string& strMethod, const json_spirit::Array& params, const json_spirit::Value& id);
 json_spirit::Object JSONRPCReplyObj(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
 std::string JSONRPCReply(const json_spirit::Value& result, const json_spirit::Value& error, const json_spirit::Value& id);
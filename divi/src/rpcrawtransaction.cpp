@@ -283,11 +283,11 @@ Value getrawtransaction(const Array& params, bool fHelp)
     int nConfirmations = 0;
     int nBlockTime = 0;
 
+    if (!GetTransaction(hash, tx, hashBlock, true))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
+
     {
         LOCK(cs_main);
-        if (!GetTransaction(hash, tx, hashBlock, true))
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
-
         BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
         if (mi != mapBlockIndex.end() && (*mi).second) {
             CBlockIndex* pindex = (*mi).second;
@@ -16,11 +16,15 @@
 #include "wallet.h"
 #endif
 #include "Settings.h"
+#include "checkqueue.h"
+#include "RpcStateSnapshot.h"
 #include <utilmoneystr.h>
 #include <random.h>
+#include <defaultValues.h>
 
 #include "json/json_spirit_writer_template.h"
 #include <boost/algorithm/string.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
@@ -30,6 +34,9 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
+#include <atomic>
+#include <sstream>
+
 extern CCriticalSection cs_main;
 extern CConditionVariable cvBlockChange;
 
@@ -113,6 +120,7 @@ extern json_spirit::Value getlotteryblockwinners(const json_spirit::Array& param
 extern json_spirit::Value getbestblockhash(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getdifficulty(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getmempoolinfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getsigcacheinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getrawmempool(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblockhash(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblock(const json_spirit::Array& params, bool fHelp);
@@ -184,6 +192,17 @@ static asio::io_service* rpc_io_service = NULL;
 static map<string, boost::shared_ptr<deadline_timer> > deadlineTimers;
 static boost::thread_group* rpc_worker_group = NULL;
 static boost::asio::io_service::work* rpc_dummy_work = NULL;
+//! Runs RPC calls on the -rpcthreads workers, so that socket I/O never waits on them
+static asio::io_service* rpc_work_service = NULL;
+static boost::asio::io_service::work* rpc_work_keepalive = NULL;
+static std::atomic<int> nRPCWorkPending(0);
+static int nRPCWorkLimit = 0;
+//! Runs the thread-safe entries of JSON-RPC batches alongside the worker that received the batch
+class JSONRPCBatchCall;
+static CCheckQueue<JSONRPCBatchCall>* rpc_batch_queue = NULL;
+//! Held by the batch using rpc_batch_queue; others run on their calling thread alone
+boost::mutex cs_rpcBatchQueue;
+static boost::thread_group* rpc_batch_group = NULL;
 static std::vector<CSubNet> rpc_allow_subnets; //!< List of subnets to allow RPC connections from
 static std::vector<boost::shared_ptr<ip::tcp::acceptor> > rpc_acceptors;
 
@@ -407,17 +426,18 @@ static const CRPCCommand vRPCCommands[] =
         {"network", "ping", &ping, true, false, false},
 
         /* Block chain and UTXO */
-        {"blockchain", "getblockchaininfo", &getblockchaininfo, true, false, false},
-        {"blockchain", "getbestblockhash", &getbestblockhash, true, false, false},
-        {"blockchain", "getblockcount", &getblockcount, true, false, false},
+        {"blockchain", "getblockchaininfo", &getblockchaininfo, true, true, false},
+        {"blockchain", "getbestblockhash", &getbestblockhash, true, true, false},
+        {"blockchain", "getblockcount", &getblockcount, true, true, false},
         {"blockchain", "getlotteryblockwinners", &getlotteryblockwinners, true, false, false},
-        {"blockchain", "getblock", &getblock, true, false, false},
+        {"blockchain", "getblock", &getblock, true, true, false},
         {"blockchain", "getblockhash", &getblockhash, true, false, false},
         {"blockchain", "getblockheader", &getblockheader, false, false, false},
         {"blockchain", "getchaintips", &getchaintips, true, false, false},
         {"blockchain", "getdifficulty", &getdifficulty, true, false, false},
         {"blockchain", "getmempoolinfo", &getmempoolinfo, true, true, false},
         {"blockchain", "getrawmempool", &getrawmempool, true, false, false},
+        {"blockchain", "getsigcacheinfo", &getsigcacheinfo, true, true, false},
         {"blockchain", "gettxout", &gettxout, true, false, false},
         {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true, false, false},
         {"blockchain", "verifychain", &verifychain, true, false, false},
@@ -441,7 +461,7 @@ static const CRPCCommand vRPCCommands[] =
         {"rawtransactions", "createrawtransaction", &createrawtransaction, true, false, false},
         {"rawtransactions", "decoderawtransaction", &decoderawtransaction, true, false, false},
         {"rawtransactions", "decodescript", &decodescript, true, false, false},
-        {"rawtransactions", "getrawtransaction", &getrawtransaction, true, false, false},
+        {"rawtransactions", "getrawtransaction", &getrawtransaction, true, true, false},
         {"rawtransactions", "sendrawtransaction", &sendrawtransaction, false, false, false},
         {"rawtransactions", "signrawtransaction", &signrawtransaction, false, false, false}, /* uses wallet if enabled */
 
@@ -518,12 +538,12 @@ static const CRPCCommand vRPCCommands[] =
         {"wallet", "getaccountaddress", &getaccountaddress, true, false, true},
         {"wallet", "getaccount", &getaccount, true, false, true},
         {"wallet", "getaddressesbyaccount", &getaddressesbyaccount, true, false, true},
-        {"wallet", "getbalance", &getbalance, false, false, true},
+        {"wallet", "getbalance", &getbalance, false, true, true},
         {"wallet", "getnewaddress", &getnewaddress, true, false, true},
         {"wallet", "getrawchangeaddress", &getrawchangeaddress, true, false, true},
         {"wallet", "getreceivedbyaccount", &getreceivedbyaccount, false, false, true},
         {"wallet", "getreceivedbyaddress", &getreceivedbyaddress, false, false, true},
-        {"wallet", "getstakingstatus", &getstakingstatus, false, false, true},
+        {"wallet", "getstakingstatus", &getstakingstatus, false, true, true},
         {"wallet", "gettransaction", &gettransaction, false, false, true},
         {"wallet", "getunconfirmedbalance", &getunconfirmedbalance, false, false, true},
         {"wallet", "getwalletinfo", &getwalletinfo, false, false, true},
@@ -629,54 +649,224 @@ bool ClientAllowed(const boost::asio::ip::address& address)
     return false;
 }
 
-template <typename Protocol>
-class AcceptedConnectionImpl : public AcceptedConnection
+static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
+    string& strRequest,
+    map<string, string>& mapHeaders,
+    bool fRun);
+
+static void RunRPCWork(const boost::function<void(void)>& work)
+{
+    work();
+    --nRPCWorkPending;
+}
+
+/**
+ * Hand an RPC call to the worker threads. Once -rpcworkqueue calls are waiting
+ * for a free worker, further ones are refused so that a burst of clients
+ * cannot queue up unbounded work.
+ */
+static bool QueueRPCWork(const boost::function<void(void)>& work)
+{
+    if (++nRPCWorkPending > nRPCWorkLimit) {
+        --nRPCWorkPending;
+        return false;
+    }
+    rpc_work_service->post(boost::bind(&RunRPCWork, work));
+    return true;
+}
+
+/** Collects the reply that an RPC or REST handler writes, to be sent without blocking */
+class BufferedReplyConnection : public AcceptedConnection
 {
+private:
+    std::string peerAddress;
+    std::stringstream reply;
+
 public:
-    AcceptedConnectionImpl()
+    explicit BufferedReplyConnection(const std::string& peerAddressIn) : peerAddress(peerAddressIn)
     {
     }
 
     virtual std::iostream& stream() override
     {
-        return socketStream;
+        return reply;
     }
 
     virtual std::string peer_address_to_string() const override
     {
-        return peer.address().to_string();
+        return peerAddress;
     }
 
     virtual void close() override
     {
-        socketStream.close();
     }
 
-    typename Protocol::endpoint peer;
-    typename Protocol::iostream socketStream;
+    std::string GetReply() const
+    {
+        return reply.str();
+    }
 };
 
-void ServiceConnection(AcceptedConnection* conn);
+/**
+ * A client connection driven by asio completion handlers, so that idle
+ * keep-alive connections hold no thread. Bytes are read as they arrive; each
+ * complete request is queued for the RPC workers and its reply written back
+ * before the next pipelined request in the buffer is looked at. Reading stops
+ * while a request is being served, leaving further requests to back up in
+ * the client's socket.
+ */
+class HTTPRPCConnection : public boost::enable_shared_from_this<HTTPRPCConnection>
+{
+private:
+    static const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+    asio::io_service& ioService;
+    std::vector<char> readChunk;
+    std::string received;
+
+    void ReadMore()
+    {
+        socket.async_read_some(asio::buffer(readChunk),
+            boost::bind(&HTTPRPCConnection::HandleRead, shared_from_this(), asio::placeholders::error, asio::placeholders::bytes_transferred));
+    }
+
+    void HandleRead(const boost::system::error_code& error, size_t bytesRead)
+    {
+        if (error) {
+            Close();
+            return;
+        }
+        received.append(readChunk.data(), bytesRead);
+        ServiceNextRequest();
+    }
+
+    /** Queue the next complete request in the buffer, or read until there is one */
+    void ServiceNextRequest()
+    {
+        if (ShutdownRequested()) {
+            Close();
+            return;
+        }
+
+        size_t requestSize = 0;
+        switch (FrameHTTPRequest(received, MAX_SIZE, requestSize)) {
+        case HTTP_REQUEST_INCOMPLETE:
+            ReadMore();
+            return;
+        case HTTP_REQUEST_TOO_LARGE:
+            SendReply(HTTPError(HTTP_BAD_REQUEST, false), false);
+            return;
+        case HTTP_REQUEST_COMPLETE:
+            break;
+        }
+
+        const std::string request = received.substr(0, requestSize);
+        received.erase(0, requestSize);
+        if (!QueueRPCWork(boost::bind(&HTTPRPCConnection::Execute, shared_from_this(), request))) {
+            LogPrint("rpc", "RPC work queue depth exceeded, refusing request from %s\n", peer.address().to_string());
+            SendReply(HTTPReply(HTTP_SERVICE_UNAVAILABLE, "Work queue depth exceeded\r\n", false, false, "text/plain"), false);
+        }
+    }
+
+    /** Runs on an RPC worker thread */
+    void Execute(const std::string& request)
+    {
+        std::istringstream requestStream(request);
+        int nProto = 0;
+        map<string, string> mapHeaders;
+        string strRequest, strMethod, strURI;
+
+        // Read HTTP request line
+        if (!ReadHTTPRequestLine(requestStream, nProto, strMethod, strURI)) {
+            ioService.post(boost::bind(&HTTPRPCConnection::SendReply, shared_from_this(), std::string(), false));
+            return;
+        }
+
+        // Read HTTP message headers and body
+        ReadHTTPMessage(requestStream, mapHeaders, strRequest, nProto, MAX_SIZE);
+
+        // HTTP Keep-Alive is false; close connection after replying
+        bool fRun = (mapHeaders["connection"] != "close") && settings.GetBoolArg("-rpckeepalive", true);
+
+        BufferedReplyConnection conn(peer.address().to_string());
+        bool fKeepOpen = fRun;
+        // Process via JSON-RPC API
+        if (strURI == "/") {
+            fKeepOpen = HTTPReq_JSONRPC(&conn, strRequest, mapHeaders, fRun) && fRun;
+
+            // Process via HTTP REST API
+        } else if (strURI.substr(0, 6) == "/rest/" && settings.GetBoolArg("-rest", false)) {
+            fKeepOpen = HTTPReq_REST(&conn, strURI, mapHeaders, fRun) && fRun;
+
+        } else {
+            conn.stream() << HTTPError(HTTP_NOT_FOUND, false) << std::flush;
+            fKeepOpen = false;
+        }
+        ioService.post(boost::bind(&HTTPRPCConnection::SendReply, shared_from_this(), conn.GetReply(), fKeepOpen));
+    }
+
+    void SendReply(const std::string& reply, bool fKeepOpen)
+    {
+        boost::shared_ptr<std::string> buffer(new std::string(reply));
+        asio::async_write(socket, asio::buffer(*buffer),
+            boost::bind(&HTTPRPCConnection::HandleWrite, shared_from_this(), buffer, fKeepOpen, asio::placeholders::error));
+    }
+
+    void HandleWrite(boost::shared_ptr<std::string> buffer, bool fKeepOpen, const boost::system::error_code& error)
+    {
+        if (error || !fKeepOpen) {
+            Close();
+            return;
+        }
+        ServiceNextRequest();
+    }
+
+    void Close()
+    {
+        boost::system::error_code ec;
+        socket.shutdown(ip::tcp::socket::shutdown_both, ec);
+        socket.close(ec);
+    }
+
+public:
+    ip::tcp::socket socket;
+    ip::tcp::endpoint peer;
+
+    explicit HTTPRPCConnection(asio::io_service& ioServiceIn)
+        : ioService(ioServiceIn), readChunk(READ_CHUNK_SIZE), socket(ioServiceIn)
+    {
+    }
+
+    void Start()
+    {
+        // Restrict callers by IP.  It is important to
+        // do this before reading anything, to filter out
+        // certain DoS and misbehaving clients.
+        if (!ClientAllowed(peer.address())) {
+            SendReply(HTTPError(HTTP_FORBIDDEN, false), false);
+            return;
+        }
+        ServiceNextRequest();
+    }
+};
 
 //! Forward declaration required for RPCListen
-template <typename Protocol>
-static void RPCAcceptHandler(boost::shared_ptr<basic_socket_acceptor<Protocol> > acceptor,
-    boost::shared_ptr<AcceptedConnection> conn,
+static void RPCAcceptHandler(boost::shared_ptr<ip::tcp::acceptor> acceptor,
+    boost::shared_ptr<HTTPRPCConnection> conn,
     const boost::system::error_code& error);
 
 /**
  * Sets up I/O resources to accept and handle a new connection.
  */
-template <typename Protocol>
-static void RPCListen(boost::shared_ptr<basic_socket_acceptor<Protocol> > acceptor)
+static void RPCListen(boost::shared_ptr<ip::tcp::acceptor> acceptor)
 {
     // Accept connection
-    boost::shared_ptr<AcceptedConnectionImpl<Protocol> > conn(new AcceptedConnectionImpl<Protocol>());
+    boost::shared_ptr<HTTPRPCConnection> conn(new HTTPRPCConnection(*rpc_io_service));
 
     acceptor->async_accept(
-        *conn->socketStream.rdbuf(),
+        conn->socket,
         conn->peer,
-        boost::bind(&RPCAcceptHandler<Protocol>,
+        boost::bind(&RPCAcceptHandler,
             acceptor,
             conn,
             _1));
@@ -686,30 +876,19 @@ static void RPCListen(boost::shared_ptr<basic_socket_acceptor<Protocol> > accept
 /**
  * Accept and handle incoming connection.
  */
-template <typename Protocol>
-static void RPCAcceptHandler(boost::shared_ptr<basic_socket_acceptor<Protocol> > acceptor,
-    boost::shared_ptr<AcceptedConnection> conn,
+static void RPCAcceptHandler(boost::shared_ptr<ip::tcp::acceptor> acceptor,
+    boost::shared_ptr<HTTPRPCConnection> conn,
     const boost::system::error_code& error)
 {
     // Immediately start accepting new connections, except when we're cancelled or our socket is closed.
     if (error != asio::error::operation_aborted && acceptor->is_open())
         RPCListen(acceptor);
 
-    AcceptedConnectionImpl<Protocol>* tcp_conn = dynamic_cast<AcceptedConnectionImpl<Protocol>*>(conn.get());
-
     if (error) {
         // TODO: Actually handle errors
         LogPrintf("%s: Error: %s\n", __func__, error.message());
-    }
-    // Restrict callers by IP.  It is important to
-    // do this before starting client thread, to filter out
-    // certain DoS and misbehaving clients.
-    else if (tcp_conn && !ClientAllowed(tcp_conn->peer.address())) {
-        conn->stream() << HTTPError(HTTP_FORBIDDEN, false) << std::flush;
-        conn->close();
     } else {
-        ServiceConnection(conn.get());
-        conn->close();
+        conn->Start();
     }
 }
 
@@ -812,10 +991,10 @@ void StartRPCThreads()
             straddress = bindAddress.to_string();
             LogPrintf("Binding RPC on address %s port %i (IPv4+IPv6 bind any: %i)\n", straddress, endpoint.port(), bBindAny);
             boost::system::error_code v6_only_error;
-            boost::shared_ptr<basic_socket_acceptor<ip::tcp> > acceptor(new basic_socket_acceptor<ip::tcp>(*rpc_io_service));
+            boost::shared_ptr<ip::tcp::acceptor> acceptor(new ip::tcp::acceptor(*rpc_io_service));
 
             acceptor->open(endpoint.protocol());
-            acceptor->set_option(basic_socket_acceptor<ip::tcp>::reuse_address(true));
+            acceptor->set_option(ip::tcp::acceptor::reuse_address(true));
 
             // Try making the socket dual IPv6/IPv4 when listening on the IPv6 "any" address
             acceptor->set_option(boost::asio::ip::v6_only(
@@ -845,12 +1024,40 @@ void StartRPCThreads()
         return;
     }
 
+    // One thread drives all sockets; calls run on the -rpcthreads workers
+    const int nWorkers = std::max((int)settings.GetArg("-rpcthreads", DEFAULT_RPC_THREADS), 1);
+    nRPCWorkLimit = nWorkers + std::max((int)settings.GetArg("-rpcworkqueue", DEFAULT_RPC_WORK_QUEUE), 0);
+    rpc_work_service = new asio::io_service();
+    rpc_work_keepalive = new asio::io_service::work(*rpc_work_service);
     rpc_worker_group = new boost::thread_group();
-    for (int i = 0; i < settings.GetArg("-rpcthreads", 4); i++)
-        rpc_worker_group->create_thread(boost::bind(&asio::io_service::run, rpc_io_service));
+    rpc_worker_group->create_thread(boost::bind(&asio::io_service::run, rpc_io_service));
+    for (int i = 0; i < nWorkers; i++)
+        rpc_worker_group->create_thread(boost::bind(&asio::io_service::run, rpc_work_service));
+    // The worker receiving a batch runs its share too, so one fewer helper is needed
+    StartRPCBatchThreads(nWorkers - 1);
     fRPCRunning = true;
 }
 
+void StartRPCBatchThreads(int nHelpers)
+{
+    rpc_batch_queue = new CCheckQueue<JSONRPCBatchCall>(1);
+    rpc_batch_group = new boost::thread_group();
+    for (int i = 0; i < nHelpers; i++)
+        rpc_batch_group->create_thread(boost::bind(&CCheckQueue<JSONRPCBatchCall>::Thread, rpc_batch_queue));
+}
+
+void StopRPCBatchThreads()
+{
+    if (rpc_batch_group != NULL) {
+        rpc_batch_group->interrupt_all();
+        rpc_batch_group->join_all();
+    }
+    delete rpc_batch_group;
+    rpc_batch_group = NULL;
+    delete rpc_batch_queue;
+    rpc_batch_queue = NULL;
+}
+
 void StartDummyRPCThread()
 {
     if (rpc_io_service == NULL) {
@@ -888,13 +1095,21 @@ void StopRPCThreads()
     deadlineTimers.clear();
 
     rpc_io_service->stop();
+    if (rpc_work_service != NULL)
+        rpc_work_service->stop();
     cvBlockChange.notify_all();
     if (rpc_worker_group != NULL)
         rpc_worker_group->join_all();
+    // Only now that no batch can be waiting on them
+    StopRPCBatchThreads();
     delete rpc_dummy_work;
     rpc_dummy_work = NULL;
     delete rpc_worker_group;
     rpc_worker_group = NULL;
+    delete rpc_work_keepalive;
+    rpc_work_keepalive = NULL;
+    delete rpc_work_service;
+    rpc_work_service = NULL;
     delete rpc_io_service;
     rpc_io_service = NULL;
 }
@@ -1005,13 +1220,92 @@ static Object JSONRPCExecOne(const Value& req)
     return rpc_result;
 }
 
-static string JSONRPCExecBatch(const Array& vReq)
+/** One thread-safe entry of a JSON-RPC batch, run on the batch queue */
+class JSONRPCBatchCall
+{
+private:
+    const Value* request;
+    Object* reply;
+
+public:
+    JSONRPCBatchCall() : request(NULL), reply(NULL) {}
+    JSONRPCBatchCall(const Value& requestIn, Object& replyIn) : request(&requestIn), reply(&replyIn) {}
+
+    bool operator()()
+    {
+        *reply = JSONRPCExecOne(*request);
+        return true;
+    }
+
+    void swap(JSONRPCBatchCall& call)
+    {
+        std::swap(request, call.request);
+        std::swap(reply, call.reply);
+    }
+};
+
+static bool IsThreadSafeCall(const Value& req)
+{
+    if (req.type() != obj_type)
+        return false;
+    const Value& valMethod = find_value(req.get_obj(), "method");
+    if (valMethod.type() != str_type)
+        return false;
+    const CRPCCommand* pcmd = tableRPC[valMethod.get_str()];
+    return pcmd && pcmd->threadSafe;
+}
+
+static Object JSONRPCBatchOverflowReply(const Value& req)
+{
+    const Value id = req.type() == obj_type ? find_value(req.get_obj(), "id") : Value::null;
+    return JSONRPCReplyObj(Value::null, JSONRPCError(RPC_OUT_OF_MEMORY, "Batch reply size limit exceeded"), id);
+}
+
+/**
+ * Runs of consecutive thread-safe entries are executed concurrently on the
+ * batch queue, at most MAX_BATCH_CALLS_IN_FLIGHT at a time. Each reply is
+ * serialized as soon as everything before it is done, so only that many
+ * replies are ever held as json objects. Entries that take the global locks
+ * run on this thread in between, after all earlier entries have finished.
+ * Once the reply passes nMaxReplySize the remaining entries are not
+ * executed but answered with an error.
+ */
+string JSONRPCExecBatch(const Array& vReq, size_t nMaxReplySize)
 {
-    Array ret;
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    boost::unique_lock<boost::mutex> lockBatchQueue(cs_rpcBatchQueue, boost::try_to_lock);
+    // Another batch is using the queue; run this one on the calling thread only
+    CCheckQueue<JSONRPCBatchCall>* queue = lockBatchQueue.owns_lock() ? rpc_batch_queue : NULL;
+
+    string strReply = "[";
+    std::vector<Object> replies(MAX_BATCH_CALLS_IN_FLIGHT);
+    size_t reqIdx = 0;
+    while (reqIdx < vReq.size()) {
+        size_t reqEnd = reqIdx;
+        if (strReply.size() > nMaxReplySize) {
+            replies[0] = JSONRPCBatchOverflowReply(vReq[reqEnd++]);
+        } else if (queue != NULL && IsThreadSafeCall(vReq[reqIdx])) {
+            std::vector<JSONRPCBatchCall> vCalls;
+            while (reqEnd < vReq.size() && reqEnd - reqIdx < MAX_BATCH_CALLS_IN_FLIGHT && IsThreadSafeCall(vReq[reqEnd])) {
+                vCalls.push_back(JSONRPCBatchCall(vReq[reqEnd], replies[reqEnd - reqIdx]));
+                reqEnd++;
+            }
+            CCheckQueueControl<JSONRPCBatchCall> control(queue);
+            control.Add(vCalls);
+            control.Wait();
+        } else {
+            replies[0] = JSONRPCExecOne(vReq[reqEnd++]);
+        }
 
-    return write_string(Value(ret), false) + "\n";
+        for (size_t index = reqIdx; index < reqEnd; index++) {
+            Object& reply = replies[index - reqIdx];
+            if (index > 0)
+                strReply += ",";
+            strReply += write_string(Value(reply), false);
+            reply = Object();
+        }
+        reqIdx = reqEnd;
+    }
+    return strReply + "]\n";
 }
 
 static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
@@ -1078,42 +1372,6 @@ static bool HTTPReq_JSONRPC(AcceptedConnection* conn,
     return true;
 }
 
-void ServiceConnection(AcceptedConnection* conn)
-{
-    bool fRun = true;
-    while (fRun && !ShutdownRequested()) {
-        int nProto = 0;
-        map<string, string> mapHeaders;
-        string strRequest, strMethod, strURI;
-
-        // Read HTTP request line
-        if (!ReadHTTPRequestLine(conn->stream(), nProto, strMethod, strURI))
-            break;
-
-        // Read HTTP message headers and body
-        ReadHTTPMessage(conn->stream(), mapHeaders, strRequest, nProto, MAX_SIZE);
-
-        // HTTP Keep-Alive is false; close connection immediately
-        if ((mapHeaders["connection"] == "close") || (!settings.GetBoolArg("-rpckeepalive", true)))
-            fRun = false;
-
-        // Process via JSON-RPC API
-        if (strURI == "/") {
-            if (!HTTPReq_JSONRPC(conn, strRequest, mapHeaders, fRun))
-                break;
-
-            // Process via HTTP REST API
-        } else if (strURI.substr(0, 6) == "/rest/" && settings.GetBoolArg("-rest", false)) {
-            if (!HTTPReq_REST(conn, strURI, mapHeaders, fRun))
-                break;
-
-        } else {
-            conn->stream() << HTTPError(HTTP_NOT_FOUND, false) << std::flush;
-            break;
-        }
-    }
-}
-
 json_spirit::Value CRPCTable::execute(const std::string& strMethod, const json_spirit::Array& params) const
 {
     // Find method
@@ -1141,29 +1399,17 @@ json_spirit::Value CRPCTable::execute(const std::string& strMethod, const json_s
             else if (!pwalletMain) {
                 LOCK(cs_main);
                 result = pcmd->actor(params, false);
+                UpdateRpcStateSnapshot();
             } else {
-                while (true) {
-                    TRY_LOCK(cs_main, lockMain);
-                    if (!lockMain) {
-                        MilliSleep(50);
-                        continue;
-                    }
-                    while (true) {
-                        TRY_LOCK(pwalletMain->cs_wallet, lockWallet);
-                        if (!lockMain) {
-                            MilliSleep(50);
-                            continue;
-                        }
-                        result = pcmd->actor(params, false);
-                        break;
-                    }
-                    break;
-                }
+                LOCK2(cs_main, pwalletMain->cs_wallet);
+                result = pcmd->actor(params, false);
+                UpdateRpcStateSnapshot();
             }
 #else  // ENABLE_WALLET
             else {
                 LOCK(cs_main);
                 result = pcmd->actor(params, false);
+                UpdateRpcStateSnapshot();
             }
 #endif // !ENABLE_WALLET
         }
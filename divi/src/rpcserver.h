@@ -43,6 +43,10 @@ void StartRPCThreads();
 void StartDummyRPCThread();
 /** Stop RPC threads */
 void StopRPCThreads();
+/** Start the threads running thread-safe JSON-RPC batch entries, besides the thread receiving the batch */
+void StartRPCBatchThreads(int nHelpers);
+/** Stop the batch threads; no batch may be executing */
+void StopRPCBatchThreads();
 /** Query whether RPC is running */
 bool IsRPCRunning();
 
@@ -128,6 +132,14 @@ public:
 
 extern const CRPCTable tableRPC;
 
+//! Batch entries executing concurrently, and so replies held unserialized, at any time
+static const size_t MAX_BATCH_CALLS_IN_FLIGHT = 16;
+//! Serialized batch reply size after which no further entries are executed
+static const size_t MAX_BATCH_REPLY_SIZE = 64 * 1024 * 1024;
+
+/** Execute a JSON-RPC batch and return the serialized array of its replies, in request order */
+std::string JSONRPCExecBatch(const json_spirit::Array& vReq, size_t nMaxReplySize = MAX_BATCH_REPLY_SIZE);
+
 /**
  * Utilities: convert hex-encoded Values
  * (throws error if not hex).
@@ -33,6 +33,7 @@
 #include <BlockDiskAccessor.h>
 #include <obfuscation.h>
 #include <Settings.h>
+#include <RpcStateSnapshot.h>
 
 using namespace std;
 using namespace boost;
@@ -43,6 +44,7 @@ int64_t nWalletUnlockTime;
 static CCriticalSection cs_nWalletUnlockTime;
 extern BlockMap mapBlockIndex;
 extern CChain chainActive;
+extern CCriticalSection cs_main;
 extern CWallet* pwalletMain;
 extern Settings& settings;
 
@@ -978,8 +980,9 @@ Value getbalance(const Array& params, bool fHelp)
                 "\nAs a json rpc call\n" + HelpExampleRpc("getbalance", "\"tabby\", 6"));
 
     if (params.size() == 0)
-        return ValueFromAmount(pwalletMain->GetBalance());
+        return ValueFromAmount(GetRpcStateSnapshot()->balance);
 
+    LOCK2(cs_main, pwalletMain->cs_wallet);
     int nMinDepth = 1;
     if (params.size() > 1)
         nMinDepth = params[1].get_int();
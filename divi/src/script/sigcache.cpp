@@ -5,87 +5,199 @@
 
 #include "sigcache.h"
 
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
+#include "defaultValues.h"
+#include "Logging.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
-#include "util.h"
 
+#include <atomic>
 #include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
 #include "Settings.h"
 extern Settings& settings;
 namespace {
 
+/**
+ * We're hashing a nonce into the entries themselves, so we don't need extra
+ * blinding in the set hash computation.
+ *
+ * This may exhibit platform endian dependent behavior but because these are
+ * nonced hashes (random) and this state is only ever used locally it is safe.
+ * All that matters is local consistency.
+ */
+class SignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select < 8, "SignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * Entries are salted hashes of (signature hash, public key, signature) kept in
+ * a fixed-size cuckoo table, so the cache never allocates after setup. Lookups
+ * only take the lock in shared mode; entries used while connecting a block are
+ * marked erasable and are reclaimed by later inserts.
  */
 class CSignatureCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
+    //! Salt for the entries, so that the table layout cannot be predicted by peers
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
     boost::shared_mutex cs_sigcache;
+    size_t nBytes;
+    uint32_t nMaxEntries;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nInserts;
 
 public:
-    bool
-    Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    CSignatureCache(): nBytes(0), nMaxEntries(0), nHits(0), nMisses(0), nInserts(0)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        GetRandBytes(nonce.begin(), 32);
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
-        return false;
+    void
+    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    /** Entries for compact signatures of messages, which name the key by its id */
+    void
+    ComputeEntry(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyId)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = settings.GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
+        static const unsigned char compactTag = 'c';
+        CSHA256().Write(nonce.begin(), 32).Write(&compactTag, 1).Write(hash.begin(), 32).Write(keyId.begin(), keyId.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
 
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+    bool IsSetUp() const
+    {
+        return nMaxEntries > 0;
+    }
 
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
+    bool
+    Get(const uint256& entry, const bool erase)
+    {
+        bool found;
         {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            found = setValid.contains(entry, erase);
         }
+        ++(found ? nHits : nMisses);
+        return found;
+    }
+
+    void Set(const uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+        ++nInserts;
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+    uint32_t setup_bytes(size_t n)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        nMaxEntries = setValid.setup_bytes(n);
+        nBytes = static_cast<size_t>(nMaxEntries) * sizeof(uint256);
+        return nMaxEntries;
+    }
+
+    SignatureCacheStats GetStats() const
+    {
+        SignatureCacheStats stats;
+        stats.bytes = nBytes;
+        stats.maxEntries = nMaxEntries;
+        stats.hits = nHits;
+        stats.misses = nMisses;
+        stats.inserts = nInserts;
+        return stats;
     }
 };
 
+/* The cache is a file static rather than a local static of VerifySignature,
+ * which would cost a guard check on every call. */
+CSignatureCache signatureCache;
+
+/** Signers of relayed messages get a small table of their own: any peer can
+ *  make the pre-validation threads fill it, which must not evict the
+ *  transaction signatures above. */
+constexpr size_t COMPACT_SIGNATURE_CACHE_BYTES = 1 << 20;
+CSignatureCache compactSignatureCache;
+
+}
+
+void InitSignatureCache()
+{
+    const int64_t nRequestedMiB = settings.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE);
+    const int64_t nMaxCacheSizeMiB = std::min(std::max(int64_t(0), nRequestedMiB), MAX_MAX_SIG_CACHE_SIZE);
+    if (nMaxCacheSizeMiB != nRequestedMiB)
+        LogPrintf("WARNING: -maxsigcachesize=%d is out of range (0 to %d MiB; it is no longer an entry count), using %d MiB\n",
+            nRequestedMiB, MAX_MAX_SIG_CACHE_SIZE, nMaxCacheSizeMiB);
+    const size_t nMaxCacheSize = static_cast<size_t>(nMaxCacheSizeMiB) << 20;
+    const uint32_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for signature cache, able to store %u elements\n",
+        (nElems * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElems);
+    if (nElems > 0)
+        compactSignatureCache.setup_bytes(COMPACT_SIGNATURE_CACHE_BYTES);
+}
+
+SignatureCacheStats GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
+}
+
+SignatureCacheStats GetCompactSignatureCacheStats()
+{
+    return compactSignatureCache.GetStats();
+}
+
+bool IsCachedCompactSignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyId)
+{
+    // messages are verified before the cache is sized, e.g. sporks read from disk
+    if (!compactSignatureCache.IsSetUp())
+        return false;
+    uint256 entry;
+    compactSignatureCache.ComputeEntry(entry, hash, vchSig, keyId);
+    return compactSignatureCache.Get(entry, false);
+}
+
+void CacheCompactSignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyId)
+{
+    if (!compactSignatureCache.IsSetUp())
+        return;
+    uint256 entry;
+    compactSignatureCache.ComputeEntry(entry, hash, vchSig, keyId);
+    compactSignatureCache.Set(entry);
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
 
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+    // Signatures checked while connecting a block (store == false) will not be
+    // needed again, so they are marked erasable as they are found.
+    if (signatureCache.Get(entry, !store))
         return true;
 
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
     if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+        signatureCache.Set(entry);
     return true;
 }
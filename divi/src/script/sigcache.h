@@ -8,9 +8,22 @@
 
 #include "script/SignatureCheckers.h"
 
+#include <stdint.h>
 #include <vector>
 
+class CKeyID;
 class CPubKey;
+class uint256;
+
+/** Usage counters of the signature cache since startup */
+struct SignatureCacheStats
+{
+    uint64_t bytes;
+    uint32_t maxEntries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+};
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
@@ -23,4 +36,15 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/** Whether the compact signature of hash was recorded as made by the given key.
+ *  These live in a small cache apart from the transaction signatures.  */
+bool IsCachedCompactSignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyId);
+/** Records that the compact signature of hash recovers to the given key */
+void CacheCompactSignature(const uint256& hash, const std::vector<unsigned char>& vchSig, const CKeyID& keyId);
+
+/** Size the signature cache from -maxsigcachesize (in MiB). Must be called before any script is checked. */
+void InitSignatureCache();
+SignatureCacheStats GetSignatureCacheStats();
+SignatureCacheStats GetCompactSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
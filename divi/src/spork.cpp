@@ -544,7 +544,7 @@ bool CSporkMessage::Sign(const CKey& key, const CPubKey &sporkPubKey)
 
     std::string strError = "";
 
-    std::string strMessage = boost::lexical_cast<std::string>(nSporkID) + strValue + boost::lexical_cast<std::string>(nTimeSigned);
+    std::string strMessage = getMessageToSign();
 
     if(!CObfuScationSigner::SignMessage(strMessage, strError, vchSig, key)) {
         LogPrintf("CSporkMessage::Sign -- SignMessage() failed\n");
@@ -563,10 +563,7 @@ bool CSporkMessage::CheckSignature(const CPubKey& pubKey) const
 {
     std::string strError = "";
 
-
-    std::string strMessage = boost::lexical_cast<std::string>(nSporkID) + boost::lexical_cast<std::string>(strValue) + boost::lexical_cast<std::string>(nTimeSigned);
-
-    if (!CObfuScationSigner::VerifyMessage(pubKey.GetID(), vchSig, strMessage, strError)){
+    if (!CObfuScationSigner::VerifyMessage(pubKey.GetID(), vchSig, getMessageToSign(), strError)){
         LogPrintf("CSporkMessage::CheckSignature -- VerifyHash() failed, error: %s\n", strError);
         return false;
     }
@@ -574,6 +571,16 @@ bool CSporkMessage::CheckSignature(const CPubKey& pubKey) const
     return true;
 }
 
+bool CSporkMessage::PreVerifySignature() const
+{
+    return CObfuScationSigner::PreVerifyMessage(vchSig, getMessageToSign());
+}
+
+std::string CSporkMessage::getMessageToSign() const
+{
+    return boost::lexical_cast<std::string>(nSporkID) + strValue + boost::lexical_cast<std::string>(nTimeSigned);
+}
+
 void CSporkMessage::Relay()
 {
     CInv inv(MSG_SPORK, GetHash());
@@ -53,6 +53,8 @@ class CSporkMessage
 private:
     std::vector<unsigned char> vchSig;
 
+    std::string getMessageToSign() const;
+
 public:
     int nSporkID;
     std::string strValue;
@@ -89,6 +91,8 @@ public:
 
     bool Sign(const CKey& key, const CPubKey &sporkPubKey);
     bool CheckSignature(const CPubKey &pubKey) const;
+    /** Caches the signer ahead of CheckSignature, for the message pre-validation threads */
+    bool PreVerifySignature() const;
     void Relay();
 };
 
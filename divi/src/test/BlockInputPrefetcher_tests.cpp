@@ -0,0 +1,127 @@
+#include <BlockInputPrefetcher.h>
+
+#include <primitives/block.h>
+#include <script/script.h>
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+extern int nInputPrefetchThreads;
+
+namespace
+{
+class CountingCoinsView : public CCoinsView
+{
+private:
+    std::map<uint256, CCoins> coins_;
+
+public:
+    mutable unsigned reads;
+
+    CountingCoinsView(): coins_(), reads(0u)
+    {
+    }
+
+    void Add(const CTransaction& tx)
+    {
+        coins_[tx.GetHash()] = CCoins(tx, 1);
+    }
+
+    bool GetCoins(const uint256& txid, CCoins& coins) const override
+    {
+        ++reads;
+        std::map<uint256, CCoins>::const_iterator it = coins_.find(txid);
+        if (it == coins_.end())
+            return false;
+        coins = it->second;
+        return true;
+    }
+};
+
+CTransaction Spending(const uint256& prevHash, int salt)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(prevHash, 0);
+    tx.vout.emplace_back(COIN, CScript() << OP_TRUE << salt);
+    return tx;
+}
+
+CTransaction Coinbase()
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.SetNull();
+    tx.vout.emplace_back(0, CScript());
+    return tx;
+}
+
+class PrefetchThreadsSetting
+{
+private:
+    const int previous_;
+
+public:
+    explicit PrefetchThreadsSetting(int threads): previous_(nInputPrefetchThreads)
+    {
+        nInputPrefetchThreads = threads;
+    }
+    ~PrefetchThreadsSetting()
+    {
+        nInputPrefetchThreads = previous_;
+    }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(BlockInputPrefetcher_tests)
+
+BOOST_AUTO_TEST_CASE(willWarmTheCacheWithInputsOnlyTheBaseViewHas)
+{
+    PrefetchThreadsSetting threads(4);
+    CountingCoinsView base;
+    CCoinsViewCache cache(&base);
+
+    const CTransaction first = Spending(uint256S("01"), 1);
+    const CTransaction second = Spending(uint256S("02"), 2);
+    const CTransaction cached = Spending(uint256S("03"), 3);
+    base.Add(first);
+    base.Add(second);
+    base.Add(cached);
+    BOOST_CHECK(cache.AccessCoins(cached.GetHash()) != nullptr);
+
+    CBlock block;
+    block.vtx.push_back(Coinbase());
+    block.vtx.push_back(Spending(first.GetHash(), 4));
+    block.vtx.push_back(Spending(second.GetHash(), 5));
+    block.vtx.push_back(Spending(cached.GetHash(), 6));
+    block.vtx.push_back(Spending(block.vtx[1].GetHash(), 7));
+    block.vtx.push_back(Spending(uint256S("04"), 8));
+
+    base.reads = 0u;
+    BOOST_CHECK_EQUAL(BlockInputPrefetcher(cache).Prefetch(block), 2u);
+    // The cached input and the one created within the block are not read, the unknown one is
+    BOOST_CHECK_EQUAL(base.reads, 3u);
+    BOOST_CHECK(cache.HaveCoinsInCache(first.GetHash()));
+    BOOST_CHECK(cache.HaveCoinsInCache(second.GetHash()));
+    BOOST_CHECK(!cache.HaveCoinsInCache(uint256S("04")));
+
+    base.reads = 0u;
+    BOOST_CHECK(*cache.AccessCoins(first.GetHash()) == CCoins(first, 1));
+    BOOST_CHECK_EQUAL(base.reads, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotReadAheadWhenDisabled)
+{
+    PrefetchThreadsSetting threads(0);
+    CountingCoinsView base;
+    CCoinsViewCache cache(&base);
+
+    CBlock block;
+    block.vtx.push_back(Spending(uint256S("01"), 1));
+    block.vtx.push_back(Spending(uint256S("02"), 2));
+    BOOST_CHECK_EQUAL(BlockInputPrefetcher(cache).Prefetch(block), 0u);
+    BOOST_CHECK_EQUAL(base.reads, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
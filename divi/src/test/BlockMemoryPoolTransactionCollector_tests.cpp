@@ -0,0 +1,179 @@
+#include <test_only.h>
+
+#include <BlockMemoryPoolTransactionCollector.h>
+#include <BlockTemplate.h>
+#include <FeeRate.h>
+#include <Settings.h>
+#include <blockmap.h>
+#include <chain.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <sync.h>
+#include <txmempool.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+extern Settings& settings;
+
+namespace
+{
+
+/**
+ * Fixture with a tip, a few coins and a mempool of independent spends
+ * of them, from which a long-lived collector assembles its templates.
+ * The coins are changed behind the mempool's back in the tests, which
+ * only shows in a template that was assembled again.
+ */
+class BlockMemoryPoolTransactionCollectorTestFixture
+{
+private:
+    bool addressIndex_;
+    bool spentIndex_;
+    CCoinsView dummyCoins_;
+    std::vector<std::unique_ptr<CBlockIndex>> blockIndices_;
+
+protected:
+    BlockMap blockIndexMap;
+    CChain chain;
+    CCoinsViewCache coins;
+    CTxMemPool mempool;
+    CCriticalSection mainCS;
+    CFeeRate relayFee;
+    std::vector<uint256> fundingHashes;
+    std::vector<uint256> transactionHashes;
+    std::unique_ptr<BlockMemoryPoolTransactionCollector> collector;
+
+    BlockMemoryPoolTransactionCollectorTestFixture(
+        ): addressIndex_(false)
+        , spentIndex_(false)
+        , dummyCoins_()
+        , blockIndices_()
+        , blockIndexMap()
+        , chain()
+        , coins(&dummyCoins_)
+        , mempool(CFeeRate(0), addressIndex_, spentIndex_)
+        , mainCS()
+        , relayFee(10000)
+    {
+        MoveTipTo(GetRandHash());
+        for (unsigned i = 0; i < 4; ++i) {
+            CMutableTransaction funding;
+            funding.vin.resize(1);
+            funding.vin[0].prevout = COutPoint(GetRandHash(), i);
+            funding.vout.emplace_back(COIN, CScript() << OP_TRUE);
+            coins.ModifyCoins(funding.GetHash())->FromTx(funding, 1);
+            fundingHashes.push_back(funding.GetHash());
+
+            CMutableTransaction spend;
+            spend.vin.resize(1);
+            spend.vin[0].prevout = COutPoint(funding.GetHash(), 0);
+            const CAmount fee = 10000 + i;
+            spend.vout.emplace_back(COIN - fee, CScript() << OP_TRUE);
+            const CTransaction tx(spend);
+            mempool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, fee, 0, 0.0, 1), coins);
+            transactionHashes.push_back(tx.GetHash());
+        }
+
+        collector.reset(new BlockMemoryPoolTransactionCollector(
+            settings, &coins, chain, blockIndexMap, mempool, mainCS, relayFee));
+    }
+
+    void MoveTipTo(const uint256& tipHash)
+    {
+        blockIndices_.emplace_back(new CBlockIndex());
+        CBlockIndex* tip = blockIndices_.back().get();
+        tip->nHeight = 100;
+        tip->phashBlock = &blockIndexMap.insert(std::make_pair(tipHash, tip)).first->first;
+        chain.SetTip(tip);
+        coins.SetBestBlock(tipHash);
+    }
+
+    /** Spends a coin without the mempool noticing */
+    void SpendFundingCoin(unsigned index)
+    {
+        coins.ModifyCoins(fundingHashes[index])->Spend(0);
+    }
+
+    /** Makes a coin unspendable, which only a fresh script check notices */
+    void LockFundingCoin(unsigned index)
+    {
+        coins.ModifyCoins(fundingHashes[index])->vout[0].scriptPubKey = CScript() << OP_FALSE;
+    }
+
+    std::vector<uint256> AssembleTemplate() const
+    {
+        CBlockTemplate blockTemplate;
+        BOOST_CHECK(collector->CollectTransactionsIntoBlock(blockTemplate));
+        std::vector<uint256> txids;
+        for (const CTransaction& tx : blockTemplate.block.vtx)
+            txids.push_back(tx.GetHash());
+        return txids;
+    }
+
+    bool Includes(const std::vector<uint256>& txids, unsigned index) const
+    {
+        return std::find(txids.begin(), txids.end(), transactionHashes[index]) != txids.end();
+    }
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(BlockMemoryPoolTransactionCollector_tests, BlockMemoryPoolTransactionCollectorTestFixture)
+
+BOOST_AUTO_TEST_CASE(willReuseTheTemplateWhileNeitherTipNorMempoolChanged)
+{
+    const std::vector<uint256> first = AssembleTemplate();
+    BOOST_CHECK_EQUAL(first.size(), transactionHashes.size());
+
+    SpendFundingCoin(0);
+    BOOST_CHECK(AssembleTemplate() == first);
+}
+
+BOOST_AUTO_TEST_CASE(willRebuildTheTemplateWhenTheMempoolChanged)
+{
+    AssembleTemplate();
+
+    SpendFundingCoin(0);
+    mempool.AddTransactionsUpdated(1);
+    const std::vector<uint256> rebuilt = AssembleTemplate();
+    BOOST_CHECK_EQUAL(rebuilt.size(), transactionHashes.size() - 1);
+    BOOST_CHECK(!Includes(rebuilt, 0));
+}
+
+BOOST_AUTO_TEST_CASE(willRebuildTheTemplateWhenTheTipChanged)
+{
+    AssembleTemplate();
+
+    SpendFundingCoin(0);
+    MoveTipTo(GetRandHash());
+    const std::vector<uint256> rebuilt = AssembleTemplate();
+    BOOST_CHECK_EQUAL(rebuilt.size(), transactionHashes.size() - 1);
+    BOOST_CHECK(!Includes(rebuilt, 0));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepScriptChecksOnTheSameTipAcrossMempoolChanges)
+{
+    AssembleTemplate();
+
+    LockFundingCoin(0);
+    mempool.AddTransactionsUpdated(1);
+    const std::vector<uint256> rebuilt = AssembleTemplate();
+    BOOST_CHECK_EQUAL(rebuilt.size(), transactionHashes.size());
+    BOOST_CHECK(Includes(rebuilt, 0));
+}
+
+BOOST_AUTO_TEST_CASE(willDropScriptChecksWithTheTemplateOfAnOldTip)
+{
+    AssembleTemplate();
+
+    LockFundingCoin(0);
+    MoveTipTo(GetRandHash());
+    const std::vector<uint256> rebuilt = AssembleTemplate();
+    BOOST_CHECK_EQUAL(rebuilt.size(), transactionHashes.size() - 1);
+    BOOST_CHECK(!Includes(rebuilt, 0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,219 @@
+#include <flat-database.h>
+
+#include <DataDirectory.h>
+#include <MasternodeNetworkMessageManager.h>
+#include <MasternodePaymentData.h>
+#include <masternode.h>
+#include <random.h>
+
+#include <stdio.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class FlatDBLogTestFixture
+{
+public:
+    const std::string strFilename;
+    const boost::filesystem::path pathJournal;
+    const CScript payee;
+    const uint256 scoreHash;
+
+    FlatDBLogTestFixture(
+        ): strFilename("journaltest_" + GetRandHash().GetHex().substr(0, 16) + ".dat")
+        , pathJournal(GetDataDir() / (strFilename + ".log"))
+        , payee(CScript() << OP_TRUE << 1)
+        , scoreHash(uint256S("aa"))
+    {
+    }
+    ~FlatDBLogTestFixture()
+    {
+        boost::filesystem::remove(GetDataDir() / strFilename);
+        boost::filesystem::remove(pathJournal);
+        boost::filesystem::remove(pathJournal.string() + ".old");
+    }
+
+    CMasternodePaymentWinner Winner(unsigned voter) const
+    {
+        CMasternodePaymentWinner winner(CTxIn(COutPoint(uint256(voter), 0)), 200, scoreHash);
+        winner.AddPayee(payee);
+        return winner;
+    }
+
+    /** Loads the payment data from a fresh store, as a restarted node would */
+    size_t LoadVotes(MasternodePaymentData& paymentData) const
+    {
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        return paymentData.mapMasternodePayeeVotes.size();
+    }
+
+    void AppendToJournal(const std::string& data) const
+    {
+        FILE* file = fopen(pathJournal.string().c_str(), "ab");
+        BOOST_REQUIRE(file != nullptr);
+        fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(FlatDBLog_tests, FlatDBLogTestFixture)
+
+BOOST_AUTO_TEST_CASE(willRestoreJournaledVotesWithoutASnapshot)
+{
+    {
+        MasternodePaymentData paymentData;
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        paymentData.SetJournal(&store);
+        for (unsigned voter = 1; voter <= 3; ++voter)
+            BOOST_CHECK(paymentData.RecordWinnerVote(Winner(voter)));
+        BOOST_CHECK(!paymentData.RecordWinnerVote(Winner(1)));
+    }
+    BOOST_CHECK(!boost::filesystem::exists(GetDataDir() / strFilename));
+
+    MasternodePaymentData restored;
+    BOOST_CHECK_EQUAL(LoadVotes(restored), 3u);
+    BOOST_CHECK(restored.mapMasternodeBlocks.count(scoreHash) > 0);
+    const MasternodePaymentData::BlocksByHeight expected = {std::make_pair(200, scoreHash)};
+    BOOST_CHECK(restored.mapPaidPayeeBlocks[payee] == expected);
+}
+
+BOOST_AUTO_TEST_CASE(willCutOffATornRecordAndKeepAppendingAfterIt)
+{
+    {
+        MasternodePaymentData paymentData;
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        paymentData.SetJournal(&store);
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(1)));
+    }
+    const uintmax_t journalSize = boost::filesystem::file_size(pathJournal);
+    AppendToJournal(std::string("\x40\x00\x00\x00torn", 8));
+
+    {
+        MasternodePaymentData paymentData;
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        BOOST_CHECK_EQUAL(paymentData.mapMasternodePayeeVotes.size(), 1u);
+        BOOST_CHECK_EQUAL(boost::filesystem::file_size(pathJournal), journalSize);
+        paymentData.SetJournal(&store);
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(2)));
+    }
+
+    MasternodePaymentData restored;
+    BOOST_CHECK_EQUAL(LoadVotes(restored), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willStartAnEmptyJournalWhenCompacting)
+{
+    {
+        MasternodePaymentData paymentData;
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        paymentData.SetJournal(&store);
+        const uintmax_t emptyJournalSize = boost::filesystem::file_size(pathJournal);
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(1)));
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(2)));
+
+        BOOST_CHECK(store.Compact(paymentData));
+        BOOST_CHECK(boost::filesystem::exists(GetDataDir() / strFilename));
+        BOOST_CHECK(!boost::filesystem::exists(pathJournal.string() + ".old"));
+        BOOST_CHECK_EQUAL(boost::filesystem::file_size(pathJournal), emptyJournalSize);
+        BOOST_CHECK(!store.NeedsCompaction());
+
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(3)));
+    }
+
+    MasternodePaymentData restored;
+    BOOST_CHECK_EQUAL(LoadVotes(restored), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(willKeepEntriesAppendedWhileASnapshotIsWritten)
+{
+    {
+        MasternodePaymentData paymentData;
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        paymentData.SetJournal(&store);
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(1)));
+
+        CDataStream snapshot(SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(store.PrepareCompaction(paymentData, snapshot));
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(2)));
+        BOOST_CHECK(store.FinishCompaction(snapshot));
+        BOOST_CHECK(!boost::filesystem::exists(pathJournal.string() + ".old"));
+    }
+
+    MasternodePaymentData restored;
+    BOOST_CHECK_EQUAL(LoadVotes(restored), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willReplayTheJournalOfAnInterruptedCompaction)
+{
+    {
+        MasternodePaymentData paymentData;
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        paymentData.SetJournal(&store);
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(1)));
+    }
+    // as if the journal had been rotated but the snapshot never written
+    boost::filesystem::rename(pathJournal, pathJournal.string() + ".old");
+    {
+        MasternodePaymentData paymentData;
+        CFlatDBLog<MasternodePaymentData> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(paymentData));
+        paymentData.SetJournal(&store);
+        BOOST_CHECK(paymentData.RecordWinnerVote(Winner(2)));
+    }
+
+    MasternodePaymentData restored;
+    BOOST_CHECK_EQUAL(LoadVotes(restored), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willReplayMasternodeListChanges)
+{
+    CMasternode kept;
+    kept.vin = CTxIn(COutPoint(uint256S("01"), 0));
+    kept.lastPing.vin = kept.vin;
+    kept.lastPing.sigTime = 1000;
+    CMasternode removed;
+    removed.vin = CTxIn(COutPoint(uint256S("02"), 0));
+    removed.sigTime = kept.sigTime + 1;
+    const CMasternodeBroadcast keptBroadcast(kept);
+    const CMasternodeBroadcast removedBroadcast(removed);
+
+    CMasternodePing newerPing = kept.lastPing;
+    newerPing.sigTime = 2000;
+    {
+        MasternodeNetworkMessageManager networkMessageManager;
+        CFlatDBLog<MasternodeNetworkMessageManager> store(strFilename, "magicJournalTest");
+        BOOST_CHECK(store.Load(networkMessageManager));
+        networkMessageManager.SetJournal(&store);
+
+        networkMessageManager.masternodes.push_back(kept);
+        networkMessageManager.recordBroadcast(keptBroadcast);
+        networkMessageManager.masternodes.push_back(removed);
+        networkMessageManager.recordBroadcast(removedBroadcast);
+        networkMessageManager.recordPing(newerPing);
+        networkMessageManager.masternodes.pop_back();
+        networkMessageManager.recordMasternodeRemoval(removed.vin.prevout);
+    }
+
+    MasternodeNetworkMessageManager restored;
+    CFlatDBLog<MasternodeNetworkMessageManager> store(strFilename, "magicJournalTest");
+    BOOST_CHECK(store.Load(restored));
+    BOOST_CHECK_EQUAL(restored.masternodeCount(), 1u);
+    const CMasternode* restoredMasternode = restored.find(kept.vin);
+    BOOST_REQUIRE(restoredMasternode != nullptr);
+    BOOST_CHECK_EQUAL(restoredMasternode->lastPing.sigTime, 2000);
+    BOOST_CHECK(restored.pingIsKnown(newerPing.GetHash()));
+    BOOST_CHECK(restored.broadcastIsKnown(keptBroadcast.GetHash()));
+    BOOST_CHECK(!restored.broadcastIsKnown(removedBroadcast.GetHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+#include <MasternodePaymentData.h>
+
+#include <clientversion.h>
+#include <streams.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+class MasternodePaymentDataTestFixture
+{
+public:
+    MasternodePaymentData paymentData;
+    const CScript payee;
+    const CScript otherPayee;
+
+    MasternodePaymentDataTestFixture(
+        ): paymentData()
+        , payee(CScript() << OP_TRUE << 1)
+        , otherPayee(CScript() << OP_TRUE << 2)
+    {
+    }
+
+    void Vote(const uint256& scoreHash, int height, const CScript& payeeVotedFor)
+    {
+        auto mit = paymentData.mapMasternodeBlocks.find(scoreHash);
+        if (mit == paymentData.mapMasternodeBlocks.end())
+            mit = paymentData.mapMasternodeBlocks.emplace(scoreHash, CMasternodeBlockPayees(height)).first;
+        mit->second.CountVote(COutPoint(GetVoter(), 0), payeeVotedFor);
+        paymentData.RecordPayeeVote(payeeVotedFor, scoreHash);
+    }
+
+    MasternodePaymentData::BlocksByHeight PaidBlocks(const CScript& paidPayee) const
+    {
+        const auto mit = paymentData.mapPaidPayeeBlocks.find(paidPayee);
+        return mit == paymentData.mapPaidPayeeBlocks.end() ? MasternodePaymentData::BlocksByHeight() : mit->second;
+    }
+
+private:
+    uint256 GetVoter()
+    {
+        static unsigned voters = 0;
+        return uint256(++voters);
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(MasternodePaymentData_tests, MasternodePaymentDataTestFixture)
+
+BOOST_AUTO_TEST_CASE(willIndexBlocksOnlyOncePayeeHasTwoVotes)
+{
+    const uint256 scoreHash = uint256S("aa");
+    Vote(scoreHash, 200, payee);
+    BOOST_CHECK(PaidBlocks(payee).empty());
+
+    Vote(scoreHash, 200, otherPayee);
+    Vote(scoreHash, 200, payee);
+    const MasternodePaymentData::BlocksByHeight expected = {std::make_pair(200, scoreHash)};
+    BOOST_CHECK(PaidBlocks(payee) == expected);
+    BOOST_CHECK(PaidBlocks(otherPayee).empty());
+}
+
+BOOST_AUTO_TEST_CASE(willDropPrunedBlocksFromTheIndex)
+{
+    const uint256 oldScoreHash = uint256S("aa");
+    const uint256 newScoreHash = uint256S("bb");
+    for (int i = 0; i < 2; ++i) {
+        Vote(oldScoreHash, 200, payee);
+        Vote(newScoreHash, 300, payee);
+        Vote(newScoreHash, 300, otherPayee);
+    }
+
+    paymentData.EraseBlockPayees(oldScoreHash);
+    BOOST_CHECK_EQUAL(paymentData.mapMasternodeBlocks.count(oldScoreHash), 0u);
+    const MasternodePaymentData::BlocksByHeight expected = {std::make_pair(300, newScoreHash)};
+    BOOST_CHECK(PaidBlocks(payee) == expected);
+
+    paymentData.EraseBlockPayees(newScoreHash);
+    BOOST_CHECK(paymentData.mapPaidPayeeBlocks.empty());
+}
+
+BOOST_AUTO_TEST_CASE(willRebuildTheIndexWhenLoaded)
+{
+    const uint256 scoreHash = uint256S("aa");
+    Vote(scoreHash, 200, payee);
+    Vote(scoreHash, 200, payee);
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << paymentData;
+    MasternodePaymentData loaded;
+    stream >> loaded;
+
+    BOOST_CHECK(loaded.mapPaidPayeeBlocks == paymentData.mapPaidPayeeBlocks);
+    BOOST_CHECK_EQUAL(loaded.mapPaidPayeeBlocks.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
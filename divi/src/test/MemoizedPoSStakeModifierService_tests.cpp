@@ -0,0 +1,206 @@
+#include <test_only.h>
+#include <MemoizedPoSStakeModifierService.h>
+#include <LegacyPoSStakeModifierService.h>
+#include <PoSStakeModifierService.h>
+#include <MockPoSStakeModifierService.h>
+#include <FakeBlockIndexChain.h>
+#include <StakeModifierIntervalHelpers.h>
+#include <StakingData.h>
+#include <ForkActivation.h>
+#include <blockmap.h>
+#include <chain.h>
+#include <hash.h>
+#include <kernel.h>
+#include <random.h>
+#include <streams.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+using ::testing::_;
+using ::testing::Exactly;
+using ::testing::Return;
+
+namespace
+{
+/** The stake modifier selection as it was implemented before candidate hashes were precomputed */
+bool ReferenceComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier)
+{
+    nStakeModifier = 0;
+    fGeneratedStakeModifier = false;
+    if (!pindexPrev) {
+        fGeneratedStakeModifier = true;
+        return true;
+    }
+    if (pindexPrev->nHeight == 0) {
+        fGeneratedStakeModifier = true;
+        nStakeModifier = uint64_t("stakemodifier");
+        return true;
+    }
+
+    const CBlockIndex* lastModifierIndex = pindexPrev;
+    while (lastModifierIndex && lastModifierIndex->pprev && !lastModifierIndex->GeneratedStakeModifier())
+        lastModifierIndex = lastModifierIndex->pprev;
+    if (!lastModifierIndex || !lastModifierIndex->GeneratedStakeModifier())
+        return false;
+
+    nStakeModifier = lastModifierIndex->nStakeModifier;
+    if (lastModifierIndex->GetBlockTime() / MODIFIER_INTERVAL >= pindexPrev->GetBlockTime() / MODIFIER_INTERVAL)
+        return true;
+
+    std::vector<std::pair<int64_t, const CBlockIndex*> > sortedByTimestamp;
+    const int64_t nSelectionIntervalStart =
+        (pindexPrev->GetBlockTime() / MODIFIER_INTERVAL) * MODIFIER_INTERVAL - GetStakeModifierSelectionInterval();
+    for (const CBlockIndex* pindex = pindexPrev; pindex && pindex->GetBlockTime() >= nSelectionIntervalStart; pindex = pindex->pprev)
+        sortedByTimestamp.push_back(std::make_pair(pindex->GetBlockTime(), pindex));
+    std::sort(sortedByTimestamp.begin(), sortedByTimestamp.end(),
+        [](const std::pair<int64_t, const CBlockIndex*>& a, const std::pair<int64_t, const CBlockIndex*>& b) {
+            return a.first < b.first || (a.first == b.first && a.second->GetBlockHash() < b.second->GetBlockHash());
+        });
+
+    uint64_t nStakeModifierNew = 0;
+    int64_t nSelectionIntervalStop = nSelectionIntervalStart;
+    std::map<uint256, const CBlockIndex*> selectedBlocks;
+    for (int nRound = 0; nRound < std::min(64, (int)sortedByTimestamp.size()); nRound++) {
+        nSelectionIntervalStop += GetStakeModifierSelectionIntervalSection(nRound);
+        bool fSelected = false;
+        uint256 hashBest = 0;
+        const CBlockIndex* selected = nullptr;
+        for (const auto& item : sortedByTimestamp) {
+            const CBlockIndex* pindex = item.second;
+            if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
+                break;
+            if (selectedBlocks.count(pindex->GetBlockHash()) > 0)
+                continue;
+            uint256 hashProof = pindex->IsProofOfStake() ? 0 : pindex->GetBlockHash();
+            CDataStream ss(SER_GETHASH, 0);
+            ss << hashProof << nStakeModifier;
+            uint256 hashSelection = Hash(ss.begin(), ss.end());
+            if (pindex->IsProofOfStake())
+                hashSelection >>= 32;
+            if (!fSelected || hashSelection < hashBest) {
+                fSelected = true;
+                hashBest = hashSelection;
+                selected = pindex;
+            }
+        }
+        if (!fSelected)
+            return false;
+        nStakeModifierNew |= (((uint64_t)selected->GetStakeEntropyBit()) << nRound);
+        selectedBlocks.insert(std::make_pair(selected->GetBlockHash(), selected));
+    }
+
+    if (ActivationState(pindexPrev).IsActive(Fork::HardenedStakeModifier)) {
+        CHashWriter hasher(SER_GETHASH, 0);
+        hasher << pindexPrev->GetBlockHash() << nStakeModifierNew;
+        nStakeModifier = hasher.GetHash().GetLow64();
+    } else {
+        nStakeModifier = nStakeModifierNew;
+    }
+    fGeneratedStakeModifier = true;
+    return true;
+}
+
+class SyntheticChain
+{
+public:
+    FakeBlockIndexWithHashes fakeChain;
+
+    SyntheticChain(unsigned numberOfBlocks, unsigned startTime): fakeChain(numberOfBlocks, startTime, 4)
+    {
+        CChain& chain = *fakeChain.activeChain;
+        for (int height = 1; height <= chain.Height(); ++height) {
+            // Irregular block spacing, including blocks sharing a timestamp
+            chain[height]->nTime = chain[height - 1]->nTime + GetRandInt(90);
+            if (GetRandInt(3) > 0) chain[height]->SetProofOfStake();
+        }
+        chain[0]->SetStakeModifier(0, true);
+    }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(MemoizedPoSStakeModifierService_tests)
+
+BOOST_AUTO_TEST_CASE(willComputeTheSameStakeModifiersAsTheReferenceSelectionOverASyntheticChain)
+{
+    for (unsigned startTime : {1500000000u, 1700000000u}) {
+        SyntheticChain synthetic(400, startTime);
+        CChain& chain = *synthetic.fakeChain.activeChain;
+        unsigned numberOfGeneratedModifiers = 0;
+        for (int height = 1; height <= chain.Height(); ++height) {
+            uint64_t expectedModifier = 0;
+            bool expectedGenerated = false;
+            BOOST_CHECK(ReferenceComputeNextStakeModifier(chain[height - 1], expectedModifier, expectedGenerated));
+
+            SetStakeModifiersForNewBlockIndex(chain[height]);
+            BOOST_CHECK_EQUAL(chain[height]->nStakeModifier, expectedModifier);
+            BOOST_CHECK_EQUAL(chain[height]->GeneratedStakeModifier(), expectedGenerated);
+            if (expectedGenerated) ++numberOfGeneratedModifiers;
+        }
+        BOOST_CHECK(numberOfGeneratedModifiers > 100u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willReturnTheSameStakeModifiersAsTheDecoratedServiceOverASyntheticChain)
+{
+    for (unsigned startTime : {1500000000u, 1700000000u}) {
+        SyntheticChain synthetic(300, startTime);
+        CChain& chain = *synthetic.fakeChain.activeChain;
+        for (int height = 1; height <= chain.Height(); ++height)
+            SetStakeModifiersForNewBlockIndex(chain[height]);
+
+        LegacyPoSStakeModifierService legacyService(*synthetic.fakeChain.blockIndexByHash, chain);
+        PoSStakeModifierService stakeModifierService(legacyService, *synthetic.fakeChain.blockIndexByHash);
+        MemoizedPoSStakeModifierService memoizedService(stakeModifierService, chain, 100u);
+        for (unsigned pass = 0; pass < 2; ++pass) {
+            for (int height = 0; height <= chain.Height(); ++height) {
+                StakingData stakingData;
+                stakingData.blockHashOfFirstConfirmationBlock_ = chain[height]->GetBlockHash();
+                stakingData.blockHashOfChainTipBlock_ = chain[std::max(height, chain.Height() - height)]->GetBlockHash();
+                const std::pair<uint64_t, bool> expected = stakeModifierService.getStakeModifier(stakingData);
+                const std::pair<uint64_t, bool> memoized = memoizedService.getStakeModifier(stakingData);
+                BOOST_CHECK_EQUAL(memoized.first, expected.first);
+                BOOST_CHECK_EQUAL(memoized.second, expected.second);
+            }
+        }
+        BOOST_CHECK(memoizedService.size() <= 100u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyQueryTheDecoratedServiceOnceWhileTheChainTipIsUnchanged)
+{
+    FakeBlockIndexWithHashes fakeChain(10, 1500000000, 4);
+    MockPoSStakeModifierService decoratedService;
+    MemoizedPoSStakeModifierService memoizedService(decoratedService, *fakeChain.activeChain);
+
+    StakingData stakingData;
+    stakingData.blockHashOfFirstConfirmationBlock_ = fakeChain.activeChain->Tip()->pprev->GetBlockHash();
+    stakingData.blockHashOfChainTipBlock_ = fakeChain.activeChain->Tip()->GetBlockHash();
+
+    EXPECT_CALL(decoratedService, getStakeModifier(_)).Times(Exactly(1)).WillOnce(Return(std::make_pair(uint64_t(42), true)));
+    BOOST_CHECK_EQUAL(memoizedService.getStakeModifier(stakingData).first, 42u);
+    BOOST_CHECK_EQUAL(memoizedService.getStakeModifier(stakingData).first, 42u);
+    ::testing::Mock::VerifyAndClearExpectations(&decoratedService);
+
+    fakeChain.addBlocks(1, 4);
+    EXPECT_CALL(decoratedService, getStakeModifier(_)).Times(Exactly(1)).WillOnce(Return(std::make_pair(uint64_t(43), true)));
+    BOOST_CHECK_EQUAL(memoizedService.getStakeModifier(stakingData).first, 43u);
+    BOOST_CHECK_EQUAL(memoizedService.getStakeModifier(stakingData).first, 43u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotRememberFailedLookups)
+{
+    FakeBlockIndexWithHashes fakeChain(10, 1500000000, 4);
+    MockPoSStakeModifierService decoratedService;
+    MemoizedPoSStakeModifierService memoizedService(decoratedService, *fakeChain.activeChain);
+
+    StakingData stakingData;
+    EXPECT_CALL(decoratedService, getStakeModifier(_)).Times(Exactly(2)).WillRepeatedly(Return(std::make_pair(uint64_t(0), false)));
+    BOOST_CHECK(!memoizedService.getStakeModifier(stakingData).second);
+    BOOST_CHECK(!memoizedService.getStakeModifier(stakingData).second);
+    BOOST_CHECK_EQUAL(memoizedService.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
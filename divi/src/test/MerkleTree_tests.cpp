@@ -0,0 +1,125 @@
+#include <test_only.h>
+#include <MerkleTree.h>
+#include <hash.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <utilstrencodings.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+/** The merkle tree as CBlock::BuildMerkleTree built it before levels were hashed in batches */
+uint256 ReferenceMerkleTree(const std::vector<uint256>& leaves, std::vector<uint256>& tree, bool& mutated)
+{
+    tree = leaves;
+    mutated = false;
+    int j = 0;
+    for (int nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2)
+    {
+        for (int i = 0; i < nSize; i += 2)
+        {
+            int i2 = std::min(i + 1, nSize - 1);
+            if (i2 == i + 1 && i2 + 1 == nSize && tree[j + i] == tree[j + i2])
+                mutated = true;
+            tree.push_back(Hash(BEGIN(tree[j + i]), END(tree[j + i]), BEGIN(tree[j + i2]), END(tree[j + i2])));
+        }
+        j += nSize;
+    }
+    return tree.empty() ? uint256() : tree.back();
+}
+
+std::vector<uint256> RandomLeaves(size_t numberOfLeaves)
+{
+    std::vector<uint256> leaves(numberOfLeaves);
+    for (uint256& leaf : leaves)
+        leaf = GetRandHash();
+    return leaves;
+}
+
+void CheckAgainstReference(const std::vector<uint256>& leaves)
+{
+    std::vector<uint256> expectedTree;
+    bool expectedMutation = true;
+    const uint256 expectedRoot = ReferenceMerkleTree(leaves, expectedTree, expectedMutation);
+
+    std::vector<uint256> tree(leaves);
+    bool mutated = !expectedMutation;
+    BOOST_CHECK(ComputeMerkleTree(tree, &mutated) == expectedRoot);
+    BOOST_CHECK(tree == expectedTree);
+    BOOST_CHECK_EQUAL(mutated, expectedMutation);
+
+    mutated = !expectedMutation;
+    BOOST_CHECK(ComputeMerkleRoot(leaves, &mutated) == expectedRoot);
+    BOOST_CHECK_EQUAL(mutated, expectedMutation);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MerkleTree_tests)
+
+BOOST_AUTO_TEST_CASE(willBuildTheSameTreeAsPairwiseHashingForAnyNumberOfLeaves)
+{
+    for (size_t numberOfLeaves = 0; numberOfLeaves <= 70; ++numberOfLeaves)
+        CheckAgainstReference(RandomLeaves(numberOfLeaves));
+    for (size_t numberOfLeaves : {255u, 256u, 257u, 1000u, 1023u})
+        CheckAgainstReference(RandomLeaves(numberOfLeaves));
+}
+
+BOOST_AUTO_TEST_CASE(willReturnASingleLeafAsTheRootAndZeroForNoLeaves)
+{
+    std::vector<uint256> tree;
+    BOOST_CHECK(ComputeMerkleTree(tree) == uint256());
+    BOOST_CHECK(tree.empty());
+
+    const uint256 leaf = GetRandHash();
+    tree.assign(1, leaf);
+    BOOST_CHECK(ComputeMerkleTree(tree) == leaf);
+    BOOST_CHECK_EQUAL(tree.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willDetectDuplicatedHashesAtTheEndOfALevel)
+{
+    // [1,2,3,4,5,6] and [1,2,3,4,5,6,5,6] share a root (CVE-2012-2459)
+    std::vector<uint256> leaves = RandomLeaves(6);
+    bool mutated = true;
+    const uint256 root = ComputeMerkleRoot(leaves, &mutated);
+    BOOST_CHECK(!mutated);
+
+    leaves.push_back(leaves[4]);
+    leaves.push_back(leaves[5]);
+    BOOST_CHECK(ComputeMerkleRoot(leaves, &mutated) == root);
+    BOOST_CHECK(mutated);
+    CheckAgainstReference(leaves);
+
+    std::vector<uint256> duplicatedLastLeaf = RandomLeaves(9);
+    duplicatedLastLeaf.push_back(duplicatedLastLeaf.back());
+    mutated = false;
+    ComputeMerkleRoot(duplicatedLastLeaf, &mutated);
+    BOOST_CHECK(mutated);
+    CheckAgainstReference(duplicatedLastLeaf);
+}
+
+BOOST_AUTO_TEST_CASE(willComputeTheRootOfABlockWithoutBuildingItsTree)
+{
+    for (unsigned numberOfTransactions : {1u, 2u, 7u, 64u}) {
+        CBlock block;
+        for (unsigned i = 0; i < numberOfTransactions; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(GetRandHash(), i);
+            block.vtx.push_back(tx);
+        }
+        bool mutated = true;
+        BOOST_CHECK(BlockMerkleRoot(block, &mutated) == block.BuildMerkleTree());
+        BOOST_CHECK(!mutated);
+    }
+
+    CBlock duplicated;
+    duplicated.vtx.resize(2);
+    bool mutated = false;
+    BlockMerkleRoot(duplicated, &mutated);
+    BOOST_CHECK(mutated);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
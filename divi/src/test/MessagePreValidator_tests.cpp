@@ -0,0 +1,179 @@
+#include <MessagePreValidator.h>
+
+#include <MasternodePing.h>
+#include <coins.h>
+#include <key.h>
+#include <keystore.h>
+#include <obfuscation.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <scriptCheck.h>
+#include <spork.h>
+#include <streams.h>
+#include <sync.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+extern CCriticalSection cs_main;
+extern CCoinsViewCache* pcoinsTip;
+
+namespace
+{
+class MessagePreValidatorTestFixture
+{
+public:
+    CKey masternodeKey;
+    CPubKey masternodePubKey;
+    CBasicKeyStore keystore;
+    CScript coinScript;
+
+    MessagePreValidatorTestFixture()
+    {
+        masternodeKey.MakeNewKey(true);
+        masternodePubKey = masternodeKey.GetPubKey();
+        keystore.AddKey(masternodeKey);
+        coinScript = GetScriptForDestination(masternodePubKey.GetID());
+    }
+
+    /** A signed transaction spending a coin just added to the chain state */
+    CMutableTransaction SpendOfNewCoin() const
+    {
+        CMutableTransaction funding;
+        funding.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0)));
+        funding.vout.push_back(CTxOut(COIN, coinScript));
+        {
+            LOCK(cs_main);
+            pcoinsTip->ModifyCoins(funding.GetHash())->FromTx(funding, 1);
+        }
+
+        CMutableTransaction spend;
+        spend.vin.push_back(CTxIn(COutPoint(funding.GetHash(), 0)));
+        spend.vout.push_back(CTxOut(COIN / 2, coinScript));
+        spend.vout.push_back(CTxOut(COIN / 2, coinScript));
+        BOOST_REQUIRE(SignSignature(keystore, coinScript, spend, 0));
+        return spend;
+    }
+
+    /** A ping with a fresh hash, so that the signature cache has not seen it */
+    CMasternodePing SignedPing(const CKey& key) const
+    {
+        CMasternodePing ping;
+        ping.vin = CTxIn(COutPoint(GetRandHash(), 0));
+        ping.blockHash = GetRandHash();
+        ping.sigTime = 1000;
+        std::string errorMessage;
+        BOOST_REQUIRE(CObfuScationSigner::SignMessage(ping.getMessageToSign(), errorMessage, ping.signature, key));
+        return ping;
+    }
+
+    template <typename T>
+    static bool PreValidate(const std::string& strCommand, const T& message)
+    {
+        CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+        vRecv << message;
+        return MessagePreValidator::PreValidate(strCommand, vRecv);
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(MessagePreValidator_tests, MessagePreValidatorTestFixture)
+
+BOOST_AUTO_TEST_CASE(willPreValidateOnlyRelayedSignedMessages)
+{
+    BOOST_CHECK(MessagePreValidator::IsPreValidated("tx"));
+    BOOST_CHECK(MessagePreValidator::IsPreValidated("mnb"));
+    BOOST_CHECK(MessagePreValidator::IsPreValidated("mnp"));
+    BOOST_CHECK(MessagePreValidator::IsPreValidated("mnw"));
+    BOOST_CHECK(MessagePreValidator::IsPreValidated("spork"));
+    BOOST_CHECK(!MessagePreValidator::IsPreValidated("block"));
+    BOOST_CHECK(!MessagePreValidator::IsPreValidated("inv"));
+}
+
+BOOST_AUTO_TEST_CASE(willMakeTheLaterSignatureCheckACacheHit)
+{
+    const CMasternodePing ping = SignedPing(masternodeKey);
+    BOOST_CHECK(PreValidate("mnp", ping));
+
+    const uint64_t hitsBefore = GetCompactSignatureCacheStats().hits;
+    std::string errorMessage;
+    BOOST_CHECK(CObfuScationSigner::VerifySignature(ping, masternodePubKey, errorMessage));
+    BOOST_CHECK_EQUAL(GetCompactSignatureCacheStats().hits, hitsBefore + 1);
+}
+
+BOOST_AUTO_TEST_CASE(willKeepMessageSignersOutOfTheTransactionSignatureCache)
+{
+    const uint64_t insertsBefore = GetSignatureCacheStats().inserts;
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    BOOST_CHECK(PreValidate("mnp", SignedPing(otherKey)));
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().inserts, insertsBefore);
+}
+
+BOOST_AUTO_TEST_CASE(willMakeTheLaterScriptCheckOfATransactionACacheHit)
+{
+    const CTransaction spend(SpendOfNewCoin());
+    BOOST_CHECK(PreValidate("tx", spend));
+
+    const uint64_t hitsBefore = GetSignatureCacheStats().hits;
+    CScriptCheck check(*pcoinsTip->AccessCoins(spend.vin[0].prevout.hash), spend, 0, STANDARD_SCRIPT_VERIFY_FLAGS, false);
+    BOOST_CHECK(check());
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().hits, hitsBefore + 1);
+}
+
+BOOST_AUTO_TEST_CASE(willLeaveOrphansAndCoinstakesToTheHandlerThread)
+{
+    CMutableTransaction orphan = SpendOfNewCoin();
+    orphan.vin[0].prevout.hash = GetRandHash();
+    CMutableTransaction coinstake = SpendOfNewCoin();
+    coinstake.vout.insert(coinstake.vout.begin(), CTxOut(0, CScript()));
+    BOOST_REQUIRE(CTransaction(coinstake).IsCoinStake());
+    BOOST_REQUIRE(SignSignature(keystore, coinScript, coinstake, 0));
+
+    const uint64_t insertsBefore = GetSignatureCacheStats().inserts;
+    BOOST_CHECK(!PreValidate("tx", CTransaction(orphan)));
+    BOOST_CHECK(!PreValidate("tx", CTransaction(coinstake)));
+    BOOST_CHECK_EQUAL(GetSignatureCacheStats().inserts, insertsBefore);
+}
+
+BOOST_AUTO_TEST_CASE(willNotAcceptASignatureByAnotherKey)
+{
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    const CMasternodePing ping = SignedPing(otherKey);
+    BOOST_CHECK(PreValidate("mnp", ping));
+
+    std::string errorMessage;
+    BOOST_CHECK(!CObfuScationSigner::VerifySignature(ping, masternodePubKey, errorMessage));
+    BOOST_CHECK(CObfuScationSigner::VerifySignature(ping, otherKey.GetPubKey(), errorMessage));
+}
+
+BOOST_AUTO_TEST_CASE(willNotCacheATamperedMessage)
+{
+    CMasternodePing ping = SignedPing(masternodeKey);
+    BOOST_CHECK(PreValidate("mnp", ping));
+    ping.sigTime += 1;
+
+    std::string errorMessage;
+    BOOST_CHECK(!CObfuScationSigner::VerifySignature(ping, masternodePubKey, errorMessage));
+}
+
+BOOST_AUTO_TEST_CASE(willPreValidateSporks)
+{
+    CSporkMessage spork(10001, "1", 1000);
+    BOOST_CHECK(spork.Sign(masternodeKey, masternodePubKey));
+    BOOST_CHECK(PreValidate("spork", spork));
+    BOOST_CHECK(spork.CheckSignature(masternodePubKey));
+}
+
+BOOST_AUTO_TEST_CASE(willIgnoreMalformedAndUnknownMessages)
+{
+    BOOST_CHECK(!PreValidate("mnp", std::string("short")));
+    BOOST_CHECK(!PreValidate("mnw", std::string()));
+    BOOST_CHECK(!PreValidate("block", SignedPing(masternodeKey)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,8 @@
 #include <I_ProofOfStakeCalculator.h>
 #include <MockPoSStakeModifierService.h>
 #include <sstream>
+#include <limits>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -31,6 +33,7 @@ class MockProofOfStakeCalculator: public I_ProofOfStakeCalculator
 {
 public:
     MOCK_CONST_METHOD3( computeProofOfStakeAndCheckItMeetsTarget, bool(unsigned int, uint256&, bool) );
+    MOCK_CONST_METHOD3( computeProofsOfStake, void(unsigned int, unsigned int, uint256*) );
 };
 
 
@@ -90,6 +93,28 @@ BOOST_AUTO_TEST_CASE(willRecoverCorrectTimestampIfSuccessAndRecoverZeroOtherwise
     BOOST_CHECK(HashproofCreationResult::FailedGeneration().timestamp() == 0u);
 }
 
+BOOST_AUTO_TEST_CASE(batchedProofsOfStakeMatchIndividuallyComputedProofsOfStake)
+{
+    for(unsigned trial = 0; trial < 8; ++trial)
+    {
+        uint32_t blockTimeOfFirstUTXOConfirmation = GetRandInt(1<<20);
+        unsigned latestTimestamp = blockTimeOfFirstUTXOConfirmation + 60*60*60 + GetRandInt(1<<16);
+        COutPoint utxo(GetRandHash(),GetRandInt(10));
+        StakingData stakingData(0x1000001, blockTimeOfFirstUTXOConfirmation, GetRandHash(), utxo, GetRandInt(1<<20)*COIN, 0);
+        ProofOfStakeCalculator calculator(stakingData, GetRand(std::numeric_limits<uint64_t>::max()));
+
+        const unsigned numberOfTimestamps = 1 + GetRandInt(I_ProofOfStakeGenerator::nHashDrift);
+        std::vector<uint256> batchedProofs(numberOfTimestamps);
+        calculator.computeProofsOfStake(latestTimestamp, numberOfTimestamps, batchedProofs.data());
+        for(unsigned offset = 0; offset < numberOfTimestamps; ++offset)
+        {
+            uint256 individualProof;
+            calculator.computeProofOfStakeAndCheckItMeetsTarget(latestTimestamp - offset, individualProof, false);
+            BOOST_CHECK_MESSAGE(individualProof == batchedProofs[offset], "Mismatched proof at offset "+std::to_string(offset));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(willEnsureBackwardCompatibilityWithMainnetHashproofs)
 {
     struct PoSTestCase
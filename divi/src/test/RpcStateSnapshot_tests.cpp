@@ -0,0 +1,126 @@
+#include <test_only.h>
+#include <RpcStateSnapshot.h>
+#include <chain.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+#include <sync.h>
+#include <txmempool.h>
+#ifdef ENABLE_WALLET
+#include <test/FakeBlockIndexChain.h>
+#include <test/FakeWallet.h>
+#include <WalletTx.h>
+#endif
+
+#include <memory>
+
+extern CChain chainActive;
+extern CCriticalSection cs_main;
+extern CTxMemPool mempool;
+#ifdef ENABLE_WALLET
+extern CWallet* pwalletMain;
+#endif
+
+BOOST_AUTO_TEST_SUITE(RpcStateSnapshot_tests)
+
+BOOST_AUTO_TEST_CASE(willKeepHandedOutSnapshotsUnchangedWhenANewOneIsPublished)
+{
+    std::shared_ptr<const RpcStateSnapshot> original = GetRpcStateSnapshot();
+    const int originalHeight = original->height;
+
+    std::shared_ptr<RpcStateSnapshot> replacement = std::make_shared<RpcStateSnapshot>();
+    replacement->height = originalHeight + 10;
+    PublishRpcStateSnapshot(replacement);
+
+    BOOST_CHECK_EQUAL(original->height, originalHeight);
+    BOOST_CHECK_EQUAL(GetRpcStateSnapshot()->height, originalHeight + 10);
+
+    PublishRpcStateSnapshot(original);
+    BOOST_CHECK(GetRpcStateSnapshot() == original);
+}
+
+BOOST_AUTO_TEST_CASE(willCaptureTheActiveChainTipWhenUpdated)
+{
+    PublishRpcStateSnapshot(std::make_shared<RpcStateSnapshot>());
+    {
+        LOCK(cs_main);
+        UpdateRpcStateSnapshot();
+    }
+
+    std::shared_ptr<const RpcStateSnapshot> snapshot = GetRpcStateSnapshot();
+    LOCK(cs_main);
+    BOOST_CHECK(snapshot->tip == chainActive.Tip());
+    BOOST_CHECK_EQUAL(snapshot->height, chainActive.Height());
+    BOOST_CHECK(snapshot->bestBlockHash == chainActive.Tip()->GetBlockHash());
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyRecomputeTheTipSummaryWhenTheTipChanged)
+{
+    std::shared_ptr<RpcStateSnapshot> stale = std::make_shared<RpcStateSnapshot>();
+    {
+        LOCK(cs_main);
+        stale->tip = chainActive.Tip();
+    }
+    stale->difficulty = -1.0;
+    PublishRpcStateSnapshot(stale);
+    {
+        LOCK(cs_main);
+        UpdateRpcStateSnapshot();
+    }
+    BOOST_CHECK_EQUAL(GetRpcStateSnapshot()->difficulty, -1.0);
+    BOOST_CHECK(GetRpcStateSnapshot() != stale);
+
+    stale->tip = nullptr;
+    PublishRpcStateSnapshot(stale);
+    {
+        LOCK(cs_main);
+        UpdateRpcStateSnapshot();
+    }
+    BOOST_CHECK(GetRpcStateSnapshot()->difficulty != -1.0);
+}
+
+#ifdef ENABLE_WALLET
+BOOST_AUTO_TEST_CASE(willRefreshTheWalletBalanceWhenTheMempoolDropsAWalletTransaction)
+{
+    FakeBlockIndexWithHashes fakeChain(1, 1600000000, 1);
+    FakeWallet wallet(fakeChain);
+    CWallet* const mainWallet = pwalletMain;
+    pwalletMain = &wallet;
+
+    unsigned outputIndex;
+    const CWalletTx& funding = wallet.AddDefaultTx(GetScriptForDestination(wallet.getNewKey().GetID()), outputIndex, 100 * COIN);
+    wallet.FakeAddToChain(funding);
+    wallet.AddConfirmations(1);
+
+    // A spend that only the mempool knows about, entered long enough ago to expire
+    CMutableTransaction spend;
+    spend.vin.push_back(CTxIn(COutPoint(funding.GetHash(), outputIndex)));
+    spend.vout.push_back(CTxOut(100 * COIN, CScript() << OP_TRUE));
+    const CTransaction spendTx(spend);
+    CCoinsView noCoins;
+    CCoinsViewCache coins(&noCoins);
+    mempool.addUnchecked(spendTx.GetHash(), CTxMemPoolEntry(spendTx, 0, 0, 0.0, 1), coins);
+    wallet.AddToWallet(CWalletTx(CMerkleTx(spendTx, *fakeChain.activeChain, *fakeChain.blockIndexByHash)));
+    {
+        LOCK(cs_main);
+        UpdateRpcStateSnapshot();
+    }
+    BOOST_CHECK_EQUAL(GetRpcStateSnapshot()->balance, 0);
+
+    const uint64_t walletChangeCount = wallet.GetBalanceChangeCount();
+    BOOST_CHECK_EQUAL(mempool.Expire(1), 1);
+    BOOST_CHECK_EQUAL(wallet.GetBalanceChangeCount(), walletChangeCount);
+    {
+        LOCK(cs_main);
+        UpdateRpcStateSnapshot();
+    }
+    BOOST_CHECK_EQUAL(GetRpcStateSnapshot()->balance, 100 * COIN);
+
+    pwalletMain = mainWallet;
+    PublishRpcStateSnapshot(std::make_shared<RpcStateSnapshot>());
+    LOCK(cs_main);
+    UpdateRpcStateSnapshot();
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+#include <test_only.h>
+#include <StakableCoinIndex.h>
+#include <random.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+COutPoint RandomOutput()
+{
+    return COutPoint(GetRandHash(), GetRandInt(10));
+}
+bool ContainsOutput(const std::vector<COutPoint>& outputs, const COutPoint& output)
+{
+    return std::find(outputs.begin(), outputs.end(), output) != outputs.end();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(StakableCoinIndex_tests)
+
+BOOST_AUTO_TEST_CASE(willRequireARebuildUntilMarkedRebuilt)
+{
+    StakableCoinIndex index;
+    BOOST_CHECK(index.NeedsRebuild());
+    index.MarkRebuilt();
+    BOOST_CHECK(!index.NeedsRebuild());
+    index.MarkForRebuild();
+    BOOST_CHECK(index.NeedsRebuild());
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyReturnOutputsConfirmedAtOrBelowTheRequestedHeight)
+{
+    StakableCoinIndex index;
+    const COutPoint deepOutput = RandomOutput();
+    const COutPoint shallowOutput = RandomOutput();
+    const COutPoint unconfirmedOutput = RandomOutput();
+    index.Update(deepOutput, 10);
+    index.Update(shallowOutput, 20);
+    index.Update(unconfirmedOutput, StakableCoinIndex::UNCONFIRMED);
+
+    std::vector<COutPoint> outputs;
+    index.GetOutputsConfirmedAtOrBelow(15, outputs);
+    BOOST_CHECK_EQUAL(outputs.size(), 1u);
+    BOOST_CHECK(ContainsOutput(outputs, deepOutput));
+
+    outputs.clear();
+    index.GetOutputsConfirmedAtOrBelow(20, outputs);
+    BOOST_CHECK_EQUAL(outputs.size(), 2u);
+    BOOST_CHECK(!ContainsOutput(outputs, unconfirmedOutput));
+
+    outputs.clear();
+    index.GetUnconfirmedOutputs(outputs);
+    BOOST_CHECK_EQUAL(outputs.size(), 1u);
+    BOOST_CHECK(ContainsOutput(outputs, unconfirmedOutput));
+}
+
+BOOST_AUTO_TEST_CASE(willMoveOutputsBetweenBucketsWhenTheirConfirmationHeightChanges)
+{
+    StakableCoinIndex index;
+    const COutPoint output = RandomOutput();
+    index.Update(output, StakableCoinIndex::UNCONFIRMED);
+    index.Update(output, 5);
+    BOOST_CHECK_EQUAL(index.size(), 1u);
+
+    std::vector<COutPoint> outputs;
+    index.GetUnconfirmedOutputs(outputs);
+    BOOST_CHECK(outputs.empty());
+    index.GetOutputsConfirmedAtOrBelow(5, outputs);
+    BOOST_CHECK(ContainsOutput(outputs, output));
+}
+
+BOOST_AUTO_TEST_CASE(willForgetRemovedOutputs)
+{
+    StakableCoinIndex index;
+    const COutPoint output = RandomOutput();
+    index.Update(output, 5);
+    BOOST_CHECK(index.Contains(output));
+    index.Remove(output);
+    BOOST_CHECK(!index.Contains(output));
+    BOOST_CHECK_EQUAL(index.size(), 0u);
+
+    std::vector<COutPoint> outputs;
+    index.GetOutputsConfirmedAtOrBelow(100, outputs);
+    BOOST_CHECK(outputs.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
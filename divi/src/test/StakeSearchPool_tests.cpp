@@ -0,0 +1,68 @@
+#include <test_only.h>
+#include <StakeSearchPool.h>
+#include <defaultValues.h>
+
+#include <atomic>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(StakeSearchPool_tests)
+
+BOOST_AUTO_TEST_CASE(singleThreadedSearchChecksCandidatesInOrderUntilFirstHit)
+{
+    StakeSearchPool pool(1u);
+    std::vector<size_t> checkedCandidates;
+    const size_t hit = pool.search(10u, [&checkedCandidates](size_t candidateIndex) {
+        checkedCandidates.push_back(candidateIndex);
+        return candidateIndex == 6u;
+    });
+    BOOST_CHECK_EQUAL(hit, 6u);
+    BOOST_CHECK_EQUAL(checkedCandidates.size(), 7u);
+    for(size_t candidateIndex = 0; candidateIndex < checkedCandidates.size(); ++candidateIndex)
+    {
+        BOOST_CHECK_EQUAL(checkedCandidates[candidateIndex], candidateIndex);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(multiThreadedSearchChecksEveryCandidateExactlyOnceWithoutAHit)
+{
+    StakeSearchPool pool(4u);
+    const size_t numberOfCandidates = 1000u;
+    for(unsigned round = 0; round < 5u; ++round)
+    {
+        std::vector<std::atomic<unsigned>> timesChecked(numberOfCandidates);
+        for(std::atomic<unsigned>& counter: timesChecked) counter = 0u;
+        const size_t hit = pool.search(numberOfCandidates, [&timesChecked](size_t candidateIndex) {
+            ++timesChecked[candidateIndex];
+            return false;
+        });
+        BOOST_CHECK_EQUAL(hit, numberOfCandidates);
+        for(const std::atomic<unsigned>& counter: timesChecked)
+        {
+            BOOST_CHECK_EQUAL(counter.load(), 1u);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(multiThreadedSearchReportsAHitAndStopsEarly)
+{
+    StakeSearchPool pool(4u);
+    const size_t numberOfCandidates = 100000u;
+    std::atomic<size_t> numberOfChecks(0u);
+    const size_t hit = pool.search(numberOfCandidates, [&numberOfChecks](size_t candidateIndex) {
+        ++numberOfChecks;
+        return candidateIndex == 10u || candidateIndex == 11u;
+    });
+    BOOST_CHECK(hit == 10u || hit == 11u);
+    BOOST_CHECK(numberOfChecks.load() < numberOfCandidates);
+}
+
+BOOST_AUTO_TEST_CASE(stakingThreadCountIsClampedToSupportedRange)
+{
+    BOOST_CHECK_EQUAL(ResolveStakingThreadCount(1), 1u);
+    BOOST_CHECK_EQUAL(ResolveStakingThreadCount(3), 3u);
+    BOOST_CHECK_EQUAL(ResolveStakingThreadCount(MAX_STAKING_THREADS + 10), static_cast<unsigned>(MAX_STAKING_THREADS));
+    BOOST_CHECK(ResolveStakingThreadCount(0) >= 1u);
+    BOOST_CHECK_EQUAL(ResolveStakingThreadCount(-1000), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
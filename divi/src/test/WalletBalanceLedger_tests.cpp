@@ -0,0 +1,117 @@
+#include <test_only.h>
+#include <WalletBalanceLedger.h>
+#include <random.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+WalletBalances TrustedBalance(CAmount amount)
+{
+    WalletBalances balances;
+    balances.trusted = amount;
+    balances.spendable = amount;
+    return balances;
+}
+bool ContainsTransaction(const std::vector<uint256>& txids, const uint256& txid)
+{
+    return std::find(txids.begin(), txids.end(), txid) != txids.end();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(WalletBalanceLedger_tests)
+
+BOOST_AUTO_TEST_CASE(willRequireARebuildUntilMarkedRebuilt)
+{
+    WalletBalanceLedger ledger;
+    BOOST_CHECK(ledger.NeedsRebuild());
+    ledger.MarkRebuilt();
+    BOOST_CHECK(!ledger.NeedsRebuild());
+    ledger.MarkForRebuild();
+    BOOST_CHECK(ledger.NeedsRebuild());
+}
+
+BOOST_AUTO_TEST_CASE(willCountTheChangesThatMayMoveTheBalances)
+{
+    WalletBalanceLedger ledger;
+    const uint64_t initialCount = ledger.ChangeCount();
+    ledger.Record(GetRandHash(), TrustedBalance(10), false);
+    ledger.MarkRebuilt();
+    BOOST_CHECK_EQUAL(ledger.ChangeCount(), initialCount);
+    ledger.MarkDirty(GetRandHash());
+    BOOST_CHECK_EQUAL(ledger.ChangeCount(), initialCount + 1);
+    ledger.MarkForRebuild();
+    BOOST_CHECK_EQUAL(ledger.ChangeCount(), initialCount + 2);
+}
+
+BOOST_AUTO_TEST_CASE(willSumTheLatestContributionOfEachTransaction)
+{
+    WalletBalanceLedger ledger;
+    const uint256 firstTx = GetRandHash();
+    const uint256 secondTx = GetRandHash();
+    ledger.Record(firstTx, TrustedBalance(10), false);
+    ledger.Record(secondTx, TrustedBalance(5), false);
+    ledger.Record(firstTx, TrustedBalance(3), false);
+    BOOST_CHECK(ledger.Totals() == TrustedBalance(8));
+
+    ledger.Remove(secondTx);
+    BOOST_CHECK(ledger.Totals() == TrustedBalance(3));
+    BOOST_CHECK_EQUAL(ledger.size(), 1u);
+
+    ledger.Clear();
+    BOOST_CHECK(ledger.Totals() == WalletBalances());
+    BOOST_CHECK_EQUAL(ledger.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyRefreshDirtyVolatileAndDueTransactions)
+{
+    WalletBalanceLedger ledger;
+    const uint256 settledTx = GetRandHash();
+    const uint256 volatileTx = GetRandHash();
+    const uint256 maturingTx = GetRandHash();
+    const uint256 dirtyTx = GetRandHash();
+    ledger.Record(settledTx, TrustedBalance(1), false);
+    ledger.Record(volatileTx, TrustedBalance(1), true);
+    ledger.Record(maturingTx, TrustedBalance(1), false, 100);
+    ledger.Record(dirtyTx, TrustedBalance(1), false);
+    ledger.MarkDirty(dirtyTx);
+
+    std::vector<uint256> txids;
+    ledger.TakeTransactionsToRefresh(99, txids);
+    BOOST_CHECK_EQUAL(txids.size(), 2u);
+    BOOST_CHECK(ContainsTransaction(txids, volatileTx));
+    BOOST_CHECK(ContainsTransaction(txids, dirtyTx));
+
+    txids.clear();
+    ledger.TakeTransactionsToRefresh(100, txids);
+    BOOST_CHECK_EQUAL(txids.size(), 2u);
+    BOOST_CHECK(ContainsTransaction(txids, volatileTx));
+    BOOST_CHECK(ContainsTransaction(txids, maturingTx));
+    BOOST_CHECK(!ContainsTransaction(txids, settledTx));
+}
+
+BOOST_AUTO_TEST_CASE(willNoLongerRefreshATransactionRecordedAsSettled)
+{
+    WalletBalanceLedger ledger;
+    const uint256 txid = GetRandHash();
+    ledger.Record(txid, TrustedBalance(1), true, 50);
+    ledger.Record(txid, TrustedBalance(2), false);
+
+    std::vector<uint256> txids;
+    ledger.TakeTransactionsToRefresh(100, txids);
+    BOOST_CHECK(txids.empty());
+    BOOST_CHECK(ledger.Totals() == TrustedBalance(2));
+}
+
+BOOST_AUTO_TEST_CASE(willRememberTheTipItWasSyncedTo)
+{
+    WalletBalanceLedger ledger;
+    BOOST_CHECK_EQUAL(ledger.SyncedHeight(), -1);
+    const uint256 blockHash = GetRandHash();
+    ledger.SetSyncedTip(42, blockHash);
+    BOOST_CHECK_EQUAL(ledger.SyncedHeight(), 42);
+    BOOST_CHECK(ledger.SyncedBlockHash() == blockHash);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace
+{
+/** Counts its own runs and succeeds unless told to fail */
+class CountingCheck
+{
+private:
+    std::atomic<unsigned>* runs;
+    bool fFail;
+
+public:
+    CountingCheck() : runs(nullptr), fFail(false) {}
+    CountingCheck(std::atomic<unsigned>& runsIn, bool fFailIn) : runs(&runsIn), fFail(fFailIn) {}
+
+    bool operator()()
+    {
+        ++*runs;
+        return !fFail;
+    }
+
+    void swap(CountingCheck& check)
+    {
+        std::swap(runs, check.runs);
+        std::swap(fFail, check.fFail);
+    }
+};
+
+typedef CCheckQueue<CountingCheck> CountingCheckQueue;
+
+/** Starts worker threads for a queue and stops them again on destruction */
+class WorkerThreads
+{
+private:
+    boost::thread_group threads;
+
+public:
+    WorkerThreads(CountingCheckQueue& queue, unsigned numberOfThreads)
+    {
+        for (unsigned i = 0; i < numberOfThreads; ++i)
+            threads.create_thread(boost::bind(&CountingCheckQueue::Thread, &queue));
+    }
+    ~WorkerThreads()
+    {
+        threads.interrupt_all();
+        threads.join_all();
+    }
+};
+
+void AddChecks(CCheckQueueControl<CountingCheck>& control, std::atomic<unsigned>& runs, unsigned numberOfChecks, unsigned failingCheck)
+{
+    std::vector<CountingCheck> checks;
+    for (unsigned i = 0; i < numberOfChecks; ++i)
+        checks.push_back(CountingCheck(runs, i == failingCheck));
+    control.Add(checks);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(checkqueue_tests)
+
+BOOST_AUTO_TEST_CASE(every_check_runs_exactly_once_when_all_succeed)
+{
+    CountingCheckQueue queue(16);
+    WorkerThreads workers(queue, 4);
+    for (unsigned round = 0; round < 50; ++round) {
+        std::atomic<unsigned> runs(0);
+        CCheckQueueControl<CountingCheck> control(&queue);
+        for (unsigned transaction = 0; transaction < 200; ++transaction)
+            AddChecks(control, runs, 1 + transaction % 5, -1);
+        BOOST_CHECK(control.Wait());
+        BOOST_CHECK_EQUAL(runs.load(), 600u);
+        BOOST_CHECK(queue.IsIdle());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(a_failing_check_fails_the_round_but_not_the_next)
+{
+    CountingCheckQueue queue(16);
+    WorkerThreads workers(queue, 3);
+    std::atomic<unsigned> runs(0);
+    {
+        CCheckQueueControl<CountingCheck> control(&queue);
+        AddChecks(control, runs, 1000, 500);
+        BOOST_CHECK(!control.Wait());
+    }
+    BOOST_CHECK(queue.IsIdle());
+    {
+        CCheckQueueControl<CountingCheck> control(&queue);
+        AddChecks(control, runs, 1000, -1);
+        BOOST_CHECK(control.Wait());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(checks_after_a_failure_are_discarded)
+{
+    CountingCheckQueue queue(16);
+    std::atomic<unsigned> runs(0);
+    CCheckQueueControl<CountingCheck> control(&queue);
+    AddChecks(control, runs, 100, 0);
+    BOOST_CHECK(!control.Wait());
+    // Without worker threads the master runs the checks in order and stops at the first failure
+    BOOST_CHECK_EQUAL(runs.load(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(checks_added_after_a_failure_are_not_queued)
+{
+    CountingCheckQueue queue(16);
+    WorkerThreads workers(queue, 2);
+    std::atomic<unsigned> runs(0);
+    CCheckQueueControl<CountingCheck> control(&queue);
+    AddChecks(control, runs, 1, 0);
+    while (!control.HasFailed())
+        boost::this_thread::yield();
+    AddChecks(control, runs, 100, -1);
+    BOOST_CHECK(!control.Wait());
+    BOOST_CHECK_EQUAL(runs.load(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
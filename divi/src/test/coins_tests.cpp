@@ -61,6 +61,22 @@ public:
 
     bool GetStats(CCoinsStats& stats) const override { return false; }
 };
+
+class CCoinsViewCacheTest : public CCoinsViewCache
+{
+public:
+    CCoinsViewCacheTest(CCoinsView* base) : CCoinsViewCache(base) {}
+
+    void SelfTest() const
+    {
+        // Manually recompute the dynamic usage of the whole data, and compare it.
+        size_t ret = memusage::DynamicUsage(cacheCoins);
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+            ret += it->second.coins.DynamicMemoryUsage();
+        }
+        BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
+    }
+};
 }
 
 BOOST_AUTO_TEST_SUITE(coins_tests)
@@ -92,8 +108,8 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
 
     // The cache stack.
     CCoinsViewTest base; // A CCoinsViewTest at the bottom.
-    std::vector<CCoinsViewCache*> stack; // A stack of CCoinsViewCaches on top.
-    stack.push_back(new CCoinsViewCache(&base)); // Start with one cache.
+    std::vector<CCoinsViewCacheTest*> stack; // A stack of CCoinsViewCaches on top.
+    stack.push_back(new CCoinsViewCacheTest(&base)); // Start with one cache.
 
     // Use a limited set of random transaction ids, so we do test overwriting entries.
     std::vector<uint256> txids;
@@ -116,8 +132,11 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                     updated_an_entry = true;
                 }
                 coins.nVersion = insecure_rand();
-                coins.vout.resize(1);
-                coins.vout[0].nValue = insecure_rand();
+                coins.vout.resize(1 + insecure_rand() % 4);
+                for (CTxOut& out : coins.vout) {
+                    out.nValue = insecure_rand();
+                    out.scriptPubKey.assign(insecure_rand() & 0x3F, 0);
+                }
                 *entry = coins;
             } else {
                 coins.Clear();
@@ -138,6 +157,9 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                     missed_an_entry = true;
                 }
             }
+            for (const CCoinsViewCacheTest* test : stack) {
+                test->SelfTest();
+            }
         }
 
         if (insecure_rand() % 100 == 0) {
@@ -154,7 +176,7 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
                 } else {
                     removed_all_caches = true;
                 }
-                stack.push_back(new CCoinsViewCache(tip));
+                stack.push_back(new CCoinsViewCacheTest(tip));
                 if (stack.size() == 4) {
                     reached_4_caches = true;
                 }
@@ -178,4 +200,31 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(missed_an_entry);
 }
 
+BOOST_AUTO_TEST_CASE(coins_cache_usage_counts_every_output)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    const uint256 small = GetRandHash();
+    const uint256 large = GetRandHash();
+
+    CTxOut out;
+    out.nValue = 1;
+    out.scriptPubKey.assign(25, 0);
+    cache.ModifyCoins(small)->vout.assign(1, out);
+    const size_t smallUsage = cache.DynamicMemoryUsage();
+    cache.ModifyCoins(large)->vout.assign(1000, out);
+    const size_t largeUsage = cache.DynamicMemoryUsage() - smallUsage;
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 2u);
+    BOOST_CHECK(largeUsage > 100 * smallUsage);
+    cache.SelfTest();
+
+    // Spending every output releases the entry, and flushing empties the cache
+    cache.ModifyCoins(large)->Clear();
+    BOOST_CHECK(cache.DynamicMemoryUsage() < smallUsage + largeUsage / 10);
+    cache.SelfTest();
+    cache.Flush();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0u);
+    cache.SelfTest();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
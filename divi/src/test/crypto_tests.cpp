@@ -134,6 +134,88 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+void TestSHA256DBatch() {
+    for (size_t len = 0; len <= SHA256D_BATCH_MAX_MESSAGE_SIZE; len += 11) {
+        for (size_t count = 1; count <= 21; count += 4) {
+            std::vector<unsigned char> messages(len * count + 1);
+            GetRandBytes(&messages[0], messages.size());
+            std::vector<unsigned char> batched(CSHA256::OUTPUT_SIZE * count);
+            SHA256DBatch(&batched[0], &messages[0], len, count);
+            for (size_t i = 0; i < count; ++i) {
+                unsigned char single[CSHA256::OUTPUT_SIZE];
+                CSHA256().Write(&messages[len * i], len).Finalize(single);
+                CSHA256().Write(single, sizeof(single)).Finalize(single);
+                BOOST_CHECK(std::equal(single, single + sizeof(single), batched.begin() + CSHA256::OUTPUT_SIZE * i));
+            }
+        }
+    }
+}
+
+void TestSHA256DBatchWithPrefix() {
+    unsigned char prefix[64];
+    GetRandBytes(prefix, sizeof(prefix));
+    for (size_t len = 0; len <= SHA256D_BATCH_MAX_MESSAGE_SIZE; len += 11) {
+        for (size_t count = 1; count <= 21; count += 4) {
+            std::vector<unsigned char> messages(len * count + 1);
+            GetRandBytes(&messages[0], messages.size());
+            std::vector<unsigned char> batched(CSHA256::OUTPUT_SIZE * count);
+            SHA256DBatchWithPrefix(&batched[0], prefix, &messages[0], len, count);
+            for (size_t i = 0; i < count; ++i) {
+                unsigned char single[CSHA256::OUTPUT_SIZE];
+                CSHA256().Write(prefix, sizeof(prefix)).Write(&messages[len * i], len).Finalize(single);
+                CSHA256().Write(single, sizeof(single)).Finalize(single);
+                BOOST_CHECK(std::equal(single, single + sizeof(single), batched.begin() + CSHA256::OUTPUT_SIZE * i));
+            }
+        }
+    }
+}
+
+void TestSHA256D64() {
+    for (size_t blocks = 0; blocks <= 34; ++blocks) {
+        std::vector<unsigned char> messages(64 * blocks + 1);
+        GetRandBytes(&messages[0], messages.size());
+        std::vector<unsigned char> batched(CSHA256::OUTPUT_SIZE * blocks + 1);
+        SHA256D64(&batched[0], &messages[0], blocks);
+        for (size_t i = 0; i < blocks; ++i) {
+            unsigned char single[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write(&messages[64 * i], 64).Finalize(single);
+            CSHA256().Write(single, sizeof(single)).Finalize(single);
+            BOOST_CHECK(std::equal(single, single + sizeof(single), batched.begin() + CSHA256::OUTPUT_SIZE * i));
+        }
+    }
+}
+
+/** Run a test once with every backend this CPU has, so that the multi-lane
+ *  ones are covered even where the SHA extensions would be picked over them. */
+template<typename Test>
+void TestEachSHA256Backend(const Test& test) {
+    using namespace sha256_implementation;
+    for (UseImplementation use : {USE_STANDARD, USE_SSE4, USE_AVX2, USE_SHANI, USE_ALL}) {
+        BOOST_TEST_MESSAGE("SHA256 backend: " << SHA256AutoDetect(use));
+        test();
+    }
+    SHA256AutoDetect();
+}
+
+BOOST_AUTO_TEST_CASE(sha256d_batch_matches_sequential_double_sha256) {
+    TestEachSHA256Backend(TestSHA256DBatch);
+}
+
+BOOST_AUTO_TEST_CASE(sha256d_batch_with_prefix_matches_sequential_double_sha256) {
+    TestEachSHA256Backend(TestSHA256DBatchWithPrefix);
+}
+
+BOOST_AUTO_TEST_CASE(sha256d64_matches_sequential_double_sha256) {
+    TestEachSHA256Backend(TestSHA256D64);
+}
+
+BOOST_AUTO_TEST_CASE(sha256_backends_are_selectable) {
+    BOOST_CHECK_EQUAL(SHA256AutoDetect(sha256_implementation::USE_STANDARD), "standard");
+    BOOST_CHECK(SHA256AutoDetect(sha256_implementation::USE_SSE4).find("avx2") == std::string::npos);
+    BOOST_CHECK(SHA256AutoDetect(sha256_implementation::USE_AVX2).find("sse41") == std::string::npos);
+    BOOST_CHECK(SHA256AutoDetect(sha256_implementation::USE_ALL) == SHA256AutoDetect());
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
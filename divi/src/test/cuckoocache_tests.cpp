@@ -0,0 +1,100 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+/** Uses the bytes of an already random key as the eight hashes, like the signature cache */
+struct RandomKeyHasher
+{
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+typedef CuckooCache::cache<uint256, RandomKeyHasher> TestCache;
+
+std::vector<uint256> RandomKeys(size_t numberOfKeys)
+{
+    std::vector<uint256> keys(numberOfKeys);
+    for (uint256& key : keys)
+        key = GetRandHash();
+    return keys;
+}
+
+/** Fraction of keys found in the cache */
+double HitRate(const TestCache& cache, const std::vector<uint256>& keys)
+{
+    size_t found = 0;
+    for (const uint256& key : keys)
+        found += cache.contains(key, false);
+    return static_cast<double>(found) / keys.size();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(cuckoocache_tests)
+
+BOOST_AUTO_TEST_CASE(cuckoocache_no_fakes)
+{
+    TestCache cache;
+    cache.setup_bytes(1 << 20);
+    for (const uint256& key : RandomKeys(100000))
+        cache.insert(key);
+    for (const uint256& key : RandomKeys(100000))
+        BOOST_CHECK(!cache.contains(key, false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_sizes_itself_in_bytes)
+{
+    TestCache cache;
+    BOOST_CHECK_EQUAL(cache.setup_bytes(1 << 20), (1u << 20) / sizeof(uint256));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_keeps_most_entries_up_to_ninety_percent_load)
+{
+    TestCache cache;
+    const uint32_t maxEntries = cache.setup_bytes(1 << 20);
+    const std::vector<uint256> keys = RandomKeys(maxEntries * 9 / 10);
+    for (const uint256& key : keys)
+        cache.insert(key);
+    BOOST_CHECK(HitRate(cache, keys) > 0.95);
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_reuses_erased_entries_first)
+{
+    TestCache cache;
+    const uint32_t maxEntries = cache.setup_bytes(1 << 20);
+    const std::vector<uint256> erased = RandomKeys(maxEntries / 2);
+    const std::vector<uint256> kept = RandomKeys(maxEntries / 4);
+    for (const uint256& key : erased)
+        cache.insert(key);
+    for (const uint256& key : kept)
+        cache.insert(key);
+
+    // Erasure is lazy: erased entries stay visible until their slots are needed
+    for (const uint256& key : erased)
+        BOOST_CHECK(cache.contains(key, true));
+    BOOST_CHECK(HitRate(cache, erased) > 0.99);
+
+    const std::vector<uint256> added = RandomKeys(maxEntries / 2);
+    for (const uint256& key : added)
+        cache.insert(key);
+    BOOST_CHECK(HitRate(cache, kept) > 0.99);
+    BOOST_CHECK(HitRate(cache, added) > 0.99);
+    BOOST_CHECK(HitRate(cache, erased) < 0.5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/quark.h"
+#include "primitives/block.h"
+#include "random.h"
 #include "utilstrencodings.h"
 
 #include <vector>
@@ -46,4 +49,101 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+static CBlockHeader GenesisHeader(uint256 hashMerkleRoot, unsigned int nNonce)
+{
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.hashPrevBlock = 0;
+    header.hashMerkleRoot = hashMerkleRoot;
+    header.nTime = 1537971708;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = nNonce;
+    return header;
+}
+
+BOOST_AUTO_TEST_CASE(quark_known_answers)
+{
+    // Main and test network genesis block headers
+    const std::vector<CBlockHeader> headers = {
+        GenesisHeader(uint256("0xec803cc6b5e68728ec0117cb1154b6d2893152f89d61319647db106908888bd6"), 749845),
+        GenesisHeader(uint256("0xb68f3b6cefa827045e8bac505203050c9d247c10d7fe2a951575924427a51052"), 418873053)};
+    const std::vector<uint256> expected = {
+        uint256("0x00000e258596876664989374c7ee36445cf5f4f80889af415cc32478214394ea"),
+        uint256("0x0000050d77a86f7a3aa38dfac9c23821ed2c5d3002c2e02f9626c7521cd8ced5")};
+
+    std::vector<unsigned char> serializedHeaders;
+    for (unsigned int i = 0; i < headers.size(); i++) {
+        BOOST_CHECK(headers[i].GetHash() == expected[i]);
+        const unsigned char* begin = reinterpret_cast<const unsigned char*>(&headers[i].nVersion);
+        serializedHeaders.insert(serializedHeaders.end(), begin, begin + 80);
+    }
+
+    QuarkAutoDetect();
+    std::vector<uint256> batched(headers.size());
+    QuarkHashBatch(batched[0].begin(), &serializedHeaders[0], 80, headers.size());
+    for (unsigned int i = 0; i < headers.size(); i++)
+        BOOST_CHECK(batched[i] == expected[i]);
+}
+
+BOOST_AUTO_TEST_CASE(quark_batch_matches_single_hashes)
+{
+    QuarkAutoDetect();
+    for (size_t len : {0, 1, 32, 64, 71, 72, 80, 111, 112, 128, 129, 200}) {
+        for (size_t count = 1; count <= 9; count++) {
+            std::vector<unsigned char> messages(len * count + 1);
+            GetRandBytes(&messages[0], messages.size());
+            std::vector<uint256> batched(count);
+            QuarkHashBatch(batched[0].begin(), &messages[0], len, count);
+            for (size_t i = 0; i < count; i++)
+                BOOST_CHECK(batched[i] == HashQuark(messages.begin() + len * i, messages.begin() + len * (i + 1)));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(precomputed_header_hashes_match_single_hashes)
+{
+    QuarkAutoDetect();
+    std::vector<CBlockHeader> headers;
+    for (uint32_t nNonce = 0; nNonce < 20; nNonce++) {
+        CBlockHeader header = GenesisHeader(GetRandHash(), nNonce);
+        header.nVersion = 1 + nNonce % 5;
+        header.nAccumulatorCheckpoint = GetRandHash();
+        headers.push_back(header);
+    }
+    PrecomputeBlockHeaderHashes(headers);
+
+    for (CBlockHeader& header : headers) {
+        const unsigned char* begin = reinterpret_cast<const unsigned char*>(&header.nVersion);
+        const uint256 expected = header.nVersion < 4 ? HashQuark(begin, begin + 80) : Hash(BEGIN(header.nVersion), END(header.nAccumulatorCheckpoint));
+        BOOST_CHECK(header.GetHash() == expected);
+
+        // Remembered hashes are keyed by the header contents
+        header.nTime++;
+        BOOST_CHECK(header.GetHash() != expected);
+        BOOST_CHECK(header.GetHash() == (header.nVersion < 4 ? HashQuark(begin, begin + 80) : Hash(BEGIN(header.nVersion), END(header.nAccumulatorCheckpoint))));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(precomputed_header_hashes_are_not_recomputed)
+{
+    std::vector<CBlockHeader> headers;
+    for (uint32_t nNonce = 0; nNonce < 20; nNonce++)
+        headers.push_back(GenesisHeader(GetRandHash(), nNonce));
+    PrecomputeBlockHeaderHashes(headers);
+
+    for (const CBlockHeader& header : headers) {
+        const uint64_t hitsBefore = GetRememberedHeaderHashHits();
+        header.GetHash();
+        BOOST_CHECK_EQUAL(GetRememberedHeaderHashHits(), hitsBefore + 1);
+    }
+
+    // Headers that were not precomputed are remembered once hashed
+    const CBlockHeader other = GenesisHeader(GetRandHash(), 0);
+    const uint64_t hitsBefore = GetRememberedHeaderHashHits();
+    const uint256 hash = other.GetHash();
+    BOOST_CHECK_EQUAL(GetRememberedHeaderHashHits(), hitsBefore);
+    BOOST_CHECK(other.GetHash() == hash);
+    BOOST_CHECK_EQUAL(GetRememberedHeaderHashHits(), hitsBefore + 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,16 +2,27 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "BlockDiskAccessor.h"
 #include "BlockRewards.h"
+#include "blockmap.h"
+#include "chain.h"
 #include "coins.h"
 #include "hash.h"
+#include "IndexDatabaseUpdates.h"
 #include "kernel.h"
+#include "random.h"
 #include "script/StakingVaultScript.h"
+#include "StakingData.h"
+#include "txdb.h"
 #include "utilstrencodings.h"
 
 #include <boost/test/unit_test.hpp>
 #include "test_only.h"
 
+extern BlockMap mapBlockIndex;
+extern CBlockTreeDB* pblocktree;
+extern bool fTxIndex;
+
 namespace
 {
 
@@ -263,4 +274,139 @@ BOOST_AUTO_TEST_CASE(willRequireStakingVaultToAbsorbNonVaultFunds)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+/**
+ * Fixture for tests of the stake input recovery.  It writes a block
+ * confirming a staked transaction to disk (and indexes the transaction)
+ * and sets up a coins view with that transaction at the tip after it.
+ */
+class StakeInputRecoveryTestFixture
+{
+
+private:
+
+  const bool fTxIndexBefore;
+  CCoinsView coinsDummy;
+
+protected:
+
+  CMutableTransaction stakedTx;
+  COutPoint stakedOutput;
+  CBlock confirmingBlock;
+  CBlockIndex confirmationBlock;
+  uint256 chainTipHash;
+  CBlockIndex chainTip;
+  CCoinsViewCache coins;
+
+  StakeInputRecoveryTestFixture()
+    : fTxIndexBefore(fTxIndex), coins(&coinsDummy)
+  {
+    stakedTx.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0)));
+    stakedTx.vout.push_back(CTxOut(100 * COIN, CScript() << OP_TRUE));
+    stakedTx.vout.push_back(CTxOut(20000 * COIN, CScript() << OP_FALSE));
+    const CTransaction tx(stakedTx);
+    stakedOutput = COutPoint(tx.GetHash(), 1);
+
+    confirmingBlock.nTime = 1600000000;
+    confirmingBlock.vtx.push_back(tx);
+    confirmingBlock.hashMerkleRoot = confirmingBlock.BuildMerkleTree();
+
+    CDiskBlockPos blockPos(9999, 0);
+    BOOST_CHECK(WriteBlockToDisk(confirmingBlock, blockPos));
+    const CDiskTxPos txPos(blockPos, GetSizeOfCompactSize(confirmingBlock.vtx.size()));
+    BOOST_CHECK(pblocktree->WriteTxIndex({TxIndexEntry(tx.GetHash(), tx.GetBareTxid(), txPos)}));
+    fTxIndex = true;
+
+    confirmationBlock = CBlockIndex(confirmingBlock);
+    confirmationBlock.nHeight = 100;
+    const auto inserted = mapBlockIndex.insert(std::make_pair(confirmingBlock.GetHash(), &confirmationBlock));
+    confirmationBlock.phashBlock = &inserted.first->first;
+
+    chainTipHash = GetRandHash();
+    chainTip.phashBlock = &chainTipHash;
+    chainTip.pprev = &confirmationBlock;
+    chainTip.nHeight = confirmationBlock.nHeight + 1;
+
+    coins.SetBestBlock(chainTipHash);
+    coins.ModifyCoins(tx.GetHash())->FromTx(tx, confirmationBlock.nHeight);
+  }
+
+  ~StakeInputRecoveryTestFixture()
+  {
+    mapBlockIndex.erase(confirmingBlock.GetHash());
+    fTxIndex = fTxIndexBefore;
+  }
+
+  /** The staking data that a coinstake on top of the chain tip would
+   *  be checked with if its kernel was recovered as source.  */
+  StakingData StakingDataFor(const StakeInputSource& source) const
+  {
+    BOOST_REQUIRE(source.confirmationBlock != nullptr);
+    return StakingData(
+        confirmingBlock.nBits,
+        source.confirmationBlock->GetBlockTime(),
+        source.confirmationBlock->GetBlockHash(),
+        stakedOutput,
+        source.output.nValue,
+        chainTip.GetBlockHash());
+  }
+
+};
+
+BOOST_FIXTURE_TEST_SUITE(StakeInputRecovery_tests, StakeInputRecoveryTestFixture)
+
+BOOST_AUTO_TEST_CASE(willRecoverTheSameStakeInputFromCoinsAsFromDisk)
+{
+  StakeInputSource fromCoins;
+  BOOST_CHECK(RecoverStakeInputFromCoins(coins, &chainTip, stakedOutput, fromCoins));
+
+  StakeInputSource fromDisk;
+  BOOST_CHECK(RecoverStakeInputFromDisk(stakedOutput, true, fromDisk));
+
+  BOOST_CHECK(fromCoins.confirmationBlock == &confirmationBlock);
+  BOOST_CHECK(fromDisk.confirmationBlock == &confirmationBlock);
+  BOOST_CHECK(fromCoins.output == stakedTx.vout[1]);
+  BOOST_CHECK(fromDisk.output == stakedTx.vout[1]);
+  BOOST_CHECK(StakingDataFor(fromCoins) == StakingDataFor(fromDisk));
+}
+
+BOOST_AUTO_TEST_CASE(willFallBackToDiskForSpentCoins)
+{
+  coins.ModifyCoins(stakedOutput.hash)->Spend(stakedOutput.n);
+
+  StakeInputSource source;
+  BOOST_CHECK(!RecoverStakeInputFromCoins(coins, &chainTip, stakedOutput, source));
+  BOOST_CHECK(RecoverStakeInput(coins, &chainTip, stakedOutput, true, source));
+
+  BOOST_CHECK(source.confirmationBlock == &confirmationBlock);
+  BOOST_CHECK(source.output == stakedTx.vout[1]);
+}
+
+BOOST_AUTO_TEST_CASE(willFallBackToDiskForMissingCoins)
+{
+  CCoinsView noCoins;
+  CCoinsViewCache emptyCoins(&noCoins);
+  emptyCoins.SetBestBlock(chainTipHash);
+
+  StakeInputSource source;
+  BOOST_CHECK(!RecoverStakeInputFromCoins(emptyCoins, &chainTip, stakedOutput, source));
+  BOOST_CHECK(RecoverStakeInput(emptyCoins, &chainTip, stakedOutput, true, source));
+
+  BOOST_CHECK(source.confirmationBlock == &confirmationBlock);
+  BOOST_CHECK(source.output == stakedTx.vout[1]);
+}
+
+BOOST_AUTO_TEST_CASE(willFallBackToDiskForCoinsOfAnotherChainTip)
+{
+  coins.SetBestBlock(GetRandHash());
+
+  StakeInputSource source;
+  BOOST_CHECK(!RecoverStakeInputFromCoins(coins, &chainTip, stakedOutput, source));
+  BOOST_CHECK(RecoverStakeInput(coins, &chainTip, stakedOutput, true, source));
+
+  BOOST_CHECK(source.confirmationBlock == &confirmationBlock);
+  BOOST_CHECK(source.output == stakedTx.vout[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 } // anonymous namespace
@@ -0,0 +1,52 @@
+#include <masternode.h>
+
+#include <hash.h>
+#include <random.h>
+#include <version.h>
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+/** The score as it was defined before the rounds were batched: one hash writer copied per round */
+uint256 ReferenceScore(const CMasternode& mn, const uint256& seedHash, size_t nHashRounds)
+{
+    const uint256 aux = mn.vin.prevout.hash + mn.vin.prevout.n;
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << seedHash;
+    ss << aux;
+
+    uint256 r;
+    for (size_t i = 0; i < nHashRounds; ++i) {
+        CHashWriter round(ss);
+        round << static_cast<int>(i);
+        r = std::max(round.GetHash(), r);
+    }
+    return r;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(masternode_tests)
+
+BOOST_AUTO_TEST_CASE(willScoreMasternodesAsWithOneHashWriterPerRound)
+{
+    const std::pair<MasternodeTier, size_t> roundsByTier[] = {
+        {MasternodeTier::COPPER, 20},
+        {MasternodeTier::SILVER, 63},
+        {MasternodeTier::GOLD, 220},
+        {MasternodeTier::PLATINUM, 690},
+        {MasternodeTier::DIAMOND, 2400},
+        {MasternodeTier::INVALID, 0},
+    };
+    for (const auto& tierAndRounds : roundsByTier) {
+        CMasternode mn;
+        mn.vin = CTxIn(COutPoint(GetRandHash(), GetRand(10)));
+        mn.nTier = tierAndRounds.first;
+        const uint256 seedHash = GetRandHash();
+        BOOST_CHECK(mn.CalculateScore(seedHash) == ReferenceScore(mn, seedHash, tierAndRounds.second));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,8 +5,10 @@
 #include "txmempool.h"
 
 #include "FakeBlockIndexChain.h"
+#include "utiltime.h"
 
 #include <boost/test/unit_test.hpp>
+#include <limits>
 #include <list>
 
 class MempoolTestFixture
@@ -251,4 +253,213 @@ BOOST_AUTO_TEST_CASE(MempoolSpentIndex)
     BOOST_CHECK(!testPool.getSpentIndex(keyChild, value));
 }
 
+BOOST_AUTO_TEST_CASE(MempoolMemoryUsageIsAccounted)
+{
+    BOOST_CHECK_EQUAL(testPool.DynamicMemoryUsage(), 0u);
+
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 0, 0, 0.0, 1), coins);
+    const size_t usageWithParent = testPool.DynamicMemoryUsage();
+    BOOST_CHECK(usageWithParent > testPool.GetTotalTxSize());
+
+    testPool.addUnchecked(txChild[0].GetHash(), CTxMemPoolEntry(txChild[0], 0, 0, 0.0, 1), coins);
+    BOOST_CHECK(testPool.DynamicMemoryUsage() > usageWithParent);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    std::list<CTransaction> removed;
+    testPool.remove(txParent, removed, true);
+    BOOST_CHECK_EQUAL(testPool.DynamicMemoryUsage(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolTrimEvictsLowestFeeRatePackageWithDescendants)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 50000, 0, 0.0, 1), coins);
+    const CAmount childFees[3] = {0, 5000, 20000};
+    const CAmount grandChildFees[3] = {100000, 1000, 10000};
+    for (int i = 0; i < 3; i++)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], childFees[i], 0, 0.0, 1), coins);
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], grandChildFees[i], 0, 0.0, 1), coins);
+    }
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    // The lowest own fee rate belongs to Child[0], but GrandChild[0] pays for it
+    testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!testPool.exists(txGrandChild[1].GetHash()));
+    BOOST_CHECK(testPool.exists(txChild[0].GetHash()));
+    BOOST_CHECK_EQUAL(testPool.size(), 6);
+    BOOST_CHECK_EQUAL(testPool.GetEvictedCount(), 1u);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    const size_t grandChildSize = ::GetSerializeSize(CTransaction(txGrandChild[1]), SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(testPool.GetMinFee(1) == CFeeRate(grandChildFees[1], grandChildSize));
+
+    // Prioritisation moves transactions within the eviction order
+    testPool.PrioritiseTransaction(txParent.GetHash(), txParent.GetHash().ToString(), 0.0, -50000);
+    for (int i = 0; i < 3; i++)
+        testPool.PrioritiseTransaction(txChild[i].GetHash(), txChild[i].GetHash().ToString(), 0.0, 1000000);
+    testPool.PrioritiseTransaction(txGrandChild[0].GetHash(), txGrandChild[0].GetHash().ToString(), 0.0, -100000);
+    testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!testPool.exists(txGrandChild[0].GetHash()));
+    BOOST_CHECK_EQUAL(testPool.size(), 5);
+
+    testPool.TrimToSize(0);
+    BOOST_CHECK_EQUAL(testPool.size(), 0);
+    BOOST_CHECK_EQUAL(testPool.GetEvictedCount(), 7u);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolRollingMinimumFeeDecaysAfterABlock)
+{
+    SetMockTime(1500000000);
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 100000, 0, 0.0, 1), coins);
+    testPool.TrimToSize(0);
+    const CFeeRate bumped = testPool.GetMinFee(1000000);
+    BOOST_CHECK(bumped > CFeeRate(0));
+
+    // Without a block the minimum fee stays put
+    SetMockTime(1500000000 + CTxMemPool::ROLLING_FEE_HALFLIFE);
+    BOOST_CHECK(testPool.GetMinFee(1000000) == bumped);
+
+    // An empty pool decays with a quarter of the half-life
+    std::list<CTransaction> conflicts;
+    testPool.removeForBlock(std::vector<CTransaction>(), 2, conflicts);
+    SetMockTime(1500000000 + 2 * CTxMemPool::ROLLING_FEE_HALFLIFE);
+    const CFeeRate decayed = testPool.GetMinFee(1000000);
+    BOOST_CHECK(decayed < bumped);
+    BOOST_CHECK(decayed.GetFeePerK() <= bumped.GetFeePerK() / 16 + 1);
+
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolExpireRemovesOldTransactionsWithDescendants)
+{
+    const int64_t childTimes[3] = {100, 300, 300};
+    const int64_t grandChildTimes[3] = {400, 300, 50};
+    for (int i = 0; i < 3; i++)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], 0, childTimes[i], 0.0, 1), coins);
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], 0, grandChildTimes[i], 0.0, 1), coins);
+    }
+
+    BOOST_CHECK_EQUAL(testPool.Expire(200), 3);
+    BOOST_CHECK(!testPool.exists(txChild[0].GetHash()));
+    BOOST_CHECK(!testPool.exists(txGrandChild[0].GetHash()));
+    BOOST_CHECK(!testPool.exists(txGrandChild[2].GetHash()));
+    BOOST_CHECK(testPool.exists(txChild[2].GetHash()));
+    BOOST_CHECK_EQUAL(testPool.size(), 3);
+    BOOST_CHECK_EQUAL(testPool.GetExpiredCount(), 3u);
+
+    BOOST_CHECK_EQUAL(testPool.Expire(200), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolTracksAncestorAndDescendantPackages)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 10000, 0, 0.0, 1), coins);
+    for (int i = 0; i < 3; i++)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], 1000, 0, 0.0, 1), coins);
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], 100, 0, 0.0, 1), coins);
+    }
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    const size_t parentSize = ::GetSerializeSize(CTransaction(txParent), SER_NETWORK, PROTOCOL_VERSION);
+    const size_t childSize = ::GetSerializeSize(CTransaction(txChild[0]), SER_NETWORK, PROTOCOL_VERSION);
+    const size_t grandChildSize = ::GetSerializeSize(CTransaction(txGrandChild[0]), SER_NETWORK, PROTOCOL_VERSION);
+
+    CTxMemPool::txiter parentIt = testPool.mapTx.find(txParent.GetHash());
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithDescendants(), 7u);
+    BOOST_CHECK_EQUAL(parentIt->GetSizeWithDescendants(), parentSize + 3 * childSize + 3 * grandChildSize);
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 13300);
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithAncestors(), 1u);
+
+    CTxMemPool::txiter grandChildIt = testPool.mapTx.find(txGrandChild[1].GetHash());
+    BOOST_CHECK_EQUAL(grandChildIt->GetCountWithAncestors(), 3u);
+    BOOST_CHECK_EQUAL(grandChildIt->GetSizeWithAncestors(), parentSize + childSize + grandChildSize);
+    BOOST_CHECK_EQUAL(grandChildIt->GetModFeesWithAncestors(), 11100);
+    BOOST_CHECK_EQUAL(grandChildIt->GetCountWithDescendants(), 1u);
+
+    // Prioritisation flows into the package state of relatives
+    testPool.PrioritiseTransaction(txChild[1].GetHash(), txChild[1].GetHash().ToString(), 0.0, 5000);
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 18300);
+    BOOST_CHECK_EQUAL(grandChildIt->GetModFeesWithAncestors(), 16100);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    // Removing a branch takes it out of the parent's descendants
+    std::list<CTransaction> removed;
+    testPool.remove(txChild[0], removed, true);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithDescendants(), 5u);
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 17200);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    // Confirming the parent leaves the children without in-mempool ancestors
+    std::vector<CTransaction> block(1, txParent);
+    std::list<CTransaction> conflicts;
+    testPool.removeForBlock(block, 2, conflicts);
+    BOOST_CHECK_EQUAL(testPool.mapTx.find(txChild[2].GetHash())->GetCountWithAncestors(), 1u);
+    BOOST_CHECK_EQUAL(grandChildIt->GetCountWithAncestors(), 2u);
+    BOOST_CHECK_EQUAL(grandChildIt->GetModFeesWithAncestors(), 6100);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolLinksDescendantsAddedBeforeTheirParents)
+{
+    // Transactions from a disconnected block re-enter after their spenders
+    testPool.addUnchecked(txGrandChild[0].GetHash(), CTxMemPoolEntry(txGrandChild[0], 100, 0, 0.0, 1), coins);
+    testPool.addUnchecked(txChild[0].GetHash(), CTxMemPoolEntry(txChild[0], 1000, 0, 0.0, 1), coins);
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 10000, 0, 0.0, 1), coins);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    CTxMemPool::txiter parentIt = testPool.mapTx.find(txParent.GetHash());
+    CTxMemPool::txiter grandChildIt = testPool.mapTx.find(txGrandChild[0].GetHash());
+    BOOST_CHECK_EQUAL(parentIt->GetCountWithDescendants(), 3u);
+    BOOST_CHECK_EQUAL(parentIt->GetModFeesWithDescendants(), 11100);
+    BOOST_CHECK_EQUAL(grandChildIt->GetCountWithAncestors(), 3u);
+    BOOST_CHECK_EQUAL(grandChildIt->GetModFeesWithAncestors(), 11100);
+    BOOST_CHECK_EQUAL(testPool.GetMemPoolChildren(parentIt).size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolOrdersEntriesByAncestorFeeRate)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 0, 0, 0.0, 1), coins);
+    const CAmount childFees[3] = {2000, 50000, 10000};
+    for (int i = 0; i < 3; i++)
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], childFees[i], 0, 0.0, 1), coins);
+
+    // Child[1] pays the most for its package with the free parent
+    std::vector<uint256> order;
+    for (const CTxMemPoolEntry& entry : testPool.mapTx.get<ancestor_score>())
+        order.push_back(entry.GetTx().GetHash());
+    BOOST_CHECK_EQUAL(order.size(), 4u);
+    BOOST_CHECK(order[0] == txChild[1].GetHash());
+    BOOST_CHECK(order[1] == txChild[2].GetHash());
+    BOOST_CHECK(order[2] == txChild[0].GetHash());
+    BOOST_CHECK(order[3] == txParent.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolEnforcesAncestorAndDescendantLimits)
+{
+    AddAll();
+    std::string errString;
+    CTxMemPool::setEntries ancestors;
+    const uint64_t noLimit = std::numeric_limits<uint64_t>::max();
+
+    const CTxMemPoolEntry& grandChild = *testPool.mapTx.find(txGrandChild[0].GetHash());
+    BOOST_CHECK(testPool.CalculateMemPoolAncestors(grandChild, ancestors, 3, noLimit, noLimit, noLimit, errString, false));
+    BOOST_CHECK_EQUAL(ancestors.size(), 2u);
+
+    ancestors.clear();
+    BOOST_CHECK(!testPool.CalculateMemPoolAncestors(grandChild, ancestors, 2, noLimit, noLimit, noLimit, errString, false));
+
+    // A new spend of the parent would give it an eighth descendant
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(txGrandChild[2].GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = COIN;
+    CTxMemPoolEntry spendEntry(spend, 0, 0, 0.0, 1);
+    ancestors.clear();
+    BOOST_CHECK(testPool.CalculateMemPoolAncestors(spendEntry, ancestors, noLimit, noLimit, 8, noLimit, errString));
+    ancestors.clear();
+    BOOST_CHECK(!testPool.CalculateMemPoolAncestors(spendEntry, ancestors, noLimit, noLimit, 7, noLimit, errString));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
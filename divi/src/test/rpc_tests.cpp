@@ -10,11 +10,14 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 #include "test_only.h"
 
 using namespace std;
 using namespace json_spirit;
 
+extern boost::mutex cs_rpcBatchQueue;
+
 Array
 createArgs(int nRequired, const char* address1=NULL, const char* address2=NULL)
 {
@@ -46,6 +49,41 @@ Value CallRPC(string args)
     }
 }
 
+Object BatchEntry(const string& strMethod, int id)
+{
+    Object request;
+    request.push_back(Pair("method", strMethod));
+    request.push_back(Pair("params", Array()));
+    request.push_back(Pair("id", id));
+    return request;
+}
+
+Array ExecBatch(const Array& vReq, size_t nMaxReplySize = MAX_BATCH_REPLY_SIZE)
+{
+    Value replies;
+    BOOST_REQUIRE(read_string(JSONRPCExecBatch(vReq, nMaxReplySize), replies));
+    BOOST_REQUIRE(replies.type() == array_type);
+    BOOST_REQUIRE_EQUAL(replies.get_array().size(), vReq.size());
+    return replies.get_array();
+}
+
+/** Checks each reply answers the request at its position, by id and by the type its method returns */
+void CheckBatchReplies(const Array& vReq, const Array& replies)
+{
+    for (size_t i = 0; i < vReq.size(); i++) {
+        const Object& reply = replies[i].get_obj();
+        BOOST_CHECK(find_value(reply, "error").type() == null_type);
+        BOOST_CHECK_EQUAL(find_value(reply, "id").get_int(), find_value(vReq[i].get_obj(), "id").get_int());
+        const Value_type expected = find_value(vReq[i].get_obj(), "method").get_str() == "getbestblockhash" ? str_type : int_type;
+        BOOST_CHECK(find_value(reply, "result").type() == expected);
+    }
+}
+
+/** Starts the batch helper threads for the duration of a test, as StartRPCThreads does */
+struct RPCBatchThreadsSetup {
+    RPCBatchThreadsSetup() { StartRPCBatchThreads(3); }
+    ~RPCBatchThreadsSetup() { StopRPCBatchThreads(); }
+};
 
 BOOST_AUTO_TEST_SUITE(rpc_tests)
 
@@ -180,4 +218,108 @@ BOOST_AUTO_TEST_CASE(rpc_boostasiotocnetaddr)
     BOOST_CHECK_EQUAL(BoostAsioToCNetAddr(boost::asio::ip::address::from_string("::ffff:127.0.0.1")).ToString(), "127.0.0.1");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_frame_http_requests)
+{
+    const std::string first = "POST / HTTP/1.1\r\nContent-Length: 4\r\nConnection: keep-alive\r\n\r\nabcd";
+    const std::string second = "GET /rest/tx/0.json HTTP/1.1\r\n\r\n";
+    size_t requestSize = 0;
+
+    // Requests are only complete once the blank line and the whole body have arrived
+    BOOST_CHECK_EQUAL(FrameHTTPRequest("", 1000, requestSize), HTTP_REQUEST_INCOMPLETE);
+    BOOST_CHECK_EQUAL(FrameHTTPRequest(first.substr(0, 30), 1000, requestSize), HTTP_REQUEST_INCOMPLETE);
+    BOOST_CHECK_EQUAL(FrameHTTPRequest(first.substr(0, first.size() - 1), 1000, requestSize), HTTP_REQUEST_INCOMPLETE);
+
+    // Pipelined requests are framed one at a time
+    std::string buffer = first + second;
+    BOOST_CHECK_EQUAL(FrameHTTPRequest(buffer, 1000, requestSize), HTTP_REQUEST_COMPLETE);
+    BOOST_CHECK_EQUAL(requestSize, first.size());
+    buffer.erase(0, requestSize);
+    BOOST_CHECK_EQUAL(FrameHTTPRequest(buffer, 1000, requestSize), HTTP_REQUEST_COMPLETE);
+    BOOST_CHECK_EQUAL(requestSize, second.size());
+
+    // A framed request parses the same way a blocking read of it would
+    std::istringstream stream(first);
+    int nProto = 0;
+    std::string strMethod, strURI, strBody;
+    std::map<std::string, std::string> mapHeaders;
+    BOOST_CHECK(ReadHTTPRequestLine(stream, nProto, strMethod, strURI));
+    ReadHTTPMessage(stream, mapHeaders, strBody, nProto, 1000);
+    BOOST_CHECK_EQUAL(strBody, "abcd");
+    BOOST_CHECK_EQUAL(mapHeaders["connection"], "keep-alive");
+
+    // Bodies over the limit and endless headers are refused before they are buffered
+    BOOST_CHECK_EQUAL(FrameHTTPRequest(first, 3, requestSize), HTTP_REQUEST_TOO_LARGE);
+    BOOST_CHECK_EQUAL(FrameHTTPRequest("POST / HTTP/1.1\r\n" + std::string(100000, 'x'), 1000, requestSize), HTTP_REQUEST_TOO_LARGE);
+}
+
+BOOST_FIXTURE_TEST_CASE(rpc_batch_replies_in_request_order, RPCBatchThreadsSetup)
+{
+    // getbestblockhash runs on the batch queue, getconnectioncount under the locks in between
+    Array vReq;
+    for (int i = 0; i < 24; i++)
+        vReq.push_back(BatchEntry(i % 5 == 4 ? "getconnectioncount" : "getbestblockhash", i));
+    CheckBatchReplies(vReq, ExecBatch(vReq));
+}
+
+BOOST_FIXTURE_TEST_CASE(rpc_batch_runs_longer_than_calls_in_flight, RPCBatchThreadsSetup)
+{
+    Array vReq;
+    for (int i = 0; i < 3 * (int)MAX_BATCH_CALLS_IN_FLIGHT + 5; i++)
+        vReq.push_back(BatchEntry("getbestblockhash", i));
+    vReq.push_back(BatchEntry("getconnectioncount", vReq.size()));
+    CheckBatchReplies(vReq, ExecBatch(vReq));
+}
+
+BOOST_FIXTURE_TEST_CASE(rpc_batch_overflow_answers_remaining_entries, RPCBatchThreadsSetup)
+{
+    Array vReq;
+    vReq.push_back(BatchEntry("getconnectioncount", 0));
+    for (int i = 1; i < 20; i++)
+        vReq.push_back(BatchEntry(i % 2 ? "getbestblockhash" : "getconnectioncount", i));
+
+    // Only the opening bracket fits, so everything after the first entry is left unexecuted
+    const Array replies = ExecBatch(vReq, 1);
+    CheckBatchReplies(Array(vReq.begin(), vReq.begin() + 1), Array(replies.begin(), replies.begin() + 1));
+    for (size_t i = 1; i < vReq.size(); i++) {
+        const Object& reply = replies[i].get_obj();
+        BOOST_CHECK(find_value(reply, "result").type() == null_type);
+        BOOST_CHECK_EQUAL(find_value(find_value(reply, "error").get_obj(), "code").get_int(), RPC_OUT_OF_MEMORY);
+        BOOST_CHECK_EQUAL(find_value(reply, "id").get_int(), (int)i);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(rpc_batch_runs_on_calling_thread_while_queue_is_busy, RPCBatchThreadsSetup)
+{
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    bool queueHeld = false;
+    bool release = false;
+    // Stands in for another batch holding the queue until this one is done
+    boost::thread otherBatch([&]() {
+        boost::lock_guard<boost::mutex> lockBatchQueue(cs_rpcBatchQueue);
+        boost::unique_lock<boost::mutex> lock(mutex);
+        queueHeld = true;
+        condition.notify_all();
+        while (!release)
+            condition.wait(lock);
+    });
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (!queueHeld)
+            condition.wait(lock);
+    }
+
+    Array vReq;
+    for (int i = 0; i < (int)MAX_BATCH_CALLS_IN_FLIGHT + 3; i++)
+        vReq.push_back(BatchEntry(i % 7 == 6 ? "getconnectioncount" : "getbestblockhash", i));
+    CheckBatchReplies(vReq, ExecBatch(vReq));
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        release = true;
+    }
+    condition.notify_all();
+    otherBatch.join();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
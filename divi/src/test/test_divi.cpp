@@ -11,6 +11,9 @@
 #include "txdb.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "crypto/quark.h"
+#include "crypto/sha256.h"
+#include "script/sigcache.h"
 #ifdef ENABLE_WALLET
 #include "db.h"
 #include "wallet.h"
@@ -41,9 +44,12 @@ struct TestingSetup {
 
     TestingSetup() {
         SetupEnvironment();
+        SHA256AutoDetect();
+        QuarkAutoDetect();
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(CBaseChainParams::UNITTEST);
+        InitSignatureCache();
         noui_connect();
 #ifdef ENABLE_WALLET
         CDB::bitdb.MakeMock();
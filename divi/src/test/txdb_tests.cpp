@@ -0,0 +1,218 @@
+#include "txdb.h"
+
+#include "coins.h"
+#include "primitives/transaction.h"
+#include "script/script.h"
+
+#include <limits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+/** In-memory chainstate that can also store records in the pre-upgrade layout */
+class CCoinsViewDBWithLegacyRecords : public CCoinsViewDB
+{
+public:
+    CCoinsViewDBWithLegacyRecords(): CCoinsViewDB(1 << 20, true)
+    {
+    }
+
+    void WriteLegacyCoins(const uint256& txid, const CCoins& coins)
+    {
+        db.Write(std::make_pair('c', txid), coins);
+    }
+
+    bool HasLegacyCoins(const uint256& txid)
+    {
+        return db.Exists(std::make_pair('c', txid));
+    }
+
+    void WriteOutputSlots(const uint256& txid, uint32_t nOutputs)
+    {
+        db.Write(std::make_pair('O', txid), nOutputs);
+    }
+};
+
+CCoins CoinsWithOutputs(unsigned outputs, int height)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256S("01"), height);
+    for (unsigned n = 0; n < outputs; ++n)
+        tx.vout.emplace_back(COIN * (n + 1), CScript() << OP_TRUE << n);
+    return CCoins(CTransaction(tx), height);
+}
+
+void WriteCoins(CCoinsView& view, const uint256& txid, const CCoins& coins, unsigned char flags = CCoinsCacheEntry::DIRTY)
+{
+    CCoinsMap map;
+    CCoinsCacheEntry& entry = map[txid];
+    entry.coins = coins;
+    entry.flags = flags;
+    BOOST_CHECK(view.BatchWrite(map, uint256(0)));
+}
+
+void SpendThroughCache(CCoinsView& view, const uint256& txid, const std::vector<unsigned>& outputs)
+{
+    CCoinsViewCache cache(&view);
+    for (unsigned n : outputs)
+        cache.ModifyCoins(txid)->Spend(n);
+    BOOST_CHECK(cache.Flush());
+}
+}
+
+BOOST_AUTO_TEST_SUITE(txdb_tests)
+
+BOOST_AUTO_TEST_CASE(willReadBackCoinsWrittenAsPerOutputRecords)
+{
+    CCoinsViewDBWithLegacyRecords view;
+    const uint256 txid = uint256S("aa");
+    const CCoins coins = CoinsWithOutputs(5, 42);
+    WriteCoins(view, txid, coins, CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+
+    CCoins read;
+    BOOST_CHECK(view.HaveCoins(txid));
+    BOOST_CHECK(view.GetCoins(txid, read));
+    BOOST_CHECK(read == coins);
+    BOOST_CHECK(!view.HaveCoins(uint256S("ab")));
+    BOOST_CHECK(!view.GetCoins(uint256S("ab"), read));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepRemainingOutputsWhenOneIsSpent)
+{
+    CCoinsViewDBWithLegacyRecords view;
+    const uint256 txid = uint256S("aa");
+    CCoins coins = CoinsWithOutputs(4, 7);
+    WriteCoins(view, txid, coins, CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+
+    coins.Spend(1);
+    coins.Spend(3);
+    SpendThroughCache(view, txid, {1, 3});
+
+    CCoins read;
+    BOOST_CHECK(view.GetCoins(txid, read));
+    BOOST_CHECK(read == coins);
+    BOOST_CHECK(read.IsAvailable(0));
+    BOOST_CHECK(!read.IsAvailable(1));
+    BOOST_CHECK(read.IsAvailable(2));
+    BOOST_CHECK_EQUAL(read.vout.size(), 3u);
+
+    SpendThroughCache(view, txid, {0, 2});
+    BOOST_CHECK(!view.HaveCoins(txid));
+    BOOST_CHECK(!view.GetCoins(txid, read));
+}
+
+BOOST_AUTO_TEST_CASE(willRewriteOutputsOfATransactionReconnectedAtAnotherHeight)
+{
+    CCoinsViewDBWithLegacyRecords view;
+    const uint256 txid = uint256S("aa");
+    WriteCoins(view, txid, CoinsWithOutputs(3, 7), CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+
+    const CCoins reconnected = CoinsWithOutputs(3, 9);
+    {
+        CCoinsViewCache cache(&view);
+        cache.ModifyCoins(txid)->Clear();
+        *cache.ModifyCoins(txid) = reconnected;
+        BOOST_CHECK(cache.Flush());
+    }
+
+    CCoins read;
+    BOOST_CHECK(view.GetCoins(txid, read));
+    BOOST_CHECK(read == reconnected);
+}
+
+BOOST_AUTO_TEST_CASE(willFindOutputsRestoredBeyondTheStoredOnes)
+{
+    CCoinsViewDBWithLegacyRecords view;
+    const uint256 txid = uint256S("aa");
+    const CCoins original = CoinsWithOutputs(4, 7);
+    WriteCoins(view, txid, original, CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+    SpendThroughCache(view, txid, {0, 1, 2, 3});
+    BOOST_CHECK(!view.HaveCoins(txid));
+
+    // Disconnected blocks bring the outputs back one at a time
+    CCoins restored;
+    for (unsigned n : {1u, 3u}) {
+        {
+            CCoinsViewCache cache(&view);
+            {
+                CCoinsModifier coins = cache.ModifyCoins(txid);
+                if (coins->IsPruned()) {
+                    coins->fCoinBase = original.fCoinBase;
+                    coins->nHeight = original.nHeight;
+                    coins->nVersion = original.nVersion;
+                }
+                if (coins->vout.size() <= n)
+                    coins->vout.resize(n + 1);
+                coins->vout[n] = original.vout[n];
+                restored = *coins;
+            }
+            BOOST_CHECK(cache.Flush());
+        }
+
+        CCoins read;
+        BOOST_CHECK(view.GetCoins(txid, read));
+        BOOST_CHECK(read == restored);
+    }
+    BOOST_CHECK(restored.IsAvailable(1));
+    BOOST_CHECK(restored.IsAvailable(3));
+}
+
+BOOST_AUTO_TEST_CASE(willFetchAMostlySpentWideTransactionWithoutVisitingSpentSlots)
+{
+    CCoinsViewDBWithLegacyRecords view;
+    const uint256 txid = uint256S("aa");
+    const uint256 nextTxid = uint256S("ab");
+    CCoins expected = CoinsWithOutputs(300, 7);
+    WriteCoins(view, txid, expected, CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+    WriteCoins(view, nextTxid, CoinsWithOutputs(2, 8), CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+
+    std::vector<unsigned> spent;
+    for (unsigned n = 0; n < 300; ++n) {
+        if (n != 5 && n != 256 && n != 299)
+            spent.push_back(n);
+    }
+    SpendThroughCache(view, txid, spent);
+    for (unsigned n : spent)
+        expected.Spend(n);
+
+    // A point read per output slot would now take billions of lookups
+    view.WriteOutputSlots(txid, std::numeric_limits<uint32_t>::max());
+
+    CCoins read;
+    BOOST_CHECK(view.GetCoins(txid, read));
+    BOOST_CHECK(read == expected);
+    BOOST_CHECK_EQUAL(read.vout.size(), 300u);
+    BOOST_CHECK(read.IsAvailable(5) && read.IsAvailable(256) && read.IsAvailable(299));
+    BOOST_CHECK(!read.IsAvailable(4) && !read.IsAvailable(257));
+}
+
+BOOST_AUTO_TEST_CASE(willUpgradeLegacyPerTransactionRecords)
+{
+    CCoinsViewDBWithLegacyRecords view;
+    const uint256 first = uint256S("aa");
+    const uint256 second = uint256S("bb");
+    CCoins firstCoins = CoinsWithOutputs(3, 10);
+    firstCoins.Spend(1);
+    const CCoins secondCoins = CoinsWithOutputs(1, 11);
+    view.WriteLegacyCoins(first, firstCoins);
+    view.WriteLegacyCoins(second, secondCoins);
+
+    BOOST_CHECK(view.Upgrade());
+
+    BOOST_CHECK(!view.HasLegacyCoins(first));
+    BOOST_CHECK(!view.HasLegacyCoins(second));
+    CCoins read;
+    BOOST_CHECK(view.GetCoins(first, read));
+    BOOST_CHECK(read == firstCoins);
+    BOOST_CHECK(view.GetCoins(second, read));
+    BOOST_CHECK(read == secondCoins);
+
+    BOOST_CHECK(view.Upgrade());
+    BOOST_CHECK(view.GetCoins(first, read));
+    BOOST_CHECK(read == firstCoins);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
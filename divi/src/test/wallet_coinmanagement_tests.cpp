@@ -49,6 +49,16 @@ public:
             ToByteVector(ownerKey.GetPubKey().GetID()),
             ToByteVector(wallet.vchDefaultKey.GetID()) );
     }
+    /** A wallet transaction as it is first seen in the current top block,
+     *  so that it reaches the wallet through AddToWallet already confirmed.  */
+    CWalletTx confirmedInTip(const CMutableTransaction& tx) const
+    {
+        CWalletTx wtx(CMerkleTx(tx, *fakeChain.activeChain, *fakeChain.blockIndexByHash));
+        wtx.hashBlock = fakeChain.activeChain->Tip()->GetBlockHash();
+        wtx.nIndex = 0;
+        wtx.fMerkleVerified = true;
+        return wtx;
+    }
 };
 
 BOOST_FIXTURE_TEST_SUITE(WalletCoinManagementTests,WalletCoinManagementTestFixture)
@@ -400,4 +410,37 @@ BOOST_AUTO_TEST_CASE(willEnsureStakingBalanceAndTotalBalanceAgreeEvenIfTxsBelong
     BOOST_CHECK_EQUAL_MESSAGE(stakableCoins.size(),2,"Missing coins in the stakable set");
 }
 
+BOOST_AUTO_TEST_CASE(willKeepBalancesUpToDateThroughConfirmationsLocksAndSpends)
+{
+    const CScript normalScript = GetScriptForDestination(wallet.vchDefaultKey.GetID());
+    const CAmount value = (GetRand(1000)+1)*COIN;
+
+    unsigned outputIndex=0;
+    wallet.AddDefaultTx(normalScript,outputIndex,value);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), 0);
+
+    CMutableTransaction fundingTx;
+    fundingTx.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0)));
+    fundingTx.vout.push_back(CTxOut(value, normalScript));
+    wallet.AddToWallet(confirmedInTip(fundingTx));
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), value);
+    BOOST_CHECK_EQUAL(wallet.GetStakingBalance(), value);
+
+    const COutPoint output(CTransaction(fundingTx).GetHash(),0);
+    wallet.LockCoin(output);
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), value);
+    BOOST_CHECK_EQUAL(wallet.GetStakingBalance(), 0);
+    wallet.UnlockCoin(output);
+    BOOST_CHECK_EQUAL(wallet.GetStakingBalance(), value);
+
+    CKey key; key.MakeNewKey(true);
+    CMutableTransaction spendingTx;
+    spendingTx.vin.push_back(CTxIn(output));
+    spendingTx.vout.push_back(CTxOut(value, GetScriptForDestination(key.GetPubKey().GetID())));
+    wallet.AddBlock();
+    wallet.AddToWallet(confirmedInTip(spendingTx));
+    BOOST_CHECK_EQUAL(wallet.GetBalance(), 0);
+    BOOST_CHECK_EQUAL(wallet.GetStakingBalance(), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
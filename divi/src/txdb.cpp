@@ -9,6 +9,7 @@
 #include "uint256.h"
 #include <stdint.h>
 #include <coins.h>
+#include <compressor.h>
 #include <boost/thread.hpp>
 #include <blockFileInfo.h>
 #include <blockmap.h>
@@ -20,6 +21,8 @@
 
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+
 using namespace std;
 
 namespace
@@ -31,6 +34,8 @@ constexpr char DB_ADDRESSUNSPENTINDEX = 'u';
 constexpr char DB_TXINDEX = 't';
 constexpr char DB_BARETXIDINDEX = 'T';
 constexpr char DB_COINS = 'c';
+constexpr char DB_COIN = 'C';
+constexpr char DB_COINOUTPUTS = 'O';
 constexpr char DB_BESTBLOCKHASH = 'B';
 constexpr char DB_BLOCKINDEX = 'b';
 constexpr char DB_BLOCKFILEINFO = 'f';
@@ -38,20 +43,77 @@ constexpr char DB_LASTBLOCKFILE = 'l';
 constexpr char DB_REINDEXINGFLAG = 'R';
 constexpr char DB_NAMEDFLAG = 'F';
 
+/** Transactions converted per batch when upgrading DB_COINS records */
+constexpr unsigned UPGRADE_TRANSACTIONS_PER_BATCH = 10000;
+
+/**
+ * One unspent output as stored under (DB_COIN, outpoint). The metadata of
+ * its transaction is repeated with every output, so spending one output
+ * touches a single small record instead of rewriting the whole CCoins.
+ *
+ * Serialized format:
+ * - VARINT(nHeight * 4 + (fCoinStake ? 2 : 0) + (fCoinBase ? 1 : 0))
+ * - VARINT(nVersion)
+ * - the output, as a CTxOutCompressor
+ *
+ * (DB_COINOUTPUTS, txid) holds the number of output slots of a transaction
+ * with unspent outputs, so that its existence is a single point lookup. The
+ * records themselves are collected by seeking to their common key prefix.
+ */
+class CCoinsOutputRecord
+{
+public:
+    bool fCoinBase;
+    bool fCoinStake;
+    int nHeight;
+    int nVersion;
+    CTxOut out;
+
+    CCoinsOutputRecord(): fCoinBase(false), fCoinStake(false), nHeight(0), nVersion(0), out() {}
+    CCoinsOutputRecord(
+        const CCoins& coins,
+        unsigned int n
+        ): fCoinBase(coins.fCoinBase)
+        , fCoinStake(coins.fCoinStake)
+        , nHeight(coins.nHeight)
+        , nVersion(coins.nVersion)
+        , out(coins.vout[n])
+    {
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersionIn)
+    {
+        unsigned int nCode = nHeight * 4 + (fCoinStake ? 2 : 0) + (fCoinBase ? 1 : 0);
+        READWRITE(VARINT(nCode));
+        if (ser_action.ForRead()) {
+            nHeight = nCode / 4;
+            fCoinStake = (nCode & 2) != 0;
+            fCoinBase = (nCode & 1) != 0;
+        }
+        READWRITE(VARINT(nVersion));
+        READWRITE(REF(CTxOutCompressor(REF(out))));
+    }
+};
+
 } // anonymous namespace
 
 extern BlockMap mapBlockIndex;
 
-CBlockIndex* InsertBlockIndex(uint256 hash);
-
-void static BatchWriteCoins(CLevelDBBatch& batch, const uint256& hash, const CCoins& coins)
-{
-    if (coins.IsPruned())
-        batch.Erase(std::make_pair(DB_COINS, hash));
-    else
-        batch.Write(std::make_pair(DB_COINS, hash), coins);
+template<typename K> bool GetKey(leveldb::Slice slKey, K& key) {
+    try {
+        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        ssKey >> key;
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
 }
 
+CBlockIndex* InsertBlockIndex(uint256 hash);
+
 void static BatchWriteHashBestChain(CLevelDBBatch& batch, const uint256& hash)
 {
     batch.Write(DB_BESTBLOCKHASH, hash);
@@ -63,12 +125,48 @@ CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(Get
 
 bool CCoinsViewDB::GetCoins(const uint256& txid, CCoins& coins) const
 {
-    return db.Read(std::make_pair(DB_COINS, txid), coins);
+    // Only unspent outputs have records, and those of one transaction share
+    // the (DB_COIN, txid) key prefix, so a single seek finds all of them
+    // however many slots of a wide transaction were spent.
+    CDataStream ssKeyPrefix(SER_DISK, CLIENT_VERSION);
+    ssKeyPrefix << std::make_pair(DB_COIN, COutPoint(txid, 0));
+    const std::string strKeyPrefix = ssKeyPrefix.str().substr(0, 1 + txid.size());
+
+    boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    coins.Clear();
+    bool fFound = false;
+    for (pcursor->Seek(ssKeyPrefix.str()); pcursor->Valid() && pcursor->key().starts_with(strKeyPrefix); pcursor->Next()) {
+        std::pair<char, COutPoint> key;
+        CCoinsOutputRecord record;
+        if (!GetKey(pcursor->key(), key))
+            continue;
+        try {
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> record;
+        } catch (const std::exception&) {
+            // Unreadable records are skipped, as a point read of them would be
+            continue;
+        }
+        const uint32_t n = key.second.n;
+        if (!fFound) {
+            coins.fCoinBase = record.fCoinBase;
+            coins.fCoinStake = record.fCoinStake;
+            coins.nHeight = record.nHeight;
+            coins.nVersion = record.nVersion;
+            fFound = true;
+        }
+        // Keys order the output index by its little-endian bytes, not numerically
+        if (coins.vout.size() <= n)
+            coins.vout.resize(n + 1);
+        coins.vout[n] = record.out;
+    }
+    return fFound;
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256& txid) const
 {
-    return db.Exists(std::make_pair(DB_COINS, txid));
+    return db.Exists(std::make_pair(DB_COINOUTPUTS, txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const
@@ -84,9 +182,36 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     CLevelDBBatch batch;
     size_t count = 0;
     size_t changed = 0;
+    size_t changedOutputs = 0;
     for (auto it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            BatchWriteCoins(batch, it->first, it->second.coins);
+            const uint256& txid = it->first;
+            const CCoins& coins = it->second.coins;
+            // The entry remembers which outputs are stored, so spending one
+            // output of a wide transaction erases a single record without
+            // reading any back. Outputs are fixed by the txid; only a
+            // reconnection at another height changes stored ones.
+            const std::vector<bool>& unspentInBase = it->second.unspentInBase;
+            const bool fHeightChanged = it->second.nHeightInBase != coins.nHeight;
+            bool fStored = false;
+            for (unsigned int n = 0; n < std::max<size_t>(coins.vout.size(), unspentInBase.size()); n++) {
+                const bool fWasUnspent = n < unspentInBase.size() && unspentInBase[n];
+                const bool fUnspent = n < coins.vout.size() && !coins.vout[n].IsNull();
+                fStored |= fWasUnspent;
+                if (fUnspent && (!fWasUnspent || fHeightChanged))
+                    batch.Write(std::make_pair(DB_COIN, COutPoint(txid, n)), CCoinsOutputRecord(coins, n));
+                else if (!fUnspent && fWasUnspent)
+                    batch.Erase(std::make_pair(DB_COIN, COutPoint(txid, n)));
+                else
+                    continue;
+                changedOutputs++;
+            }
+            if (coins.IsPruned()) {
+                if (fStored)
+                    batch.Erase(std::make_pair(DB_COINOUTPUTS, txid));
+            } else if (!fStored || coins.vout.size() > unspentInBase.size()) {
+                batch.Write(std::make_pair(DB_COINOUTPUTS, txid), static_cast<uint32_t>(coins.vout.size()));
+            }
             changed++;
         }
         count++;
@@ -96,10 +221,62 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     if (hashBlock != uint256(0))
         BatchWriteHashBestChain(batch, hashBlock);
 
-    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    LogPrint("coindb", "Committing %u changed outputs of %u changed transactions (out of %u) to coin database...\n",
+             (unsigned int)changedOutputs, (unsigned int)changed, (unsigned int)count);
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::Upgrade()
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << std::make_pair(DB_COINS, uint256(0));
+    pcursor->Seek(ssKeySet.str());
+    std::pair<char, uint256> key;
+    if (!pcursor->Valid() || !GetKey(pcursor->key(), key) || key.first != DB_COINS)
+        return true;
+
+    LogPrintf("Upgrading chainstate database to per-output records...\n");
+    CLevelDBBatch batch;
+    size_t nTransactions = 0;
+    size_t nBatched = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (!GetKey(pcursor->key(), key) || key.first != DB_COINS)
+            break;
+        try {
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CCoins coins;
+            ssValue >> coins;
+            for (unsigned int n = 0; n < coins.vout.size(); n++) {
+                if (!coins.vout[n].IsNull())
+                    batch.Write(std::make_pair(DB_COIN, COutPoint(key.second, n)), CCoinsOutputRecord(coins, n));
+            }
+            if (!coins.IsPruned())
+                batch.Write(std::make_pair(DB_COINOUTPUTS, key.second), static_cast<uint32_t>(coins.vout.size()));
+        } catch (std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+        // The old record goes in the same batch as its replacements, so an
+        // interrupted upgrade resumes cleanly on the next start.
+        batch.Erase(key);
+        nTransactions++;
+        if (++nBatched == UPGRADE_TRANSACTIONS_PER_BATCH) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch = CLevelDBBatch();
+            nBatched = 0;
+            LogPrintf("Upgraded %u transactions...\n", (unsigned int)nTransactions);
+        }
+        pcursor->Next();
+    }
+    if (!db.WriteBatch(batch))
+        return false;
+    LogPrintf("Chainstate upgrade complete: %u transactions converted\n", (unsigned int)nTransactions);
+    return true;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe)
 {
 }
@@ -154,6 +331,7 @@ bool CCoinsViewDB::GetStats(CCoinsStats& stats) const
     stats.hashBlock = GetBestBlock();
     ss << stats.hashBlock;
     CAmount nTotalAmount = 0;
+    uint256 currentTxid;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         try {
@@ -161,35 +339,36 @@ bool CCoinsViewDB::GetStats(CCoinsStats& stats) const
             CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
             char chType;
             ssKey >> chType;
-            if (chType == DB_COINS) {
+            if (chType == DB_COIN) {
                 leveldb::Slice slValue = pcursor->value();
                 CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CCoins coins;
-                ssValue >> coins;
-                uint256 txhash;
-                ssKey >> txhash;
-                ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
-                stats.nTransactions++;
-                for (unsigned int i = 0; i < coins.vout.size(); i++) {
-                    const CTxOut& out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i + 1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
+                CCoinsOutputRecord record;
+                ssValue >> record;
+                COutPoint outpoint;
+                ssKey >> outpoint;
+                if (outpoint.hash != currentTxid) {
+                    if (stats.nTransactions > 0)
+                        ss << VARINT(0);
+                    currentTxid = outpoint.hash;
+                    ss << currentTxid;
+                    ss << VARINT(record.nVersion);
+                    ss << (record.fCoinBase ? 'c' : 'n');
+                    ss << VARINT(record.nHeight);
+                    stats.nTransactions++;
                 }
-                stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
+                stats.nTransactionOutputs++;
+                ss << VARINT(outpoint.n + 1);
+                ss << record.out;
+                nTotalAmount += record.out.nValue;
+                stats.nSerializedSize += slKey.size() + slValue.size();
             }
             pcursor->Next();
         } catch (std::exception& e) {
             return error("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
     }
+    if (stats.nTransactions > 0)
+        ss << VARINT(0);
     stats.nHeight = mapBlockIndex.find(GetBestBlock())->second->nHeight;
     stats.hashSerialized = ss.GetHash();
     stats.nTotalAmount = nTotalAmount;
@@ -321,16 +500,6 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
     return WriteBatch(batch);
 }
 
-template<typename K> bool GetKey(leveldb::Slice slKey, K& key) {
-    try {
-        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-        ssKey >> key;
-    } catch (const std::exception&) {
-        return false;
-    }
-    return true;
-}
-
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
@@ -44,6 +44,9 @@ public:
     uint256 GetBestBlock() const override;
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
     bool GetStats(CCoinsStats& stats) const override;
+
+    //! Convert per-transaction DB_COINS records left by older versions into per-output records
+    bool Upgrade();
 };
 
 /** Access to the block database (blocks/index/) */
@@ -7,15 +7,19 @@
 #include "txmempool.h"
 
 #include "clientversion.h"
+#include "core_memusage.h"
 #include "main.h"
+#include "random.h"
 #include "streams.h"
 #include "Logging.h"
 #include "utilmoneystr.h"
+#include "utiltime.h"
 #include "version.h"
 #include <UtxoCheckingAndUpdating.h>
 #include <chainparams.h>
 
 #include <boost/circular_buffer.hpp>
+#include <cmath>
 
 
 #include "FeeAndPriorityCalculator.h"
@@ -23,16 +27,27 @@
 
 using namespace std;
 
-CTxMemPoolEntry::CTxMemPoolEntry() : nFee(0), nTxSize(0), nModSize(0), nTime(0), dPriority(0.0)
+CTxMemPoolEntry::CTxMemPoolEntry() : nFee(0), nTxSize(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0), feeDelta(0),
+    nCountWithDescendants(1), nSizeWithDescendants(0), nModFeesWithDescendants(0),
+    nCountWithAncestors(1), nSizeWithAncestors(0), nModFeesWithAncestors(0)
 {
     nHeight = MEMPOOL_HEIGHT;
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight) : tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight)
+CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight) : tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight), feeDelta(0)
 {
     nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
 
     nModSize = FeeAndPriorityCalculator::instance().CalculateModifiedSize(tx,nTxSize);
+    nUsageSize = RecursiveDynamicUsage(tx);
+
+    nCountWithDescendants = 1;
+    nSizeWithDescendants = nTxSize;
+    nModFeesWithDescendants = nFee;
+
+    nCountWithAncestors = 1;
+    nSizeWithAncestors = nTxSize;
+    nModFeesWithAncestors = nFee;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
@@ -40,6 +55,35 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
     *this = other;
 }
 
+void CTxMemPoolEntry::UpdateFeeDelta(CAmount newFeeDelta)
+{
+    nModFeesWithDescendants += newFeeDelta - feeDelta;
+    nModFeesWithAncestors += newFeeDelta - feeDelta;
+    feeDelta = newFeeDelta;
+}
+
+void CTxMemPoolEntry::UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithDescendants += modifySize;
+    assert(int64_t(nSizeWithDescendants) > 0);
+    nModFeesWithDescendants += modifyFee;
+    nCountWithDescendants += modifyCount;
+    assert(int64_t(nCountWithDescendants) > 0);
+}
+
+void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithAncestors += modifySize;
+    assert(int64_t(nSizeWithAncestors) > 0);
+    nModFeesWithAncestors += modifyFee;
+    nCountWithAncestors += modifyCount;
+    assert(int64_t(nCountWithAncestors) > 0);
+}
+
+mempoolentry_txid_hasher::mempoolentry_txid_hasher(): salt(GetRand(std::numeric_limits<uint64_t>::max()))
+{
+}
+
 double
 CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
 {
@@ -365,6 +409,9 @@ CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee,
                        const bool& addressIndex, const bool& spentIndex)
     : nTransactionsUpdated(0),
       minRelayFee(_minRelayFee),
+      totalTxSize(0), cachedInnerUsage(0),
+      rollingMinimumFeeRate(0), lastRollingFeeUpdate(GetTime()), blockSinceLastRollingFeeBump(false),
+      nTransactionsEvicted(0), nTransactionsExpired(0),
       fAddressIndex_(addressIndex), fSpentIndex_(spentIndex)
 {
     // Sanity checks off by default for performance, because otherwise
@@ -418,14 +465,57 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry,
     // all the appropriate checks.
     LOCK(cs);
     {
-        mapTx[hash] = entry;
-        const auto* entryInMap = &mapTx[hash];
-        const CTransaction& tx = entryInMap->GetTx();
-        mapBareTxid.emplace(tx.GetBareTxid(), entryInMap);
-        for (unsigned int i = 0; i < tx.vin.size(); i++)
+        const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+        txiter newit = mapTx.insert(entry).first;
+        mapLinks.insert(make_pair(newit, TxLinks()));
+
+        // Update transaction for any feeDelta created by PrioritiseTransaction
+        std::map<uint256, std::pair<double, CAmount> >::const_iterator pos = mapDeltas.find(hash);
+        if (pos != mapDeltas.end() && pos->second.second != 0)
+            mapTx.modify(newit, update_fee_delta(pos->second.second));
+
+        const CTransaction& tx = newit->GetTx();
+        mapBareTxid.emplace(tx.GetBareTxid(), &*newit);
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
             mapNextTx[tx.vin[i].prevout] = CInPoint(&tx, i);
+            txiter parentIt = mapTx.find(tx.vin[i].prevout.hash);
+            if (parentIt != mapTx.end()) {
+                UpdateParent(newit, parentIt, true);
+                UpdateChild(parentIt, newit, true);
+            }
+        }
+        // Transactions of a disconnected block can return underneath
+        // descendants that stayed in the pool.
+        for (auto it = mapNextTx.lower_bound(COutPoint(hash, 0)); it != mapNextTx.end() && it->first.hash == hash; ++it) {
+            txiter childIt = mapTx.find(it->second.ptx->GetHash());
+            assert(childIt != mapTx.end());
+            UpdateChild(newit, childIt, true);
+            UpdateParent(childIt, newit, true);
+        }
+
+        if (GetMemPoolChildren(newit).empty()) {
+            setEntries setAncestors;
+            std::string dummy;
+            CalculateMemPoolAncestors(*newit, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+            UpdateAncestorsOf(true, newit, setAncestors);
+            UpdateEntryForAncestors(newit, setAncestors);
+        } else {
+            // Every descendant gains ancestors and every ancestor of those
+            // descendants may gain descendants; recount them all.
+            setEntries setDescendants;
+            CalculateDescendants(newit, setDescendants);
+            setEntries setAffected = setDescendants;
+            for (txiter descendantIt : setDescendants) {
+                std::string dummy;
+                CalculateMemPoolAncestors(*descendantIt, setAffected, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+            }
+            for (txiter affectedIt : setAffected)
+                RecalculatePackageState(affectedIt);
+        }
+
         nTransactionsUpdated++;
         totalTxSize += entry.GetTxSize();
+        cachedInnerUsage += entry.DynamicMemoryUsage();
     }
 
     // Add memory address index
@@ -585,9 +675,11 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
     // Remove transaction from memory pool
     {
         LOCK(cs);
-        std::deque<uint256> txToRemove;
-        txToRemove.push_back(origTx.GetHash());
-        if (fRecursive && !mapTx.count(origTx.GetHash())) {
+        setEntries txToRemove;
+        txiter origit = mapTx.find(origTx.GetHash());
+        if (origit != mapTx.end()) {
+            txToRemove.insert(origit);
+        } else if (fRecursive) {
             // If recursively removing but origTx isn't in the mempool
             // be sure to remove any children that are in the pool. This can
             // happen during chain re-orgs if origTx isn't re-accepted into
@@ -596,36 +688,21 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
                 std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(COutPoint(origTx.GetHash(), i));
                 if (it == mapNextTx.end())
                     continue;
-                txToRemove.push_back(it->second.ptx->GetHash());
+                txiter nextit = mapTx.find(it->second.ptx->GetHash());
+                assert(nextit != mapTx.end());
+                txToRemove.insert(nextit);
             }
         }
-        while (!txToRemove.empty()) {
-            const uint256 hash = txToRemove.front();
-            txToRemove.pop_front();
-            if (!mapTx.count(hash))
-                continue;
-
-            removeAddressIndex(hash);
-            removeSpentIndex(hash);
-
-            const CTransaction& tx = mapTx[hash].GetTx();
-            if (fRecursive) {
-                for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                    std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(COutPoint(hash, i));
-                    if (it == mapNextTx.end())
-                        continue;
-                    txToRemove.push_back(it->second.ptx->GetHash());
-                }
-            }
-            mapBareTxid.erase(tx.GetBareTxid());
-            for (const auto& txin : tx.vin)
-                mapNextTx.erase(txin.prevout);
-
-            removed.push_back(tx);
-            totalTxSize -= mapTx[hash].GetTxSize();
-            mapTx.erase(hash);
-            nTransactionsUpdated++;
+        setEntries setAllRemoves;
+        if (fRecursive) {
+            for (txiter it : txToRemove)
+                CalculateDescendants(it, setAllRemoves);
+        } else {
+            setAllRemoves.swap(txToRemove);
         }
+        for (txiter it : setAllRemoves)
+            removed.push_back(it->GetTx());
+        RemoveStaged(setAllRemoves, !fRecursive);
     }
 }
 
@@ -634,8 +711,8 @@ void CTxMemPool::removeCoinbaseSpends(const CCoinsViewCache* pcoins, unsigned in
     // Remove transactions spending a coinbase which are now immature
     LOCK(cs);
     list<CTransaction> transactionsToRemove;
-    for (const auto& entry : mapTx) {
-        const CTransaction& tx = entry.second.GetTx();
+    for (const CTxMemPoolEntry& entry : mapTx) {
+        const CTransaction& tx = entry.GetTx();
         for (const auto& txin : tx.vin) {
             CTransaction tx2;
             if (lookupOutpoint(txin.prevout.hash, tx2))
@@ -678,9 +755,9 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
     LOCK(cs);
     std::vector<CTxMemPoolEntry> entries;
     BOOST_FOREACH (const CTransaction& tx, vtx) {
-        uint256 hash = tx.GetHash();
-        if (mapTx.count(hash))
-            entries.push_back(mapTx[hash]);
+        txiter i = mapTx.find(tx.GetHash());
+        if (i != mapTx.end())
+            entries.push_back(*i);
     }
     minerPolicyEstimator->seenBlock(entries, nBlockHeight, minRelayFee);
     BOOST_FOREACH (const CTransaction& tx, vtx) {
@@ -689,16 +766,20 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
         removeConflicts(tx, conflicts);
         ClearPrioritisation(tx.GetHash());
     }
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = true;
 }
 
 
 void CTxMemPool::clear()
 {
     LOCK(cs);
+    mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
     mapBareTxid.clear();
     totalTxSize = 0;
+    cachedInnerUsage = 0;
     ++nTransactionsUpdated;
 }
 
@@ -710,22 +791,31 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins, const BlockMap& blockIndex
     LogPrint("mempool", "Checking mempool with %u transactions and %u inputs\n", (unsigned int)mapTx.size(), (unsigned int)mapNextTx.size());
 
     uint64_t checkTotal = 0;
+    uint64_t innerUsage = 0;
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
 
     CCoinsViewCache mempoolDuplicate(const_cast<CCoinsViewCache*>(pcoins));
 
     LOCK(cs);
     list<const CTxMemPoolEntry*> waitingOnDependants;
-    for (const auto& entry : mapTx) {
+    for (txiter it = mapTx.begin(); it != mapTx.end(); it++) {
         unsigned int i = 0;
-        checkTotal += entry.second.GetTxSize();
-        const CTransaction& tx = entry.second.GetTx();
+        checkTotal += it->GetTxSize();
+        innerUsage += it->DynamicMemoryUsage();
+        const CTransaction& tx = it->GetTx();
+        const txlinksMap::const_iterator linksiter = mapLinks.find(it);
+        assert(linksiter != mapLinks.end());
+        const TxLinks &links = linksiter->second;
+        innerUsage += memusage::DynamicUsage(links.parents) + memusage::DynamicUsage(links.children);
         bool fDependsWait = false;
+        setEntries setParentCheck;
         for (const auto& txin : tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
             CTransaction tx2;
             if (lookupOutpoint(txin.prevout.hash, tx2)) {
                 assert(tx2.vout.size() > txin.prevout.n && !tx2.vout[txin.prevout.n].IsNull());
                 fDependsWait = true;
+                setParentCheck.insert(mapTx.find(txin.prevout.hash));
             } else {
                 const CCoins* coins = pcoins->AccessCoins(txin.prevout.hash);
                 assert(coins && coins->IsAvailable(txin.prevout.n));
@@ -737,8 +827,46 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins, const BlockMap& blockIndex
             assert(mit->second.n == i);
             i++;
         }
+        assert(setParentCheck == GetMemPoolParents(it));
+        // Verify ancestor state is correct.
+        setEntries setAncestors;
+        std::string dummy;
+        CalculateMemPoolAncestors(*it, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy);
+        uint64_t nCountCheck = setAncestors.size() + 1;
+        uint64_t nSizeCheck = it->GetTxSize();
+        CAmount nFeesCheck = it->GetModifiedFee();
+        for (txiter ancestorIt : setAncestors) {
+            nSizeCheck += ancestorIt->GetTxSize();
+            nFeesCheck += ancestorIt->GetModifiedFee();
+        }
+        assert(it->GetCountWithAncestors() == nCountCheck);
+        assert(it->GetSizeWithAncestors() == nSizeCheck);
+        assert(it->GetModFeesWithAncestors() == nFeesCheck);
+
+        // Check children against mapNextTx
+        setEntries setChildrenCheck;
+        const uint256 hash = tx.GetHash();
+        for (auto iter = mapNextTx.lower_bound(COutPoint(hash, 0)); iter != mapNextTx.end() && iter->first.hash == hash; ++iter) {
+            txiter childit = mapTx.find(iter->second.ptx->GetHash());
+            assert(childit != mapTx.end()); // mapNextTx points to in-mempool transactions
+            setChildrenCheck.insert(childit);
+        }
+        assert(setChildrenCheck == GetMemPoolChildren(it));
+        // Verify descendant state is correct.
+        setEntries setDescendants;
+        CalculateDescendants(it, setDescendants);
+        nSizeCheck = 0;
+        nFeesCheck = 0;
+        for (txiter descendantIt : setDescendants) {
+            nSizeCheck += descendantIt->GetTxSize();
+            nFeesCheck += descendantIt->GetModifiedFee();
+        }
+        assert(it->GetCountWithDescendants() == setDescendants.size());
+        assert(it->GetSizeWithDescendants() == nSizeCheck);
+        assert(it->GetModFeesWithDescendants() == nFeesCheck);
+
         if (fDependsWait)
-            waitingOnDependants.push_back(&entry.second);
+            waitingOnDependants.push_back(&(*it));
         else {
             CValidationState state;
             CTxUndo undo;
@@ -766,13 +894,15 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins, const BlockMap& blockIndex
         const uint256 hash = entry.second.ptx->GetHash();
         const auto mit = mapTx.find(hash);
         assert(mit != mapTx.end());
-        const CTransaction& tx = mit->second.GetTx();
+        const CTransaction& tx = mit->GetTx();
         assert(&tx == entry.second.ptx);
         assert(tx.vin.size() > entry.second.n);
         assert(entry.first == entry.second.ptx->vin[entry.second.n].prevout);
     }
 
     assert(totalTxSize == checkTotal);
+    assert(innerUsage == cachedInnerUsage);
+    assert(mapLinks.size() == mapTx.size());
 }
 
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
@@ -781,16 +911,16 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
 
     LOCK(cs);
     vtxid.reserve(mapTx.size());
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
-        vtxid.push_back((*mi).first);
+    for (const CTxMemPoolEntry& entry : mapTx)
+        vtxid.push_back(entry.GetTx().GetHash());
 }
 
 bool CTxMemPool::lookup(const uint256& hash, CTransaction& result) const
 {
     LOCK(cs);
-    map<uint256, CTxMemPoolEntry>::const_iterator i = mapTx.find(hash);
+    txiter i = mapTx.find(hash);
     if (i == mapTx.end()) return false;
-    result = i->second.GetTx();
+    result = i->GetTx();
     return true;
 }
 
@@ -859,6 +989,10 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash, const string strHash,
         std::pair<double, CAmount>& deltas = mapDeltas[hash];
         deltas.first += dPriorityDelta;
         deltas.second += nFeeDelta;
+        txiter it = mapTx.find(hash);
+        if (it != mapTx.end())
+            ApplyFeeDeltaChange(it, deltas.second);
+        ++nTransactionsUpdated;
     }
     LogPrintf("PrioritiseTransaction: %s priority += %f, fee += %d\n", strHash, dPriorityDelta, FormatMoney(nFeeDelta));
 }
@@ -878,6 +1012,383 @@ void CTxMemPool::ClearPrioritisation(const uint256 hash)
 {
     LOCK(cs);
     mapDeltas.erase(hash);
+    txiter it = mapTx.find(hash);
+    if (it != mapTx.end() && it->GetModifiedFee() != it->GetFee())
+        ApplyFeeDeltaChange(it, 0);
+}
+
+void CTxMemPool::ApplyFeeDeltaChange(txiter it, CAmount nFeeDelta)
+{
+    AssertLockHeld(cs);
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    const CAmount nChange = nFeeDelta - (it->GetModifiedFee() - it->GetFee());
+    mapTx.modify(it, update_fee_delta(nFeeDelta));
+
+    // Now update all ancestors' modified fees with descendants
+    setEntries setAncestors;
+    std::string dummy;
+    CalculateMemPoolAncestors(*it, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+    for (txiter ancestorIt : setAncestors)
+        mapTx.modify(ancestorIt, update_descendant_state(0, nChange, 0));
+
+    // ... and all descendants' modified fees with ancestors
+    setEntries setDescendants;
+    CalculateDescendants(it, setDescendants);
+    setDescendants.erase(it);
+    for (txiter descendantIt : setDescendants)
+        mapTx.modify(descendantIt, update_ancestor_state(0, nChange, 0));
+}
+
+const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
+{
+    assert (entry != mapTx.end());
+    txlinksMap::const_iterator it = mapLinks.find(entry);
+    assert(it != mapLinks.end());
+    return it->second.parents;
+}
+
+const CTxMemPool::setEntries & CTxMemPool::GetMemPoolChildren(txiter entry) const
+{
+    assert (entry != mapTx.end());
+    txlinksMap::const_iterator it = mapLinks.find(entry);
+    assert(it != mapLinks.end());
+    return it->second.children;
+}
+
+void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+{
+    setEntries s;
+    if (add && mapLinks[entry].children.insert(child).second) {
+        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
+    } else if (!add && mapLinks[entry].children.erase(child)) {
+        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    }
+}
+
+void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
+{
+    setEntries s;
+    if (add && mapLinks[entry].parents.insert(parent).second) {
+        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
+    } else if (!add && mapLinks[entry].parents.erase(parent)) {
+        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    }
+}
+
+bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents) const
+{
+    LOCK(cs);
+
+    setEntries parentHashes;
+    const CTransaction &tx = entry.GetTx();
+
+    if (fSearchForParents) {
+        // Get parents of this transaction that are in the mempool
+        // GetMemPoolParents() is only valid for entries in the mempool, so we
+        // iterate mapTx to find parents.
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            txiter piter = mapTx.find(tx.vin[i].prevout.hash);
+            if (piter != mapTx.end()) {
+                parentHashes.insert(piter);
+                if (parentHashes.size() + 1 > limitAncestorCount) {
+                    errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
+                    return false;
+                }
+            }
+        }
+    } else {
+        // If we're not searching for parents, we require this to be an
+        // entry in the mempool already.
+        txiter it = mapTx.iterator_to(entry);
+        parentHashes = GetMemPoolParents(it);
+    }
+
+    size_t totalSizeWithAncestors = entry.GetTxSize();
+
+    while (!parentHashes.empty()) {
+        txiter stageit = *parentHashes.begin();
+
+        setAncestors.insert(stageit);
+        parentHashes.erase(stageit);
+        totalSizeWithAncestors += stageit->GetTxSize();
+
+        if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
+            errString = strprintf("exceeds descendant size limit for tx %s [limit: %u]", stageit->GetTx().GetHash().ToString(), limitDescendantSize);
+            return false;
+        } else if (stageit->GetCountWithDescendants() + 1 > limitDescendantCount) {
+            errString = strprintf("too many descendants for tx %s [limit: %u]", stageit->GetTx().GetHash().ToString(), limitDescendantCount);
+            return false;
+        } else if (totalSizeWithAncestors > limitAncestorSize) {
+            errString = strprintf("exceeds ancestor size limit [limit: %u]", limitAncestorSize);
+            return false;
+        }
+
+        const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
+        for (const txiter &phash : setMemPoolParents) {
+            // If this is a new ancestor, add it.
+            if (setAncestors.count(phash) == 0) {
+                parentHashes.insert(phash);
+            }
+            if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
+                errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
+{
+    setEntries parentIters = GetMemPoolParents(it);
+    // add or remove this tx as a child of each parent
+    for (txiter piter : parentIters) {
+        UpdateChild(piter, it, add);
+    }
+    const int64_t updateCount = (add ? 1 : -1);
+    const int64_t updateSize = updateCount * it->GetTxSize();
+    const CAmount updateFee = updateCount * it->GetModifiedFee();
+    for (txiter ancestorIt : setAncestors) {
+        mapTx.modify(ancestorIt, update_descendant_state(updateSize, updateFee, updateCount));
+    }
+}
+
+void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncestors)
+{
+    int64_t updateCount = setAncestors.size();
+    int64_t updateSize = 0;
+    CAmount updateFee = 0;
+    for (txiter ancestorIt : setAncestors) {
+        updateSize += ancestorIt->GetTxSize();
+        updateFee += ancestorIt->GetModifiedFee();
+    }
+    mapTx.modify(it, update_ancestor_state(updateSize, updateFee, updateCount));
+}
+
+void CTxMemPool::UpdateChildrenForRemoval(txiter it)
+{
+    const setEntries &setMemPoolChildren = GetMemPoolChildren(it);
+    for (txiter updateIt : setMemPoolChildren) {
+        UpdateParent(updateIt, it, false);
+    }
+}
+
+void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants)
+{
+    // For each entry, walk back all ancestors and decrement size associated with this
+    // transaction
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    if (updateDescendants) {
+        // updateDescendants should be true whenever we're not recursively
+        // removing a tx and all its descendants, eg when a transaction is
+        // confirmed in a block.
+        // Here we only update statistics and not data in mapLinks (which
+        // we need to preserve until we're finished with all operations that
+        // need to traverse the mempool).
+        for (txiter removeIt : entriesToRemove) {
+            setEntries setDescendants;
+            CalculateDescendants(removeIt, setDescendants);
+            setDescendants.erase(removeIt); // don't update state for self
+            int64_t modifySize = -((int64_t)removeIt->GetTxSize());
+            CAmount modifyFee = -removeIt->GetModifiedFee();
+            for (txiter dit : setDescendants) {
+                mapTx.modify(dit, update_ancestor_state(modifySize, modifyFee, -1));
+            }
+        }
+    }
+    for (txiter removeIt : entriesToRemove) {
+        setEntries setAncestors;
+        const CTxMemPoolEntry &entry = *removeIt;
+        std::string dummy;
+        // Since this is a tx that is already in the mempool, we can call CMPA
+        // with fSearchForParents = false.  If the mempool is in a consistent
+        // state, then using true or false should both be correct, though false
+        // should be a bit faster.
+        CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+        // Note that UpdateAncestorsOf severs the child links that point to
+        // removeIt in the entries for the parents of removeIt.
+        UpdateAncestorsOf(false, removeIt, setAncestors);
+    }
+    // After updating all the ancestor sizes, we can now sever the link between each
+    // transaction being removed and any mempool children (ie, update setMemPoolParents
+    // for each direct child of a transaction being removed).
+    for (txiter removeIt : entriesToRemove) {
+        UpdateChildrenForRemoval(removeIt);
+    }
+}
+
+void CTxMemPool::RecalculatePackageState(txiter it)
+{
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    setEntries setAncestors;
+    std::string dummy;
+    CalculateMemPoolAncestors(*it, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+    int64_t nSizeWithAncestors = it->GetTxSize();
+    CAmount nFeesWithAncestors = it->GetModifiedFee();
+    for (txiter ancestorIt : setAncestors) {
+        nSizeWithAncestors += ancestorIt->GetTxSize();
+        nFeesWithAncestors += ancestorIt->GetModifiedFee();
+    }
+    mapTx.modify(it, update_ancestor_state(nSizeWithAncestors - (int64_t)it->GetSizeWithAncestors(),
+                                           nFeesWithAncestors - it->GetModFeesWithAncestors(),
+                                           (int64_t)setAncestors.size() + 1 - (int64_t)it->GetCountWithAncestors()));
+
+    setEntries setDescendants;
+    CalculateDescendants(it, setDescendants);
+    int64_t nSizeWithDescendants = 0;
+    CAmount nFeesWithDescendants = 0;
+    for (txiter descendantIt : setDescendants) {
+        nSizeWithDescendants += descendantIt->GetTxSize();
+        nFeesWithDescendants += descendantIt->GetModifiedFee();
+    }
+    mapTx.modify(it, update_descendant_state(nSizeWithDescendants - (int64_t)it->GetSizeWithDescendants(),
+                                             nFeesWithDescendants - it->GetModFeesWithDescendants(),
+                                             (int64_t)setDescendants.size() - (int64_t)it->GetCountWithDescendants()));
+}
+
+void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants) const
+{
+    setEntries stage;
+    if (setDescendants.count(entryit) == 0) {
+        stage.insert(entryit);
+    }
+    // Traverse down the children of entry, only adding children that are not
+    // accounted for in setDescendants already (because those children have either
+    // already been walked, or will be walked in this iteration).
+    while (!stage.empty()) {
+        txiter it = *stage.begin();
+        setDescendants.insert(it);
+        stage.erase(it);
+
+        const setEntries &setChildren = GetMemPoolChildren(it);
+        for (const txiter &childiter : setChildren) {
+            if (!setDescendants.count(childiter)) {
+                stage.insert(childiter);
+            }
+        }
+    }
+}
+
+void CTxMemPool::removeUnchecked(txiter it)
+{
+    const uint256 hash = it->GetTx().GetHash();
+    removeAddressIndex(hash);
+    removeSpentIndex(hash);
+
+    const CTransaction& tx = it->GetTx();
+    for (const auto& txin : tx.vin)
+        mapNextTx.erase(txin.prevout);
+    mapBareTxid.erase(tx.GetBareTxid());
+
+    totalTxSize -= it->GetTxSize();
+    cachedInnerUsage -= it->DynamicMemoryUsage();
+    cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
+    mapLinks.erase(it);
+    mapTx.erase(it);
+    nTransactionsUpdated++;
+}
+
+void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants)
+{
+    AssertLockHeld(cs);
+    UpdateForRemoveFromMempool(stage, updateDescendants);
+    for (const txiter& it : stage) {
+        removeUnchecked(it);
+    }
+}
+
+size_t CTxMemPool::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() +
+           memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) +
+           memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(mapBareTxid) +
+           memusage::DynamicUsage(mapAddress) + memusage::DynamicUsage(mapAddressInserted) +
+           memusage::DynamicUsage(mapSpent) + memusage::DynamicUsage(mapSpentInserted) +
+           cachedInnerUsage;
+}
+
+CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const
+{
+    LOCK(cs);
+    if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
+        return CFeeRate(static_cast<CAmount>(rollingMinimumFeeRate));
+
+    const int64_t time = GetTime();
+    if (time > lastRollingFeeUpdate + 10) {
+        double halflife = ROLLING_FEE_HALFLIFE;
+        const size_t usage = DynamicMemoryUsage();
+        if (usage < sizelimit / 4)
+            halflife /= 4;
+        else if (usage < sizelimit / 2)
+            halflife /= 2;
+
+        rollingMinimumFeeRate = rollingMinimumFeeRate / pow(2.0, (time - lastRollingFeeUpdate) / halflife);
+        lastRollingFeeUpdate = time;
+
+        if (rollingMinimumFeeRate < (double)minRelayFee.GetFeePerK() / 2) {
+            rollingMinimumFeeRate = 0;
+            return CFeeRate(0);
+        }
+    }
+    return std::max(CFeeRate(static_cast<CAmount>(rollingMinimumFeeRate)), minRelayFee);
+}
+
+void CTxMemPool::trackPackageRemoved(const CFeeRate& rate)
+{
+    AssertLockHeld(cs);
+    if (rate.GetFeePerK() > rollingMinimumFeeRate) {
+        rollingMinimumFeeRate = rate.GetFeePerK();
+        blockSinceLastRollingFeeBump = false;
+    }
+}
+
+void CTxMemPool::TrimToSize(size_t sizelimit)
+{
+    LOCK(cs);
+
+    unsigned nTxnRemoved = 0;
+    CFeeRate maxFeeRateRemoved(0);
+    while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
+        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+
+        // We set the new mempool min fee to the feerate of the removed set, plus the
+        // minimum relay fee. This way, we don't allow txn to enter mempool with feerate
+        // equal to txn which were removed with no block in between.
+        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+        removed = CFeeRate(removed.GetFeePerK() + minRelayFee.GetFeePerK());
+        trackPackageRemoved(removed);
+        maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
+
+        setEntries stage;
+        CalculateDescendants(mapTx.project<0>(it), stage);
+        nTxnRemoved += stage.size();
+        RemoveStaged(stage, false);
+    }
+    nTransactionsEvicted += nTxnRemoved;
+
+    if (maxFeeRateRemoved > CFeeRate(0))
+        LogPrint("mempool", "Removed %u txn, rolling minimum fee bumped to %s\n", nTxnRemoved, maxFeeRateRemoved.ToString());
+}
+
+int CTxMemPool::Expire(int64_t time)
+{
+    LOCK(cs);
+    indexed_transaction_set::index<entry_time>::type::iterator it = mapTx.get<entry_time>().begin();
+    setEntries toremove;
+    while (it != mapTx.get<entry_time>().end() && it->GetTime() < time) {
+        toremove.insert(mapTx.project<0>(it));
+        it++;
+    }
+    setEntries stage;
+    for (txiter removeit : toremove) {
+        CalculateDescendants(removeit, stage);
+    }
+    RemoveStaged(stage, false);
+    nTransactionsExpired += stage.size();
+    return stage.size();
 }
 
 
@@ -8,6 +8,7 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <list>
+#include <set>
 
 #include "addressindex.h"
 #include "spentindex.h"
@@ -17,6 +18,10 @@
 #include "primitives/transaction.h"
 #include "sync.h"
 
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
 class BlockMap;
 class CAutoFile;
 
@@ -38,6 +43,13 @@ static const unsigned int MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
 /**
  * CTxMemPool stores these:
+ *
+ * Besides the transaction itself, each entry caches the size, modified fee
+ * (fee plus any prioritisation delta) and count of its package of in-mempool
+ * descendants, and of its package of in-mempool ancestors; both include the
+ * entry itself. CTxMemPool updates them whenever a relative enters or leaves
+ * the pool, so eviction and block assembly can rank packages without walking
+ * the dependency graph.
  */
 class CTxMemPoolEntry
 {
@@ -46,9 +58,19 @@ private:
     CAmount nFee;         //! Cached to avoid expensive parent-transaction lookups
     size_t nTxSize;       //! ... and avoid recomputing tx size
     size_t nModSize;      //! ... and modified size for priority
+    size_t nUsageSize;    //! ... and total memory usage
     int64_t nTime;        //! Local time when entering the mempool
     double dPriority;     //! Priority when entering the mempool
     unsigned int nHeight; //! Chain height when entering the mempool
+    CAmount feeDelta;     //! Used for determining the priority of the transaction for mining in a block
+
+    uint64_t nCountWithDescendants;  //! number of descendant transactions
+    uint64_t nSizeWithDescendants;   //! ... and size
+    CAmount nModFeesWithDescendants; //! ... and total fees (all including us)
+
+    uint64_t nCountWithAncestors;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
 
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight);
@@ -59,10 +81,177 @@ public:
     double GetPriority(unsigned int currentHeight) const;
     CAmount GetFee() const { return nFee; }
     size_t GetTxSize() const { return nTxSize; }
+    size_t DynamicMemoryUsage() const { return nUsageSize; }
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return nHeight; }
+    CAmount GetModifiedFee() const { return nFee + feeDelta; }
+
+    // Adjusts the descendant state, if this entry is not dirty.
+    void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    // Adjusts the ancestor state
+    void UpdateAncestorState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+    // Updates the fee delta used for mining priority score, and the
+    // modified fees with descendants and ancestors.
+    void UpdateFeeDelta(CAmount feeDelta);
+
+    uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
+    uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
+    CAmount GetModFeesWithDescendants() const { return nModFeesWithDescendants; }
+
+    uint64_t GetCountWithAncestors() const { return nCountWithAncestors; }
+    uint64_t GetSizeWithAncestors() const { return nSizeWithAncestors; }
+    CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
+};
+
+// Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
+struct update_descendant_state
+{
+    update_descendant_state(int64_t _modifySize, CAmount _modifyFee, int64_t _modifyCount) :
+        modifySize(_modifySize), modifyFee(_modifyFee), modifyCount(_modifyCount)
+    {}
+
+    void operator() (CTxMemPoolEntry &e)
+        { e.UpdateDescendantState(modifySize, modifyFee, modifyCount); }
+
+    private:
+        int64_t modifySize;
+        CAmount modifyFee;
+        int64_t modifyCount;
+};
+
+struct update_ancestor_state
+{
+    update_ancestor_state(int64_t _modifySize, CAmount _modifyFee, int64_t _modifyCount) :
+        modifySize(_modifySize), modifyFee(_modifyFee), modifyCount(_modifyCount)
+    {}
+
+    void operator() (CTxMemPoolEntry &e)
+        { e.UpdateAncestorState(modifySize, modifyFee, modifyCount); }
+
+    private:
+        int64_t modifySize;
+        CAmount modifyFee;
+        int64_t modifyCount;
+};
+
+struct update_fee_delta
+{
+    update_fee_delta(CAmount _feeDelta) : feeDelta(_feeDelta) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdateFeeDelta(feeDelta); }
+
+private:
+    CAmount feeDelta;
+};
+
+// extracts a TxMemPoolEntry's transaction hash
+struct mempoolentry_txid
+{
+    typedef uint256 result_type;
+    result_type operator() (const CTxMemPoolEntry &entry) const
+    {
+        return entry.GetTx().GetHash();
+    }
+};
+
+/** Hashes txids with a per-process secret, so peers cannot aim transactions at one bucket */
+class mempoolentry_txid_hasher
+{
+private:
+    uint64_t salt;
+
+public:
+    mempoolentry_txid_hasher();
+
+    size_t operator() (const uint256& txid) const
+    {
+        // splitmix64 finalizer
+        uint64_t h = txid.GetLow64() ^ salt;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return static_cast<size_t>(h ^ (h >> 31));
+    }
+};
+
+/** \class CompareTxMemPoolEntryByDescendantScore
+ *
+ *  Sort an entry by max(score/size of entry's tx, score/size with all descendants).
+ */
+class CompareTxMemPoolEntryByDescendantScore
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        bool fUseADescendants = UseDescendantScore(a);
+        bool fUseBDescendants = UseDescendantScore(b);
+
+        double aModFee = fUseADescendants ? a.GetModFeesWithDescendants() : a.GetModifiedFee();
+        double aSize = fUseADescendants ? a.GetSizeWithDescendants() : a.GetTxSize();
+
+        double bModFee = fUseBDescendants ? b.GetModFeesWithDescendants() : b.GetModifiedFee();
+        double bSize = fUseBDescendants ? b.GetSizeWithDescendants() : b.GetTxSize();
+
+        // Avoid division by rewriting (a/b > c/d) as (a*d > c*b).
+        double f1 = aModFee * bSize;
+        double f2 = aSize * bModFee;
+
+        if (f1 == f2) {
+            return a.GetTime() >= b.GetTime();
+        }
+        return f1 < f2;
+    }
+
+    // Calculate which score to use for an entry (avoiding division).
+    bool UseDescendantScore(const CTxMemPoolEntry &a) const
+    {
+        double f1 = (double)a.GetModifiedFee() * a.GetSizeWithDescendants();
+        double f2 = (double)a.GetModFeesWithDescendants() * a.GetTxSize();
+        return f2 > f1;
+    }
 };
 
+class CompareTxMemPoolEntryByEntryTime
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        return a.GetTime() < b.GetTime();
+    }
+};
+
+/** \class CompareTxMemPoolEntryByAncestorFee
+ *
+ *  Sort an entry by the fee rate of it together with all of its in-mempool
+ *  ancestors, highest first; this is the fee rate a block gets for including it.
+ */
+class CompareTxMemPoolEntryByAncestorFee
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        double aFees = a.GetModFeesWithAncestors();
+        double aSize = a.GetSizeWithAncestors();
+
+        double bFees = b.GetModFeesWithAncestors();
+        double bSize = b.GetSizeWithAncestors();
+
+        // Avoid division by rewriting (a/b > c/d) as (a*d > c*b).
+        double f1 = aFees * bSize;
+        double f2 = aSize * bFees;
+
+        if (f1 == f2) {
+            return a.GetTx().GetHash() < b.GetTx().GetHash();
+        }
+
+        return f1 > f2;
+    }
+};
+
+// Multi_index tag names
+struct descendant_score {};
+struct entry_time {};
+struct ancestor_score {};
+
 class CMinerPolicyEstimator;
 
 /** An inpoint - a combination of a transaction and an index n into its vin */
@@ -95,6 +284,20 @@ public:
  * are added to the pool: if a new transaction double-spends
  * an input of a transaction in the pool, it is dropped,
  * as are non-standard transactions.
+ *
+ * mapTx is a boost::multi_index that sorts the mempool on 4 criteria:
+ * - transaction hash
+ * - descendant feerate [we use max(feerate of tx, feerate of tx with all descendants)]
+ * - time in mempool
+ * - ancestor feerate [the feerate of tx with all of its unconfirmed ancestors]
+ *
+ * Note: the term "descendant" refers to in-mempool transactions that depend on
+ * this one, while "ancestor" refers to in-mempool transactions that a given
+ * transaction depends on.
+ *
+ * mapLinks records each entry's in-mempool parents and children, so that the
+ * cached package state of every relative can be updated as entries are added
+ * and removed, without rescanning the pool.
  */
 class CTxMemPool
 {
@@ -105,6 +308,15 @@ private:
 
     CFeeRate minRelayFee; //! Passed to constructor to avoid dependency on main
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
+    uint64_t cachedInnerUsage; //! sum of dynamic memory usage of all the map elements (NOT the maps themselves)
+
+    /** Fee rate (per kB) a package must beat after an eviction; decays once blocks arrive */
+    mutable double rollingMinimumFeeRate;
+    mutable int64_t lastRollingFeeUpdate;
+    mutable bool blockSinceLastRollingFeeBump;
+
+    uint64_t nTransactionsEvicted; //! removed by TrimToSize since startup
+    uint64_t nTransactionsExpired; //! removed by Expire since startup
 
     /* The mempool reads these flags, which are passed by reference in the
        constructor and refer to the globals in main (normally at least).  */
@@ -136,9 +348,85 @@ private:
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool removeSpentIndex(const uint256& txhash);
 
+    void trackPackageRemoved(const CFeeRate& rate);
+
 public:
+    typedef boost::multi_index_container<
+        CTxMemPoolEntry,
+        boost::multi_index::indexed_by<
+            // sorted by txid
+            boost::multi_index::hashed_unique<mempoolentry_txid, mempoolentry_txid_hasher>,
+            // sorted by fee rate
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<descendant_score>,
+                boost::multi_index::identity<CTxMemPoolEntry>,
+                CompareTxMemPoolEntryByDescendantScore
+            >,
+            // sorted by entry time
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<entry_time>,
+                boost::multi_index::identity<CTxMemPoolEntry>,
+                CompareTxMemPoolEntryByEntryTime
+            >,
+            // sorted by fee rate with ancestors
+            boost::multi_index::ordered_non_unique<
+                boost::multi_index::tag<ancestor_score>,
+                boost::multi_index::identity<CTxMemPoolEntry>,
+                CompareTxMemPoolEntryByAncestorFee
+            >
+        >
+    > indexed_transaction_set;
+
     mutable CCriticalSection cs;
-    std::map<uint256, CTxMemPoolEntry> mapTx;
+    indexed_transaction_set mapTx;
+    typedef indexed_transaction_set::nth_index<0>::type::iterator txiter;
+    struct CompareIteratorByHash {
+        bool operator()(const txiter &a, const txiter &b) const {
+            return a->GetTx().GetHash() < b->GetTx().GetHash();
+        }
+    };
+    typedef std::set<txiter, CompareIteratorByHash> setEntries;
+
+    const setEntries & GetMemPoolParents(txiter entry) const;
+    const setEntries & GetMemPoolChildren(txiter entry) const;
+private:
+    struct TxLinks {
+        setEntries parents;
+        setEntries children;
+    };
+
+    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
+    txlinksMap mapLinks;
+
+    void UpdateParent(txiter entry, txiter parent, bool add);
+    void UpdateChild(txiter entry, txiter child, bool add);
+
+    /** Set ancestor state for an entry from its full set of in-mempool ancestors */
+    void UpdateEntryForAncestors(txiter it, const setEntries &setAncestors);
+    /** Update ancestors of hash to add/remove it as a descendant transaction. */
+    void UpdateAncestorsOf(bool add, txiter hash, setEntries &setAncestors);
+    /** For each transaction being removed, update ancestors and any direct children.
+      * If updateDescendants is true, then also update in-mempool descendants'
+      * ancestor state. */
+    void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants);
+    /** Sever link between specified transaction and direct children. */
+    void UpdateChildrenForRemoval(txiter entry);
+    /** Recompute the ancestor and descendant state of an entry from scratch */
+    void RecalculatePackageState(txiter entry);
+    /** Change an entry's fee delta, and the modified fees of its packages */
+    void ApplyFeeDeltaChange(txiter it, CAmount nFeeDelta);
+
+    /** Before calling removeUnchecked for a given transaction,
+     *  UpdateForRemoveFromMempool must be called on the entire (dependent) set
+     *  of transactions being removed at the same time.  We use each
+     *  CTxMemPoolEntry's setMemPoolParents in order to walk ancestors of a
+     *  given transaction that is removed, so we can't remove intermediate
+     *  transactions in a chain before we've updated all the state for the
+     *  removal.
+     */
+    void removeUnchecked(txiter entry);
+
+public:
     std::map<COutPoint, CInPoint> mapNextTx;
 
     explicit CTxMemPool(const CFeeRate& _minRelayFee,
@@ -154,6 +442,11 @@ public:
     void check(const CCoinsViewCache* pcoins, const BlockMap& blockIndexMap) const;
     void setSanityCheck(bool _fSanityCheck) { fSanityCheck = _fSanityCheck; }
 
+    /**
+     * Add an entry, linking it to its in-mempool parents and to in-mempool
+     * children left behind by a disconnected block, and updating the cached
+     * package state of all of them.
+     */
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry, const CCoinsViewCache& view);
     void remove(const CTransaction& tx, std::list<CTransaction>& removed, bool fRecursive = false);
     void removeCoinbaseSpends(const CCoinsViewCache* pcoins, unsigned int nMemPoolHeight);
@@ -161,6 +454,31 @@ public:
     void removeForBlock(const std::vector<CTransaction>& vtx, unsigned int nBlockHeight, std::list<CTransaction>& conflicts);
     void clear();
     void queryHashes(std::vector<uint256>& vtxid);
+    /** Remove a set of transactions from the mempool.
+     *  If a transaction is in this set, then all in-mempool descendants must
+     *  also be in the set, unless this transaction is being removed for being
+     *  in a block.
+     *  Set updateDescendants to true when removing a tx that was in a block, so
+     *  that any in-mempool descendants have their ancestor state updated.
+     */
+    void RemoveStaged(setEntries &stage, bool updateDescendants);
+
+    /** Try to calculate all in-mempool ancestors of entry.
+     *  (these are all calculated including the tx itself)
+     *  limitAncestorCount = max number of ancestors
+     *  limitAncestorSize = max size of ancestors
+     *  limitDescendantCount = max number of descendants any ancestor can have
+     *  limitDescendantSize = max size of descendants any ancestor can have
+     *  errString = populated with error reason if any limits are hit
+     *  fSearchForParents = whether to search a tx's vin for in-mempool parents, or
+     *    look up parents from mapLinks. Must be true for entries not in the mempool
+     */
+    bool CalculateMemPoolAncestors(const CTxMemPoolEntry& entry, setEntries& setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string& errString, bool fSearchForParents = true) const;
+
+    /** Populate setDescendants with all in-mempool descendants of hash.
+     *  Assumes that setDescendants includes all in-mempool descendants of anything
+     *  already in it.  */
+    void CalculateDescendants(txiter it, setEntries& setDescendants) const;
     void pruneSpent(const uint256& hash, CCoins& coins);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
@@ -186,6 +504,37 @@ public:
         return totalTxSize;
     }
 
+    /** Memory used by the pool: its entries, their transactions and all indices */
+    size_t DynamicMemoryUsage() const;
+
+    /**
+     * The fee rate a transaction needs to enter a mempool limited to sizelimit
+     * bytes. It is raised whenever TrimToSize evicts a package, and halves every
+     * ROLLING_FEE_HALFLIFE seconds (faster while the pool is mostly empty) once a
+     * block has been connected since.
+     */
+    CFeeRate GetMinFee(size_t sizelimit) const;
+    static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12;
+
+    /**
+     * Evict the transactions with the lowest descendant fee rate, together with
+     * their descendants, until the pool uses at most sizelimit bytes.
+     */
+    void TrimToSize(size_t sizelimit);
+    /** Remove transactions which entered before time, and their descendants. Returns the number removed */
+    int Expire(int64_t time);
+
+    uint64_t GetEvictedCount() const
+    {
+        LOCK(cs);
+        return nTransactionsEvicted;
+    }
+    uint64_t GetExpiredCount() const
+    {
+        LOCK(cs);
+        return nTransactionsExpired;
+    }
+
     bool exists(const uint256& hash)
     {
         LOCK(cs);
@@ -20,20 +20,100 @@
 #include <boost/thread.hpp>
 #include <ActiveChainManager.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <vector>
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins */
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, bool fJustCheck, bool fAlreadyChecked = false);
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckMerkleRoot = true);
 
+extern int nScriptCheckThreads;
+
+namespace
+{
+/** Outcome of check levels 0 and 1 for one block, which need no chain state */
+struct CheckedBlock
+{
+    CBlockIndex* blockIndex;
+    CBlock block;
+    bool readFromDisk;
+    bool passedCheckBlock;
+};
+
+/** Number of blocks each verification thread is handed at a time */
+constexpr unsigned BLOCKS_TO_CHECK_PER_THREAD = 8u;
+
+// Reads and context-free checks the blocks from pindex back to minimumHeight (or
+// a thread-count dependent batch of them) on the script check threads.
+void ReadAndCheckBlocks(
+    CBlockIndex* pindex,
+    int minimumHeight,
+    int nCheckLevel,
+    std::vector<CheckedBlock>& checkedBlocks)
+{
+    const unsigned numberOfThreads = std::max(1, nScriptCheckThreads);
+    checkedBlocks.clear();
+    for (; pindex && pindex->pprev && pindex->nHeight >= minimumHeight; pindex = pindex->pprev) {
+        if (checkedBlocks.size() >= numberOfThreads * BLOCKS_TO_CHECK_PER_THREAD)
+            break;
+        checkedBlocks.emplace_back();
+        checkedBlocks.back().blockIndex = pindex;
+    }
+
+    // The helpers reference the batch, so they are always joined
+    boost::this_thread::disable_interruption noInterruptions;
+    const unsigned numberOfHelpers = std::min<unsigned>(numberOfThreads, checkedBlocks.size()) - 1u;
+    auto runOnAllThreads = [numberOfHelpers](const std::function<void()>& work) {
+        boost::thread_group helpers;
+        for (unsigned helper = 0; helper < numberOfHelpers; ++helper)
+            helpers.create_thread(work);
+        work();
+        helpers.join_all();
+    };
+
+    std::atomic<unsigned> nextBlockToRead(0u);
+    runOnAllThreads([&checkedBlocks, &nextBlockToRead, nCheckLevel]() {
+        for (unsigned index = nextBlockToRead++; index < checkedBlocks.size(); index = nextBlockToRead++) {
+            CheckedBlock& checkedBlock = checkedBlocks[index];
+            checkedBlock.readFromDisk = ReadBlockFromDisk(checkedBlock.block, checkedBlock.blockIndex);
+            checkedBlock.passedCheckBlock = checkedBlock.readFromDisk && nCheckLevel < 1;
+        }
+    });
+    if (nCheckLevel < 1)
+        return;
+
+    // CheckBlock hashes the headers of proof of work blocks
+    std::vector<CBlockHeader> headers;
+    for (const CheckedBlock& checkedBlock : checkedBlocks) {
+        if (checkedBlock.readFromDisk && checkedBlock.block.IsProofOfWork())
+            headers.push_back(checkedBlock.block.GetBlockHeader());
+    }
+    PrecomputeBlockHeaderHashes(headers);
+
+    std::atomic<unsigned> nextBlockToCheck(0u);
+    runOnAllThreads([&checkedBlocks, &nextBlockToCheck]() {
+        for (unsigned index = nextBlockToCheck++; index < checkedBlocks.size(); index = nextBlockToCheck++) {
+            CheckedBlock& checkedBlock = checkedBlocks[index];
+            CValidationState state;
+            checkedBlock.passedCheckBlock = checkedBlock.readFromDisk && CheckBlock(checkedBlock.block, state);
+        }
+    });
+}
+}
+
 CVerifyDB::CVerifyDB(
     const ActiveChainManager& chainManager,
     CChain& activeChain,
     CClientUIInterface& clientInterface,
-    const unsigned& coinsCacheSize,
+    const size_t& coinsCacheUsage,
     ShutdownListener shutdownListener
     ): chainManager_(chainManager)
     , activeChain_(activeChain)
     , clientInterface_(clientInterface)
-    , coinsCacheSize_(coinsCacheSize)
+    , coinsCacheUsage_(coinsCacheUsage)
     , shutdownListener_(shutdownListener)
 {
     clientInterface_.ShowProgress(translate("Verifying blocks..."), 0);
@@ -61,6 +141,8 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, CCoinsViewCache* pcoinsTip, int
     CBlockIndex* pindexFailure = NULL;
     int nGoodTransactions = 0;
     CValidationState state;
+    std::vector<CheckedBlock> checkedBlocks;
+    size_t nextCheckedBlock = 0;
     for (CBlockIndex* pindex = activeChain_.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
         boost::this_thread::interruption_point();
         const double fractionOfBlocksChecked = (double)(activeChain_.Height() - pindex->nHeight) / (double)nCheckDepth;
@@ -69,12 +151,18 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, CCoinsViewCache* pcoinsTip, int
         clientInterface_.ShowProgress(translate("Verifying blocks..."), progressValue);
         if (pindex->nHeight < activeChain_.Height() - nCheckDepth)
             break;
-        CBlock block;
+        if (nextCheckedBlock == checkedBlocks.size()) {
+            ReadAndCheckBlocks(pindex, activeChain_.Height() - nCheckDepth, nCheckLevel, checkedBlocks);
+            nextCheckedBlock = 0;
+        }
+        CheckedBlock& checkedBlock = checkedBlocks[nextCheckedBlock++];
+        assert(checkedBlock.blockIndex == pindex);
+        CBlock& block = checkedBlock.block;
         // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex))
+        if (!checkedBlock.readFromDisk)
             return error("VerifyDB() : *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash());
         // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state))
+        if (nCheckLevel >= 1 && !checkedBlock.passedCheckBlock)
             return error("VerifyDB() : *** found bad block at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash());
         // check level 2: verify undo validity
         if (nCheckLevel >= 2 && pindex) {
@@ -86,7 +174,7 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, CCoinsViewCache* pcoinsTip, int
             }
         }
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.GetCacheSize() + pcoinsTip->GetCacheSize()) <= coinsCacheSize_) {
+        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= coinsCacheUsage_) {
             bool fClean = true;
             if (!chainManager_.DisconnectBlock(block, state, pindex, coins, &fClean))
                 return error("VerifyDB() : *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash());
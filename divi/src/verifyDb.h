@@ -7,6 +7,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 #ifndef BITCOIN_VERIFYDB_H
 #define BITCOIN_VERIFYDB_H
+#include <stddef.h>
+
 class CCoinsView;
 class CChain;
 class CClientUIInterface;
@@ -22,14 +24,14 @@ private:
     const ActiveChainManager& chainManager_;
     CChain& activeChain_;
     CClientUIInterface& clientInterface_;
-    const unsigned& coinsCacheSize_;
+    const size_t& coinsCacheUsage_;
     ShutdownListener shutdownListener_;
 public:
     CVerifyDB(
         const ActiveChainManager& chainManager,
         CChain& activeChain,
         CClientUIInterface& clientInterface,
-        const unsigned& coinsCacheSize,
+        const size_t& coinsCacheUsage,
         ShutdownListener shutdownListener);
     ~CVerifyDB();
     bool VerifyDB(CCoinsView* coinsview, CCoinsViewCache* pcoinsTip, int nCheckLevel, int nCheckDepth);
@@ -35,6 +35,8 @@
 #include <Logging.h>
 #include <StakableCoin.h>
 #include <SpentOutputTracker.h>
+#include <StakableCoinIndex.h>
+#include <WalletBalanceLedger.h>
 #include <WalletTx.h>
 #include <WalletTransactionRecord.h>
 #include <StochasticSubsetSelectionAlgorithm.h>
@@ -171,6 +173,9 @@ CWallet::CWallet(const CChain& chain, const BlockMap& blockMap
     ): cs_wallet()
     , transactionRecord_(new WalletTransactionRecord(cs_wallet,strWalletFile) )
     , outputTracker_( new SpentOutputTracker(*transactionRecord_) )
+    , stakableCoins_( new StakableCoinIndex() )
+    , balanceLedger_( new WalletBalanceLedger() )
+    , checkBalanceLedger_(settings.GetBoolArg("-checkbalanceledger", Params().DefaultConsistencyChecks()))
     , chainActive_(chain)
     , mapBlockIndex_(blockMap)
     , orderedTransactionIndex()
@@ -202,6 +207,8 @@ CWallet::~CWallet()
     signatureSizeEstimator_.reset();
     delete pwalletdbEncryption;
     pwalletdbEncryption = NULL;
+    balanceLedger_.reset();
+    stakableCoins_.reset();
     outputTracker_.reset();
     transactionRecord_.reset();
 }
@@ -595,6 +602,8 @@ bool CWallet::AddHDPubKey(const CExtPubKey &extPubKey, bool fInternal)
     hdPubKey.hdchainID = hdChainCurrent.GetID();
     hdPubKey.nChangeIndex = fInternal ? 1 : 0;
     mapHdPubKeys[extPubKey.pubkey.GetID()] = hdPubKey;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
 
     // check if we need to remove from watch-only
     CScript script;
@@ -613,6 +622,8 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
         return false;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
 
     // check if we need to remove from watch-only
     CScript script;
@@ -635,6 +646,8 @@ bool CWallet::AddCryptedKey(const CPubKey& vchPubKey,
 {
     if (!CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret))
         return false;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
     if (!fFileBacked)
         return true;
     {
@@ -688,6 +701,8 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
     if (!fFileBacked)
         return true;
     return CWalletDB(settings,strWalletFile).WriteCScript(Hash160(redeemScript), redeemScript);
@@ -724,6 +739,8 @@ bool CWallet::RemoveVault(const CScript& vaultScript)
 {
     LOCK2(cs_KeyStore,cs_wallet);
     mapScripts.erase(vaultScript);
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
     if (!fFileBacked)
         return true;
     return CWalletDB(settings,strWalletFile).EraseCScript(Hash160(vaultScript));
@@ -734,6 +751,8 @@ bool CWallet::AddWatchOnly(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddWatchOnly(dest))
         return false;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
     nTimeFirstKey = 1; // No birthday information for watch-only keys.
     NotifyWatchonlyChanged(true);
     if (!fFileBacked)
@@ -746,6 +765,8 @@ bool CWallet::RemoveWatchOnly(const CScript& dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (fFileBacked)
@@ -764,6 +785,8 @@ bool CWallet::AddMultiSig(const CScript& dest)
 {
     if (!CCryptoKeyStore::AddMultiSig(dest))
         return false;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
     nTimeFirstKey = 1; // No birthday information
     NotifyMultiSigChanged(true);
     if (!fFileBacked)
@@ -776,6 +799,8 @@ bool CWallet::RemoveMultiSig(const CScript& dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveMultiSig(dest))
         return false;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
     if (!HaveMultiSig())
         NotifyMultiSigChanged(false);
     if (fFileBacked)
@@ -1198,6 +1223,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
 
         // Break debit/credit balance caches:
         wtx.RecomputeCachedQuantities();
+        UpdateStakableCoinIndex(wtx);
+        MarkBalanceLedgerDirty(wtx);
 
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, transactionHashIsNewToWallet ? CT_NEW : CT_UPDATED);
@@ -1489,6 +1516,11 @@ CAmount CWallet::GetStakingBalance() const
     return GetBalanceByCoinType(STAKABLE_COINS);
 }
 
+uint64_t CWallet::GetBalanceChangeCount() const
+{
+    return balanceLedger_->ChangeCount();
+}
+
 CAmount CWallet::GetSpendableBalance() const
 {
     return GetBalanceByCoinType(ALL_SPENDABLE_COINS);
@@ -1496,65 +1528,173 @@ CAmount CWallet::GetSpendableBalance() const
 
 CAmount CWallet::GetBalance() const
 {
-    CAmount nTotal = 0;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().trusted;
+}
+
+CAmount CWallet::GetBalanceByCoinType(AvailableCoinsType coinType) const
+{
+    LOCK2(cs_main, cs_wallet);
+    const WalletBalances balances = GetBalances();
+    switch(coinType)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (IsTrusted(*pcoin))
-                nTotal += GetAvailableCredit(*pcoin);
-        }
+    case ALL_SPENDABLE_COINS:
+        return balances.spendable;
+    case STAKABLE_COINS:
+        return balances.stakable;
+    case OWNED_VAULT_COINS:
+        return balances.ownedVaults;
     }
+    assert(false);
+    return 0;
+}
 
-    return nTotal;
+CAmount CWallet::GetUnconfirmedBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().unconfirmed;
 }
 
-CAmount CWallet::GetBalanceByCoinType(AvailableCoinsType coinType) const
+CAmount CWallet::GetImmatureBalance() const
 {
-    CAmount nTotal = 0;
+    LOCK2(cs_main, cs_wallet);
+    return GetBalances().immature;
+}
+
+static int CreditFiltersForCoinType(AvailableCoinsType coinType)
+{
+    int coinTypeEncoding = static_cast<int>(coinType) << 4;
+    int additionalFilterFlags = REQUIRE_UNSPENT | REQUIRE_AVAILABLE_TYPE | coinTypeEncoding;
+    if(coinType==STAKABLE_COINS) additionalFilterFlags |= REQUIRE_UNLOCKED;
+    return additionalFilterFlags;
+}
+
+/**
+ * The share of a transaction in each balance, computed the way the balance
+ * queries used to when they scanned the whole wallet.
+ */
+WalletBalances CWallet::ComputeBalanceContribution(const CWalletTx& wtx) const
+{
+    WalletBalances contribution;
+    const bool trusted = IsTrusted(wtx);
+    const CAmount availableCredit = GetAvailableCredit(wtx, false);
+    if (trusted)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (IsTrusted(*pcoin))
-            {
-                int coinTypeEncoding = static_cast<int>(coinType) << 4;
-                int additionalFilterFlags = REQUIRE_UNSPENT | REQUIRE_AVAILABLE_TYPE | coinTypeEncoding;
-                if(coinType==STAKABLE_COINS) additionalFilterFlags |= REQUIRE_UNLOCKED;
-                nTotal += ComputeCredit(*pcoin,ISMINE_SPENDABLE, additionalFilterFlags);
-            }
+        contribution.trusted = availableCredit;
+        contribution.spendable = ComputeCredit(wtx, ISMINE_SPENDABLE, CreditFiltersForCoinType(ALL_SPENDABLE_COINS));
+        contribution.stakable = ComputeCredit(wtx, ISMINE_SPENDABLE, CreditFiltersForCoinType(STAKABLE_COINS));
+        contribution.ownedVaults = ComputeCredit(wtx, ISMINE_SPENDABLE, CreditFiltersForCoinType(OWNED_VAULT_COINS));
+    }
+    if (!IsFinalTx(wtx, chainActive_) || (!trusted && wtx.GetNumberOfBlockConfirmations() == 0))
+        contribution.unconfirmed = availableCredit;
+    contribution.immature = GetImmatureCredit(wtx, false);
+    return contribution;
+}
 
-        }
+/**
+ * A contribution is volatile if it depends on the mempool, which can drop a
+ * transaction without telling the wallet: the transaction itself is only in
+ * the mempool, or one of its outputs is spent only by such a transaction.
+ */
+bool CWallet::BalanceContributionIsVolatile(const CWalletTx& wtx) const
+{
+    if (wtx.GetNumberOfBlockConfirmations() == 0 || !IsFinalTx(wtx, chainActive_))
+        return true;
+    const uint256 hash = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.vout.size(); i++)
+    {
+        if (outputTracker_->IsSpentOnlyInMempool(hash, i))
+            return true;
     }
+    return false;
+}
 
-    return nTotal;
+void CWallet::RecordBalanceContribution(const CWalletTx& wtx) const
+{
+    const int blocksToMaturity = wtx.GetBlocksToMaturity();
+    const int refreshHeight = (blocksToMaturity > 0 && wtx.IsInMainChain())
+        ? chainActive_.Height() + blocksToMaturity
+        : WalletBalanceLedger::NEVER;
+    balanceLedger_->Record(wtx.GetHash(), ComputeBalanceContribution(wtx), BalanceContributionIsVolatile(wtx), refreshHeight);
 }
 
-CAmount CWallet::GetUnconfirmedBalance() const
+/** A transaction changes the balances it contributes to, and those of the wallet outputs it spends */
+void CWallet::MarkBalanceLedgerDirty(const CWalletTx& wtx) const
 {
-    CAmount nTotal = 0;
+    AssertLockHeld(cs_wallet);
+    balanceLedger_->MarkDirty(wtx.GetHash());
+    if (wtx.IsCoinBase())
+        return;
+    for (const CTxIn& txin : wtx.vin)
+        balanceLedger_->MarkDirty(txin.prevout.hash);
+}
+
+/**
+ * Bring the balance ledger up to the active tip: rebuild it when requested or
+ * when the tip it was synced to has been reorganised away, otherwise recompute
+ * only the contributions that are dirty, volatile or due at this height.
+ */
+void CWallet::RefreshBalanceLedger() const
+{
+    AssertLockHeld(cs_wallet);
+    const CBlockIndex* tip = chainActive_.Tip();
+    const int height = tip ? tip->nHeight : -1;
+    const int syncedHeight = balanceLedger_->SyncedHeight();
+    if (syncedHeight >= 0 &&
+        (syncedHeight > height || chainActive_[syncedHeight]->GetBlockHash() != balanceLedger_->SyncedBlockHash()))
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!IsFinalTx(*pcoin, chainActive_) || (!IsTrusted(*pcoin) && pcoin->GetNumberOfBlockConfirmations() == 0))
-                nTotal += GetAvailableCredit(*pcoin);
+        balanceLedger_->MarkForRebuild();
+    }
+
+    if (balanceLedger_->NeedsRebuild())
+    {
+        balanceLedger_->Clear();
+        for (const auto& entry : transactionRecord_->mapWallet)
+            RecordBalanceContribution(entry.second);
+        balanceLedger_->MarkRebuilt();
+        LogPrint("wallet", "%s : rebuilt balances from %u transactions\n", __func__, balanceLedger_->size());
+    }
+    else
+    {
+        std::vector<uint256> txids;
+        balanceLedger_->TakeTransactionsToRefresh(height, txids);
+        for (const uint256& txid : txids)
+        {
+            const CWalletTx* wtx = GetWalletTx(txid);
+            if (wtx != nullptr)
+                RecordBalanceContribution(*wtx);
+            else
+                balanceLedger_->Remove(txid);
         }
     }
-    return nTotal;
-}
+    balanceLedger_->SetSyncedTip(height, tip ? tip->GetBlockHash() : uint256(0));
 
-CAmount CWallet::GetImmatureBalance() const
-{
-    CAmount nTotal = 0;
+    if (checkBalanceLedger_)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            nTotal += GetImmatureCredit(*pcoin);
+        const WalletBalances scanned = ComputeBalancesByFullScan();
+        if (scanned != balanceLedger_->Totals())
+        {
+            LogPrintf("%s : balance ledger (%s) differs from a full scan (%s)\n", __func__,
+                FormatMoney(balanceLedger_->Totals().trusted), FormatMoney(scanned.trusted));
         }
+        assert(scanned == balanceLedger_->Totals());
     }
-    return nTotal;
+}
+
+WalletBalances CWallet::ComputeBalancesByFullScan() const
+{
+    AssertLockHeld(cs_wallet);
+    WalletBalances balances;
+    for (const auto& entry : transactionRecord_->mapWallet)
+        balances += ComputeBalanceContribution(entry.second);
+    return balances;
+}
+
+WalletBalances CWallet::GetBalances() const
+{
+    AssertLockHeld(cs_wallet);
+    RefreshBalanceLedger();
+    return balanceLedger_->Totals();
 }
 
 CAmount CWallet::GetWatchOnlyBalance() const
@@ -1770,11 +1910,117 @@ static void ApproximateSmallestCoinSubsetForPayment(
     }
 }
 
+int CWallet::GetConfirmationHeight(const CWalletTx& wtx) const
+{
+    if (wtx.hashBlock == 0)
+        return StakableCoinIndex::UNCONFIRMED;
+    const auto mit = mapBlockIndex_.find(wtx.hashBlock);
+    if (mit == mapBlockIndex_.end() || !chainActive_.Contains(mit->second))
+        return StakableCoinIndex::UNCONFIRMED;
+    return mit->second->nHeight;
+}
+
+void CWallet::UpdateStakableCoinIndex(const CWalletTx& wtx, unsigned int outputIndex) const
+{
+    const COutPoint output(wtx.GetHash(), outputIndex);
+    isminetype mine;
+    VaultType vaultType;
+    if (!IsAvailableType(*this, wtx.vout[outputIndex].scriptPubKey, STAKABLE_COINS, mine, vaultType) ||
+        mine == ISMINE_NO || mine == ISMINE_WATCH_ONLY ||
+        wtx.vout[outputIndex].nValue <= 0 ||
+        outputTracker_->IsSpentInBlock(output.hash, output.n))
+    {
+        stakableCoins_->Remove(output);
+        return;
+    }
+    stakableCoins_->Update(output, GetConfirmationHeight(wtx));
+}
+
+/**
+ * Refresh the stakable coin index entries of a transaction's outputs and of
+ * the wallet outputs it spends. Spent outputs are only dropped once the
+ * spending transaction is in a block, since a mempool spend can still be
+ * conflicted away without the wallet hearing about the outputs again.
+ */
+void CWallet::UpdateStakableCoinIndex(const CWalletTx& wtx) const
+{
+    AssertLockHeld(cs_wallet);
+    if (stakableCoins_->NeedsRebuild())
+        return;
+
+    for (unsigned int i = 0; i < wtx.vout.size(); i++)
+        UpdateStakableCoinIndex(wtx, i);
+
+    for (const CTxIn& txin : wtx.vin) {
+        const CWalletTx* previousTx = GetWalletTx(txin.prevout.hash);
+        if (previousTx != nullptr && txin.prevout.n < previousTx->vout.size())
+            UpdateStakableCoinIndex(*previousTx, txin.prevout.n);
+    }
+}
+
+void CWallet::RebuildStakableCoinIndexIfNeeded() const
+{
+    AssertLockHeld(cs_wallet);
+    if (!stakableCoins_->NeedsRebuild())
+        return;
+
+    stakableCoins_->Clear();
+    for (const auto& entry : transactionRecord_->mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        for (unsigned int i = 0; i < wtx.vout.size(); i++)
+            UpdateStakableCoinIndex(wtx, i);
+    }
+    stakableCoins_->MarkRebuilt();
+    LogPrint("staking", "%s : indexed %u stakable outputs\n", __func__, stakableCoins_->size());
+}
+
+/**
+ * Equivalent to AvailableCoins(vCoins, true, false, STAKABLE_COINS) restricted to
+ * outputs with at least minimumDepth confirmations, but only visits the outputs
+ * in the stakable coin index. Also reports the spendable value of those outputs.
+ */
+void CWallet::StakableCoins(std::vector<COutput>& vCoins, int minimumDepth, CAmount& stakableBalance) const
+{
+    vCoins.clear();
+    stakableBalance = 0;
+
+    LOCK2(cs_main, cs_wallet);
+    RebuildStakableCoinIndexIfNeeded();
+
+    // Outputs not known to be confirmed are re-checked, in case they got into a block since they were indexed
+    std::vector<COutPoint> candidates;
+    stakableCoins_->GetOutputsConfirmedAtOrBelow(chainActive_.Height() - minimumDepth + 1, candidates);
+    stakableCoins_->GetUnconfirmedOutputs(candidates);
+
+    const CWalletTx* pcoin = nullptr;
+    int nDepth = 0;
+    bool satisfiesDepthRequirements = false;
+    for (const COutPoint& output : candidates) {
+        if (pcoin == nullptr || pcoin->GetHash() != output.hash) {
+            pcoin = GetWalletTx(output.hash);
+            if (pcoin == nullptr)
+                continue;
+            satisfiesDepthRequirements = SatisfiesMinimumDepthRequirements(pcoin, nDepth, true);
+        }
+        if (!satisfiesDepthRequirements)
+            continue;
+
+        bool fIsSpendable = false;
+        if (!IsAvailableForSpending(pcoin, output.n, false, fIsSpendable, STAKABLE_COINS))
+            continue;
+
+        if (IsMine(pcoin->vout[output.n]) & ISMINE_SPENDABLE)
+            stakableBalance += pcoin->vout[output.n].nValue;
+        vCoins.emplace_back(COutput(pcoin, output.n, nDepth, fIsSpendable));
+    }
+}
+
 bool CWallet::SelectStakeCoins(std::set<StakableCoin>& setCoins) const
 {
-    CAmount nTargetAmount = GetStakingBalance();
+    static const int minimumStakingDepth = 10;
+    CAmount nTargetAmount = 0;
     std::vector<COutput> vCoins;
-    AvailableCoins(vCoins, true, false, STAKABLE_COINS);
+    StakableCoins(vCoins, minimumStakingDepth, nTargetAmount);
     CAmount nAmountSelected = 0;
 
     for (const COutput& out : vCoins) {
@@ -1793,7 +2039,7 @@ bool CWallet::SelectStakeCoins(std::set<StakableCoin>& setCoins) const
             continue;
 
         //check that it is matured
-        if (out.nDepth < (out.tx->IsCoinStake() ? Params().COINBASE_MATURITY() : 10))
+        if (out.nDepth < (out.tx->IsCoinStake() ? Params().COINBASE_MATURITY() : minimumStakingDepth))
             continue;
 
         //add to our stake set
@@ -1805,11 +2051,11 @@ bool CWallet::SelectStakeCoins(std::set<StakableCoin>& setCoins) const
 
 bool CWallet::MintableCoins()
 {
-    if (GetStakingBalance() <= 0)
-        return false;
-
+    CAmount stakableBalance = 0;
     std::vector<COutput> vCoins;
-    AvailableCoins(vCoins, true, false, STAKABLE_COINS);
+    StakableCoins(vCoins, 1, stakableBalance);
+    if (stakableBalance <= 0)
+        return false;
 
     for (const COutput& out : vCoins) {
         int64_t nTxTime = out.tx->GetTxTime();
@@ -2334,6 +2580,8 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
     if (nLoadWalletRet != DB_LOAD_OK)
         return nLoadWalletRet;
     fFirstRunRet = !vchDefaultKey.IsValid();
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
 
     uiInterface.LoadWallet(this);
 
@@ -2361,6 +2609,8 @@ DBErrors CWallet::ZapWalletTx(std::vector<CWalletTx>& vWtx)
 
     if (nZapWalletTxRet != DB_LOAD_OK)
         return nZapWalletTxRet;
+    stakableCoins_->MarkForRebuild();
+    balanceLedger_->MarkForRebuild();
 
     return DB_LOAD_OK;
 }
@@ -2817,18 +3067,21 @@ void CWallet::LockCoin(const COutPoint& output)
     setLockedCoins.insert(output);
     CWalletTx* txPtr = const_cast<CWalletTx*>(GetWalletTx(output.hash));
     if (txPtr != nullptr) txPtr->RecomputeCachedQuantities(); // recalculate all credits for this tx
+    balanceLedger_->MarkDirty(output.hash);
 }
 
 void CWallet::UnlockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    balanceLedger_->MarkDirty(output.hash);
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    balanceLedger_->MarkForRebuild();
 }
 
 bool CWallet::IsLockedCoin(const uint256& hash, unsigned int n) const
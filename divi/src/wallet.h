@@ -38,6 +38,9 @@ class CBlockIndex;
 struct StakableCoin;
 class WalletTransactionRecord;
 class SpentOutputTracker;
+class StakableCoinIndex;
+class WalletBalanceLedger;
+struct WalletBalances;
 class BlockMap;
 class CAccountingEntry;
 class CChain;
@@ -121,6 +124,9 @@ public:
 private:
     std::unique_ptr<WalletTransactionRecord> transactionRecord_;
     std::unique_ptr<SpentOutputTracker> outputTracker_;
+    std::unique_ptr<StakableCoinIndex> stakableCoins_;
+    std::unique_ptr<WalletBalanceLedger> balanceLedger_;
+    bool checkBalanceLedger_;
     const CChain& chainActive_;
     const BlockMap& mapBlockIndex_;
     int64_t orderedTransactionIndex;
@@ -162,6 +168,20 @@ public:
 private:
     void DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal /*= false*/);
 
+    int GetConfirmationHeight(const CWalletTx& wtx) const;
+    void UpdateStakableCoinIndex(const CWalletTx& wtx, unsigned int outputIndex) const;
+    void UpdateStakableCoinIndex(const CWalletTx& wtx) const;
+    void RebuildStakableCoinIndexIfNeeded() const;
+    void StakableCoins(std::vector<COutput>& vCoins, int minimumDepth, CAmount& stakableBalance) const;
+
+    WalletBalances ComputeBalanceContribution(const CWalletTx& wtx) const;
+    bool BalanceContributionIsVolatile(const CWalletTx& wtx) const;
+    void RecordBalanceContribution(const CWalletTx& wtx) const;
+    void MarkBalanceLedgerDirty(const CWalletTx& wtx) const;
+    void RefreshBalanceLedger() const;
+    WalletBalances ComputeBalancesByFullScan() const;
+    WalletBalances GetBalances() const;
+
 public:
     bool MoveFundsBetweenAccounts(std::string from, std::string to, CAmount amount, std::string comment);
 
@@ -306,6 +326,8 @@ public:
     CAmount GetBalanceByCoinType(AvailableCoinsType coinType) const;
     CAmount GetSpendableBalance() const;
     CAmount GetStakingBalance() const;
+    /** Grows whenever the balances above may have changed other than by the tip moving */
+    uint64_t GetBalanceChangeCount() const;
 
     CAmount GetChange(const CWalletTx& walletTransaction) const;
     CAmount GetAvailableWatchOnlyCredit(const CWalletTx& walletTransaction, const bool& fUseCache = true) const;